@@ -26,6 +26,7 @@
 
 extern int RETARGET_ReadChar(void);
 extern int RETARGET_WriteChar(char c);
+extern int RETARGET_Write(const char *ptr, int len);
 
 #if !defined(__CROSSWORKS_ARM) && defined(__GNUC__)
 
@@ -245,20 +246,13 @@ caddr_t _sbrk(int incr)
  *  Number of characters to be written.
  *
  * @return
- *  Number of characters that have been written.
+ *  Number of characters that have been written, or -1 if none could be.
  *****************************************************************************/
 int _write(int file, const char *ptr, int len)
 {
-  int txCount;
-
   (void) file;
 
-  for (txCount = 0; txCount < len; txCount++)
-  {
-    RETARGET_WriteChar(*ptr++);
-  }
-
-  return len;
+  return RETARGET_Write(ptr, len);
 }
 #endif /* !defined( __CROSSWORKS_ARM ) && defined( __GNUC__ ) */
 
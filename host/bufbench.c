@@ -0,0 +1,218 @@
+/******************************************************************************
+ * @file bufbench.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "buffer.h"
+
+/***************************************************************************//**
+ * @defgroup Bufbench
+ * @brief Throughput of the circular buffer API, per byte against bulk
+ * @details
+ * 		Usage: bufbench
+ *
+ * 		Moves the same data through a buffer the size of the serial TX
+ * 		buffer, in chunks of several sizes, with buf_write_byte() and
+ * 		buf_read_byte(), with buf_write() and buf_read(), and with the
+ * 		span calls, and prints bytes per cycle for each. Cycles are from
+ * 		the time stamp counter on x86, otherwise they are nanoseconds.
+ * 		Exits non-zero if any API corrupts the data.
+ * @{
+ ******************************************************************************/
+
+#define BUFBENCH_BUF_SIZE   1024  // as demo_serial.c's TX buffer
+#define BUFBENCH_TOTAL      (16 * 1024 * 1024)
+#define BUFBENCH_MAX_CHUNK  256
+
+static uint8_t raw_buf[BUF_RAW_SIZE(BUFBENCH_BUF_SIZE)];
+static uint8_t src[BUFBENCH_MAX_CHUNK];
+static uint8_t dst[BUFBENCH_MAX_CHUNK];
+
+typedef bool bufbench_fn_t(buf_t *buf, size_t chunk);
+
+/***************************************************************************//**
+ * @brief
+ *   Current cycle count, or nanoseconds where there is no cycle counter
+ ******************************************************************************/
+static uint64_t bufbench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, & ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Move one chunk through the buffer a byte at a time
+ ******************************************************************************/
+static bool bufbench_bytes(buf_t *buf, size_t chunk)
+{
+	size_t i;
+
+	for (i = 0; i < chunk; i++)
+		buf_write_byte(buf, src[i]);
+	for (i = 0; i < chunk; i++)
+		buf_read_byte(buf, & dst[i]);
+	return memcmp(src, dst, chunk) == 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Move one chunk through the buffer with the bulk calls
+ ******************************************************************************/
+static bool bufbench_bulk(buf_t *buf, size_t chunk)
+{
+	if (buf_write(buf, src, chunk) != chunk)
+		return false;
+	if (buf_read(buf, dst, chunk) != chunk)
+		return false;
+	return memcmp(src, dst, chunk) == 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Move one chunk through the buffer with the span calls
+ ******************************************************************************/
+static bool bufbench_span(buf_t *buf, size_t chunk)
+{
+	uint8_t *span;
+	size_t done;
+	size_t n;
+
+	for (done = 0; done < chunk; done += n)
+	{
+		n = buf_write_span(buf, & span);
+		if (n == 0)
+			return false;
+		if (n > chunk - done)
+			n = chunk - done;
+		memcpy(span, & src[done], n);
+		buf_write_commit(buf, n);
+	}
+	for (done = 0; done < chunk; done += n)
+	{
+		n = buf_read_span(buf, & span);
+		if (n == 0)
+			return false;
+		if (n > chunk - done)
+			n = chunk - done;
+		memcpy(& dst[done], span, n);
+		buf_read_consume(buf, n);
+	}
+	return memcmp(src, dst, chunk) == 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time moving BUFBENCH_TOTAL bytes through the buffer
+ * @param[in] *fn
+ * 		Function moving one chunk
+ * @param[in] chunk
+ * 		Chunk size
+ * @param[out] *bytes_per_cycle
+ * 		Result
+ * @return TRUE if the data came out as it went in
+ ******************************************************************************/
+static bool bufbench_run(bufbench_fn_t *fn, size_t chunk, double *bytes_per_cycle)
+{
+	buf_t *buf = init_buf(raw_buf, sizeof(raw_buf));
+	uint64_t start = 0;
+	uint64_t cycles;
+	size_t moved;
+	size_t i;
+
+	for (moved = 0; moved < BUFBENCH_TOTAL; moved += chunk)
+	{
+		if (moved == BUFBENCH_TOTAL / 16)
+			start = bufbench_cycles();  // after warming up
+		for (i = 0; i < chunk; i++)
+			src[i] = moved + i;
+		if (! fn(buf, chunk))
+			return false;
+	}
+	cycles = bufbench_cycles() - start;
+	*bytes_per_cycle = (double) (BUFBENCH_TOTAL - BUFBENCH_TOTAL / 16) / (cycles ? cycles : 1);
+	return true;
+}
+
+int main(void)
+{
+	static const size_t chunks[] = { 1, 4, 16, 64, 256 };
+	static const struct
+	{
+		const char *name;
+		bufbench_fn_t *fn;
+	} apis[] =
+	{
+		{ "byte", bufbench_bytes },
+		{ "bulk", bufbench_bulk },
+		{ "span", bufbench_span },
+	};
+	double result[3];
+	bool ok = true;
+	unsigned int i;
+	int j;
+
+#if defined(__x86_64__) || defined(__i386__)
+	printf("bytes/cycle, %d byte buffer\n", BUFBENCH_BUF_SIZE);
+#else
+	printf("bytes/ns, %d byte buffer\n", BUFBENCH_BUF_SIZE);
+#endif
+	printf("  %5s %8s %8s %8s %8s\n", "chunk", "byte", "bulk", "span", "bulk x");
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			if (! bufbench_run(apis[j].fn, chunks[i], & result[j]))
+			{
+				printf("  %5zu %s: data corrupted\n", chunks[i], apis[j].name);
+				ok = false;
+				result[j] = 0;
+			}
+		}
+		printf("  %5zu %8.3f %8.3f %8.3f %8.1f\n", chunks[i],
+			   result[0], result[1], result[2], result[0] ? result[1] / result[0] : 0.0);
+	}
+	return ok ? 0 : 1;
+}
+
+/** @} (end defgroup Bufbench) */
@@ -0,0 +1,231 @@
+/******************************************************************************
+ * @file bufstress.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "buffer.h"
+
+/***************************************************************************//**
+ * @defgroup Bufstress
+ * @brief Concurrent test of the circular buffer, one writer and one reader
+ * @details
+ * 		Usage: bufstress
+ *
+ * 		A writer thread and a reader thread, standing in for the thread
+ * 		and the serial interrupt handler, move a numbered byte stream
+ * 		through a small buffer as fast as they can, with no locking. Each
+ * 		side picks byte, bulk or span calls and a length from its own
+ * 		random sequence, so the indices wrap and the buffer runs both
+ * 		full and empty many times. The reader checks every byte, and the
+ * 		test exits non-zero at the first one out of sequence.
+ * @{
+ ******************************************************************************/
+
+#define BUFSTRESS_BUF_SIZE  64
+#define BUFSTRESS_TOTAL     (64u * 1024 * 1024)
+#define BUFSTRESS_MAX_CHUNK 100  // more than the buffer holds
+
+static uint8_t raw_buf[BUF_RAW_SIZE(BUFSTRESS_BUF_SIZE)];
+static buf_t *buf;
+
+static volatile bool failed;
+static uint32_t fail_offset;
+static uint64_t full_count;
+static uint64_t empty_count;
+
+/***************************************************************************//**
+ * @brief
+ *   Byte at a given offset in the stream
+ ******************************************************************************/
+static uint8_t bufstress_byte(uint32_t offset)
+{
+	return (offset * 7) ^ (offset >> 8);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Next from a xorshift32 sequence
+ ******************************************************************************/
+static uint32_t bufstress_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Writer thread
+ ******************************************************************************/
+static void *bufstress_writer(void *arg)
+{
+	(void) arg;
+
+	uint8_t chunk[BUFSTRESS_MAX_CHUNK];
+	uint32_t state = 0x12345678;
+	uint32_t offset = 0;
+	uint8_t *span;
+	size_t len;
+	size_t n;
+	size_t i;
+
+	while (offset < BUFSTRESS_TOTAL && ! failed)
+	{
+		uint32_t r = bufstress_random(& state);
+
+		len = 1 + (r >> 8) % BUFSTRESS_MAX_CHUNK;
+		if (len > BUFSTRESS_TOTAL - offset)
+			len = BUFSTRESS_TOTAL - offset;
+		switch (r % 3)
+		{
+		case 0:
+			for (i = 0; i < len; i++)
+				if (! buf_write_byte(buf, bufstress_byte(offset + i)))
+					break;
+			n = i;
+			break;
+		case 1:
+			for (i = 0; i < len; i++)
+				chunk[i] = bufstress_byte(offset + i);
+			n = buf_write(buf, chunk, len);
+			break;
+		default:
+			n = buf_write_span(buf, & span);
+			if (n > len)
+				n = len;
+			for (i = 0; i < n; i++)
+				span[i] = bufstress_byte(offset + i);
+			buf_write_commit(buf, n);
+			break;
+		}
+		if (n < len)
+			full_count++;
+		if (n == 0)
+			sched_yield();  // let the reader run on a single core
+		offset += n;
+	}
+	return NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reader thread
+ ******************************************************************************/
+static void *bufstress_reader(void *arg)
+{
+	(void) arg;
+
+	uint8_t chunk[BUFSTRESS_MAX_CHUNK];
+	uint32_t state = 0x9abcdef0;
+	uint32_t offset = 0;
+	uint8_t *span;
+	size_t len;
+	size_t n;
+	size_t i;
+
+	while (offset < BUFSTRESS_TOTAL)
+	{
+		uint32_t r = bufstress_random(& state);
+
+		len = 1 + (r >> 8) % BUFSTRESS_MAX_CHUNK;
+		switch (r % 3)
+		{
+		case 0:
+			for (n = 0; n < len; n++)
+				if (! buf_read_byte(buf, & chunk[n]))
+					break;
+			break;
+		case 1:
+			n = buf_read(buf, chunk, len);
+			break;
+		default:
+			n = buf_read_span(buf, & span);
+			if (n > len)
+				n = len;
+			memcpy(chunk, span, n);
+			buf_read_consume(buf, n);
+			break;
+		}
+		if (n < len)
+			empty_count++;
+		if (n == 0)
+			sched_yield();
+		for (i = 0; i < n; i++)
+		{
+			if (chunk[i] != bufstress_byte(offset + i))
+			{
+				fail_offset = offset + i;
+				failed = true;
+				return NULL;
+			}
+		}
+		offset += n;
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t writer;
+	pthread_t reader;
+
+	buf = init_buf(raw_buf, sizeof(raw_buf));
+	pthread_create(& reader, NULL, bufstress_reader, NULL);
+	pthread_create(& writer, NULL, bufstress_writer, NULL);
+	pthread_join(writer, NULL);
+	pthread_join(reader, NULL);
+
+	if (failed)
+	{
+		printf("data corrupted at offset %" PRIu32 "\n", fail_offset);
+		return 1;
+	}
+	if (! buf_empty(buf))
+	{
+		printf("data left over\n");
+		return 1;
+	}
+	printf("%u bytes through a %d byte buffer, %" PRIu64 " times full, %" PRIu64 " times empty\n",
+		   BUFSTRESS_TOTAL, BUFSTRESS_BUF_SIZE, full_count, empty_count);
+	return 0;
+}
+
+/** @} (end defgroup Bufstress) */
@@ -0,0 +1,254 @@
+/******************************************************************************
+ * @file dumpbench.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE  // fopencookie()
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "buffer.h"
+#include "hex_dump.h"
+#include "serial.h"
+
+/***************************************************************************//**
+ * @defgroup Dumpbench
+ * @brief Cost of hex_dump() against the printf() formatter it replaced
+ * @details
+ * 		Usage: dumpbench
+ *
+ * 		Formats the same data with each, into a buffer the size of the
+ * 		serial TX buffer which is emptied whenever it fills, as the
+ * 		serial interrupt would. printf() output reaches it as on the
+ * 		board: line buffered, then a byte at a time, as _write() calls
+ * 		RETARGET_WriteChar(). hex_dump() output reaches it through
+ * 		serial_blocking_write(). Prints cycles per KiB dumped, from the
+ * 		time stamp counter on x86, otherwise nanoseconds. Exits non-zero
+ * 		if the two differ in output with no flags.
+ * @{
+ ******************************************************************************/
+
+#define DUMPBENCH_TX_SIZE 1024  // as demo_serial.c's TX buffer
+#define DUMPBENCH_CHUNK   256   // as demo_serial_dump()
+#define DUMPBENCH_TOTAL   (4 * 1024 * 1024)
+#define DUMPBENCH_CAPTURE (64 * 1024)
+
+static uint8_t raw_tx_buf[BUF_RAW_SIZE(DUMPBENCH_TX_SIZE)];
+static buf_t *tx_buf;
+
+static uint8_t data[DUMPBENCH_CHUNK * 16];
+
+static char capture[DUMPBENCH_CAPTURE];  // output, while capturing
+static size_t capture_len;
+static bool capturing;
+
+typedef void dumpbench_fn_t(const uint8_t *buf, size_t len, uint32_t addr, unsigned int flags);
+
+/***************************************************************************//**
+ * @brief
+ *   Current cycle count, or nanoseconds where there is no cycle counter
+ ******************************************************************************/
+static uint64_t dumpbench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, & ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Empty the TX buffer, as the serial interrupt would
+ ******************************************************************************/
+static void dumpbench_drain(void)
+{
+	uint8_t *span;
+	size_t n;
+
+	while ((n = buf_read_span(tx_buf, & span)) != 0)
+	{
+		if (capturing && (capture_len + n <= sizeof(capture)))
+			memcpy(& capture[capture_len], span, n);
+		capture_len += n;
+		buf_read_consume(tx_buf, n);
+	}
+}
+
+// serial.c, for hex_dump()
+void serial_blocking_write(const uint8_t *p, size_t len)
+{
+	size_t n;
+
+	while (len)
+	{
+		n = buf_write(tx_buf, p, len);
+		if (n == 0)
+			dumpbench_drain();
+		p += n;
+		len -= n;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   _write() of retargetio.c, for printf()
+ ******************************************************************************/
+static ssize_t dumpbench_retarget_write(void *cookie, const char *p, size_t len)
+{
+	(void) cookie;
+
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		while (! buf_write_char(tx_buf, p[i]))
+			dumpbench_drain();
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   hex_dump() as it was, one printf() per byte
+ ******************************************************************************/
+static void dumpbench_printf(const uint8_t *buf, size_t len, uint32_t addr_offset, unsigned int flags)
+{
+	(void) flags;
+
+	uint32_t i;
+	int j;
+
+	for (i = 0; i < len; i += 16)
+	{
+		printf("%08" PRIx32 ":", addr_offset + i);
+		for (j = 0; j < 16; j++)
+		{
+			if (i + j < len)
+				printf(" %02" PRIx8 "", buf[i+j]);
+			else
+				printf("   ");
+		}
+		printf("\r\n");
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Dump len bytes of data, a chunk at a time as demo_serial_dump()
+ ******************************************************************************/
+static void dumpbench_dump(dumpbench_fn_t *fn, size_t len, unsigned int flags)
+{
+	size_t done;
+
+	for (done = 0; done < len; done += DUMPBENCH_CHUNK)
+		fn(& data[done % sizeof(data)], DUMPBENCH_CHUNK, done,
+		   (done ? HEX_DUMP_CONTINUED : 0) | ((done + DUMPBENCH_CHUNK < len) ? HEX_DUMP_MORE : 0) | flags);
+	fflush(stdout);
+	dumpbench_drain();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Cycles per KiB to dump DUMPBENCH_TOTAL bytes
+ ******************************************************************************/
+static double dumpbench_run(dumpbench_fn_t *fn, unsigned int flags)
+{
+	uint64_t start;
+
+	dumpbench_dump(fn, DUMPBENCH_TOTAL / 16, flags);  // warm up
+	start = dumpbench_cycles();
+	dumpbench_dump(fn, DUMPBENCH_TOTAL, flags);
+	return (double) (dumpbench_cycles() - start) / (DUMPBENCH_TOTAL / 1024);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Capture the output of a dump of the start of data
+ ******************************************************************************/
+static size_t dumpbench_capture(dumpbench_fn_t *fn, char *out, unsigned int flags)
+{
+	capturing = true;
+	capture_len = 0;
+	dumpbench_dump(fn, sizeof(data), flags);
+	capturing = false;
+	memcpy(out, capture, capture_len);
+	return capture_len;
+}
+
+int main(void)
+{
+	static cookie_io_functions_t retarget = { .write = dumpbench_retarget_write };
+	static char expected[DUMPBENCH_CAPTURE];
+	FILE *console = stdout;
+	size_t expected_len;
+	double old;
+	double result;
+	bool ok;
+	size_t i;
+
+	tx_buf = init_buf(raw_tx_buf, sizeof(raw_tx_buf));
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (i < sizeof(data) / 2) ? (i * 7) : 0xff;  // half erased, for repeats
+
+	stdout = fopencookie(NULL, "w", retarget);
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	expected_len = dumpbench_capture(dumpbench_printf, expected, 0);
+	ok = (dumpbench_capture(hex_dump, capture, 0) == expected_len) &&
+		 (memcmp(capture, expected, expected_len) == 0);
+
+	old = dumpbench_run(dumpbench_printf, 0);
+	fprintf(console, "%s per KiB dumped, %d byte chunks\n",
+#if defined(__x86_64__) || defined(__i386__)
+			"cycles",
+#else
+			"ns",
+#endif
+			DUMPBENCH_CHUNK);
+	fprintf(console, "  %-24s %10.0f\n", "printf", old);
+	result = dumpbench_run(hex_dump, 0);
+	fprintf(console, "  %-24s %10.0f %6.1fx\n", "hex_dump", result, old / result);
+	result = dumpbench_run(hex_dump, HEX_DUMP_ASCII);
+	fprintf(console, "  %-24s %10.0f %6.1fx\n", "hex_dump ASCII", result, old / result);
+	result = dumpbench_run(hex_dump, HEX_DUMP_ASCII | HEX_DUMP_SKIP_REPEATS);
+	fprintf(console, "  %-24s %10.0f %6.1fx\n", "hex_dump ASCII, repeats", result, old / result);
+	if (! ok)
+		fprintf(console, "hex_dump output differs from printf\n");
+	return ok ? 0 : 1;
+}
+
+/** @} (end defgroup Dumpbench) */
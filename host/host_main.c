@@ -0,0 +1,639 @@
+/******************************************************************************
+ * @file host_main.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE  // fopencookie()
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "em_emu.h"
+
+#include "bench.h"
+#include "console.h"
+#include "demo_serial.h"
+#include "serial.h"
+#include "main.h"
+#include "sim_clock.h"
+#include "sim_flash.h"
+#include "spiflash.h"
+#include "spi_trace.h"
+#include "workload.h"
+
+/***************************************************************************//**
+ * @defgroup Host
+ * @brief Runs the demo workloads against each simulated part
+ * @details
+ * 		Usage: flashsim [-t trace_dir] [part ...]
+ * 		       flashsim -c [part] < commands
+ *
+ * 		For each part (all by default), runs the demos as though selected
+ * 		from the menus, and prints their results with p99 operation
+ * 		latency, estimated MCU energy, simulated times and flash command
+ * 		counts. Then compares the driver's duration estimates with
+ * 		simulated durations. Last, runs the serial demo waiting for the
+ * 		port in EM0, then asleep, and prints the energy of each. Each
+ * 		part runs in its own process, so it starts from power-up with
+ * 		the demo's initial state. Exits
+ * 		non-zero if a demo fails or the driver sends a command the part
+ * 		would ignore for being busy, or doesn't know.
+ *
+ * 		WKLD runs are followed by the workload generator's operation count
+ * 		and hash, which match those of the same run on the board.
+ *
+ * 		With -c, runs serial console commands from stdin on one part (the
+ * 		first by default) instead, e.g. to try a script for the board, or
+ * 		from ../tools/flashlink.py --sim.
+ *
+ * 		With -t, the SPI trace of each demo is written to trace_dir, as
+ * 		it would be sent by the TRACE menu item.
+ * @{
+ ******************************************************************************/
+
+extern spiflash_id_t part;  // detected part, in main.c
+extern uint32_t spi_freq;  // SPI clock in Hz, in main.c
+extern FILE *sim_serial_file;  // serial output, in sim_board.c
+extern FILE *sim_serial_input;  // serial input, in sim_board.c
+extern FILE *sim_serial_clock;  // simulated time when waiting for input, in sim_board.c
+extern bool sim_serial_spin;  // wait for TX room in EM0, in sim_board.c
+extern bool sim_spi_prefix_separate;  // charge prefixes as transactions, in sim_spi.c
+
+#define HOST_USAGE "usage: %s [-t trace_dir] [part ...]\n" \
+                   "       %s -c [-s] [part] < commands\n"
+
+static const char *host_trace_dir;
+
+typedef struct
+{
+	const char *demo;
+	int32_t choice;
+	const char *config;  // CONFIG item set for this demo only, or NULL
+	int32_t value;
+	int32_t reset;       // value restored afterwards
+	uint32_t idle_ms;    // left idle in the menu first, as on the board
+} host_workload_t;
+
+static const host_workload_t host_workloads[] =
+{
+	{ "ERA",       64, NULL,       0, 0,    0 },
+	{ "WRITE",     64, "VFY",      1, 0,    0 },
+	{ "READ",      64, "VFY",      1, 0,    0 },
+	{ "WRITE",     64, NULL,       0, 0,    0 },
+	{ "READ",      64, NULL,       0, 0,    0 },
+	{ "WRITE",     64, "QUE",      1, 0,    0 },
+	{ "READ",      64, "QUE",      1, 0,    0 },
+	{ "WRITE",     16, "VFY",      1, 0,    0 },
+	{ "WRITE",     16, "PULL",     1, 0,    0 },
+	{ "WRITE",     64, "PULL",     1, 0,    0 },
+	{ "WRITE",    256, "VFY",      1, 0,    0 },
+	{ "WRITE",    256, "PULL",     1, 0,    0 },
+	{ "WRITE",     64, "SO",       1, 0,    0 },
+	{ "READ",      16, "ITER",    16, 1,    0 },
+	{ "WKLD",      64, NULL,       0, 0,    0 },
+	{ "WKLD",      64, "DIST",     1, 0,    0 },
+	{ "WKLD",      64, "DIST",     2, 0,    0 },
+	{ "WKLD",      64, "DIST",     3, 0,    0 },
+	{ "WKLD",      64, "ER PCT",   1, 0,    0 },
+	{ "WKLD",     256, "REQ MAX", 16, 8,    0 },
+	{ "RMW",      100, NULL,       0, 0,    0 },
+	{ "APPL",      16, NULL,       0, 0,    0 },
+	{ "LOG",        1, NULL,       0, 0,    0 },
+	{ "LOG",        1, "QUE",      1, 0,    0 },
+	{ "BURST",     16, "ERA SZ",   0, 0, 2000 },
+	{ "JRNL",      64, NULL,       0, 0,    0 },
+	{ "JRNL",      16, "ERA SZ",   0, 0,    0 },
+	{ "KV",      1024, NULL,       0, 0,    0 },
+	{ "KV",      4096, NULL,       0, 0,    0 },
+	{ "FTL",      256, NULL,       0, 0,    0 },
+	{ "FTL",     4096, NULL,       0, 0,    0 },
+	{ "POWERDN",    0, NULL,       0, 0,    0 },
+	{ "POWERDN",    1, NULL,       0, 0,    0 },
+	{ "PROT",       0, NULL,       0, 0,    0 },
+	{ "PROT",       1, NULL,       0, 0,    0 },
+	{ "CAL",        0, NULL,       0, 0,    0 },
+};
+
+#define HOST_WORKLOAD_COUNT (sizeof(host_workloads) / sizeof(host_workload_t))
+
+/***************************************************************************//**
+ * @brief
+ *   Find a part by name
+ * @param[in] *name
+ * 		Part name, as in spiflash_info_table
+ * @return Part, or PART_UNKNOWN
+ ******************************************************************************/
+static spiflash_id_t host_part_by_name(const char *name)
+{
+	int i;
+
+	for (i = 0; i < PART_UNKNOWN; i++)
+		if (strcmp(spiflash_info_table[i].name, name) == 0)
+			return i;
+	return PART_UNKNOWN;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the SPI trace of the last demo to the trace directory
+ * @param[in] index
+ * 		Workload number, for the file name
+ * @param[in] *w
+ * 		Workload
+ ******************************************************************************/
+static void host_write_trace(unsigned int index, const host_workload_t *w)
+{
+	char path[256];
+
+	snprintf(path, sizeof(path), "%s/%s-%02u-%s.bin",
+			 host_trace_dir, spiflash_info_table[part].name, index, w->demo);
+	sim_serial_file = fopen(path, "wb");
+	if (! sim_serial_file)
+	{
+		perror(path);
+		return;
+	}
+	spi_trace_dump();
+	fclose(sim_serial_file);
+	sim_serial_file = NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run one demo and print its result
+ * @param[in] index
+ * 		Workload number
+ * @param[in] *w
+ * 		Workload
+ * @return TRUE if the demo passed
+ ******************************************************************************/
+static bool host_run_workload(unsigned int index, const host_workload_t *w)
+{
+	const sim_flash_stats_t *stats = sim_flash_stats();
+	char config[20] = "-";
+	char fw_ms[16] = "-";
+	uint64_t start;
+	uint64_t sim_us;
+	uint32_t ignored;
+	bench_result_t bench;
+	char p99_us[16] = "-";
+	char uj_per_kib[16] = "-";
+	bool ok = true;
+
+	// a choice the part doesn't offer leaves the demo's default
+	if (w->config && demo_set_config(w->config, w->value))
+		snprintf(config, sizeof(config), "%s=%" PRId32, w->config, w->value);
+
+	if (w->idle_ms)
+		demo_idle_state(w->demo, w->idle_ms);
+
+	sim_flash_clear_stats();
+	duration = -1;
+	message_text = "";
+	message_number = 0;
+	start = sim_now_ns();
+
+	if (! demo_run_state(w->demo, w->choice))
+	{
+		printf("  %-7s %4" PRId32 "  not available\n", w->demo, w->choice);
+		ok = false;
+	}
+	else
+	{
+		sim_us = (sim_now_ns() - start) / 1000;
+		if (duration >= 0)
+			snprintf(fw_ms, sizeof(fw_ms), "%d", duration);
+		bench_get_result(& bench);
+		if (bench.ops)
+			snprintf(p99_us, sizeof(p99_us), "%" PRIu32, bench.lat_p99_us);
+		if (bench.bytes)
+			snprintf(uj_per_kib, sizeof(uj_per_kib), "%" PRIu32 ".%02" PRIu32,
+					 bench.nj_per_kib / 1000, (bench.nj_per_kib % 1000) / 10);
+		ignored = stats->ignored_busy + stats->ignored_power_down + stats->ignored_no_wel +
+				  stats->ignored_protected + stats->unknown;
+
+		if ((strcmp(message_text, "DataErr") == 0) || (strcmp(message_text, "ReadErr") == 0))
+			ok = false;
+		if (stats->ignored_busy || stats->unknown)
+			ok = false;
+
+		printf("  %-7s %4" PRId32 " %-10s %-8.8s %5d %7s %7s %7s %9" PRIu64 ".%03" PRIu64 " %6" PRIu32 " %6" PRIu32 " %6" PRIu32 " %5" PRIu32 " %4" PRIu32 "%s\n",
+			   w->demo, w->choice, config,
+			   message_text, message_number,
+			   p99_us, uj_per_kib, fw_ms,
+			   sim_us / 1000, sim_us % 1000,
+			   stats->programs, stats->erases, stats->status_reads,
+			   stats->early_after_wake, ignored,
+			   ok ? "" : "  FAIL");
+		if (strcmp(w->demo, "WKLD") == 0)
+			printf("         workload ops %" PRIu32 ", hash %08" PRIx32 "\n",
+				   workload_op_count(), workload_hash());
+		if (host_trace_dir)
+			host_write_trace(index, w);
+		if (ignored)
+			printf("         ignored: busy %" PRIu32 ", power down %" PRIu32 ", no WEL %" PRIu32
+				   ", protected %" PRIu32 ", unknown %" PRIu32 "\n",
+				   stats->ignored_busy, stats->ignored_power_down, stats->ignored_no_wel,
+				   stats->ignored_protected, stats->unknown);
+	}
+
+	if (w->config)
+		demo_set_config(w->config, w->reset);
+	return ok;
+}
+
+// How far a driver estimate may be from the simulated duration. The model
+// takes the same datasheet times from its own table, so this checks the
+// estimator's arithmetic rather than the times.
+#define HOST_ESTIMATE_TOLERANCE_PCT 5
+
+// SPI clocks at which the estimates are checked: the board's 2 and 12 MHz
+// settings, and 1 MHz, where command and transfer time count for more
+static const uint32_t host_estimate_bit_rates[] = { 1000000, 2000000, 12000000 };
+
+/***************************************************************************//**
+ * @brief
+ *   Print an estimate against the simulated duration
+ * @param[in] *what
+ * 		Operation
+ * @param[in] estimate_us
+ * 		Driver estimate
+ * @param[in] start
+ * 		Simulated start time, in ns
+ * @return true if the estimate is within HOST_ESTIMATE_TOLERANCE_PCT
+ ******************************************************************************/
+static bool host_print_estimate(const char *what, uint32_t estimate_us, uint64_t start)
+{
+	uint64_t sim_us = (sim_now_ns() - start) / 1000;
+	uint64_t diff = (estimate_us > sim_us) ? estimate_us - sim_us : sim_us - estimate_us;
+	bool ok = diff * 100 <= sim_us * HOST_ESTIMATE_TOLERANCE_PCT;
+
+	printf("  %-16s %12" PRIu32 " %12" PRIu64 " %7.2f%s\n",
+		   what, estimate_us, sim_us,
+		   sim_us ? (double) estimate_us / sim_us : 0.0,
+		   ok ? "" : "  out of tolerance");
+	return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Compare the driver's duration estimates with the simulation
+ * @param[in] worst_case
+ * 		If true, compare worst case estimates with the model running at
+ * 		the datasheet maximum times
+ * @return true if all are within HOST_ESTIMATE_TOLERANCE_PCT
+ ******************************************************************************/
+static bool host_check_estimates(bool worst_case)
+{
+	const spiflash_info_t *info = & spiflash_info_table[part];
+	char what[24];
+	uint64_t start;
+	bool ok = true;
+	int i;
+
+	sim_flash_set_worst_case(worst_case);
+	spiflash_ultra_deep_power_down(false, NULL, NULL);
+	spiflash_ultra_deep_power_down(false, NULL, NULL);
+	spiflash_set_global_protect(false, NULL, NULL);
+
+	for (i = 0; i < info->erase_info_count; i++)
+	{
+		uint32_t size = info->erase_info[i].size;
+		snprintf(what, sizeof(what), "erase %" PRIu32, size);
+		start = sim_now_ns();
+		if (! spiflash_erase(0, size, size, false, NULL, NULL))
+		{
+			printf("  %-16s erase refused\n", what);
+			ok = false;
+		}
+		else if (! host_print_estimate(what, spiflash_estimate_erase_us(0, size, size, worst_case), start))
+			ok = false;
+	}
+
+	start = sim_now_ns();
+	spiflash_write(0, BUFFER_SIZE, buf1, false, NULL, NULL);
+	snprintf(what, sizeof(what), "write %d", BUFFER_SIZE);
+	if (! host_print_estimate(what, spiflash_estimate_write_us(0, BUFFER_SIZE, worst_case), start))
+		ok = false;
+
+	start = sim_now_ns();
+	spiflash_read(0, BUFFER_SIZE, buf2, NULL, NULL);
+	snprintf(what, sizeof(what), "read %d", BUFFER_SIZE);
+	if (! host_print_estimate(what, spiflash_estimate_read_us(BUFFER_SIZE), start))
+		ok = false;
+
+	sim_flash_set_worst_case(false);
+	return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check the typical and worst case estimates at each SPI clock
+ * @return true if all are within HOST_ESTIMATE_TOLERANCE_PCT
+ ******************************************************************************/
+static bool host_check_all_estimates(void)
+{
+	bool ok = true;
+	unsigned int i;
+	int worst_case;
+
+	printf("\n  %-16s %12s %12s %7s  (tolerance %d%%)\n",
+		   "operation", "estimate us", "sim us", "ratio", HOST_ESTIMATE_TOLERANCE_PCT);
+	for (i = 0; i < sizeof(host_estimate_bit_rates) / sizeof(host_estimate_bit_rates[0]); i++)
+	{
+		if (spiflash_init(host_estimate_bit_rates[i]) != part)
+		{
+			printf("  not detected at %" PRIu32 " Hz\n", host_estimate_bit_rates[i]);
+			ok = false;
+			continue;
+		}
+		for (worst_case = 0; worst_case <= 1; worst_case++)
+		{
+			printf("  %" PRIu32 " MHz, %s\n", host_estimate_bit_rates[i] / 1000000,
+				   worst_case ? "maximum" : "typical");
+			if (! host_check_estimates(worst_case))
+				ok = false;
+		}
+	}
+	spiflash_init(spi_freq);
+	return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Measure what sending WRITE ENABLE as a prefix saves per page programmed
+ * @note
+ * 		Writes BUFFER_SIZE with the prefix in the same transfer as each page
+ * 		program, then again with the model charging each prefix as a
+ * 		transaction of its own. The difference is the sim's assumed cost
+ * 		of a transaction, against the part's tCSH, so it shows the scale of
+ * 		the saving rather than measuring it.
+ ******************************************************************************/
+static void host_measure_prefix(void)
+{
+	const spiflash_info_t *info = & spiflash_info_table[part];
+	uint32_t pages = BUFFER_SIZE / info->program_page_size;
+	uint64_t fused_ns;
+	uint64_t separate_ns;
+	uint64_t start;
+
+	if (info->dataflash)
+	{
+		printf("  write enable prefix: none, no write enable latch\n");
+		return;
+	}
+
+	start = sim_now_ns();
+	spiflash_write(0, BUFFER_SIZE, buf1, false, NULL, NULL);
+	fused_ns = sim_now_ns() - start;
+
+	sim_spi_prefix_separate = true;
+	start = sim_now_ns();
+	spiflash_write(0, BUFFER_SIZE, buf1, false, NULL, NULL);
+	separate_ns = sim_now_ns() - start;
+	sim_spi_prefix_separate = false;
+
+	printf("  write enable prefix: %" PRIu32 " pages, %.1f us fused, %.1f us separate, %.2f us a page (%.2f%%)\n",
+		   pages, fused_ns / 1000.0, separate_ns / 1000.0,
+		   ((double) separate_ns - fused_ns) / 1000.0 / pages,
+		   ((double) separate_ns - fused_ns) * 100.0 / separate_ns);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   printf() output, while the serial demo runs
+ * @note
+ * 		Sent through serial_blocking_write(), as _write() sends it on the
+ * 		board, so that it takes its time on the line.
+ ******************************************************************************/
+static ssize_t host_serial_write(void *cookie, const char *buf, size_t len)
+{
+	(void) cookie;
+	serial_blocking_write((const uint8_t *) buf, len);
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run the serial demo, and get its time in each energy mode and energy
+ * @param[in] spin
+ * 		Wait for room in the TX buffer in EM0, rather than asleep
+ * @param[out] *r
+ * 		Results, a single run with no operations
+ ******************************************************************************/
+static void host_run_serial_demo(bool spin, bench_result_t *r)
+{
+	static cookie_io_functions_t retarget = { .write = host_serial_write };
+	FILE *console = stdout;
+
+	fflush(stdout);
+	sim_serial_file = fopen("/dev/null", "wb");
+	stdout = fopencookie(NULL, "w", retarget);
+	setvbuf(stdout, NULL, _IONBF, 0);
+	sim_serial_spin = spin;
+
+	bench_start();
+	bench_run_start();
+	demo_serial();
+	bench_run_stop();
+	bench_get_result(r);
+
+	sim_serial_spin = false;
+	fclose(stdout);
+	stdout = console;
+	fclose(sim_serial_file);
+	sim_serial_file = NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Measure the serial demo's MCU energy, waiting in EM0 and asleep
+ * @note
+ * 		The demo's output, about 2.2 KB, takes its line time at
+ * 		SERIAL_BIT_RATE. Energy is bench.c's estimate from the time in
+ * 		each mode, as accounted by enter_low_power_state(). Leaves the
+ * 		part in ultra deep power down.
+ ******************************************************************************/
+static void host_measure_serial_energy(void)
+{
+	bench_result_t spin;
+	bench_result_t sleep;
+
+	host_run_serial_demo(true, & spin);
+	host_run_serial_demo(false, & sleep);
+	printf("  serial demo     %7s %7s %7s %7s %10s\n", "wall ms", "EM0 ms", "EM1 ms", "EM2 ms", "energy uJ");
+	printf("    %-13s %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %10" PRIu32 "\n",
+		   "spinning", spin.wall_ms, spin.em0_ms, spin.em1_ms, spin.em2_ms, spin.energy_uj);
+	printf("    %-13s %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %10" PRIu32 "\n",
+		   "sleeping", sleep.wall_ms, sleep.em0_ms, sleep.em1_ms, sleep.em2_ms, sleep.energy_uj);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run all workloads on one part, from power-up
+ * @param[in] id
+ * 		Part
+ * @return Process exit status
+ ******************************************************************************/
+static int host_run_part(spiflash_id_t id)
+{
+	bool ok = true;
+	unsigned int i;
+
+	sim_flash_select(id);
+	demo_init();
+	if (part != id)
+	{
+		printf("%s: detected as %s\n", spiflash_info_table[id].name, spiflash_info_table[part].name);
+		return 1;
+	}
+
+	printf("%s\n", spiflash_info_table[id].name);
+	printf("  %-7s %4s %-10s %-8s %5s %7s %7s %7s %13s %6s %6s %6s %5s %4s\n",
+		   "demo", "sel", "config", "message", "num", "p99 us", "uJ/KiB", "fw ms", "sim ms",
+		   "progs", "erases", "status", "early", "ign");
+	for (i = 0; i < HOST_WORKLOAD_COUNT; i++)
+		if (! host_run_workload(i, & host_workloads[i]))
+			ok = false;
+
+	if (! host_check_all_estimates())
+		ok = false;
+	host_measure_prefix();
+	host_measure_serial_energy();
+	printf("\n");
+	return ok ? 0 : 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run serial console commands from stdin on one part, from power-up
+ * @param[in] id
+ * 		Part
+ * @return Process exit status
+ ******************************************************************************/
+static int host_run_console(spiflash_id_t id)
+{
+	sim_flash_select(id);
+	demo_init();
+
+	setvbuf(stdin, NULL, _IONBF, 0);
+	sim_serial_input = stdin;
+	console_open();
+	while (console_is_open() && ! feof(stdin))
+	{
+		console_poll();
+		if (console_is_open() && ! feof(stdin))
+			EMU_EnterEM1();  // until there is more input
+	}
+	console_close();
+	printf("\n");
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	spiflash_id_t ids[PART_UNKNOWN];
+	int count = 0;
+	int failed = 0;
+	int i;
+	int opt;
+
+	bool console = false;
+
+	while ((opt = getopt(argc, argv, "cst:")) != -1)
+	{
+		if (opt == 'c')
+			console = true;
+		else if (opt == 's')
+			sim_serial_clock = stderr;
+		else if (opt == 't')
+			host_trace_dir = optarg;
+		else
+		{
+			fprintf(stderr, HOST_USAGE, argv[0], argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind < argc)
+	{
+		for (i = optind; i < argc; i++)
+		{
+			if ((count == (int) (sizeof(ids) / sizeof(ids[0]))) ||
+				((ids[count] = host_part_by_name(argv[i])) == PART_UNKNOWN))
+			{
+				fprintf(stderr, HOST_USAGE, argv[0], argv[0]);
+				return 2;
+			}
+			count++;
+		}
+	}
+	else
+		for (count = 0; count < PART_UNKNOWN; count++)
+			ids[count] = count;
+
+	if (console)
+		return host_run_console(ids[0]);
+
+	for (i = 0; i < count; i++)
+	{
+		pid_t pid;
+		int status;
+
+		fflush(stdout);
+		pid = fork();
+		if (pid < 0)
+		{
+			perror("fork");
+			return 2;
+		}
+		if (pid == 0)
+		{
+			status = host_run_part(ids[i]);
+			fflush(stdout);
+			_exit(status);
+		}
+		if ((waitpid(pid, & status, 0) < 0) || ! WIFEXITED(status) || WEXITSTATUS(status))
+		{
+			printf("%s: FAILED\n\n", spiflash_info_table[ids[i]].name);
+			failed++;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
+
+/** @} (end defgroup Host) */
@@ -0,0 +1,74 @@
+/****************************************************************************//**
+ * @file em_cmu.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+// Host stand-in for the emlib CMU API. Clock selections are accepted
+// and ignored; the simulated SPI bus runs at the rate given to
+// spi_init(), and the core is reported as running from HFRCO.
+
+#ifndef EM_CMU_H
+#define EM_CMU_H
+
+#include "em_device.h"
+
+typedef enum
+{
+	cmuSelect_HFRCO,
+	cmuSelect_HFXO,
+	cmuSelect_LFXO,
+} CMU_Select_TypeDef;
+
+typedef enum
+{
+	cmuClock_HF,
+	cmuClock_HFPER,
+	cmuClock_GPIO,
+	cmuClock_CORE,
+	cmuClock_CORELE,
+	cmuClock_LFA,
+	cmuClock_LFB,
+	cmuClock_LESENSE,
+	cmuClock_ACMP0,
+	cmuClock_ACMP1,
+} CMU_Clock_TypeDef;
+
+typedef uint32_t CMU_ClkDiv_TypeDef;
+
+#define cmuClkDiv_1 1
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable);
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref);
+void CMU_ClockDivSet(CMU_Clock_TypeDef clock, CMU_ClkDiv_TypeDef div);
+void CMU_OscillatorEnable(CMU_Select_TypeDef osc, bool enable, bool wait);
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock);
+
+#endif /* EM_CMU_H */
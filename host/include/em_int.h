@@ -0,0 +1,63 @@
+/****************************************************************************//**
+ * @file em_int.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+// Host stand-in for the emlib INT API. Simulated interrupts only run
+// from the sleep functions, so there is nothing to mask, but the lock
+// count is kept as emlib does, so that code timed on the host pays
+// roughly what it would on the target. The compiler barrier stands in
+// for that of __disable_irq().
+
+#ifndef EM_INT_H
+#define EM_INT_H
+
+#include "em_device.h"
+
+extern uint32_t INT_LockCnt;
+
+static inline uint32_t INT_Disable(void)
+{
+	__asm__ volatile ("" ::: "memory");
+	if (INT_LockCnt < UINT32_MAX)
+		INT_LockCnt++;
+	return INT_LockCnt;
+}
+
+static inline uint32_t INT_Enable(void)
+{
+	if (INT_LockCnt > 0)
+		INT_LockCnt--;
+	__asm__ volatile ("" ::: "memory");
+	return INT_LockCnt;
+}
+
+#endif /* EM_INT_H */
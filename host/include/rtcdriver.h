@@ -0,0 +1,70 @@
+/****************************************************************************//**
+ * @file rtcdriver.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+// Host stand-in for the emdrv RTC driver, running from the simulated
+// clock. Timeouts are in milliseconds and the wallclock counts at the
+// LFXO rate, as on the board.
+
+#ifndef RTCDRIVER_H
+#define RTCDRIVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint32_t RTCDRV_TimerID_t;
+typedef uint32_t Ecode_t;
+
+#define ECODE_EMDRV_RTCDRV_OK               0
+#define ECODE_EMDRV_RTCDRV_ALL_TIMERS_USED  1
+#define ECODE_EMDRV_RTCDRV_ILLEGAL_TIMER_ID 2
+
+typedef enum
+{
+	rtcdrvTimerTypeOneshot,
+	rtcdrvTimerTypePeriodic,
+} RTCDRV_TimerType_t;
+
+typedef void (*RTCDRV_Callback_t)(RTCDRV_TimerID_t id, void *user);
+
+Ecode_t RTCDRV_Init(void);
+Ecode_t RTCDRV_AllocateTimer(RTCDRV_TimerID_t *id);
+Ecode_t RTCDRV_StartTimer(RTCDRV_TimerID_t id,
+		                  RTCDRV_TimerType_t type,
+		                  uint32_t timeout,
+		                  RTCDRV_Callback_t callback,
+		                  void *user);
+Ecode_t RTCDRV_StopTimer(RTCDRV_TimerID_t id);
+uint64_t RTCDRV_GetWallClockTicks64(void);
+uint32_t RTCDRV_TicksToMsec(uint64_t ticks);
+
+#endif /* RTCDRIVER_H */
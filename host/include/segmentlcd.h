@@ -0,0 +1,49 @@
+/****************************************************************************//**
+ * @file segmentlcd.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+// Host stand-in for the kit LCD driver. Output is discarded; the host
+// report uses the demo's message_text and message_number instead.
+
+#ifndef SEGMENTLCD_H
+#define SEGMENTLCD_H
+
+#include <stdbool.h>
+
+void SegmentLCD_Init(bool useBoost);
+void SegmentLCD_Disable(void);
+void SegmentLCD_AllOff(void);
+void SegmentLCD_Write(const char *string);
+void SegmentLCD_Number(int value);
+void SegmentLCD_NumberOff(void);
+
+#endif /* SEGMENTLCD_H */
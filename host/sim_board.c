@@ -0,0 +1,592 @@
+/******************************************************************************
+ * @file sim_board.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "em_cmu.h"
+#include "em_emu.h"
+#include "em_int.h"
+
+#include "caplesense.h"
+#include "rtcdriver.h"
+#include "segmentlcd.h"
+
+#include "bench.h"
+#include "button.h"
+#include "fatal.h"
+#include "gpio.h"
+#include "lcdtest.h"
+#include "led.h"
+#include "low_power.h"
+#include "serial.h"
+#include "sim_clock.h"
+
+/***************************************************************************//**
+ * @defgroup Sim_Board
+ * @brief Stand-ins for the kit and MCU support used by the demo
+ * @details
+ * 		Sleeping runs the next simulated event. Sleeping with nothing
+ * 		pending would never wake on the board either, so it is fatal.
+ *
+ * 		Serial input, when the host sets it, is an interrupt source too.
+ * 		Once the firmware has read all there is, sleeping waits for more
+ * 		in real time, up to when the next event is due, so that simulated
+ * 		time keeps pace with a program on the other end of a pipe.
+ * 		Events due within a millisecond run without waiting, but output
+ * 		is still passed on and input already there still wakes the
+ * 		firmware first, so a run of short events, such as erases, doesn't
+ * 		hold up the other end. If the host sets sim_serial_clock, each
+ * 		wait first writes to it the simulated time at which the serial
+ * 		line goes quiet.
+ * @{
+ ******************************************************************************/
+
+#define RTC_CLOCK 32768U
+
+#define SIM_NUM_TIMERS 8
+
+#define SIM_EM3_WAKE_MS 1000  // until PB1 is pressed to wake from EM3
+
+typedef struct
+{
+	bool allocated;
+	RTCDRV_TimerType_t type;
+	uint64_t period_ns;
+	RTCDRV_Callback_t callback;
+	void *user;
+	sim_event_t event;
+} sim_timer_t;
+
+static sim_timer_t sim_timers[SIM_NUM_TIMERS];
+
+uint32_t INT_LockCnt;
+
+DWT_Type sim_dwt;
+CoreDebug_Type sim_core_debug;
+RTC_TypeDef sim_rtc;
+
+RTCDRV_TimerID_t xTimerForWakeUp;
+
+FILE *sim_serial_file;
+FILE *sim_serial_input;
+FILE *sim_serial_clock;
+
+bool sim_serial_spin;  // wait for TX room in EM0, rather than asleep
+
+static bool sim_serial_starved;  // all serial input so far has been read
+
+// serial_blocking_write() waits for this much room, as on the board
+#define SIM_SERIAL_TX_LOW_WATER 64
+
+// Core clock cycles each wake-up from a TX wait costs: the TX interrupt
+// and the wait's check, a byte
+#define SIM_SERIAL_TX_WAKE_CYCLES 100
+
+static uint64_t sim_serial_byte_ns;  // line time of a byte, 0 before serial_init()
+static size_t sim_serial_tx_size;
+static uint64_t sim_serial_tx_ns;  // when the last byte written will have been sent
+static uint64_t sim_serial_rx_ns;  // when the next byte can be read
+static bool sim_serial_rx_idle = true;  // no byte has arrived since input ran out
+static sim_event_t sim_serial_tx_event;
+static sim_event_t sim_serial_rx_event;
+
+static button_callback_fn_t *sim_button_callback;
+static sim_event_t sim_button_event;
+
+/***************************************************************************//**
+ * @brief
+ *   Wait for serial input
+ * @param[in] timeout_ms
+ * 		Real time to wait, or -1 for no limit
+ * @return TRUE if there is input
+ ******************************************************************************/
+static bool sim_serial_wait(int timeout_ms)
+{
+	struct pollfd pfd = { fileno(sim_serial_input), POLLIN, 0 };
+
+	return poll(& pfd, 1, timeout_ms) > 0;
+}
+
+static void sim_sleep(void)
+{
+	uint64_t when_ns;
+	uint64_t wait_ms = 0;
+	bool pending = sim_next_event_ns(& when_ns);
+
+	if (pending)
+		wait_ms = (when_ns - sim_now_ns()) / 1000000;
+	if (sim_serial_input && sim_serial_starved && ! feof(sim_serial_input))
+	{
+		// before the output, so that the host has the time once it has that
+		if (sim_serial_clock && (! pending || wait_ms))
+			fprintf(sim_serial_clock, "time %" PRIu64 " us\n",
+					(sim_serial_tx_ns > sim_now_ns() ? sim_serial_tx_ns : sim_now_ns()) / 1000);
+		fflush(sim_serial_file ? sim_serial_file : stdout);
+		if (sim_serial_wait(pending ? (int) (wait_ms < INT_MAX ? wait_ms : INT_MAX) : -1))
+		{
+			sim_serial_starved = false;  // the RX interrupt
+			return;
+		}
+	}
+	if (! sim_run_next())
+		fatal("sleep with no event pending");
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Charge CPU work, for BENCH_CPU_CYCLES()
+ * @note
+ * 		Moves the simulated clock on by the time the cycles take at the
+ * 		core clock, and counts them on the DWT cycle counter.
+ * @param[in] cycles
+ * 		Core clock cycles
+ ******************************************************************************/
+void sim_cpu_cycles(uint32_t cycles)
+{
+	sim_advance((uint64_t) cycles * 1000000000ULL / CMU_ClockFreqGet(cmuClock_CORE));
+	sim_dwt.CYCCNT += cycles;
+}
+
+void sim_wfi(void)
+{
+	sim_sleep();
+}
+
+static void sim_button_press(void *ref)
+{
+	(void) ref;
+	if (sim_button_callback)
+		sim_button_callback(1, true);
+}
+
+void EMU_EnterEM1(void)
+{
+	sim_sleep();
+}
+
+void EMU_EnterEM2(bool restore)
+{
+	(void) restore;
+	sim_sleep();
+}
+
+// Only a button wakes EM3 on the board, so the user presses PB1 a
+// while later. Events due before then still run.
+void EMU_EnterEM3(bool restore)
+{
+	(void) restore;
+	sim_schedule_at(& sim_button_event, sim_now_ns() + SIM_EM3_WAKE_MS * 1000000ULL,
+			        sim_button_press, NULL);
+	while (sim_button_event.pending)
+		sim_sleep();
+}
+
+void EM2Sleep(uint32_t msec)
+{
+	RTCDRV_StartTimer(xTimerForWakeUp, rtcdrvTimerTypeOneshot, msec, NULL, NULL);
+	EMU_EnterEM2(true);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Timer expiry, as from the RTC interrupt
+ * @param[in] *ref
+ * 		Timer
+ ******************************************************************************/
+static void sim_timer_expired(void *ref)
+{
+	sim_timer_t *timer = ref;
+
+	if (timer->type == rtcdrvTimerTypePeriodic)
+		sim_schedule_at(& timer->event, timer->event.when_ns + timer->period_ns, sim_timer_expired, timer);
+	if (timer->callback)
+		timer->callback(timer - sim_timers, timer->user);
+}
+
+Ecode_t RTCDRV_Init(void)
+{
+	return ECODE_EMDRV_RTCDRV_OK;
+}
+
+Ecode_t RTCDRV_AllocateTimer(RTCDRV_TimerID_t *id)
+{
+	RTCDRV_TimerID_t i;
+
+	for (i = 0; i < SIM_NUM_TIMERS; i++)
+	{
+		if (! sim_timers[i].allocated)
+		{
+			sim_timers[i].allocated = true;
+			*id = i;
+			return ECODE_EMDRV_RTCDRV_OK;
+		}
+	}
+	return ECODE_EMDRV_RTCDRV_ALL_TIMERS_USED;
+}
+
+Ecode_t RTCDRV_StartTimer(RTCDRV_TimerID_t id,
+		                  RTCDRV_TimerType_t type,
+		                  uint32_t timeout,
+		                  RTCDRV_Callback_t callback,
+		                  void *user)
+{
+	sim_timer_t *timer;
+
+	if ((id >= SIM_NUM_TIMERS) || ! sim_timers[id].allocated)
+		return ECODE_EMDRV_RTCDRV_ILLEGAL_TIMER_ID;
+	timer = & sim_timers[id];
+	timer->type = type;
+	timer->period_ns = 1000000ULL * timeout;
+	timer->callback = callback;
+	timer->user = user;
+	sim_schedule_at(& timer->event, sim_now_ns() + timer->period_ns, sim_timer_expired, timer);
+	return ECODE_EMDRV_RTCDRV_OK;
+}
+
+Ecode_t RTCDRV_StopTimer(RTCDRV_TimerID_t id)
+{
+	if ((id >= SIM_NUM_TIMERS) || ! sim_timers[id].allocated)
+		return ECODE_EMDRV_RTCDRV_ILLEGAL_TIMER_ID;
+	sim_cancel(& sim_timers[id].event);
+	return ECODE_EMDRV_RTCDRV_OK;
+}
+
+uint64_t RTCDRV_GetWallClockTicks64(void)
+{
+	return (sim_now_ns() * RTC_CLOCK) / 1000000000ULL;
+}
+
+uint32_t RTCDRV_TicksToMsec(uint64_t ticks)
+{
+	return (ticks * 1000) / RTC_CLOCK;
+}
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable)
+{
+	(void) clock;
+	(void) enable;
+}
+
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref)
+{
+	(void) clock;
+	(void) ref;
+}
+
+void CMU_ClockDivSet(CMU_Clock_TypeDef clock, CMU_ClkDiv_TypeDef div)
+{
+	(void) clock;
+	(void) div;
+}
+
+void CMU_OscillatorEnable(CMU_Select_TypeDef osc, bool enable, bool wait)
+{
+	(void) osc;
+	(void) enable;
+	(void) wait;
+}
+
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock)
+{
+	(void) clock;
+	return 14000000;
+}
+
+void gpio_init(const gpio_init_t *table, unsigned int count)
+{
+	(void) table;
+	(void) count;
+}
+
+void gpio_irq_init(void)
+{
+}
+
+void led_init(void)
+{
+}
+
+void led_set(int num, int value)
+{
+	(void) num;
+	(void) value;
+}
+
+void button_init(button_callback_fn_t *callback)
+{
+	sim_button_callback = callback;  // demos are run with demo_run_state(), so only EM3 presses
+}
+
+void SegmentLCD_Init(bool useBoost)
+{
+	(void) useBoost;
+}
+
+void SegmentLCD_Disable(void)
+{
+}
+
+void SegmentLCD_AllOff(void)
+{
+}
+
+void SegmentLCD_Write(const char *string)
+{
+	(void) string;
+}
+
+void SegmentLCD_Number(int value)
+{
+	(void) value;
+}
+
+void SegmentLCD_NumberOff(void)
+{
+}
+
+void CAPLESENSE_Init(bool sleep)
+{
+	(void) sleep;
+}
+
+int32_t CAPLESENSE_getSliderPosition(void)
+{
+	return -1;  // not touched
+}
+
+// Serial output goes to stdout, where printf() output already goes,
+// unless sent elsewhere by the host. Serial input is from
+// sim_serial_input, if the host sets it, unbuffered so that waiting for
+// it sees what the firmware hasn't read.
+//
+// Bytes written and read through serial_write() and serial_read_char()
+// take the line's time: 10 bits a byte at the bit rate, 8N1. What has
+// been written but not yet sent counts against the TX buffer given to
+// serial_init(), and a byte can't be read until the previous one has
+// had time to arrive. printf() output isn't paced.
+//
+// serial_tx_wait() sleeps in enter_low_power_state(), woken as each byte
+// leaves, as serial.c does. With sim_serial_spin set, it waits in EM0
+// instead, as serial.c did before it slept, for comparison.
+void serial_blocking_write_char(char c)
+{
+	fputc(c, sim_serial_file ? sim_serial_file : stdout);
+}
+
+size_t serial_write(const uint8_t *p, size_t len)
+{
+	uint64_t now_ns = sim_now_ns();
+	size_t queued = 0;
+
+	if (sim_serial_byte_ns)
+	{
+		if (sim_serial_tx_ns > now_ns)
+			queued = (sim_serial_tx_ns - now_ns + sim_serial_byte_ns - 1) / sim_serial_byte_ns;
+		else
+			sim_serial_tx_ns = now_ns;
+		if (len > sim_serial_tx_size - queued)
+			len = (queued < sim_serial_tx_size) ? sim_serial_tx_size - queued : 0;
+		sim_serial_tx_ns += len * sim_serial_byte_ns;
+	}
+	return fwrite(p, 1, len, sim_serial_file ? sim_serial_file : stdout);
+}
+
+void serial_blocking_write(const uint8_t *p, size_t len)
+{
+	size_t n;
+
+	while (len)
+	{
+		n = serial_write(p, len);
+		p += n;
+		len -= n;
+		if (len)
+			serial_tx_wait(len < SIM_SERIAL_TX_LOW_WATER ? len : SIM_SERIAL_TX_LOW_WATER);
+	}
+}
+
+uint32_t serial_set_tx_nonblocking(bool nonblocking)
+{
+	(void) nonblocking;  // printf() output never runs out of room
+	return 0;
+}
+
+void serial_blocking_write_str(const char *p)
+{
+	fputs(p, sim_serial_file ? sim_serial_file : stdout);
+}
+
+static void sim_serial_wake(void *ref)
+{
+	(void) ref;  // the TX or RX interrupt
+}
+
+int serial_read_char(void)
+{
+	int c = EOF;
+
+	if (sim_serial_rx_ns > sim_now_ns())
+		return -1;  // the next byte is still arriving
+	if (sim_serial_input && sim_serial_wait(0))
+		c = fgetc(sim_serial_input);
+	sim_serial_starved = (c == EOF);
+	if (c == EOF)
+	{
+		sim_serial_rx_idle = true;
+		return -1;
+	}
+	if (sim_serial_rx_idle)
+		sim_serial_rx_ns = sim_now_ns();  // the line was quiet, so this is the first byte
+	sim_serial_rx_idle = false;
+	if (sim_serial_byte_ns)
+	{
+		sim_serial_rx_ns += sim_serial_byte_ns;
+		sim_schedule_at(& sim_serial_rx_event, sim_serial_rx_ns, sim_serial_wake, NULL);
+	}
+	return c;
+}
+
+bool serial_rx_ready(void)
+{
+	return sim_serial_input && ! sim_serial_starved && (sim_serial_rx_ns <= sim_now_ns());
+}
+
+// The port is only recorded. The bit rate sets the time each byte
+// takes on the line.
+static serial_port_t sim_serial_port;
+static uint32_t sim_serial_bit_rate;
+
+static void sim_serial_set_bit_rate(uint32_t bit_rate)
+{
+	sim_serial_bit_rate = bit_rate;
+	sim_serial_byte_ns = 10 * 1000000000ULL / bit_rate;
+}
+
+void serial_init(int bit_rate,
+		         uint8_t *raw_rx_buf,
+		         size_t raw_rx_buf_size,
+		         uint8_t *raw_tx_buf,
+		         size_t raw_tx_buf_size)
+{
+	sim_serial_port = SERIAL_PORT_CONSOLE;
+	sim_serial_set_bit_rate(bit_rate);
+	sim_serial_tx_size = raw_tx_buf_size;
+	(void) raw_rx_buf;
+	(void) raw_rx_buf_size;
+	(void) raw_tx_buf;
+}
+
+void serial_tx_wait(size_t space)
+{
+	uint64_t left_ns;  // line time of what may stay queued
+	uint64_t wake_ns;
+
+	if (! sim_serial_byte_ns || (space > sim_serial_tx_size))
+		return;
+	left_ns = (sim_serial_tx_size - space) * sim_serial_byte_ns;
+	while (sim_serial_tx_ns > sim_now_ns() + left_ns)
+	{
+		if (sim_serial_spin)
+		{
+			sim_schedule_at(& sim_serial_tx_event, sim_serial_tx_ns - left_ns, sim_serial_wake, NULL);
+			sim_sleep();  // not counted as a sleep, so EM0
+			continue;
+		}
+		// the end of the byte on the line
+		wake_ns = sim_serial_tx_ns - ((sim_serial_tx_ns - sim_now_ns() - 1) / sim_serial_byte_ns) * sim_serial_byte_ns;
+		sim_schedule_at(& sim_serial_tx_event, wake_ns, sim_serial_wake, NULL);
+		enter_low_power_state();
+		if (! sim_serial_tx_event.pending)
+			sim_cpu_cycles(SIM_SERIAL_TX_WAKE_CYCLES);
+	}
+}
+
+void serial_tx_flush(void)
+{
+	serial_tx_wait(sim_serial_tx_size);
+	fflush(stdout);
+}
+
+bool serial_blocks_em2(void)
+{
+	// the LEUART console keeps running in EM2, the fast USART doesn't
+	return (sim_serial_port == SERIAL_PORT_FAST) && (sim_serial_tx_ns > sim_now_ns());
+}
+
+bool serial_bit_rate_ok(serial_port_t port, uint32_t bit_rate)
+{
+	if (port == SERIAL_PORT_FAST)
+		return (bit_rate > 0) && (bit_rate <= 48000000 / 4);  // from the HFXO, with OVS4
+	return (bit_rate > 0) && (bit_rate <= 9600);
+}
+
+bool serial_switch(serial_port_t port, uint32_t bit_rate)
+{
+	if (! serial_bit_rate_ok(port, bit_rate))
+		return false;
+	serial_tx_flush();
+	fflush(sim_serial_file ? sim_serial_file : stdout);
+	sim_serial_port = port;
+	sim_serial_set_bit_rate(bit_rate);
+	return true;
+}
+
+serial_port_t serial_get_port(void)
+{
+	return sim_serial_port;
+}
+
+uint32_t serial_get_bit_rate(void)
+{
+	return sim_serial_bit_rate;
+}
+
+void serial_close(void)
+{
+	fflush(stdout);
+	sim_serial_port = SERIAL_PORT_CONSOLE;
+}
+
+void fatal(const char *s)
+{
+	fflush(stdout);
+	fprintf(stderr, "fatal at %" PRIu64 " us: %s\n", sim_now_ns() / 1000, s);
+	exit(2);
+}
+
+/** @} (end defgroup Sim_Board) */
@@ -0,0 +1,169 @@
+/******************************************************************************
+ * @file sim_clock.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <stddef.h>
+
+#include "em_device.h"
+
+#include "sim_clock.h"
+
+/***************************************************************************//**
+ * @addtogroup Sim_Clock
+ * @{
+ ******************************************************************************/
+
+static uint64_t sim_now;
+static sim_event_t *sim_queue;  // pending events, earliest first
+
+/***************************************************************************//**
+ * @brief
+ *   Current simulated time
+ * @return Nanoseconds since start of simulation
+ ******************************************************************************/
+uint64_t sim_now_ns(void)
+{
+	return sim_now;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Schedule an event
+ * @note
+ * 		Events due at the same time run in the order they were scheduled.
+ * 		Rescheduling a pending event moves it.
+ * @param[in] *event
+ * 		Event, which must remain valid until it has run or been cancelled
+ * @param[in] when_ns
+ * 		Simulated time to run it, no earlier than now
+ * @param[in] *fn
+ * 		Handler
+ * @param[in] *ref
+ * 		Argument to be passed to handler
+ ******************************************************************************/
+void sim_schedule_at(sim_event_t *event,
+		             uint64_t when_ns,
+		             sim_event_fn_t *fn,
+		             void *ref)
+{
+	sim_event_t **p;
+
+	sim_cancel(event);
+	if (when_ns < sim_now)
+		when_ns = sim_now;
+	event->when_ns = when_ns;
+	event->fn = fn;
+	event->ref = ref;
+	event->pending = true;
+
+	for (p = & sim_queue; *p && ((*p)->when_ns <= when_ns); p = & (*p)->next)
+		;
+	event->next = *p;
+	*p = event;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Cancel an event, if pending
+ * @param[in] *event
+ * 		Event
+ ******************************************************************************/
+void sim_cancel(sim_event_t *event)
+{
+	sim_event_t **p;
+
+	if (! event->pending)
+		return;
+	for (p = & sim_queue; *p; p = & (*p)->next)
+	{
+		if (*p == event)
+		{
+			*p = event->next;
+			break;
+		}
+	}
+	event->pending = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time of the next pending event
+ * @param[out] *when_ns
+ * 		Simulated time it is due
+ * @return FALSE if no event is pending
+ ******************************************************************************/
+bool sim_next_event_ns(uint64_t *when_ns)
+{
+	if (! sim_queue)
+		return false;
+	*when_ns = sim_queue->when_ns;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Advance to the next pending event and run it
+ * @return FALSE if no event was pending
+ ******************************************************************************/
+bool sim_run_next(void)
+{
+	sim_event_t *event = sim_queue;
+
+	if (! event)
+		return false;
+	sim_queue = event->next;
+	event->pending = false;
+	if (event->when_ns > sim_now)
+		sim_now = event->when_ns;  // else it came due during sim_advance()
+	// time only moves here, so the RTC counter can be updated here
+	sim_rtc.CNT = ((sim_now * 32768) / 1000000000ULL) & 0xffffff;
+	event->fn(event->ref);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Move the clock on without sleeping
+ * @note
+ * 		For time the CPU spends working. Events which come due meanwhile
+ * 		run late, at the next sleep, as interrupts held off by the work
+ * 		would.
+ * @param[in] ns
+ * 		Nanoseconds
+ ******************************************************************************/
+void sim_advance(uint64_t ns)
+{
+	sim_now += ns;
+	sim_rtc.CNT = ((sim_now * 32768) / 1000000000ULL) & 0xffffff;
+}
+
+/** @} (end addtogroup Sim_Clock) */
@@ -0,0 +1,80 @@
+/****************************************************************************//**
+ * @file sim_clock.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef SIM_CLOCK_H_
+#define SIM_CLOCK_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/***************************************************************************//**
+ * @defgroup Sim_Clock
+ * @brief Virtual clock and event queue of the host build
+ * @details
+ * 		Simulated time only advances when the firmware sleeps, to the time
+ * 		of the next pending event, whose handler then runs as the interrupt
+ * 		handler would. Code between sleeps takes no simulated time, unless
+ * 		it charges its cycles, through sim_advance().
+ * @{
+ ******************************************************************************/
+
+typedef void sim_event_fn_t(void *ref);
+
+// Owned by the caller, and linked into the queue while pending
+typedef struct sim_event
+{
+	uint64_t when_ns;
+	sim_event_fn_t *fn;
+	void *ref;
+	bool pending;
+	struct sim_event *next;
+} sim_event_t;
+
+uint64_t sim_now_ns(void);
+
+void sim_schedule_at(sim_event_t *event,
+		             uint64_t when_ns,
+		             sim_event_fn_t *fn,
+		             void *ref);
+
+void sim_cancel(sim_event_t *event);
+
+bool sim_next_event_ns(uint64_t *when_ns);
+
+bool sim_run_next(void);
+
+void sim_advance(uint64_t ns);
+
+/** @} (end defgroup Sim_Clock) */
+
+#endif /* SIM_CLOCK_H_ */
@@ -0,0 +1,736 @@
+/******************************************************************************
+ * @file sim_flash.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_flash.h"
+
+/***************************************************************************//**
+ * @addtogroup Sim_Flash
+ * @{
+ ******************************************************************************/
+
+#define CMD_READ_ARRAY                  0x0b
+#define CMD_READ_ARRAY_SLOW             0x03
+#define CMD_CHIP_ERASE                  0x60
+#define CMD_CHIP_ERASE2                 0xc7
+#define CMD_BYTE_PAGE_PROGRAM           0x02
+#define CMD_WRITE_ENABLE                0x06
+#define CMD_WRITE_DISABLE               0x04
+#define CMD_PROTECT_SECTOR              0x36
+#define CMD_UNPROTECT_SECTOR            0x39
+#define CMD_READ_SECTOR_PROTECTION      0x3c
+#define CMD_PROGRAM_OTP                 0x9b
+#define CMD_READ_OTP                    0x77
+#define CMD_READ_STATUS                 0x05
+#define CMD_DATAFLASH_READ_STATUS       0xd7
+#define CMD_ACTIVE_STATUS_INTERRUPT     0x25
+#define CMD_WRITE_STATUS_REG_BYTE_1     0x01
+#define CMD_WRITE_STATUS_REG_BYTE_2     0x31
+#define CMD_RESET                       0xf0
+#define CMD_READ_ID                     0x9f
+#define CMD_DEEP_POWER_DOWN             0xb9
+#define CMD_RESUME_FROM_DEEP_POWER_DOWN 0xab
+#define CMD_ULTRA_DEEP_POWER_DOWN       0x79
+
+#define CMD_DATAFLASH_CONFIGURE         0x3d
+#define CMD_DATAFLASH_RMW_BUF1          0x58
+#define CMD_DATAFLASH_RMW_BUF2          0x59
+
+#define DATAFLASH_PAGE_SIZE             256
+
+#define MAX_SIM_SECTORS                 32
+
+#define MAX_SIM_ERASE_SIZES             5
+
+// Typical and maximum page program and erase times, from the datasheets.
+// They are the same figures as in spiflash_info_table, kept apart so that
+// the simulated durations check the arithmetic of the driver's estimates:
+// command and transfer time, erase command choice and page splitting.
+// They don't check the figures themselves.
+typedef struct
+{
+	uint32_t t_pp_us;
+	uint32_t t_pp_max_us;
+	struct
+	{
+		uint32_t size;
+		uint32_t t_us;
+		uint32_t t_max_us;
+	} erase [MAX_SIM_ERASE_SIZES];
+} sim_timing_t;
+
+static const sim_timing_t sim_timing_table[] =
+{
+	[AT25SF041]  = { 600,  2500, {{ 4096, 50000, 200000 }, { 32768, 150000, 600000 },
+	                              { 65536, 250000, 1000000 }, { (4 << 20) / 8, 4000000, 8000000 }}},
+	[AT25XE021A] = { 1500, 3000, {{ 256, 10000, 25000 }, { 4096, 40000, 200000 },
+	                              { 32768, 200000, 600000 }, { 65536, 400000, 950000 },
+	                              { (2 << 20) / 8, 1500000, 4000000 }}},
+	[AT25XE041B] = { 1500, 3000, {{ 256, 10000, 25000 }, { 4096, 45000, 200000 },
+	                              { 32768, 250000, 600000 }, { 65536, 450000, 950000 },
+	                              { (4 << 20) / 8, 3000000, 7000000 }}},
+	[AT45DB081E] = { 1500, 3000, {{ 256, 8000, 35000 }, { 2048, 25000, 50000 },
+	                              { (8 << 20) / 8, 10000000, 22000000 }}},
+	[AT45DB641E] = { 1500, 3000, {{ 256, 8000, 35000 }, { 2048, 25000, 50000 },
+	                              { (64 << 20) / 8, 80000000, 208000000 }}},
+	[RM25C256DS] = { 1000, 5000, {{ 64, 1000, 5000 }, { (256 << 10) / 8, 50000, 100000 }}},
+};
+
+static const spiflash_info_t *sim_info;
+static const sim_timing_t *sim_timing;
+static bool sim_worst_case;  // program and erase take the maximum time
+static uint8_t *sim_array;
+
+static bool sim_wel;
+static bool sim_dpd;
+static bool sim_udpd;
+static bool sim_page_256;       // DataFlash page size configuration
+static bool sim_error;          // last program or erase failed, for status_error_mask
+static uint64_t sim_busy_until;
+static uint64_t sim_awake_at;
+
+// Start address of each protection sector, plus the end of the last one.
+// A part with no protection sectors but with global protection through
+// the status register is modelled as one sector; DataFlash as none.
+static uint32_t sim_sector_start[MAX_SIM_SECTORS + 1];
+static unsigned int sim_sector_count;
+static uint32_t sim_protect_mask;
+static uint32_t sim_protect_mask_all;
+static uint8_t sim_protect_bits;  // block protect bits of status byte 1, for protection_by_status
+
+static sim_flash_stats_t sim_stats;
+
+/***************************************************************************//**
+ * @brief
+ *   Power-up state
+ * @note
+ * 		Also the state after exit from ultra deep power down. Parts with
+ * 		protection sectors power up with all sectors protected, except
+ * 		those which protect by the status register, whose block protect
+ * 		bits are non-volatile.
+ ******************************************************************************/
+static void sim_power_up(void)
+{
+	sim_wel = false;
+	sim_error = false;
+	sim_dpd = false;
+	sim_udpd = false;
+	if (! sim_info->protection_by_status)
+		sim_protect_mask = sim_info->protection_sector_count ? sim_protect_mask_all : 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Protection mask selected by the block protect bits
+ * @note
+ * 		BP2..BP0 of 1..3 protect 1/8, 1/4 or 1/2 of the sectors, from the
+ * 		top of the array, or from the bottom with TB set; 4 and above
+ * 		protect all. SEC and CMP aren't modelled.
+ * @param[in] bits
+ * 		Status register byte 1
+ * @return Protection mask
+ ******************************************************************************/
+static uint32_t sim_block_protect_mask(uint8_t bits)
+{
+	unsigned int bp = (bits >> 2) & 0x07;
+	unsigned int n;
+
+	if (bp == 0)
+		return 0;
+	if (bp >= 4)
+		return sim_protect_mask_all;
+	n = sim_sector_count / (8 >> (bp - 1));
+	if (bits & 0x20)
+		return (1U << n) - 1;
+	return sim_protect_mask_all & ~ ((1U << (sim_sector_count - n)) - 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Select the part to model, with its array erased
+ * @param[in] id
+ * 		Part
+ ******************************************************************************/
+void sim_flash_select(spiflash_id_t id)
+{
+	unsigned int i;
+
+	sim_info = & spiflash_info_table[id];
+	sim_timing = & sim_timing_table[id];
+
+	free(sim_array);
+	sim_array = malloc(sim_info->device_size);
+	if (! sim_array)
+	{
+		fprintf(stderr, "sim_flash: out of memory\n");
+		exit(1);
+	}
+	memset(sim_array, 0xff, sim_info->device_size);
+
+	sim_sector_start[0] = 0;
+	if (sim_info->dataflash)
+		sim_sector_count = 0;
+	else if (sim_info->protection_sector_count == 0)
+	{
+		sim_sector_count = 1;
+		sim_sector_start[1] = sim_info->device_size;
+	}
+	else
+	{
+		sim_sector_count = sim_info->protection_sector_count;
+		for (i = 0; i < sim_sector_count; i++)
+			sim_sector_start[i + 1] = sim_sector_start[i] + sim_info->protection_sector_sizes[i];
+	}
+	sim_protect_mask_all = (uint32_t) ((1ULL << sim_sector_count) - 1);
+
+	sim_page_256 = false;  // DataFlash parts ship with 264 byte pages
+	sim_protect_bits = 0;  // and block protect bits clear
+	sim_protect_mask = 0;
+	sim_busy_until = 0;
+	sim_awake_at = 0;
+	sim_power_up();
+	sim_flash_clear_stats();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get address from command
+ * @param[in] *p
+ * 		Address bytes, most significant first
+ * @return Address, wrapped to device size
+ ******************************************************************************/
+static uint32_t sim_addr(const uint8_t *p)
+{
+	uint32_t addr = 0;
+	int i;
+
+	for (i = 0; i < sim_info->address_bytes; i++)
+		addr = (addr << 8) | p[i];
+	return addr % sim_info->device_size;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the protection sector containing an address
+ * @param[in] addr
+ * 		Address
+ * @return Sector number, or -1 if not in a protection sector
+ ******************************************************************************/
+static int sim_sector(uint32_t addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < sim_sector_count; i++)
+		if (addr < sim_sector_start[i + 1])
+			return (addr >= sim_sector_start[i]) ? (int) i : -1;
+	return -1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether any part of a range is protected
+ * @param[in] addr
+ * 		Start address
+ * @param[in] len
+ * 		Length
+ * @return TRUE if any protected sector overlaps the range
+ ******************************************************************************/
+static bool sim_range_protected(uint32_t addr, size_t len)
+{
+	unsigned int i;
+
+	for (i = 0; i < sim_sector_count; i++)
+		if ((sim_protect_mask & (1 << i)) &&
+			(addr < sim_sector_start[i + 1]) &&
+			((addr + len) > sim_sector_start[i]))
+			return true;
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check and clear the write enable latch for a program, erase or protect
+ * @return TRUE if the command may proceed
+ ******************************************************************************/
+static bool sim_take_wel(void)
+{
+	bool wel = sim_wel;
+
+	if (sim_info->dataflash)
+		return true;  // no write enable latch
+	sim_wel = false;
+	if (! wel)
+		sim_stats.ignored_no_wel++;
+	return wel;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the erase command for an opcode
+ * @param[in] cmd
+ * 		Opcode
+ * @param[in] addr_needed
+ * 		TRUE for block erase, FALSE for chip erase
+ * @return Erase info, or NULL if the part has no such erase command
+ ******************************************************************************/
+static const erase_info_t *sim_erase_info(uint8_t cmd, bool addr_needed)
+{
+	int i;
+
+	for (i = 0; i < sim_info->erase_info_count; i++)
+	{
+		const erase_info_t *ei = & sim_info->erase_info[i];
+		if (ei->addr_needed != addr_needed)
+			continue;
+		if (! addr_needed && sim_info->dataflash)
+			return ei;  // chip erase is a four byte sequence
+		if (ei->cmd == cmd)
+			return ei;
+		if (! addr_needed && (cmd == CMD_CHIP_ERASE2) && (ei->cmd == CMD_CHIP_ERASE))
+			return ei;
+	}
+	return NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Datasheet erase time
+ * @param[in] size
+ * 		Erase size
+ * @return Typical time, or maximum with sim_flash_set_worst_case(), in us
+ ******************************************************************************/
+static uint32_t sim_erase_us(uint32_t size)
+{
+	unsigned int i;
+
+	for (i = 0; i < MAX_SIM_ERASE_SIZES; i++)
+		if (sim_timing->erase[i].size == size)
+			return sim_worst_case ? sim_timing->erase[i].t_max_us : sim_timing->erase[i].t_us;
+	fprintf(stderr, "sim_flash: no erase time for %s size %" PRIu32 "\n", sim_info->name, size);
+	exit(1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Datasheet page program time
+ * @return Typical time, or maximum with sim_flash_set_worst_case(), in us
+ ******************************************************************************/
+static uint32_t sim_pp_us(void)
+{
+	return sim_worst_case ? sim_timing->t_pp_max_us : sim_timing->t_pp_us;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a block or the whole array
+ * @param[in] *ei
+ * 		Erase command info
+ * @param[in] addr
+ * 		Any address in the block
+ * @param[in] end_ns
+ * 		Time at which the command was complete
+ ******************************************************************************/
+static void sim_erase(const erase_info_t *ei, uint32_t addr, uint64_t end_ns)
+{
+	addr -= addr % ei->size;
+	if (! sim_take_wel())
+		return;
+	sim_error = sim_range_protected(addr, ei->size);
+	if (sim_error)
+	{
+		sim_stats.ignored_protected++;
+		return;
+	}
+	memset(sim_array + addr, 0xff, ei->size);
+	sim_stats.erases++;
+	sim_busy_until = end_ns + 1000ULL * sim_erase_us(ei->size);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Program data into a page, wrapping at the end of the page
+ * @param[in] addr
+ * 		Start address
+ * @param[in] *data
+ * 		Data
+ * @param[in] len
+ * 		Length of data
+ * @param[in] end_ns
+ * 		Time at which the command was complete
+ ******************************************************************************/
+static void sim_program(uint32_t addr, const uint8_t *data, size_t len, uint64_t end_ns)
+{
+	uint32_t page_size = sim_info->dataflash ? DATAFLASH_PAGE_SIZE : sim_info->program_page_size;
+	uint32_t page = addr - (addr % page_size);
+	size_t i;
+
+	if (! sim_take_wel())
+		return;
+	sim_error = sim_range_protected(page, page_size);
+	if (sim_error)
+	{
+		sim_stats.ignored_protected++;
+		return;
+	}
+	for (i = 0; i < len; i++)
+		sim_array[page + ((addr - page + i) % page_size)] &= data[i];
+	sim_stats.programs++;
+	sim_stats.bytes_programmed += len;
+	sim_busy_until = end_ns + 1000ULL * sim_pp_us();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   DataFlash read-modify-write of part of a page through a buffer
+ * @note
+ * 		The page is read into the buffer, the data replaces part of it, and
+ * 		the page is erased and programmed from the buffer.
+ * @param[in] addr
+ * 		Start address
+ * @param[in] *data
+ * 		Data
+ * @param[in] len
+ * 		Length of data
+ * @param[in] end_ns
+ * 		Time at which the command was complete
+ ******************************************************************************/
+static void sim_rmw(uint32_t addr, const uint8_t *data, size_t len, uint64_t end_ns)
+{
+	uint32_t page = addr - (addr % DATAFLASH_PAGE_SIZE);
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		sim_array[page + ((addr - page + i) % DATAFLASH_PAGE_SIZE)] = data[i];
+	sim_stats.programs++;
+	sim_stats.bytes_programmed += len;
+	sim_busy_until = end_ns + 1000ULL * (sim_erase_us(DATAFLASH_PAGE_SIZE) + sim_pp_us());
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Fill the response with the status register
+ * @param[out] *miso
+ * 		Response bytes after the opcode
+ * @param[in] len
+ * 		Number of response bytes
+ * @param[in] busy
+ * 		TRUE if a program or erase is in progress
+ ******************************************************************************/
+static void sim_status(uint8_t *miso, size_t len, bool busy)
+{
+	uint8_t status[2];
+	size_t i;
+
+	if (sim_info->dataflash)
+	{
+		status[0] = (busy ? 0x00 : 0x80) | (sim_page_256 ? 0x01 : 0x00);
+		status[1] = busy ? 0x00 : 0x80;
+	}
+	else
+	{
+		status[0] = (busy ? 0x01 : 0x00) | (sim_wel ? 0x02 : 0x00);
+		if (sim_info->protection_by_status)
+			status[0] |= sim_protect_bits;
+		else if (sim_protect_mask == sim_protect_mask_all)
+			status[0] |= sim_sector_count ? 0x0c : 0x00;
+		else if (sim_protect_mask)
+			status[0] |= 0x04;
+		status[1] = busy ? 0x01 : 0x00;
+	}
+	if (sim_error)
+	{
+		status[0] |= sim_info->status_error_mask & 0xff;
+		status[1] |= sim_info->status_error_mask >> 8;
+	}
+	for (i = 0; i < len; i++)
+		miso[i] = status[i & 1];
+	sim_stats.status_reads++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   One SPI transaction, from CS assert to CS deassert
+ * @note
+ * 		The status register reflects the state at the start of the
+ * 		transaction. Program and erase start at the end of it.
+ * @param[in] *mosi
+ * 		Bytes sent to the part
+ * @param[out] *miso
+ * 		Bytes returned by the part, including those during the command
+ * @param[in] len
+ * 		Length of transaction
+ * @param[in] start_ns
+ * 		Time of CS assert
+ * @param[in] end_ns
+ * 		Time of CS deassert
+ ******************************************************************************/
+void sim_flash_transaction(const uint8_t *mosi,
+		                   uint8_t *miso,
+		                   size_t len,
+		                   uint64_t start_ns,
+		                   uint64_t end_ns)
+{
+	size_t hdr = 1 + sim_info->address_bytes;
+	uint32_t addr = 0;
+	const erase_info_t *ei;
+	bool busy;
+	size_t i;
+	int sector;
+
+	memset(miso, 0xff, len);
+	if (len == 0)
+		return;
+	sim_stats.commands++;
+
+	if (sim_udpd)
+	{
+		// any CS cycle wakes the part, and the command is ignored
+		sim_power_up();
+		sim_awake_at = end_ns + 1000ULL * sim_info->t_wake_udpd_us;
+		return;
+	}
+	if (sim_dpd)
+	{
+		if (mosi[0] == CMD_RESUME_FROM_DEEP_POWER_DOWN)
+		{
+			sim_dpd = false;
+			sim_awake_at = end_ns + 1000ULL * sim_info->t_wake_dpd_us;
+		}
+		else
+			sim_stats.ignored_power_down++;
+		return;
+	}
+	if (start_ns < sim_awake_at)
+		sim_stats.early_after_wake++;
+
+	busy = start_ns < sim_busy_until;
+	if (busy && (mosi[0] != sim_info->read_status_cmd) && (mosi[0] != CMD_ACTIVE_STATUS_INTERRUPT))
+	{
+		sim_stats.ignored_busy++;
+		return;
+	}
+
+	if (len >= hdr)
+		addr = sim_addr(mosi + 1);
+
+	switch (mosi[0])
+	{
+	case CMD_READ_ID:
+		for (i = 1; i < len; i++)
+			miso[i] = (i <= sim_info->id_size) ? sim_info->id_bytes[i - 1] : 0x00;
+		break;
+
+	case CMD_READ_STATUS:
+	case CMD_DATAFLASH_READ_STATUS:
+		if (mosi[0] != sim_info->read_status_cmd)
+			goto unknown;
+		sim_status(miso + 1, len - 1, busy);
+		break;
+
+	case CMD_READ_ARRAY:
+	case CMD_READ_ARRAY_SLOW:
+		if (mosi[0] == CMD_READ_ARRAY)
+			hdr++;  // dummy byte
+		for (i = hdr; i < len; i++)
+			miso[i] = sim_array[(addr + i - hdr) % sim_info->device_size];
+		if (len > hdr)
+			sim_stats.bytes_read += len - hdr;
+		break;
+
+	case CMD_BYTE_PAGE_PROGRAM:
+		if (len > hdr)
+			sim_program(addr, mosi + hdr, len - hdr, end_ns);
+		break;
+
+	case CMD_WRITE_ENABLE:
+		sim_wel = true;
+		break;
+
+	case CMD_WRITE_DISABLE:
+		sim_wel = false;
+		break;
+
+	case CMD_WRITE_STATUS_REG_BYTE_1:
+		if (! sim_take_wel() || (len < 2))
+			break;
+		if (sim_info->protection_by_status)
+		{
+			sim_protect_bits = mosi[1] & 0x3c;
+			sim_protect_mask = sim_block_protect_mask(sim_protect_bits);
+		}
+		else if ((mosi[1] & 0x3c) == 0x3c)
+			sim_protect_mask = sim_protect_mask_all;
+		else if ((mosi[1] & 0x3c) == 0)
+			sim_protect_mask = 0;
+		break;
+
+	case CMD_WRITE_STATUS_REG_BYTE_2:
+	case CMD_PROGRAM_OTP:
+		sim_take_wel();  // accepted, but not modelled
+		break;
+
+	case CMD_PROTECT_SECTOR:
+	case CMD_UNPROTECT_SECTOR:
+		if (sim_info->protection_by_status)
+			goto unknown;
+		if (! sim_take_wel() || (len < hdr))
+			break;
+		sector = sim_sector(addr);
+		if (sector < 0)
+			break;
+		if (mosi[0] == CMD_PROTECT_SECTOR)
+			sim_protect_mask |= 1 << sector;
+		else
+			sim_protect_mask &= ~ (1 << sector);
+		break;
+
+	case CMD_READ_SECTOR_PROTECTION:
+		if (sim_info->protection_by_status)
+			goto unknown;
+		sector = sim_sector(addr);
+		for (i = hdr; i < len; i++)
+			miso[i] = ((sector >= 0) && (sim_protect_mask & (1 << sector))) ? 0xff : 0x00;
+		break;
+
+	case CMD_READ_OTP:
+		break;  // unprogrammed
+
+	case CMD_ACTIVE_STATUS_INTERRUPT:
+		break;  // SO timing is handled by spi_wait_so()
+
+	case CMD_RESET:
+		sim_wel = false;
+		break;
+
+	case CMD_DEEP_POWER_DOWN:
+		sim_dpd = true;
+		break;
+
+	case CMD_ULTRA_DEEP_POWER_DOWN:
+		sim_udpd = true;
+		break;
+
+	case CMD_RESUME_FROM_DEEP_POWER_DOWN:
+		break;  // not in deep power down
+
+	case CMD_DATAFLASH_CONFIGURE:
+		if (! sim_info->dataflash || (len < 4) || (mosi[1] != 0x2a))
+			goto unknown;
+		if ((mosi[2] == 0x80) && ((mosi[3] == 0xa6) || (mosi[3] == 0xa7)))
+		{
+			// page size configuration is non-volatile
+			sim_page_256 = mosi[3] == 0xa6;
+			sim_busy_until = end_ns + 1000ULL * sim_info->t_pp_max_us;
+		}
+		else if ((mosi[2] != 0x7f) || (mosi[3] != 0x9a))
+			goto unknown;
+		// else disable sector protection, which the model doesn't have
+		break;
+
+	case CMD_DATAFLASH_RMW_BUF1:
+	case CMD_DATAFLASH_RMW_BUF2:
+		if (! sim_info->dataflash)
+			goto unknown;
+		if (len > hdr)
+			sim_rmw(addr, mosi + hdr, len - hdr, end_ns);
+		break;
+
+	case CMD_CHIP_ERASE2:
+		if (sim_info->dataflash &&
+			((len < 4) || (mosi[1] != 0x94) || (mosi[2] != 0x80) || (mosi[3] != 0x9a)))
+			goto unknown;
+		// fall through
+	case CMD_CHIP_ERASE:
+		ei = sim_erase_info(mosi[0], false);
+		if (! ei)
+			goto unknown;
+		sim_erase(ei, 0, end_ns);
+		break;
+
+	default:
+		ei = sim_erase_info(mosi[0], true);
+		if (! ei || (len < hdr))
+			goto unknown;
+		sim_erase(ei, addr, end_ns);
+		break;
+	}
+	return;
+
+unknown:
+	sim_stats.unknown++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time at which the current program or erase will be done
+ * @return Simulated time, in the past if not busy
+ ******************************************************************************/
+uint64_t sim_flash_ready_ns(void)
+{
+	return sim_busy_until;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get counters
+ * @return Counters since the part was selected or the counters cleared
+ ******************************************************************************/
+const sim_flash_stats_t *sim_flash_stats(void)
+{
+	return & sim_stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Choose typical or maximum program and erase times
+ * @param[in] worst_case
+ * 		If true, program and erase take the datasheet maximum time
+ ******************************************************************************/
+void sim_flash_set_worst_case(bool worst_case)
+{
+	sim_worst_case = worst_case;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Clear counters
+ ******************************************************************************/
+void sim_flash_clear_stats(void)
+{
+	memset(& sim_stats, 0, sizeof(sim_stats));
+}
+
+/** @} (end addtogroup Sim_Flash) */
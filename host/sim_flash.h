@@ -0,0 +1,95 @@
+/****************************************************************************//**
+ * @file sim_flash.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef SIM_FLASH_H_
+#define SIM_FLASH_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "spiflash.h"
+
+/***************************************************************************//**
+ * @defgroup Sim_Flash
+ * @brief Behavioural model of the parts in spiflash_info_table
+ * @details
+ * 		Models the ID, the status register busy bit and write enable latch,
+ * 		program (1 to 0 only, wrapping within the page), the erase commands
+ * 		and sizes of the part, DataFlash page size, buffer read-modify-write
+ * 		and chip erase, sector and global protection, and deep and ultra
+ * 		deep power down. Program and erase take the datasheet typical time,
+ * 		or the maximum if set, from a table of the model's own, starting at
+ * 		the end of the command.
+ * 		Commands a real part would ignore are ignored, and counted. Commands
+ * 		sent before the wake time from power down has elapsed are counted,
+ * 		but executed, as parts usually accept them well before the
+ * 		datasheet maximum.
+ * @{
+ ******************************************************************************/
+
+typedef struct
+{
+	uint32_t commands;
+	uint32_t status_reads;
+	uint32_t programs;
+	uint32_t erases;
+	uint64_t bytes_read;
+	uint64_t bytes_programmed;
+	uint32_t early_after_wake;   // command before wake time had elapsed, executed anyway
+	uint32_t ignored_busy;       // command other than status received while busy
+	uint32_t ignored_power_down; // command other than resume received in deep power down
+	uint32_t ignored_no_wel;     // program, erase or protect without write enable
+	uint32_t ignored_protected;  // program or erase of a protected sector
+	uint32_t unknown;            // opcode not modelled
+} sim_flash_stats_t;
+
+void sim_flash_select(spiflash_id_t id);
+
+void sim_flash_transaction(const uint8_t *mosi,
+		                   uint8_t *miso,
+		                   size_t len,
+		                   uint64_t start_ns,
+		                   uint64_t end_ns);
+
+uint64_t sim_flash_ready_ns(void);
+
+const sim_flash_stats_t *sim_flash_stats(void);
+
+void sim_flash_set_worst_case(bool worst_case);
+
+void sim_flash_clear_stats(void);
+
+/** @} (end defgroup Sim_Flash) */
+
+#endif /* SIM_FLASH_H_ */
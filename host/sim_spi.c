@@ -0,0 +1,337 @@
+/******************************************************************************
+ * @file sim_spi.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fatal.h"
+#include "low_power.h"
+#include "sim_clock.h"
+#include "sim_flash.h"
+#include "spi.h"
+#include "spi_trace.h"
+
+/***************************************************************************//**
+ * @defgroup Sim_SPI
+ * @brief spi.c for the host build, connected to the simulated flash part
+ * @details
+ * 		Each transaction takes the time of its bytes at the bus bit rate,
+ * 		plus a fixed time for starting it and for the completion interrupt.
+ * 		The completion runs from the event queue, as it would from the
+ * 		USART interrupt.
+ * @{
+ ******************************************************************************/
+
+#define SIM_SPI_DEFAULT_BIT_RATE 1000000
+
+// Time to start a transaction and take its completion interrupt
+#define SIM_SPI_XFER_OVERHEAD_NS 10000
+
+// CS high time between a prefix command and the main command, for the
+// RX interrupt handler, unless the part needs longer
+#define SIM_SPI_CS_HIGH_NS 1000
+
+// Delay from the part going ready to the SO interrupt handler
+#define SIM_SPI_SO_LATENCY_NS 2000
+
+// Set by the host to charge each prefix as a transaction of its own, as if
+// it weren't sent in the same transfer as its command
+bool sim_spi_prefix_separate;
+
+static uint32_t spi_bit_rate;
+static uint32_t spi_cs_high_ns = SIM_SPI_CS_HIGH_NS;
+static bool spi_busy;
+static bool so_busy;
+
+static sim_event_t spi_event;
+static sim_event_t so_event;
+
+static spi_completion_fn_t *spi_completion;
+static void *spi_completion_ref;
+static spi_completion_fn_t *so_completion;
+static void *so_completion_ref;
+
+#if SPI_TRACE
+static spi_trace_record_t *spi_trace_xfer_record;
+static spi_trace_record_t *spi_trace_so_record;
+#endif
+
+// The timer ticks at 1 MHz, from the simulated clock, which keeps
+// counting in EM2
+
+uint32_t spi_timer_now(void)
+{
+	return sim_now_ns() / 1000;
+}
+
+uint32_t spi_timer_tick_hz(void)
+{
+	return 1000000;
+}
+
+void spi_timer_slept(uint64_t rtc_ticks)
+{
+	(void) rtc_ticks;
+}
+
+static uint8_t *spi_mosi;
+static uint8_t *spi_miso;
+static size_t spi_buf_size;
+
+/***************************************************************************//**
+ * @brief
+ *   Make sure the transaction buffers can hold a transaction
+ * @param[in] len
+ * 		Length of transaction
+ ******************************************************************************/
+static void spi_reserve(size_t len)
+{
+	if (len <= spi_buf_size)
+		return;
+	spi_mosi = realloc(spi_mosi, len);
+	spi_miso = realloc(spi_miso, len);
+	if (! spi_mosi || ! spi_miso)
+		fatal("spi: out of memory");
+	spi_buf_size = len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time for bytes on the bus
+ * @param[in] len
+ * 		Number of bytes
+ * @return Nanoseconds
+ ******************************************************************************/
+static uint64_t spi_bytes_ns(size_t len)
+{
+	return ((uint64_t) len * 8 * 1000000000ULL) / spi_bit_rate;
+}
+
+bool spi_active(void)
+{
+	return spi_busy;
+}
+
+void spi_set_cs_high_ns(uint32_t ns)
+{
+	spi_cs_high_ns = (ns > SIM_SPI_CS_HIGH_NS) ? ns : SIM_SPI_CS_HIGH_NS;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Transaction completion, as from the RX interrupt
+ * @param[in] *ref
+ * 		Unused
+ ******************************************************************************/
+static void spi_xfer_done(void *ref)
+{
+	(void) ref;
+
+	// copy completion fn ptr and ref arg, to avoid race condition
+	// if completion fn starts another SPI xfer
+	spi_completion_fn_t *completion = spi_completion;
+	void *completion_ref = spi_completion_ref;
+
+#if SPI_TRACE
+	spi_trace_end(spi_trace_xfer_record);
+#endif
+	spi_busy = false;
+	if (completion)
+		completion(completion_ref);
+}
+
+void spi_xfer_prefixed(size_t prefix_len,
+					   const uint8_t *prefix_data,
+					   size_t tx_len,
+					   const uint8_t *tx_data,
+					   size_t tx2_len,
+					   const uint8_t *tx2_data,
+					   bool half_duplex,
+					   size_t rx_len,
+					   uint8_t *rx_data,
+					   bool hold_cs_active,
+					   spi_completion_fn_t *completion,
+					   void *completion_ref)
+{
+	uint64_t t = sim_now_ns();
+	uint64_t prefix_gap_ns = sim_spi_prefix_separate ? SIM_SPI_XFER_OVERHEAD_NS : spi_cs_high_ns;
+	size_t len;
+	size_t rx_offset;
+
+	(void) hold_cs_active;  // only used around ASI, which the model doesn't need
+
+	if (spi_busy)
+		fatal("spi_xfer while busy");
+
+#if SPI_TRACE
+	// the prefix and the CS high time after it are modelled here, without
+	// the clock moving, so their times are filled in
+	if (prefix_len)
+	{
+		spi_trace_record_t *r = spi_trace_begin(SPI_TRACE_FLAG_PREFIX, prefix_len, prefix_data, prefix_len, 0);
+		spi_trace_end(r);
+		r->latency = spi_bytes_ns(prefix_len) / 1000;
+	}
+	spi_trace_xfer_record = spi_trace_begin((hold_cs_active ? SPI_TRACE_FLAG_HOLD_CS : 0) |
+			                                (half_duplex ? SPI_TRACE_FLAG_HALF_DUPLEX : 0) |
+			                                (completion ? SPI_TRACE_FLAG_ASYNC : 0),
+			                                tx_len, tx_data, tx_len + tx2_len, rx_len);
+	if (prefix_len)
+		spi_trace_xfer_record->start += (spi_bytes_ns(prefix_len) + prefix_gap_ns) / 1000;
+#endif
+
+	if (prefix_len)
+	{
+		spi_reserve(prefix_len);
+		sim_flash_transaction(prefix_data, spi_miso, prefix_len,
+				              t, t + spi_bytes_ns(prefix_len));
+		t += spi_bytes_ns(prefix_len) + prefix_gap_ns;
+	}
+
+	len = tx_len + tx2_len;
+	if (half_duplex)
+	{
+		rx_offset = len;
+		len += rx_len;
+	}
+	else
+	{
+		rx_offset = 0;
+		if (rx_len > len)
+			len = rx_len;
+	}
+	spi_reserve(len);
+
+	memset(spi_mosi, 0, len);
+	if (tx_len)
+		memcpy(spi_mosi, tx_data, tx_len);
+	if (tx2_len)
+		memcpy(spi_mosi + tx_len, tx2_data, tx2_len);
+
+	sim_flash_transaction(spi_mosi, spi_miso, len, t, t + spi_bytes_ns(len));
+	if (rx_len)
+		memcpy(rx_data, spi_miso + rx_offset, rx_len);
+	t += spi_bytes_ns(len) + SIM_SPI_XFER_OVERHEAD_NS;
+
+	spi_completion = completion;
+	spi_completion_ref = completion_ref;
+	spi_busy = true;
+	sim_schedule_at(& spi_event, t, spi_xfer_done, NULL);
+
+	if (! completion)
+		while (spi_busy)
+			enter_low_power_state();
+}
+
+void spi_xfer(size_t tx_len,
+			  const uint8_t *tx_data,
+			  size_t tx2_len,
+			  const uint8_t *tx2_data,
+			  bool half_duplex,
+			  size_t rx_len,
+			  uint8_t *rx_data,
+			  bool hold_cs_active,
+			  spi_completion_fn_t *completion,
+			  void *completion_ref)
+{
+	spi_xfer_prefixed(0, NULL,
+			          tx_len, tx_data,
+			          tx2_len, tx2_data,
+			          half_duplex,
+			          rx_len, rx_data,
+			          hold_cs_active,
+			          completion,
+			          completion_ref);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Active status interrupt, as from the SO pin GPIO interrupt
+ * @param[in] *ref
+ * 		Unused
+ ******************************************************************************/
+static void spi_so_done(void *ref)
+{
+	(void) ref;
+
+	spi_completion_fn_t *completion = so_completion;
+	void *completion_ref = so_completion_ref;
+
+#if SPI_TRACE
+	spi_trace_end(spi_trace_so_record);
+#endif
+	so_busy = false;
+	if (completion)
+		completion(completion_ref);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait for the part to signal ready on SO
+ * @note
+ * 		The level is taken to be the part's ready level; the interrupt
+ * 		is simulated when the part's program or erase is done.
+ ******************************************************************************/
+void spi_wait_so(uint8_t level,
+                 spi_completion_fn_t *completion,
+		         void *completion_ref)
+{
+	so_completion = completion;
+	so_completion_ref = completion_ref;
+	so_busy = true;
+
+#if SPI_TRACE
+	spi_trace_so_record = spi_trace_begin(SPI_TRACE_FLAG_SO_WAIT | (completion ? SPI_TRACE_FLAG_ASYNC : 0),
+			                              1, & level, 0, 0);
+#endif
+
+	if (sim_flash_ready_ns() <= sim_now_ns())
+		spi_so_done(NULL);  // already ready, as the real driver fakes the edge
+	else
+		sim_schedule_at(& so_event, sim_flash_ready_ns() + SIM_SPI_SO_LATENCY_NS, spi_so_done, NULL);
+
+	if (! completion)
+		while (so_busy)
+			enter_low_power_state();
+}
+
+void spi_init(int bit_rate)
+{
+	spi_bit_rate = bit_rate ? bit_rate : SIM_SPI_DEFAULT_BIT_RATE;
+	spi_busy = false;
+	so_busy = false;
+	sim_cancel(& spi_event);
+	sim_cancel(& so_event);
+}
+
+/** @} (end defgroup Sim_SPI) */
@@ -0,0 +1,375 @@
+/******************************************************************************
+ * @file bench.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "em_device.h"
+#include "em_cmu.h"
+
+#include "rtcdriver.h"
+
+#include "bench.h"
+#include "low_power.h"
+#include "spi.h"
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Bench
+ * @brief Timing of demo runs and of the flash operations within them
+ * @details
+ * 		Wall time of runs is from the RTC, since the demos wait for the
+ * 		flash in EM1 and EM2. Operations take from tens of microseconds,
+ * 		a page read, so their latency is from the SPI driver's timer of
+ * 		about 1 MHz rather than RTC ticks of 30.5 us. That timer stops in
+ * 		EM2, where the RTC fills in, so a latency including EM2 sleep is
+ * 		good to about an RTC tick. The DWT cycle counter stops with the
+ * 		core clock in EM1 and EM2, so it measures how much of the wall
+ * 		time the CPU was busy, which is what differs between e.g. SO
+ * 		interrupt and status polling.
+ *
+ * 		Per-operation latencies are kept for the percentile. Once
+ * 		BENCH_MAX_SAMPLES are held, every other one is dropped and only
+ * 		every other operation is kept from then on, so the samples stay
+ * 		spread over the whole benchmark. Minimum, mean and maximum cover
+ * 		every operation.
+ *
+ * 		Energy is estimated from the time each run spent in EM0, EM1 and
+ * 		EM2, as accounted by enter_low_power_state(), and the current
+ * 		table. It covers the MCU core only: peripherals, the LCD and the
+ * 		flash part itself are not included, but those are much the same
+ * 		whichever way the demo waits for the flash.
+ * @{
+ ******************************************************************************/
+
+#define BENCH_MAX_SAMPLES 512
+
+// EFM32LG typical figures at 3 V, from the datasheet
+#define BENCH_SUPPLY_MV       3000
+#define BENCH_EM0_NA_PER_MHZ  211000
+#define BENCH_EM1_NA_PER_MHZ  63000
+#define BENCH_EM2_NA          950
+
+static bench_current_t current =
+{
+	.supply_mv      = BENCH_SUPPLY_MV,
+	.em0_na_per_mhz = BENCH_EM0_NA_PER_MHZ,
+	.em1_na_per_mhz = BENCH_EM1_NA_PER_MHZ,
+	.em2_na         = BENCH_EM2_NA,
+};
+
+static uint32_t runs;
+static uint32_t ops;
+static uint32_t bytes;
+static uint64_t wall_ticks;
+static uint64_t cpu_cycles;
+static uint64_t clock_cycles;  // core clock cycles in the wall time
+static uint64_t em_ticks[3];
+static uint32_t em1_count;
+static uint32_t em2_count;
+static uint64_t energy_nj;
+
+static uint64_t run_start_ticks;
+static uint32_t run_start_cycles;
+static low_power_residency_t run_start_residency;
+
+static uint64_t lat_sum_ticks;  // ticks of spi_timer_now()
+static uint32_t lat_min_ticks;
+static uint32_t lat_max_ticks;
+
+static uint32_t samples[BENCH_MAX_SAMPLES];
+static uint32_t sample_count;
+static uint32_t sample_stride;
+static uint32_t sample_skip;
+
+/***************************************************************************//**
+ * @brief
+ *   Convert RTC ticks to microseconds
+ ******************************************************************************/
+static uint32_t bench_ticks_to_us(uint64_t ticks)
+{
+	return RTCDRV_TicksToMsec(ticks * 1000);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert operation latency ticks to microseconds
+ ******************************************************************************/
+static uint32_t bench_op_ticks_to_us(uint64_t ticks)
+{
+	return (ticks * 1000000) / spi_timer_tick_hz();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Enable the DWT cycle counter
+ ******************************************************************************/
+void bench_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	bench_start();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set the current table used for the energy estimate
+ * @param[in] *c
+ * 		Supply voltage and current by energy mode
+ ******************************************************************************/
+void bench_set_current(const bench_current_t *c)
+{
+	current = *c;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Discard results, to start a new benchmark
+ ******************************************************************************/
+void bench_start(void)
+{
+	runs = 0;
+	ops = 0;
+	bytes = 0;
+	wall_ticks = 0;
+	cpu_cycles = 0;
+	clock_cycles = 0;
+	em_ticks[0] = 0;
+	em_ticks[1] = 0;
+	em_ticks[2] = 0;
+	em1_count = 0;
+	em2_count = 0;
+	energy_nj = 0;
+	lat_sum_ticks = 0;
+	lat_min_ticks = UINT32_MAX;
+	lat_max_ticks = 0;
+	sample_count = 0;
+	sample_stride = 1;
+	sample_skip = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start timing a run
+ ******************************************************************************/
+void bench_run_start(void)
+{
+	low_power_get_residency(& run_start_residency);
+	run_start_cycles = DWT->CYCCNT;
+	run_start_ticks = RTCDRV_GetWallClockTicks64();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Stop timing a run, and add it to the results
+ * @note
+ * 		The core clock must not have been changed during the run.
+ ******************************************************************************/
+void bench_run_stop(void)
+{
+	uint64_t ticks = RTCDRV_GetWallClockTicks64() - run_start_ticks;
+	uint32_t cycles = DWT->CYCCNT - run_start_cycles;
+	uint32_t mhz = CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
+	low_power_residency_t r;
+	uint64_t em1;
+	uint64_t em2;
+	uint64_t em0;
+	uint64_t na_us;
+
+	low_power_get_residency(& r);
+	em1 = r.em1_ticks - run_start_residency.em1_ticks;
+	em2 = r.em2_ticks - run_start_residency.em2_ticks;
+	em0 = (ticks > (em1 + em2)) ? ticks - (em1 + em2) : 0;
+
+	runs++;
+	wall_ticks += ticks;
+	cpu_cycles += cycles;
+	clock_cycles += (uint64_t) bench_ticks_to_us(ticks) * mhz;
+	em_ticks[0] += em0;
+	em_ticks[1] += em1;
+	em_ticks[2] += em2;
+	em1_count += r.em1_count - run_start_residency.em1_count;
+	em2_count += r.em2_count - run_start_residency.em2_count;
+
+	na_us = (uint64_t) current.em0_na_per_mhz * mhz * bench_ticks_to_us(em0) +
+			(uint64_t) current.em1_na_per_mhz * mhz * bench_ticks_to_us(em1) +
+			(uint64_t) current.em2_na * bench_ticks_to_us(em2);
+	// mV * nA * us = 1e-18 J
+	energy_nj += (na_us / 1000) * current.supply_mv / 1000000;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Timestamp the start of an operation
+ * @return Start time, to be passed to bench_op_done()
+ ******************************************************************************/
+uint64_t bench_op_start(void)
+{
+	return spi_timer_now();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add a completed operation to the results
+ * @note
+ * 		May be called from interrupt context, e.g. from a completion, as
+ * 		long as operations of one benchmark complete either all in
+ * 		interrupt context or all in thread context.
+ * @param[in] start
+ * 		Value returned by bench_op_start() when the operation was started
+ * @param[in] op_bytes
+ * 		Bytes read, programmed or erased by the operation
+ ******************************************************************************/
+void bench_op_done(uint64_t start, uint32_t op_bytes)
+{
+	uint32_t ticks = spi_timer_now() - (uint32_t) start;  // the timer wraps after over an hour
+	uint32_t i;
+
+	ops++;
+	bytes += op_bytes;
+	lat_sum_ticks += ticks;
+	if (ticks < lat_min_ticks)
+		lat_min_ticks = ticks;
+	if (ticks > lat_max_ticks)
+		lat_max_ticks = ticks;
+
+	if (++sample_skip < sample_stride)
+		return;
+	sample_skip = 0;
+	if (sample_count == BENCH_MAX_SAMPLES)
+	{
+		for (i = 0; i < (BENCH_MAX_SAMPLES / 2); i++)
+			samples[i] = samples[2 * i + 1];
+		sample_count = BENCH_MAX_SAMPLES / 2;
+		sample_stride *= 2;
+	}
+	samples[sample_count++] = ticks;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Sort comparison for latency samples
+ ******************************************************************************/
+static int bench_compare_samples(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Compute the results of the runs and operations timed so far
+ * @note
+ * 		Sorts the latency samples, so further operations should not be
+ * 		added until bench_start() is called again.
+ * @param[out] *result
+ * 		Results
+ ******************************************************************************/
+void bench_get_result(bench_result_t *result)
+{
+	uint32_t wall_us = bench_ticks_to_us(wall_ticks);
+
+	if (wall_us == 0)
+		wall_us = 1;
+
+	result->runs = runs;
+	result->ops = ops;
+	result->bytes = bytes;
+	result->wall_ms = RTCDRV_TicksToMsec(wall_ticks);
+	result->cpu_percent = clock_cycles ? (cpu_cycles * 100) / clock_cycles : 0;
+	if (result->cpu_percent > 100)
+		result->cpu_percent = 100;
+	result->kib_per_sec = (((uint64_t) bytes * 1000000) / wall_us) >> 10;
+	result->ops_per_sec = ((uint64_t) ops * 1000000) / wall_us;
+	result->em0_ms = RTCDRV_TicksToMsec(em_ticks[0]);
+	result->em1_ms = RTCDRV_TicksToMsec(em_ticks[1]);
+	result->em2_ms = RTCDRV_TicksToMsec(em_ticks[2]);
+	result->em1_count = em1_count;
+	result->em2_count = em2_count;
+	result->energy_uj = energy_nj / 1000;
+	result->nj_per_kib = bytes ? (energy_nj * 1024) / bytes : 0;
+
+	if (! ops)
+	{
+		result->lat_min_us = 0;
+		result->lat_mean_us = 0;
+		result->lat_p99_us = 0;
+		result->lat_max_us = 0;
+		return;
+	}
+
+	qsort(samples, sample_count, sizeof(samples[0]), bench_compare_samples);
+	result->lat_min_us = bench_op_ticks_to_us(lat_min_ticks);
+	result->lat_mean_us = bench_op_ticks_to_us(lat_sum_ticks / ops);
+	result->lat_p99_us = bench_op_ticks_to_us(samples[(sample_count * 99 + 99) / 100 - 1]);
+	result->lat_max_us = bench_op_ticks_to_us(lat_max_ticks);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Print the results
+ * @note
+ * 		The serial port must be open.
+ * @param[in] *title
+ * 		First line of the report, e.g. what was run and how
+ ******************************************************************************/
+void bench_report(const char *title)
+{
+	bench_result_t r;
+
+	bench_get_result(& r);
+	printf("\r\n%s\r\n", title);
+	printf("runs %" PRIu32 "  wall %" PRIu32 " ms  cpu %" PRIu32 "%%\r\n",
+		   r.runs, r.wall_ms, r.cpu_percent);
+	printf("EM0 %" PRIu32 " ms  EM1 %" PRIu32 " ms x%" PRIu32 "  EM2 %" PRIu32 " ms x%" PRIu32 "  energy %" PRIu32 " uJ\r\n",
+		   r.em0_ms, r.em1_ms, r.em1_count, r.em2_ms, r.em2_count, r.energy_uj);
+	if (! r.ops)
+		return;
+	printf("ops %" PRIu32 "  bytes %" PRIu32 "  KiB/s %" PRIu32 "  ops/s %" PRIu32 "\r\n",
+		   r.ops, r.bytes, r.kib_per_sec, r.ops_per_sec);
+	printf("latency us  min %" PRIu32 "  mean %" PRIu32 "  p99 %" PRIu32 "  max %" PRIu32 "\r\n",
+		   r.lat_min_us, r.lat_mean_us, r.lat_p99_us, r.lat_max_us);
+	printf("uJ/KiB %" PRIu32 ".%03" PRIu32 "\r\n", r.nj_per_kib / 1000, r.nj_per_kib % 1000);
+}
+
+/** @} (end addtogroup Bench) */
+/** @} (end addtogroup AppManagement) */
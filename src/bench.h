@@ -0,0 +1,118 @@
+/****************************************************************************//**
+ * @file bench.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup Bench
+ * @brief Timing of demo runs and of the flash operations within them
+ * @{
+ ******************************************************************************/
+
+// MCU supply current by energy mode, for the energy estimate
+typedef struct
+{
+	uint32_t supply_mv;
+	uint32_t em0_na_per_mhz;  // running, per MHz of core clock
+	uint32_t em1_na_per_mhz;  // sleeping with high frequency clocks on
+	uint32_t em2_na;          // deep sleep
+} bench_current_t;
+
+typedef struct
+{
+	uint32_t runs;          // runs timed since bench_start()
+	uint32_t ops;           // operations timed
+	uint32_t bytes;         // bytes covered by the timed operations
+	uint32_t wall_ms;       // total time of the runs, by RTC
+	uint32_t cpu_percent;   // share of that time the core clock ran, by DWT
+	uint32_t kib_per_sec;   // bytes / wall time
+	uint32_t ops_per_sec;   // ops / wall time
+	uint32_t lat_min_us;    // per-operation latency, by the SPI driver's timer
+	uint32_t lat_mean_us;
+	uint32_t lat_p99_us;
+	uint32_t lat_max_us;
+	uint32_t em0_ms;        // wall time by energy mode
+	uint32_t em1_ms;
+	uint32_t em2_ms;
+	uint32_t em1_count;     // times each sleep mode was entered
+	uint32_t em2_count;
+	uint32_t energy_uj;     // estimated MCU energy
+	uint32_t nj_per_kib;    // energy / bytes, 0 if no bytes
+} bench_result_t;
+
+// Define BENCH_SIM_CPU to 1 in the host build, whose simulated clock
+// otherwise only moves when the firmware sleeps, so that code of a known
+// cost can charge its cycles with BENCH_CPU_CYCLES(). On the board the
+// code takes its own time, and BENCH_CPU_CYCLES() is empty.
+#ifndef BENCH_SIM_CPU
+#define BENCH_SIM_CPU 0
+#endif
+
+#if BENCH_SIM_CPU
+void sim_cpu_cycles(uint32_t cycles);
+#define BENCH_CPU_CYCLES(cycles) sim_cpu_cycles(cycles)
+#else
+#define BENCH_CPU_CYCLES(cycles) ((void) 0)
+#endif
+
+void bench_init(void);
+
+void bench_set_current(const bench_current_t *current);
+
+void bench_start(void);
+
+void bench_run_start(void);
+
+void bench_run_stop(void);
+
+uint64_t bench_op_start(void);
+
+void bench_op_done(uint64_t start, uint32_t bytes);
+
+void bench_get_result(bench_result_t *result);
+
+void bench_report(const char *title);
+
+/** @} (end defgroup Bench) */
+/** @} (end addtogroup AppManagement) */
+
+#endif /* BENCH_H_ */
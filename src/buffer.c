@@ -31,8 +31,8 @@
  *
  ******************************************************************************/
 
+#include <assert.h>
 #include <string.h>
-#include "em_int.h"
 #include "buffer.h"
 
 
@@ -44,41 +44,70 @@
 /***************************************************************************//**
  * @addtogroup Buffer
  * @brief Buffer definitions, initializations, and handler routines
+ * @details
+ * 		Each buffer has one writer and one reader, e.g. a thread and an
+ * 		interrupt handler, which may run concurrently. No interrupts are
+ * 		masked: the writer alone updates head, and the reader alone
+ * 		updates tail. Both count bytes from the start and wrap only at the
+ * 		integer size, so head - tail is the amount of data even after
+ * 		wrapping, and a full buffer is told apart from an empty one
+ * 		without a shared count. The capacity is a power of two, so the
+ * 		index into the data is a mask of head or tail.
+ *
+ * 		Each side loads the other's index with acquire ordering before
+ * 		touching the data, and stores its own with release ordering after.
+ * 		So the reader never sees a byte before it is written, and the
+ * 		writer never reuses space before it is read. On the Cortex-M3
+ * 		these are plain loads and stores with a DMB.
  * @{
  ******************************************************************************/
 
 typedef struct buf
 {
-  size_t size;
-  volatile size_t count;
-  size_t write_idx;
-  size_t read_idx;
+  uint32_t mask;           // capacity - 1
+  volatile uint32_t head;  // bytes written, updated by the writer only
+  volatile uint32_t tail;  // bytes read, updated by the reader only
   uint8_t data[0];
 } buf_t;
 
+#define BUF_LOAD_ACQUIRE(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define BUF_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
 /****************************************************************************//**
  * @brief  Buffer Initialization
+ * @note
+ * 		The capacity is the largest power of two which fits in the raw
+ * 		buffer after the control block. Use BUF_RAW_SIZE() to size the raw
+ * 		buffer for a given capacity.
  *
  * @param[in] *raw_buf
  * 		Pointer to buffer
  * @param[in] size
- * 		Size of Buffer
+ * 		Size of Buffer, at least BUF_RAW_SIZE(1)
  * @return buf
  *
  *****************************************************************************/
 buf_t *init_buf(uint8_t *raw_buf, size_t size)
 {
 	buf_t *buf = (buf_t *) raw_buf;
+	uint32_t capacity = 1;
+
+	assert(size >= sizeof(buf_t) + 1);
+	while (capacity <= (size - sizeof(buf_t)) / 2)
+		capacity *= 2;
+
 	memset(buf, 0, size);
-	buf->size = size - sizeof(buf_t);
-	buf->count = 0;
-	buf->write_idx = 0;
-	buf->read_idx = 0;
+	buf->mask = capacity - 1;
+	buf->head = 0;
+	buf->tail = 0;
 	return buf;
 }
 
 /****************************************************************************//**
  * @brief Checks if buffer is full
+ * @note
+ * 		Exact for the writer. For the reader it may become true at any
+ * 		time.
  *
  * @param[in] *buf
  * 		Pointer to buffer
@@ -87,11 +116,14 @@ buf_t *init_buf(uint8_t *raw_buf, size_t size)
  *****************************************************************************/
 bool buf_full(buf_t *buf)
 {
-	return buf->count == buf->size;
+	return (buf->head - BUF_LOAD_ACQUIRE(& buf->tail)) > buf->mask;
 }
 
 /****************************************************************************//**
  * @brief Checks if buffer is empty
+ * @note
+ * 		Exact for the reader. For the writer it may become true at any
+ * 		time.
  *
  * @param[in] *buf
  * 		Pointer to buffer
@@ -100,7 +132,22 @@ bool buf_full(buf_t *buf)
  *****************************************************************************/
 bool buf_empty(buf_t *buf)
 {
-	return buf->count == 0;
+	return BUF_LOAD_ACQUIRE(& buf->head) == buf->tail;
+}
+
+/****************************************************************************//**
+ * @brief Free space in buffer
+ * @note
+ * 		Exact for the writer. For the reader it may shrink at any time.
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @return Bytes which can be written
+ *
+ *****************************************************************************/
+size_t buf_space(buf_t *buf)
+{
+	return buf->mask + 1 - (BUF_LOAD_ACQUIRE(& buf->head) - BUF_LOAD_ACQUIRE(& buf->tail));
 }
 
 /****************************************************************************//**
@@ -115,14 +162,12 @@ bool buf_empty(buf_t *buf)
  *****************************************************************************/
 bool buf_write_byte(buf_t *buf, const uint8_t data)
 {
-	if (buf->count >= buf->size)
+	uint32_t head = buf->head;
+
+	if ((head - BUF_LOAD_ACQUIRE(& buf->tail)) > buf->mask)
 		return false;  // no room
-	buf->data[buf->write_idx++] = data;
-	if (buf->write_idx >= buf->size)
-		buf->write_idx = 0;
-	INT_Disable();
-	buf->count++;
-	INT_Enable();
+	buf->data[head & buf->mask] = data;
+	BUF_STORE_RELEASE(& buf->head, head + 1);
 	return true;
 }
 
@@ -138,17 +183,152 @@ bool buf_write_byte(buf_t *buf, const uint8_t data)
  *****************************************************************************/
 bool buf_read_byte(buf_t *buf, uint8_t *data)
 {
-	if (buf->count == 0)
+	uint32_t tail = buf->tail;
+
+	if (BUF_LOAD_ACQUIRE(& buf->head) == tail)
 		return false;  // no data
-	*data = buf->data[buf->read_idx++];
-	if (buf->read_idx >= buf->size)
-		buf->read_idx = 0;
-	INT_Disable();
-	buf->count--;
-	INT_Enable();
+	*data = buf->data[tail & buf->mask];
+	BUF_STORE_RELEASE(& buf->tail, tail + 1);
 	return true;
 }
 
+/****************************************************************************//**
+ * @brief  Get the contiguous free space at the write position
+ * @note
+ * 		The space is filled by the caller, then added to the buffer with
+ * 		buf_write_commit(). It stops at the end of the storage, so may be
+ * 		less than the total free space until the write position wraps.
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @param[out] **span
+ * 		Start of the free space
+ * @return Number of bytes which can be written at span
+ *
+ *****************************************************************************/
+size_t buf_write_span(buf_t *buf, uint8_t **span)
+{
+	uint32_t head = buf->head;
+	uint32_t room = buf->mask + 1 - (head - BUF_LOAD_ACQUIRE(& buf->tail));
+	uint32_t to_end = buf->mask + 1 - (head & buf->mask);
+
+	*span = & buf->data[head & buf->mask];
+	return room < to_end ? room : to_end;
+}
+
+/****************************************************************************//**
+ * @brief  Add bytes written into the span from buf_write_span()
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @param[in] len
+ * 		Number of bytes written, no more than the span length
+ *
+ *****************************************************************************/
+void buf_write_commit(buf_t *buf, size_t len)
+{
+	BUF_STORE_RELEASE(& buf->head, buf->head + len);
+}
+
+/****************************************************************************//**
+ * @brief  Get the contiguous data at the read position, without removing it
+ * @note
+ * 		The data is removed with buf_read_consume(). Like
+ * 		buf_write_span(), it stops at the end of the storage.
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @param[out] **span
+ * 		Start of the data
+ * @return Number of bytes which can be read at span
+ *
+ *****************************************************************************/
+size_t buf_read_span(buf_t *buf, uint8_t **span)
+{
+	uint32_t tail = buf->tail;
+	uint32_t count = BUF_LOAD_ACQUIRE(& buf->head) - tail;
+	uint32_t to_end = buf->mask + 1 - (tail & buf->mask);
+
+	*span = & buf->data[tail & buf->mask];
+	return count < to_end ? count : to_end;
+}
+
+/****************************************************************************//**
+ * @brief  Remove bytes read from the span from buf_read_span()
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @param[in] len
+ * 		Number of bytes read, no more than the span length
+ *
+ *****************************************************************************/
+void buf_read_consume(buf_t *buf, size_t len)
+{
+	BUF_STORE_RELEASE(& buf->tail, buf->tail + len);
+}
+
+/****************************************************************************//**
+ * @brief  Buffer Write
+ * @note
+ * 		Copies as much as there is room for, in at most two pieces.
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @param[in] *data
+ * 		Data to write
+ * @param[in] len
+ * 		Length of data
+ * @return Number of bytes written, less than len if the buffer filled
+ *
+ *****************************************************************************/
+size_t buf_write(buf_t *buf, const uint8_t *data, size_t len)
+{
+	uint32_t head = buf->head;
+	uint32_t room = buf->mask + 1 - (head - BUF_LOAD_ACQUIRE(& buf->tail));
+	uint32_t first = buf->mask + 1 - (head & buf->mask);
+
+	if (len > room)
+		len = room;
+	if (first > len)
+		first = len;
+
+	memcpy(& buf->data[head & buf->mask], data, first);
+	memcpy(buf->data, data + first, len - first);
+	BUF_STORE_RELEASE(& buf->head, head + len);
+	return len;
+}
+
+/****************************************************************************//**
+ * @brief  Buffer Read
+ * @note
+ * 		Copies as much as is available, in at most two pieces.
+ *
+ * @param[in] *buf
+ * 		Pointer to buffer
+ * @param[out] *data
+ * 		Where to copy the data
+ * @param[in] len
+ * 		Maximum length to read
+ * @return Number of bytes read, less than len if the buffer emptied
+ *
+ *****************************************************************************/
+size_t buf_read(buf_t *buf, uint8_t *data, size_t len)
+{
+	uint32_t tail = buf->tail;
+	uint32_t count = BUF_LOAD_ACQUIRE(& buf->head) - tail;
+	uint32_t first = buf->mask + 1 - (tail & buf->mask);
+
+	if (len > count)
+		len = count;
+	if (first > len)
+		first = len;
+
+	memcpy(data, & buf->data[tail & buf->mask], first);
+	memcpy(data + first, buf->data, len - first);
+	BUF_STORE_RELEASE(& buf->tail, tail + len);
+	return len;
+}
+
 /****************************************************************************//**
  * @brief  Buffer Write Char
  *
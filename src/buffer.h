@@ -54,16 +54,33 @@
 
 typedef struct buf buf_t;
 
+// Raw buffer size for init_buf() to give a capacity, a power of two
+#define BUF_RAW_SIZE(capacity) ((capacity) + 3 * sizeof(uint32_t))
+
 buf_t *init_buf(uint8_t *raw_buf, size_t size);
 
 bool buf_full(buf_t *buf);
 
 bool buf_empty(buf_t *buf);
 
+size_t buf_space(buf_t *buf);
+
 bool buf_write_byte(buf_t *buf, const uint8_t data);
 
 bool buf_read_byte(buf_t *buf, uint8_t *data);
 
+size_t buf_write_span(buf_t *buf, uint8_t **span);
+
+void buf_write_commit(buf_t *buf, size_t len);
+
+size_t buf_read_span(buf_t *buf, uint8_t **span);
+
+void buf_read_consume(buf_t *buf, size_t len);
+
+size_t buf_write(buf_t *buf, const uint8_t *data, size_t len);
+
+size_t buf_read(buf_t *buf, uint8_t *data, size_t len);
+
 bool buf_write_char(buf_t *buf, const char c);
 
 bool buf_read_char(buf_t *buf, char *c);
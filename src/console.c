@@ -0,0 +1,837 @@
+/******************************************************************************
+ * @file console.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtcdriver.h"
+
+#include "console.h"
+#include "demo_serial.h"
+#include "hex_dump.h"
+#include "link.h"
+#include "main.h"
+#include "serial.h"
+#include "spiflash.h"
+#include "spi_trace.h"
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Console
+ * @brief Command console on the serial port
+ * @details
+ * 		Lines typed on the serial port are run as commands, for the flash
+ * 		driver and for the demos, so that anything the buttons and slider
+ * 		do can be scripted. console_poll() takes whatever has been
+ * 		received and returns, so the menus keep working while the console
+ * 		is open. Backspace, ^U (erase line) and ^C (cancel line) are
+ * 		handled. A command's output is complete when the next prompt is
+ * 		sent, which is what scripts should wait for.
+ *
+ * 		Numbers may be decimal or 0x hex, with a k or m suffix for KiB or
+ * 		MiB. Demo and CONFIG item names are as shown on the LCD, in either
+ * 		case.
+ *
+ * 		The flash part is kept awake while the console is open, since
+ * 		leaving ultra deep power down resets it, including sector
+ * 		protection. It is woken when needed after a demo run or the pd
+ * 		command, and put back in ultra deep power down on closing.
+ * @{
+ ******************************************************************************/
+
+#define CONSOLE_LINE_SIZE 80
+#define CONSOLE_MAX_ARGS  10
+#define CONSOLE_MAX_CHOICES 16
+
+#define CONSOLE_PROMPT "> "
+
+typedef bool console_fn_t(int argc, char *argv[]);
+
+typedef struct
+{
+	const char *name;
+	const char *args;
+	console_fn_t *fn;
+	const char *help;
+} console_cmd_t;
+
+extern spiflash_id_t part;  // detected part, in main.c
+
+static bool is_open;
+static char line[CONSOLE_LINE_SIZE];
+static int line_len;
+static int last_char;
+typedef enum
+{
+	CONSOLE_AWAKE,
+	CONSOLE_DPD,    // deep power down
+	CONSOLE_UDPD    // ultra deep power down, as left by the demos
+} console_power_t;
+
+static console_power_t power;
+
+static console_fn_t console_help;
+static console_fn_t console_id;
+static console_fn_t console_status;
+static console_fn_t console_read;
+static console_fn_t console_write;
+static console_fn_t console_verify;
+static console_fn_t console_erase;
+static console_fn_t console_protect;
+static console_fn_t console_pd;
+static console_fn_t console_run;
+static console_fn_t console_set;
+static console_fn_t console_stats;
+static console_fn_t console_trace;
+static console_fn_t console_link;
+static console_fn_t console_exit;
+
+static const console_cmd_t console_cmds[] =
+{
+	{ "help",    "",                      console_help,    "list commands" },
+	{ "id",      "",                      console_id,      "part name, size and ID bytes" },
+	{ "status",  "",                      console_status,  "status registers" },
+	{ "read",    "addr [len]",            console_read,    "hex and ASCII, 256 bytes by default" },
+	{ "write",   "addr len [seed]",       console_write,   "program pattern (seed + address) & 0xff" },
+	{ "verify",  "addr len [seed]",       console_verify,  "compare with the write pattern" },
+	{ "erase",   "addr len [size]",       console_erase,   "erase, with one erase size or automatic" },
+	{ "protect", "addr len 0|1",          console_protect, "unprotect or protect sectors, most parts protected at reset" },
+	{ "pd",      "deep|ultra",            console_pd,      "power down until the next command, ultra may reset protection" },
+	{ "run",     "demo [choice ...]",     console_run,     "run a demo and report, for each choice (all by default)" },
+	{ "set",     "item value",            console_set,     "set a CONFIG item, e.g. set ERA SZ 4" },
+	{ "stats",   "",                      console_stats,   "report of the last demo run" },
+	{ "trace",   "",                      console_trace,   "binary SPI trace of the last demo run" },
+	{ "link",    "",                      console_link,    "binary protocol of tools/flashlink.py, until it quits" },
+	{ "exit",    "",                      console_exit,    "close the console" },
+};
+
+#define CONSOLE_CMD_COUNT (sizeof(console_cmds) / sizeof(console_cmd_t))
+
+/***************************************************************************//**
+ * @brief
+ *   Parse a number
+ * @param[in] *s
+ * 		Decimal or 0x hex, with an optional k or m suffix
+ * @param[out] *value
+ * 		Value
+ * @return TRUE if valid, and within 32 bits once scaled
+ ******************************************************************************/
+static bool console_number(const char *s, uint32_t *value)
+{
+	unsigned long long n;
+	unsigned int shift = 0;
+	char *end;
+
+	if (! isdigit((unsigned char) *s))
+		return false;  // strtoull() would take a sign or spaces
+	errno = 0;
+	n = strtoull(s, & end, 0);
+	if ((errno == ERANGE) || (n > UINT32_MAX))
+		return false;
+	if ((*end == 'k') || (*end == 'K'))
+	{
+		shift = 10;
+		end++;
+	}
+	else if ((*end == 'm') || (*end == 'M'))
+	{
+		shift = 20;
+		end++;
+	}
+	if ((*end != '\0') || (n > (UINT32_MAX >> shift)))
+		return false;
+	*value = n << shift;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert an argument to upper case, for menu names
+ ******************************************************************************/
+static void console_upper(char *s)
+{
+	for (; *s; s++)
+		*s = toupper((unsigned char) *s);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Parse address and length arguments, and check them against the part
+ * @param[in] argc
+ * 		Number of arguments, including the command
+ * @param[in] *argv[]
+ * 		Arguments
+ * @param[in] default_len
+ * 		Length if not given, or 0 if required
+ * @param[out] *addr
+ * 		Address
+ * @param[out] *len
+ * 		Length
+ * @return TRUE if valid
+ ******************************************************************************/
+static bool console_range(int argc, char *argv[], uint32_t default_len, uint32_t *addr, uint32_t *len)
+{
+	uint32_t device_size = spiflash_info_table[part].device_size;
+
+	if ((argc < 2) || ! console_number(argv[1], addr))
+		return false;
+	*len = default_len;
+	if ((argc >= 3) && ! console_number(argv[2], len))
+		return false;
+	if ((*len == 0) || (*addr >= device_size) || (*len > device_size - *addr))
+	{
+		printf("range outside the %" PRIu32 " byte part\r\n", device_size);
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wake the part up for a command, if powered down
+ ******************************************************************************/
+static void console_flash_begin(void)
+{
+	if (power == CONSOLE_DPD)
+		spiflash_deep_power_down(false, NULL, NULL);
+	else if (power == CONSOLE_UDPD)
+	{
+		spiflash_ultra_deep_power_down(false, NULL, NULL);
+		spiflash_ultra_deep_power_down(false, NULL, NULL);
+	}
+	power = CONSOLE_AWAKE;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Fill a buffer with the write pattern
+ * @param[out] *buf
+ * 		Buffer
+ * @param[in] addr
+ * 		Flash address of the first byte
+ * @param[in] len
+ * 		Length
+ * @param[in] seed
+ * 		Pattern seed
+ ******************************************************************************/
+static void console_pattern(uint8_t *buf, uint32_t addr, uint32_t len, uint32_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = seed + addr + i;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Refuse a program or erase of a protected range
+ * @param[in] *what
+ * 		Command name
+ * @param[in] addr
+ * 		Address
+ * @param[in] len
+ * 		Length
+ * @return TRUE if the range is protected, and the command has been refused
+ ******************************************************************************/
+static bool console_protected(const char *what, uint32_t addr, uint32_t len)
+{
+	if (! spiflash_range_protected(addr, len))
+		return false;
+	printf("%s refused: range is protected, see protect\r\n", what);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Report a program or erase which the part says has failed
+ * @param[in] *what
+ * 		Command name
+ * @param[in] addr
+ * 		Address of the failed operation
+ * @return TRUE if the part reports an error
+ ******************************************************************************/
+static bool console_failed(const char *what, uint32_t addr)
+{
+	if (! spiflash_op_failed())
+		return false;
+	printf("%s failed at %08" PRIx32 ": the part reports an error\r\n", what, addr);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Print the time since a command started
+ ******************************************************************************/
+static void console_done(uint64_t start)
+{
+	printf("done in %" PRIu32 " ms\r\n",
+		   RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: help
+ * @note
+ * 		List commands
+ ******************************************************************************/
+static bool console_help(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	unsigned int i;
+
+	for (i = 0; i < CONSOLE_CMD_COUNT; i++)
+		printf("%-8s %-18s %s\r\n", console_cmds[i].name, console_cmds[i].args, console_cmds[i].help);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: id
+ * @note
+ * 		Part name, size and ID bytes
+ ******************************************************************************/
+static bool console_id(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	uint8_t id[4];
+
+	console_flash_begin();
+	spiflash_read_id(sizeof(id), id, NULL, NULL);
+	printf("%s, %" PRIu32 " bytes, ID %02x %02x %02x %02x\r\n",
+		   spiflash_info_table[part].name, (uint32_t) spiflash_info_table[part].device_size,
+		   id[0], id[1], id[2], id[3]);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: status
+ * @note
+ * 		Status registers
+ ******************************************************************************/
+static bool console_status(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	uint8_t status[2];
+
+	console_flash_begin();
+	spiflash_read_status(sizeof(status), status, NULL, NULL);
+	printf("status %02x %02x\r\n", status[0], status[1]);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: read addr [len]
+ * @note
+ * 		Hex dump with ASCII, 256 bytes by default. Repeated rows show
+ * 		as "*".
+ ******************************************************************************/
+static bool console_read(int argc, char *argv[])
+{
+	uint32_t addr;
+	uint32_t len;
+
+	if (! console_range(argc, argv, 256, & addr, & len))
+		return false;
+
+	console_flash_begin();
+	demo_serial_dump(addr, len, HEX_DUMP_ASCII | HEX_DUMP_SKIP_REPEATS);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: write addr len [seed]
+ * @note
+ * 		Program pattern (seed + address) & 0xff. Refused if any of the range
+ * 		is protected; the part's error status is checked after each buffer.
+ ******************************************************************************/
+static bool console_write(int argc, char *argv[])
+{
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint32_t addr;
+	uint32_t len;
+	uint32_t seed = 0;
+	uint32_t n;
+
+	if (! console_range(argc, argv, 0, & addr, & len))
+		return false;
+	if ((argc >= 4) && ! console_number(argv[3], & seed))
+		return false;
+
+	console_flash_begin();
+	if (console_protected("write", addr, len))
+		return true;
+	for (; len; addr += n, len -= n)
+	{
+		n = len < sizeof(buf1) ? len : sizeof(buf1);
+		console_pattern(buf1, addr, n, seed);
+		spiflash_write(addr, n, buf1, false, NULL, NULL);
+		if (console_failed("write", addr))
+			return true;
+	}
+	console_done(start);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: verify addr len [seed]
+ * @note
+ * 		Compare with the write pattern
+ ******************************************************************************/
+static bool console_verify(int argc, char *argv[])
+{
+	uint32_t addr;
+	uint32_t len;
+	uint32_t seed = 0;
+	uint32_t n;
+	uint32_t i;
+	uint32_t errors = 0;
+	uint32_t first_error = 0;
+
+	if (! console_range(argc, argv, 0, & addr, & len))
+		return false;
+	if ((argc >= 4) && ! console_number(argv[3], & seed))
+		return false;
+
+	console_flash_begin();
+	for (; len; addr += n, len -= n)
+	{
+		n = len < sizeof(buf1) ? len : sizeof(buf1);
+		console_pattern(buf1, addr, n, seed);
+		spiflash_read(addr, n, buf2, NULL, NULL);
+		for (i = 0; i < n; i++)
+			if ((buf1[i] != buf2[i]) && (errors++ == 0))
+				first_error = addr + i;
+	}
+
+	if (errors)
+		printf("%" PRIu32 " bytes differ, first at %08" PRIx32 "\r\n", errors, first_error);
+	else
+		printf("ok\r\n");
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: erase addr len [size]
+ * @note
+ * 		Erase, with one erase size or automatic. Refused if any of the range
+ * 		is protected.
+ ******************************************************************************/
+static bool console_erase(int argc, char *argv[])
+{
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint32_t addr;
+	uint32_t len;
+	uint32_t size = 0;
+	bool ok;
+
+	if (! console_range(argc, argv, 0, & addr, & len))
+		return false;
+	if ((argc >= 4) && ! console_number(argv[3], & size))
+		return false;
+
+	console_flash_begin();
+	if (console_protected("erase", addr, len))
+		return true;
+	ok = spiflash_erase(addr, len, size, false, NULL, NULL);
+
+	if (! ok)
+		printf("erase refused: range not aligned to an erase size of the part\r\n");
+	else if (! console_failed("erase", addr))
+		console_done(start);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: protect addr len 0|1
+ * @note
+ * 		Unprotect or protect sectors
+ ******************************************************************************/
+static bool console_protect(int argc, char *argv[])
+{
+	uint32_t addr;
+	uint32_t len;
+	uint32_t protect;
+	bool ok;
+
+	if ((argc != 4) || ! console_range(argc, argv, 0, & addr, & len) ||
+		! console_number(argv[3], & protect))
+		return false;
+
+	console_flash_begin();
+	ok = spiflash_set_range_protection(protect != 0, addr, len);
+
+	printf("%s\r\n", ok ? "ok" : "refused: part has no sector protection");
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: pd deep|ultra
+ * @note
+ * 		Enter deep or ultra deep power down
+ ******************************************************************************/
+static bool console_pd(int argc, char *argv[])
+{
+	if (argc != 2)
+		return false;
+
+	if (strcmp(argv[1], "deep") == 0)
+	{
+		console_flash_begin();
+		spiflash_deep_power_down(true, NULL, NULL);
+		power = CONSOLE_DPD;
+	}
+	else if (strcmp(argv[1], "ultra") == 0)
+	{
+		console_flash_begin();
+		spiflash_ultra_deep_power_down(true, NULL, NULL);
+		power = CONSOLE_UDPD;
+	}
+	else
+		return false;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: run demo [choice ...]
+ * @note
+ * 		Run a demo and report, for each choice (all by default). Output
+ * 		during a run is dropped if the TX buffer is full, rather than
+ * 		holding up the run.
+ ******************************************************************************/
+static bool console_run(int argc, char *argv[])
+{
+	int32_t choices[CONSOLE_MAX_CHOICES];
+	int count;
+	int i;
+	uint32_t value;
+	uint32_t dropped;
+	bool ok;
+
+	if (argc < 2)
+		return false;
+	console_upper(argv[1]);
+
+	if (argc == 2)
+		count = demo_get_choices(argv[1], choices, CONSOLE_MAX_CHOICES);
+	else
+	{
+		for (count = 0; count + 2 < argc; count++)
+		{
+			if (! console_number(argv[count + 2], & value))
+				return false;
+			choices[count] = value;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		// a demo starts by waking the part from ultra deep power down,
+		// and leaves it there
+		console_flash_begin();
+		spiflash_ultra_deep_power_down(true, NULL, NULL);
+		power = CONSOLE_UDPD;
+		// output during the run mustn't wait for the serial port
+		serial_set_tx_nonblocking(true);
+		ok = demo_run_state(argv[1], choices[i]);
+		dropped = serial_set_tx_nonblocking(false);
+		if (! ok)
+		{
+			printf("%s %" PRId32 ": not available\r\n", argv[1], choices[i]);
+			continue;
+		}
+		if (dropped)
+			printf("(%" PRIu32 " bytes of output dropped)\r\n", dropped);
+		printf("%s %" PRId32 ": %s %d\r\n", argv[1], choices[i], message_text, message_number);
+		demo_print_report();
+	}
+	if (count == 0)
+		printf("%s: no such demo\r\n", argv[1]);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: set item value
+ * @note
+ * 		Set a CONFIG item, e.g. set ERA SZ 4
+ ******************************************************************************/
+static bool console_set(int argc, char *argv[])
+{
+	char name[16];
+	uint32_t value;
+	int i;
+
+	if ((argc < 3) || ! console_number(argv[argc - 1], & value))
+		return false;
+
+	// item names may contain a space, e.g. "ERA SZ"
+	name[0] = '\0';
+	for (i = 1; i < argc - 1; i++)
+	{
+		if (i > 1)
+			strncat(name, " ", sizeof(name) - strlen(name) - 1);
+		strncat(name, argv[i], sizeof(name) - strlen(name) - 1);
+	}
+	console_upper(name);
+
+	if (! demo_set_config(name, value))
+		printf("%s: no such item, or %" PRIu32 " is not one of its choices\r\n", name, value);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: stats
+ * @note
+ * 		Report of the last demo run
+ ******************************************************************************/
+static bool console_stats(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	demo_print_report();
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: trace
+ * @note
+ * 		Binary SPI trace of the last demo run
+ ******************************************************************************/
+static bool console_trace(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	spi_trace_dump();
+	printf("\r\n");
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: link
+ * @note
+ * 		Binary dump and upload protocol, until the host quits or goes quiet
+ ******************************************************************************/
+static bool console_link(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	console_flash_begin();
+	link_run();
+	printf("\r\n");
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Command: exit
+ * @note
+ * 		Close the console
+ ******************************************************************************/
+static bool console_exit(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+
+	console_close();
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Split a line into arguments and run the command
+ ******************************************************************************/
+static void console_execute(char *s)
+{
+	char *argv[CONSOLE_MAX_ARGS];
+	int argc = 0;
+	unsigned int i;
+
+	for (s = strtok(s, " \t"); s && (argc < CONSOLE_MAX_ARGS); s = strtok(NULL, " \t"))
+		argv[argc++] = s;
+	if (argc == 0)
+		return;
+
+	for (i = 0; i < CONSOLE_CMD_COUNT; i++)
+	{
+		if (strcmp(argv[0], console_cmds[i].name) == 0)
+		{
+			if (! console_cmds[i].fn(argc, argv))
+				printf("usage: %s %s\r\n", console_cmds[i].name, console_cmds[i].args);
+			return;
+		}
+	}
+	printf("%s: unknown command, try help\r\n", argv[0]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Handle one received character
+ ******************************************************************************/
+static void console_input(int c)
+{
+	int prev = last_char;
+
+	last_char = c;
+	switch (c)
+	{
+	case '\n':
+		if (prev == '\r')
+			break;  // CR LF ends one line
+		// fall through
+	case '\r':
+		printf("\r\n");
+		line[line_len] = '\0';
+		line_len = 0;
+		console_execute(line);
+		if (is_open)
+			printf(CONSOLE_PROMPT);
+		break;
+	case '\b':
+	case 0x7f:
+		if (line_len)
+		{
+			line_len--;
+			printf("\b \b");
+		}
+		break;
+	case 0x15:  // ^U
+		for (; line_len; line_len--)
+			printf("\b \b");
+		break;
+	case 0x03:  // ^C
+		line_len = 0;
+		printf("^C\r\n" CONSOLE_PROMPT);
+		break;
+	default:
+		if ((c < ' ') || (c > '~'))
+			break;
+		if (line_len < CONSOLE_LINE_SIZE - 1)
+		{
+			line[line_len++] = c;
+			putchar(c);
+		}
+		else
+			putchar('\a');
+		break;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Open the serial port and start taking commands
+ ******************************************************************************/
+void console_open(void)
+{
+	if (is_open)
+		return;
+	demo_serial_open();
+	is_open = true;
+	line_len = 0;
+	last_char = 0;
+	power = CONSOLE_UDPD;
+	printf("\r\n%s console, type help for commands\r\n" CONSOLE_PROMPT,
+		   spiflash_info_table[part].name);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Stop taking commands, and close the serial port once output is sent
+ ******************************************************************************/
+void console_close(void)
+{
+	if (! is_open)
+		return;
+	is_open = false;
+	if (power != CONSOLE_UDPD)
+	{
+		console_flash_begin();
+		spiflash_ultra_deep_power_down(true, NULL, NULL);
+	}
+	demo_serial_close();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Whether the console is open
+ ******************************************************************************/
+bool console_is_open(void)
+{
+	return is_open;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Handle the characters received since the last call, without waiting
+ * @note
+ * 		A complete line runs its command before returning, which may take
+ * 		as long as the command does.
+ ******************************************************************************/
+void console_poll(void)
+{
+	int c;
+
+	while (is_open && ((c = serial_read_char()) >= 0))
+		console_input(c);
+}
+
+/** @} (end addtogroup Console) */
+/** @} (end addtogroup AppManagement) */
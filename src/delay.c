@@ -88,6 +88,9 @@ static volatile bool delay_done;
 *******************************************************************************/
 static void delay_callback(RTCDRV_TimerID_t id, void *user)
 {
+	(void) id;
+	(void) user;
+
 	delay_done = true;
 }
 
@@ -37,8 +37,10 @@
 
 #include "em_cmu.h"
 
+#include "buffer.h"
 #include "demo_serial.h"
 #include "hex_dump.h"
+#include "low_power.h"
 #include "main.h"
 #include "serial.h"
 #include "spiflash.h"
@@ -65,7 +67,7 @@ void read_id(void)
 			       NULL,
 	        	   NULL);
   printf("ID:");
-  hex_dump(id, sizeof(id), 0);
+  hex_dump(id, sizeof(id), 0, 0);
   printf("\r\n");
 }
 
@@ -104,33 +106,124 @@ void get_status(void)
 }
 
 /***************************************************************************//**
- * @brief
- *   Set WRITE ENABLE, Clear UART Tx Buffer, Get Status
- *
+* @note
+* 	 	These serial I/O buffers should never be accessed directly,
+*		but only through the buffer.h API. They are circular buffers, and part
+*		of the allocation is carved out for buffer control. The capacities
+*		are powers of two.
+*
  ******************************************************************************/
-void write_enable(void)
+static uint8_t raw_serial_rx_buf[BUF_RAW_SIZE(256)];
+static uint8_t raw_serial_tx_buf[BUF_RAW_SIZE(1024)];
+
+static int open_count;
+
+/***************************************************************************//**
+* @brief
+*   Open the serial port for demo output
+* @note
+* 		printf() output goes to the serial port until demo_serial_close()
+* 		is called. Calls nest, so that a demo's report can be sent while
+* 		the console holds the port open.
+*
+ ******************************************************************************/
+void demo_serial_open(void)
 {
-  printf("setting write enable\r\n");
-  serial_tx_flush();
-  spiflash_set_write_enable(true, NULL, NULL);
-  printf("write enabled\r\n");
-  serial_tx_flush();
+	if (open_count++)
+		return;
 
-  get_status();
-}
+#if defined(LEUART_NUM)
+	CMU_ClockEnable(cmuClock_CORELE, true);
+	CMU_ClockSelectSet(cmuClock_LFA, cmuSelect_LFXO);
+	CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);
+#endif
 
+	serial_init(SERIAL_BIT_RATE,
+			    raw_serial_rx_buf, sizeof(raw_serial_rx_buf),
+			    raw_serial_tx_buf, sizeof(raw_serial_tx_buf));
+}
 
 /***************************************************************************//**
+* @brief
+*   Wait for demo output to be sent, then close the serial port
 * @note
-* 	 	These serial I/O buffers should never be accessed directly,
-*		but only through the buffer.h API. They are circular buffers, and part
-*		of the allocation is carved out for buffer control.
+* 		The port stays open until the outermost demo_serial_open() is
+* 		closed.
 *
  ******************************************************************************/
-static uint8_t raw_serial_rx_buf[200];
-static uint8_t raw_serial_tx_buf[1000];
+void demo_serial_close(void)
+{
+	serial_tx_flush();
+	if (--open_count == 0)
+		serial_close();
+}
+
+#define DUMP_CHUNK_SIZE 256
 
-/*  */
+static uint8_t dump_chunk[2][DUMP_CHUNK_SIZE];
+static volatile bool dump_read_done;
+
+/***************************************************************************//**
+* @brief
+*   Completion of a dump chunk read
+*
+ ******************************************************************************/
+static void demo_serial_dump_read_done(void *ref)
+{
+	(void) ref;
+
+	dump_read_done = true;
+}
+
+/***************************************************************************//**
+* @brief
+*   Hex dump a range of the flash to the serial port
+* @note
+* 		The range is read a chunk at a time into one of two small buffers.
+* 		While one chunk is formatted into the TX buffer, waiting for room
+* 		as it drains, the next is read into the other, by completion
+* 		callback. The SPI read is much faster than the serial port, so
+* 		the dump runs at the serial bit rate for any length, up to the
+* 		whole part.
+* @param[in] addr
+* 		Flash address
+* @param[in] len
+* 		Length
+* @param[in] flags
+* 		HEX_DUMP_ASCII and HEX_DUMP_SKIP_REPEATS, for the whole range
+*
+ ******************************************************************************/
+void demo_serial_dump(uint32_t addr, uint32_t len, unsigned int flags)
+{
+	uint32_t n = len < DUMP_CHUNK_SIZE ? len : DUMP_CHUNK_SIZE;
+	uint32_t next_n;
+	int cur = 0;
+
+	if (! len)
+		return;
+	dump_read_done = false;
+	spiflash_read(addr, n, dump_chunk[cur], demo_serial_dump_read_done, NULL);
+
+	while (len)
+	{
+		while (! dump_read_done)
+			enter_low_power_state();
+
+		next_n = (len - n) < DUMP_CHUNK_SIZE ? (len - n) : DUMP_CHUNK_SIZE;
+		if (next_n)
+		{
+			dump_read_done = false;
+			spiflash_read(addr + n, next_n, dump_chunk[cur ^ 1], demo_serial_dump_read_done, NULL);
+		}
+
+		hex_dump(dump_chunk[cur], n, addr, next_n ? (flags | HEX_DUMP_MORE) : flags);
+		flags |= HEX_DUMP_CONTINUED;
+		addr += n;
+		len -= n;
+		n = next_n;
+		cur ^= 1;
+	}
+}
 
 /***************************************************************************//**
 * @brief
@@ -139,19 +232,13 @@ static uint8_t raw_serial_tx_buf[1000];
  ******************************************************************************/
 void demo_serial(void)
 {
-	int i;
+	unsigned int i;
 	int hex_dump_size = 256;
 
-	CMU_ClockEnable(cmuClock_CORELE, true);
-	CMU_ClockSelectSet(cmuClock_LFA, cmuSelect_LFXO);
-	CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);
-
-	serial_init(9600,
-			    raw_serial_rx_buf, sizeof(raw_serial_rx_buf),
-			    raw_serial_tx_buf, sizeof(raw_serial_tx_buf));
+	demo_serial_open();
 	printf("\r\nEmbedded Masters SPI Flash Demo\r\n");
 
-	if (! spiflash_init(2000000))
+	if (spiflash_init(2000000) == PART_UNKNOWN)
 	  {
 		printf("SPI flash failed to initialize\r\n");
 		while(true)
@@ -160,16 +247,11 @@ void demo_serial(void)
 
 	get_status();
 
-	printf("reading\r\n");
-	spiflash_read(0x00000, sizeof(buf1), buf1, NULL, NULL);
-	printf("read done\r\n");
-	serial_tx_flush();
-
 	printf("data read");
-	if (hex_dump_size != sizeof(buf1))
+	if (hex_dump_size != sizeof(buf2))
 		printf(", first %d bytes", hex_dump_size);
 	printf (":\r\n");
-	hex_dump(buf1, hex_dump_size, 0);
+	demo_serial_dump(0x00000, hex_dump_size, 0);
 	serial_tx_flush();
 
 	printf("erasing\r\n");
@@ -179,16 +261,18 @@ void demo_serial(void)
 
 	get_status();
 
-	printf("setting buffer to increment from %02x\r\n", buf1[0]+1);
+	printf("setting buffer to increment from %02x\r\n", buf2[0]+1);
 	buf2[0]++;
 	for (i = 1; i < sizeof(buf2); i++)
 		buf2[i] = buf2[i-1] + 1;
 	serial_tx_flush();
 
-	write_enable();
-
-	printf("setting sector unprotect\r\n");
-	spiflash_set_sector_protection(false, 0x00000, NULL, NULL);
+	printf("unprotecting sectors\r\n");
+	if (! spiflash_set_range_protection(false, 0x00000, sizeof(buf2)))
+	{
+		printf("no protection sectors, unprotecting all\r\n");
+		spiflash_set_global_protect(false, NULL, NULL);
+	}
 
 	get_status();
 
@@ -200,23 +284,15 @@ void demo_serial(void)
 
 	get_status();
 
-	printf("reading\r\n");
-	serial_tx_flush();
-	spiflash_read(0x00000, sizeof(buf3), buf3, NULL, NULL);
-	printf("read done\r\n");
-	serial_tx_flush();
-
 	printf("data read");
-	if (hex_dump_size != sizeof(buf1))
+	if (hex_dump_size != sizeof(buf2))
 		printf(", first %d bytes", hex_dump_size);
 	printf (":\r\n");
-	serial_tx_flush();
-	hex_dump(buf3, hex_dump_size, 0);
+	demo_serial_dump(0x00000, hex_dump_size, 0);
 
 	spiflash_ultra_deep_power_down(true, NULL, NULL);
 
-	serial_tx_flush();
-	serial_close();
+	demo_serial_close();
 }
 
 /** @} (end addtogroup Serial_Demo_Functions) */
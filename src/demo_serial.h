@@ -34,6 +34,8 @@
 #ifndef DEMO_SERIAL_H_
 #define DEMO_SERIAL_H_
 
+#include <stdint.h>
+
 /*****************************************************************************/
 /** @defgroup Serial_Demo Serial_Demo
 */
@@ -49,6 +51,12 @@
  * @{
  ******************************************************************************/
 
+void demo_serial_open(void);
+
+void demo_serial_close(void);
+
+void demo_serial_dump(uint32_t addr, uint32_t len, unsigned int flags);
+
 void demo_serial(void);
 
 /** @} (end addtogroup Serial_Demo_Functions) */
@@ -0,0 +1,312 @@
+/******************************************************************************
+ * @file erase_pool.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "em_int.h"
+
+#include "rtcdriver.h"
+
+#include "erase_pool.h"
+#include "low_power.h"
+#include "spiflash.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Erase_Pool
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+ * @verbatim
+ *  The managed region is treated as a ring of erase units. Units are erased
+ *  in address order at pool_erase_addr, and handed out in the same order at
+ *  pool_claim_addr, so the units which are erased and ready are always the
+ *  ones from pool_claim_addr up to (but not including) pool_erase_addr.
+ *
+ *  At most unit_count - 1 units are kept ready, so the background eraser can
+ *  never catch up with the unit most recently handed out to a writer.
+ *  @endverbatim
+ *****************************************************************************/
+
+static uint32_t pool_base;
+static uint32_t pool_len;
+static uint32_t pool_unit_size;
+static bool pool_use_so_irq;
+
+static uint32_t pool_claim_addr;  // next erased unit to hand out
+static uint32_t pool_erase_addr;  // next unit to erase
+
+static volatile unsigned int pool_depth;
+static volatile bool pool_erase_busy;
+static uint64_t pool_erase_start;
+
+// measured erase time of each ready unit, in claim order starting at pool_ready_slot
+static uint32_t pool_erase_ticks[ERASE_POOL_MAX_DEPTH];
+static unsigned int pool_ready_slot;
+
+static erase_pool_stats_t pool_stats;
+
+/***************************************************************************//**
+ * @brief
+ *   Advance an address to the next unit of the managed region
+ * @param[in] addr
+ * 		Address of a unit in the managed region
+ * @return
+ * 		Address of the following unit, wrapping to the start of the region
+ ******************************************************************************/
+static uint32_t erase_pool_next(uint32_t addr)
+{
+	addr += pool_unit_size;
+	if (addr >= (pool_base + pool_len))
+		addr = pool_base;
+	return addr;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Background erase completion
+ * @note
+ * 		Called from interrupt context when a background erase started by
+ * 		erase_pool_service() has finished.
+ * @param[in] *ref
+ * 		Unused
+ ******************************************************************************/
+static void erase_pool_erase_done(void *ref)
+{
+	(void) ref;
+
+	unsigned int slot = (pool_ready_slot + pool_depth) % ERASE_POOL_MAX_DEPTH;
+
+	pool_erase_ticks[slot] = RTCDRV_GetWallClockTicks64() - pool_erase_start;
+	pool_erase_addr = erase_pool_next(pool_erase_addr);
+	pool_stats.erase_count++;
+	pool_depth++;
+	pool_erase_busy = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Initialize the pre-erase pool
+ * @note
+ * 		The contents of the managed region are owned by the pool from now on:
+ * 		any unit may be erased in the background. The flash must already be
+ * 		unprotected over the whole region.
+ * @param[in] base
+ * 		Start address of the managed region, aligned to unit_size
+ * @param[in] len
+ * 		Length of the managed region, a multiple of unit_size
+ * @param[in] unit_size
+ * 		Erase unit, must be one of the erase sizes supported by the part
+ * @param[in] depth
+ * 		Number of erased units to keep ready
+ * @param[in] use_so_irq
+ * 		Use the Active Status Interrupt on SO for background erases, if the
+ * 		part supports it
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool erase_pool_init(uint32_t base,
+		             uint32_t len,
+		             uint32_t unit_size,
+		             unsigned int depth,
+		             bool use_so_irq)
+{
+	uint32_t unit_count;
+
+	if ((unit_size == 0) || (base % unit_size) || (len % unit_size))
+		return false;
+	unit_count = len / unit_size;
+	if (unit_count < 2)
+		return false;
+
+	if (depth > ERASE_POOL_MAX_DEPTH)
+		depth = ERASE_POOL_MAX_DEPTH;
+	if (depth > (unit_count - 1))
+		depth = unit_count - 1;
+
+	erase_pool_quiesce();
+
+	pool_base = base;
+	pool_len = len;
+	pool_unit_size = unit_size;
+	pool_use_so_irq = use_so_irq;
+
+	pool_claim_addr = base;
+	pool_erase_addr = base;
+	pool_depth = 0;
+	pool_ready_slot = 0;
+
+	memset(& pool_stats, 0, sizeof(pool_stats));
+	pool_stats.target_depth = depth;
+
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start a background erase if the pool is below its target depth
+ * @note
+ * 		Intended to be called from the idle loop and between foreground
+ * 		flash operations. Returns immediately; the erase completes under
+ * 		interrupt control. Nothing is started if the flash driver is busy.
+ * 		Until the erase completes, foreground code must call
+ * 		erase_pool_quiesce() before using the flash driver.
+ * @return
+ * 		true if an erase was started
+ ******************************************************************************/
+bool erase_pool_service(void)
+{
+	if (pool_erase_busy || (pool_depth >= pool_stats.target_depth) || ! spiflash_idle())
+		return false;
+
+	pool_erase_busy = true;
+	pool_erase_start = RTCDRV_GetWallClockTicks64();
+	if (! spiflash_erase(pool_erase_addr, pool_unit_size, pool_unit_size,
+			             pool_use_so_irq,
+			             erase_pool_erase_done,
+			             NULL))
+	{
+		pool_erase_busy = false;
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Determine whether the pool has reached its target depth
+ * @return
+ * 		true if no more background erases are needed
+ ******************************************************************************/
+bool erase_pool_full(void)
+{
+	return pool_depth >= pool_stats.target_depth;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait for any background erase in progress to complete
+ ******************************************************************************/
+void erase_pool_quiesce(void)
+{
+	while (pool_erase_busy)
+		enter_low_power_state();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Claim an erased unit for writing
+ * @note
+ * 		If an erased unit is ready, it is handed out without touching the
+ * 		flash. Otherwise the next unit is erased synchronously, exactly as
+ * 		if there were no pool. Either way, the flash driver is idle when this
+ * 		function returns. The unit belongs to the caller until the pool
+ * 		wraps around the managed region.
+ * @param[out] *addr
+ * 		Address of the claimed unit
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool erase_pool_claim(uint32_t *addr)
+{
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	bool waited = pool_erase_busy;
+
+	if (! pool_unit_size)
+		return false;
+
+	// The driver can only hold one operation, so even if a unit is ready,
+	// the caller can't write to it until a background erase has finished.
+	erase_pool_quiesce();
+
+	if (pool_depth)
+	{
+		*addr = pool_claim_addr;
+		pool_claim_addr = erase_pool_next(pool_claim_addr);
+
+		INT_Disable();
+		pool_stats.stall_avoided_ticks += pool_erase_ticks[pool_ready_slot];
+		pool_ready_slot = (pool_ready_slot + 1) % ERASE_POOL_MAX_DEPTH;
+		pool_depth--;
+		INT_Enable();
+
+		if (! waited)
+			pool_stats.claim_ready_count++;
+	}
+	else
+	{
+		// pool is empty, so the writer pays for the erase
+		*addr = pool_erase_addr;
+		if (! spiflash_erase(*addr, pool_unit_size, pool_unit_size, pool_use_so_irq, NULL, NULL))
+			return false;
+		pool_erase_addr = erase_pool_next(pool_erase_addr);
+		pool_claim_addr = pool_erase_addr;
+	}
+
+	pool_stats.stall_ticks += RTCDRV_GetWallClockTicks64() - start;
+	pool_stats.claim_count++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of erased units currently ready
+ ******************************************************************************/
+unsigned int erase_pool_depth(void)
+{
+	return pool_depth;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get pool statistics
+ * @param[out] *stats
+ * 		Pointer to structure to receive the statistics
+ ******************************************************************************/
+void erase_pool_get_stats(erase_pool_stats_t *stats)
+{
+	INT_Disable();
+	*stats = pool_stats;
+	stats->depth = pool_depth;
+	INT_Enable();
+}
+
+/** @} (end addtogroup Erase_Pool) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
@@ -0,0 +1,87 @@
+/****************************************************************************//**
+ * @file erase_pool.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef ERASE_POOL_H_
+#define ERASE_POOL_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup Erase_Pool
+ * @brief Background pre-erase of a managed flash region
+ * @{
+ ******************************************************************************/
+
+// maximum number of erased units which can be held ready
+#define ERASE_POOL_MAX_DEPTH 16
+
+typedef struct
+{
+	unsigned int depth;            // erased units currently ready
+	unsigned int target_depth;     // configured number of units to keep ready
+	uint32_t erase_count;          // background erases completed
+	uint32_t claim_count;          // units handed out by erase_pool_claim()
+	uint32_t claim_ready_count;    // claims served from the pool without any wait
+	uint64_t stall_ticks;          // RTC ticks writers spent waiting for an erase
+	uint64_t stall_avoided_ticks;  // RTC ticks of erase time taken off the write path
+} erase_pool_stats_t;
+
+bool erase_pool_init(uint32_t base,
+		             uint32_t len,
+		             uint32_t unit_size,
+		             unsigned int depth,
+		             bool use_so_irq);
+
+bool erase_pool_service(void);
+
+bool erase_pool_full(void);
+
+void erase_pool_quiesce(void);
+
+bool erase_pool_claim(uint32_t *addr);
+
+unsigned int erase_pool_depth(void);
+
+void erase_pool_get_stats(erase_pool_stats_t *stats);
+
+/** @} (end addtogroup Erase_Pool) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
+
+#endif /* ERASE_POOL_H_ */
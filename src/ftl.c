@@ -0,0 +1,722 @@
+/******************************************************************************
+ * @file ftl.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "rtcdriver.h"
+
+#include "ftl.h"
+#include "spiflash.h"
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup FTL
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+ * @verbatim
+ *  The region is divided into units, each a multiple of an erase size of
+ *  the part. A unit holds a header, a metadata entry for each of its slots,
+ *  and the slots, each one logical block, aligned to FTL_DATA_ALIGN. A
+ *  write of a logical block goes to the next slot of the active unit,
+ *  leaving the block's old slot invalid, and the RAM map is pointed at the
+ *  new slot.
+ *
+ *  Units have the header described in store.c, with the magic "FTL0".
+ *  Metadata entry, little-endian, written after the slot's data:
+ *    logical block u16, CRC-16 u16 of the logical block and the data
+ *
+ *  Slots are filled in order, and units in sequence number order, so at
+ *  mount the map is rebuilt by reading the metadata of the units in that
+ *  order, later entries replacing earlier ones. Only the newest unit can
+ *  hold a torn write: the data of its last slot with metadata is checked,
+ *  and the slot after it must be erased to be written.
+ *
+ *  One free unit is kept for garbage collection, which copies the valid
+ *  slots of the unit with the fewest out to the active unit, then erases
+ *  it. Once free units run low, each write copies a few slots first, so
+ *  that the cost of collection is spread over writes rather than taken by
+ *  one; only if that falls behind does a write wait for a whole unit.
+ *  @endverbatim
+ *****************************************************************************/
+
+#define FTL_MAGIC 0x304c5446  // "FTL0"
+
+#define FTL_DATA_ALIGN 256  // slot alignment, a multiple of every program page size
+
+#define FTL_UNMAPPED 0xffff
+
+// collection runs in steps during writes once free units are this few
+#define FTL_GC_START_FREE 3
+// slots copied by each step
+#define FTL_GC_STEP 2
+
+typedef struct
+{
+	uint16_t fill;   // slots used
+	uint16_t valid;  // slots holding the current copy of a block
+} ftl_unit_t;
+
+static store_units_t ftl_store = { .magic = FTL_MAGIC };
+static uint32_t ftl_block_size;
+static uint32_t ftl_block_count;
+static uint32_t ftl_slots;        // per unit
+static uint32_t ftl_data_offset;  // of slot 0 in a unit
+static bool ftl_mounted;
+
+static ftl_unit_t ftl_units[FTL_MAX_UNITS];
+static uint8_t ftl_active;  // unit being written, or STORE_UNIT_NONE
+
+static uint8_t ftl_gc_victim;  // unit being collected, or STORE_UNIT_NONE
+static uint32_t ftl_gc_slot;   // next slot of it to look at
+
+// physical slot, unit * ftl_slots + slot, of each logical block
+static uint16_t ftl_map[FTL_MAX_BLOCKS];
+
+static ftl_stats_t ftl_stats;
+static uint32_t ftl_reads;
+
+static uint8_t ftl_buf[FTL_DATA_ALIGN];
+
+// CRC of a logical block number, to continue over its data
+static uint16_t ftl_block_crc(uint32_t block)
+{
+	uint8_t b[2];
+
+	store_put_u16(b, block);
+	return store_crc16(0xffff, b, sizeof(b));
+}
+
+static uint32_t ftl_slot_addr(uint32_t phys)
+{
+	return store_unit_addr(& ftl_store, phys / ftl_slots) + ftl_data_offset + (phys % ftl_slots) * ftl_block_size;
+}
+
+static uint32_t ftl_meta_addr(uint32_t phys)
+{
+	return store_unit_addr(& ftl_store, phys / ftl_slots) + FTL_UNIT_HEADER_SIZE + (phys % ftl_slots) * FTL_META_SIZE;
+}
+
+static void ftl_flash_read(uint32_t addr, size_t len, uint8_t *buf)
+{
+	spiflash_read(addr, len, buf, NULL, NULL);
+	ftl_reads++;
+}
+
+static void ftl_flash_write(uint32_t addr, size_t len, const uint8_t *buf)
+{
+	spiflash_write(addr, len, (uint8_t *) buf, ftl_store.use_so_irq, NULL, NULL);
+	ftl_stats.bytes_programmed += len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Offset of the first slot in a unit with a number of slots
+ ******************************************************************************/
+static uint32_t ftl_data_offset_for(uint32_t slots)
+{
+	uint32_t meta = FTL_UNIT_HEADER_SIZE + slots * FTL_META_SIZE;
+
+	return (meta + FTL_DATA_ALIGN - 1) & ~(FTL_DATA_ALIGN - 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of logical blocks a unit holds
+ * @param[in] unit_size
+ * 		Unit size
+ * @param[in] block_size
+ * 		Logical block size
+ * @return Slots per unit
+ ******************************************************************************/
+uint32_t ftl_slots_per_unit(uint32_t unit_size, uint32_t block_size)
+{
+	uint32_t slots;
+
+	if (block_size == 0)
+		return 0;
+	for (slots = unit_size / block_size; slots; slots--)
+		if ((ftl_data_offset_for(slots) + slots * block_size) <= unit_size)
+			break;
+	return slots;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Point a logical block at a slot, updating the valid counts
+ ******************************************************************************/
+static void ftl_map_set(uint32_t block, uint32_t phys)
+{
+	if (ftl_map[block] != FTL_UNMAPPED)
+		ftl_units[ftl_map[block] / ftl_slots].valid--;
+	ftl_map[block] = phys;
+	ftl_units[phys / ftl_slots].valid++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a unit and write the first part of its header
+ * @param[in] unit
+ * 		Unit index; its erase count is incremented
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+static bool ftl_erase_unit(uint32_t unit)
+{
+	if (! store_unit_erase(& ftl_store, unit))
+		return false;
+	ftl_stats.unit_erases++;
+	ftl_stats.bytes_programmed += STORE_UNIT_ERASE_SIZE;
+	ftl_units[unit].fill = 0;
+	ftl_units[unit].valid = 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Make the least erased free unit the active unit
+ * @return
+ * 		false if there is no free unit
+ ******************************************************************************/
+static bool ftl_open_unit(void)
+{
+	uint32_t unit = store_unit_open(& ftl_store);
+
+	if (unit == STORE_UNIT_NONE)
+		return false;
+	ftl_stats.bytes_programmed += STORE_UNIT_OPEN_SIZE;
+	ftl_active = unit;
+	return true;
+}
+
+static bool ftl_active_has_slot(void)
+{
+	return (ftl_active != STORE_UNIT_NONE) && (ftl_units[ftl_active].fill < ftl_slots);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the metadata of the active unit's next slot, and map it
+ * @param[in] block
+ * 		Logical block, whose data is already in the slot
+ * @param[in] crc
+ * 		CRC of the logical block number and data
+ ******************************************************************************/
+static void ftl_commit(uint32_t block, uint16_t crc)
+{
+	uint32_t phys = ftl_active * ftl_slots + ftl_units[ftl_active].fill;
+	uint8_t m[FTL_META_SIZE];
+
+	store_put_u16(& m[0], block);
+	store_put_u16(& m[2], crc);
+	ftl_flash_write(ftl_meta_addr(phys), sizeof(m), m);
+	ftl_units[ftl_active].fill++;
+	ftl_map_set(block, phys);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Choose the unit to collect
+ * @return
+ * 		Unit with the fewest valid slots, the least erased of those, or
+ * 		STORE_UNIT_NONE if collecting would not free a slot
+ ******************************************************************************/
+static uint32_t ftl_choose_victim(void)
+{
+	uint32_t best = STORE_UNIT_NONE;
+	uint32_t i;
+
+	for (i = 0; i < ftl_store.unit_count; i++)
+	{
+		if ((ftl_store.unit[i].seq == STORE_SEQ_FREE) || (i == ftl_active))
+			continue;
+		if ((best == STORE_UNIT_NONE) || (ftl_units[i].valid < ftl_units[best].valid) ||
+			((ftl_units[i].valid == ftl_units[best].valid) &&
+			 (ftl_store.unit[i].erase_count < ftl_store.unit[best].erase_count)))
+			best = i;
+	}
+	if ((best != STORE_UNIT_NONE) && (ftl_units[best].valid >= ftl_slots))
+		return STORE_UNIT_NONE;
+	return best;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Copy a slot's block to the active unit
+ * @param[in] phys
+ * 		Slot holding the current copy of block
+ * @param[in] block
+ * 		Logical block
+ * @param[in] crc
+ * 		CRC from the slot's metadata
+ * @return
+ * 		false if there is no free unit to copy to
+ ******************************************************************************/
+static bool ftl_copy_slot(uint32_t phys, uint32_t block, uint16_t crc)
+{
+	uint32_t src = ftl_slot_addr(phys);
+	uint32_t dst;
+	uint32_t offset;
+	uint32_t len;
+
+	if (! ftl_active_has_slot())
+		if (! ftl_open_unit())
+			return false;
+	dst = ftl_slot_addr(ftl_active * ftl_slots + ftl_units[ftl_active].fill);
+
+	for (offset = 0; offset < ftl_block_size; offset += len)
+	{
+		len = ftl_block_size - offset;
+		if (len > sizeof(ftl_buf))
+			len = sizeof(ftl_buf);
+		spiflash_read(src + offset, len, ftl_buf, NULL, NULL);
+		ftl_flash_write(dst + offset, len, ftl_buf);
+	}
+	ftl_commit(block, crc);
+	ftl_stats.gc_copies++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Collect part of a unit
+ * @note
+ * 		Starts on a new victim if none is in progress. The victim is
+ * 		erased once all its valid slots have been copied.
+ * @param[in] budget
+ * 		Most slots to copy
+ * @return
+ * 		false if there is nothing to collect, or no room to copy to
+ ******************************************************************************/
+static bool ftl_gc_step(uint32_t budget)
+{
+	uint8_t m[FTL_META_SIZE];
+	uint32_t victim;
+	uint32_t phys;
+	uint32_t block;
+
+	if (ftl_gc_victim == STORE_UNIT_NONE)
+	{
+		victim = ftl_choose_victim();
+		if (victim == STORE_UNIT_NONE)
+			return false;
+		ftl_gc_victim = victim;
+		ftl_gc_slot = 0;
+	}
+	victim = ftl_gc_victim;
+
+	while (ftl_units[victim].valid && (ftl_gc_slot < ftl_units[victim].fill))
+	{
+		phys = victim * ftl_slots + ftl_gc_slot;
+		spiflash_read(ftl_meta_addr(phys), sizeof(m), m, NULL, NULL);
+		block = store_get_u16(& m[0]);
+		if ((block < ftl_block_count) && (ftl_map[block] == phys))
+		{
+			if (budget == 0)
+				return true;
+			if (! ftl_copy_slot(phys, block, store_get_u16(& m[2])))
+				return false;
+			budget--;
+		}
+		ftl_gc_slot++;
+	}
+
+	if (! ftl_erase_unit(victim))
+		return false;
+	ftl_gc_victim = STORE_UNIT_NONE;
+	ftl_stats.gc_units++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check and set the geometry
+ ******************************************************************************/
+static bool ftl_set_geometry(uint32_t base,
+		                     uint32_t len,
+		                     uint32_t unit_size,
+		                     uint32_t block_size,
+		                     uint32_t block_count,
+		                     bool use_so_irq)
+{
+	uint32_t slots = ftl_slots_per_unit(unit_size, block_size);
+	uint32_t units = unit_size ? (len / unit_size) : 0;
+
+	ftl_mounted = false;
+	if ((slots < FTL_MIN_SLOTS) || (base % unit_size) || (len % unit_size) ||
+		(units < FTL_MIN_UNITS) || (units > FTL_MAX_UNITS) || ((units * slots) >= FTL_UNMAPPED) ||
+		(block_count > FTL_MAX_BLOCKS) || (block_count > ((units - 2) * slots)))
+		return false;
+
+	ftl_store.base = base;
+	ftl_store.unit_size = unit_size;
+	ftl_store.unit_count = units;
+	ftl_block_size = block_size;
+	ftl_block_count = block_count;
+	ftl_slots = slots;
+	ftl_data_offset = ftl_data_offset_for(slots);
+	ftl_store.erase_cmd_size = 0;  // a unit may span several erase blocks
+	ftl_store.use_so_irq = use_so_irq;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the metadata of a unit, setting its fill, and map its blocks
+ * @param[in] unit
+ * 		Unit index
+ * @param[in] map
+ * 		Map the blocks, rather than only finding the fill
+ * @param[in] skip
+ * 		Slot not to map, e.g. one with a torn write
+ ******************************************************************************/
+static void ftl_scan_unit(uint32_t unit, bool map, uint32_t skip)
+{
+	uint32_t slot;
+	uint32_t chunk;
+	uint32_t len;
+	uint32_t block;
+	const uint8_t *m;
+
+	ftl_units[unit].fill = 0;
+	for (slot = 0; slot < ftl_slots; slot++)
+	{
+		chunk = slot % (sizeof(ftl_buf) / FTL_META_SIZE);
+		if (chunk == 0)
+		{
+			len = (ftl_slots - slot) * FTL_META_SIZE;
+			if (len > sizeof(ftl_buf))
+				len = sizeof(ftl_buf);
+			ftl_flash_read(ftl_meta_addr(unit * ftl_slots + slot), len, ftl_buf);
+		}
+		m = & ftl_buf[chunk * FTL_META_SIZE];
+		block = store_get_u16(& m[0]);
+		if ((block == 0xffff) && (store_get_u16(& m[2]) == 0xffff))
+			break;
+		ftl_units[unit].fill = slot + 1;
+		if (map && (slot != skip) && (block < ftl_block_count))
+			ftl_map_set(block, unit * ftl_slots + slot);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check the data of a slot against the CRC in its metadata
+ ******************************************************************************/
+static bool ftl_check_slot(uint32_t phys)
+{
+	uint8_t m[FTL_META_SIZE];
+	uint32_t offset;
+	uint32_t len;
+	uint16_t crc;
+
+	ftl_flash_read(ftl_meta_addr(phys), sizeof(m), m);
+	crc = ftl_block_crc(store_get_u16(& m[0]));
+	for (offset = 0; offset < ftl_block_size; offset += len)
+	{
+		len = ftl_block_size - offset;
+		if (len > sizeof(ftl_buf))
+			len = sizeof(ftl_buf);
+		ftl_flash_read(ftl_slot_addr(phys) + offset, len, ftl_buf);
+		crc = store_crc16(crc, ftl_buf, len);
+	}
+	return crc == store_get_u16(& m[2]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check that a slot's data is erased
+ ******************************************************************************/
+static bool ftl_slot_erased(uint32_t phys)
+{
+	uint32_t offset;
+	uint32_t len;
+	uint32_t i;
+
+	for (offset = 0; offset < ftl_block_size; offset += len)
+	{
+		len = ftl_block_size - offset;
+		if (len > sizeof(ftl_buf))
+			len = sizeof(ftl_buf);
+		ftl_flash_read(ftl_slot_addr(phys) + offset, len, ftl_buf);
+		for (i = 0; i < len; i++)
+			if (ftl_buf[i] != 0xff)
+				return false;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Mount the FTL, rebuilding the map
+ * @note
+ * 		Units left half erased or half opened by a power failure are
+ * 		erased, and a collection cut short is finished. The flash must
+ * 		already be unprotected over the whole region.
+ * @param[in] base
+ * 		Start address of the region, aligned to unit_size
+ * @param[in] len
+ * 		Length of the region, a multiple of unit_size, from FTL_MIN_UNITS
+ * 		to FTL_MAX_UNITS units
+ * @param[in] unit_size
+ * 		Unit size, a multiple of an erase size of the part
+ * @param[in] block_size
+ * 		Logical block size, e.g. 256 or 4096
+ * @param[in] block_count
+ * 		Number of logical blocks, up to FTL_MAX_BLOCKS, and leaving at
+ * 		least two units' slots spare
+ * @param[in] use_so_irq
+ * 		Use the Active Status Interrupt on SO for erases and writes, if
+ * 		the part supports it
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool ftl_mount(uint32_t base,
+		       uint32_t len,
+		       uint32_t unit_size,
+		       uint32_t block_size,
+		       uint32_t block_count,
+		       bool use_so_irq)
+{
+	uint8_t order[FTL_MAX_UNITS];
+	uint32_t in_use;
+	uint32_t newest;
+	uint32_t skip;
+	uint32_t tries;
+	uint32_t i;
+
+	if (! ftl_set_geometry(base, len, unit_size, block_size, block_count, use_so_irq))
+		return false;
+
+	memset(& ftl_stats, 0, sizeof(ftl_stats));
+	ftl_reads = 0;
+	for (i = 0; i < FTL_MAX_BLOCKS; i++)
+		ftl_map[i] = FTL_UNMAPPED;
+	ftl_active = STORE_UNIT_NONE;
+	ftl_gc_victim = STORE_UNIT_NONE;
+	for (i = 0; i < ftl_store.unit_count; i++)
+	{
+		ftl_units[i].fill = 0;
+		ftl_units[i].valid = 0;
+	}
+
+	if (! store_units_mount(& ftl_store, order, & in_use))
+		return false;
+
+	for (i = 0; (i + 1) < in_use; i++)
+		ftl_scan_unit(order[i], true, ftl_slots);
+
+	if (in_use)
+	{
+		// the newest unit's last write may be torn, in its data or metadata
+		newest = order[in_use - 1];
+		ftl_scan_unit(newest, false, ftl_slots);
+		skip = ftl_slots;
+		if (ftl_units[newest].fill && ! ftl_check_slot(newest * ftl_slots + ftl_units[newest].fill - 1))
+			skip = ftl_units[newest].fill - 1;
+		ftl_scan_unit(newest, true, skip);
+		if ((ftl_units[newest].fill < ftl_slots) && ! ftl_slot_erased(newest * ftl_slots + ftl_units[newest].fill))
+			ftl_units[newest].fill++;
+		ftl_active = newest;
+	}
+
+	// a collection cut short may leave no free unit
+	for (tries = 0; (ftl_store.free_count == 0) && (tries < ftl_store.unit_count); tries++)
+		if (! ftl_gc_step(ftl_slots))
+			return false;
+	if (ftl_store.free_count == 0)
+		return false;
+
+	ftl_stats.gc_copies = 0;
+	ftl_stats.gc_units = 0;
+	ftl_stats.unit_erases = 0;
+	ftl_stats.bytes_programmed = 0;
+	ftl_stats.mount_reads = ftl_store.reads + ftl_reads;
+	ftl_mounted = true;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a region and mount an empty FTL in it
+ * @note
+ * 		Erase counts in valid unit headers are kept. Parameters as
+ * 		ftl_mount().
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool ftl_format(uint32_t base,
+		        uint32_t len,
+		        uint32_t unit_size,
+		        uint32_t block_size,
+		        uint32_t block_count,
+		        bool use_so_irq)
+{
+	if (! ftl_set_geometry(base, len, unit_size, block_size, block_count, use_so_irq) ||
+		! store_units_format(& ftl_store))
+		return false;
+	return ftl_mount(base, len, unit_size, block_size, block_count, use_so_irq);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read a logical block
+ * @note
+ * 		Two flash reads: the slot's metadata and its data. A block never
+ * 		written reads as erased.
+ * @param[in] block
+ * 		Logical block
+ * @param[out] *data
+ * 		Buffer for block_size bytes
+ * @return
+ * 		false if the block number is out of range, or its data is bad
+ ******************************************************************************/
+bool ftl_read(uint32_t block, uint8_t *data)
+{
+	uint8_t m[FTL_META_SIZE];
+	uint32_t phys;
+
+	if (! ftl_mounted || (block >= ftl_block_count))
+		return false;
+	ftl_stats.host_reads++;
+	phys = ftl_map[block];
+	if (phys == FTL_UNMAPPED)
+	{
+		memset(data, 0xff, ftl_block_size);
+		return true;
+	}
+	spiflash_read(ftl_meta_addr(phys), sizeof(m), m, NULL, NULL);
+	spiflash_read(ftl_slot_addr(phys), ftl_block_size, data, NULL, NULL);
+	return (store_get_u16(& m[0]) == block) &&
+		   (store_crc16(ftl_block_crc(block), data, ftl_block_size) == store_get_u16(& m[2]));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write a logical block
+ * @note
+ * 		The block is on the flash when this returns. Once free units run
+ * 		low, a few slots are collected first.
+ * @param[in] block
+ * 		Logical block
+ * @param[in] *data
+ * 		block_size bytes
+ * @return
+ * 		false if the block number is out of range, or collection failed
+ ******************************************************************************/
+bool ftl_write(uint32_t block, const uint8_t *data)
+{
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint64_t ticks;
+	uint32_t tries;
+	bool waited = false;
+
+	if (! ftl_mounted || (block >= ftl_block_count))
+		return false;
+
+	if (ftl_store.free_count <= FTL_GC_START_FREE)
+		ftl_gc_step(FTL_GC_STEP);
+
+	// only collection may open the unit kept back for it
+	for (tries = 0; ! ftl_active_has_slot(); tries++)
+	{
+		if (tries > (2 * ftl_store.unit_count))
+			return false;
+		if (ftl_store.free_count > 1)
+		{
+			if (! ftl_open_unit())
+				return false;
+			continue;
+		}
+		waited = true;
+		if (! ftl_gc_step(ftl_slots))
+			return false;
+	}
+	if (waited)
+		ftl_stats.gc_blocking++;
+
+	ticks = RTCDRV_GetWallClockTicks64() - start;
+	ftl_stats.gc_ticks += ticks;
+	if (ticks > ftl_stats.gc_max_ticks)
+		ftl_stats.gc_max_ticks = ticks;
+
+	ftl_flash_write(ftl_slot_addr(ftl_active * ftl_slots + ftl_units[ftl_active].fill), ftl_block_size, data);
+	ftl_commit(block, store_crc16(ftl_block_crc(block), data, ftl_block_size));
+	ftl_stats.host_writes++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Collect a few slots in idle time
+ * @note
+ * 		Does nothing unless free units are low enough for writes to
+ * 		collect, so calling this between writes takes that work off them.
+ * @return
+ * 		true if any work was done
+ ******************************************************************************/
+bool ftl_gc_service(void)
+{
+	if (! ftl_mounted || (ftl_store.free_count > FTL_GC_START_FREE))
+		return false;
+	return ftl_gc_step(FTL_GC_STEP);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get FTL statistics
+ * @param[out] *stats
+ * 		Pointer to structure to receive the statistics
+ ******************************************************************************/
+void ftl_get_stats(ftl_stats_t *stats)
+{
+	*stats = ftl_stats;
+	stats->block_size = ftl_block_size;
+	stats->block_count = ftl_block_count;
+	stats->unit_count = ftl_store.unit_count;
+	stats->unit_size = ftl_store.unit_size;
+	stats->slots_per_unit = ftl_slots;
+	stats->free_units = ftl_store.free_count;
+	store_units_erase_counts(& ftl_store, & stats->erase_count_min, & stats->erase_count_max);
+}
+
+/** @} (end addtogroup FTL) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
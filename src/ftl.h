@@ -0,0 +1,111 @@
+/****************************************************************************//**
+ * @file ftl.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef FTL_H_
+#define FTL_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup FTL
+ * @brief Flash translation layer: a block device of fixed size logical blocks
+ * @{
+ ******************************************************************************/
+
+#define FTL_UNIT_HEADER_SIZE STORE_UNIT_HEADER_SIZE  // at the start of each unit
+#define FTL_META_SIZE        4   // per slot, after the unit header
+
+#define FTL_MAX_BLOCKS 512
+#define FTL_MAX_UNITS  STORE_MAX_UNITS
+#define FTL_MIN_UNITS  4
+#define FTL_MIN_SLOTS  2   // per unit
+
+typedef struct
+{
+	uint32_t block_size;
+	uint32_t block_count;
+	uint32_t unit_count;
+	uint32_t unit_size;
+	uint32_t slots_per_unit;    // blocks each unit holds
+	uint32_t free_units;        // erased units, one of them kept for collection
+	uint32_t host_writes;       // blocks written by ftl_write() since mount
+	uint32_t host_reads;        // blocks read by ftl_read() since mount
+	uint32_t gc_copies;         // blocks moved by collection since mount
+	uint32_t gc_units;          // units collected since mount
+	uint32_t gc_blocking;       // writes which had to wait for a whole collection
+	uint32_t unit_erases;       // since mount
+	uint64_t bytes_programmed;  // data, metadata and unit headers, since mount
+	uint64_t gc_ticks;          // RTC ticks spent collecting in ftl_write()
+	uint64_t gc_max_ticks;      // most RTC ticks spent collecting in one write
+	uint32_t erase_count_min;   // least erased unit
+	uint32_t erase_count_max;   // most erased unit
+	uint32_t mount_reads;       // flash reads made by the last mount
+} ftl_stats_t;
+
+uint32_t ftl_slots_per_unit(uint32_t unit_size, uint32_t block_size);
+
+bool ftl_format(uint32_t base,
+		        uint32_t len,
+		        uint32_t unit_size,
+		        uint32_t block_size,
+		        uint32_t block_count,
+		        bool use_so_irq);
+
+bool ftl_mount(uint32_t base,
+		       uint32_t len,
+		       uint32_t unit_size,
+		       uint32_t block_size,
+		       uint32_t block_count,
+		       bool use_so_irq);
+
+bool ftl_read(uint32_t block, uint8_t *data);
+
+bool ftl_write(uint32_t block, const uint8_t *data);
+
+bool ftl_gc_service(void);
+
+void ftl_get_stats(ftl_stats_t *stats);
+
+/** @} (end addtogroup FTL) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
+
+#endif /* FTL_H_ */
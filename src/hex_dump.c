@@ -31,10 +31,12 @@
  *
  ******************************************************************************/
 
-#include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "hex_dump.h"
+#include "serial.h"
 
 /***************************************************************************//**
 * @addtogroup AppManagement
@@ -46,9 +48,72 @@
 * @{
 *******************************************************************************/
 
+#define HEX_DUMP_ROW      16
+#define HEX_DUMP_LINE_MAX (8 + 1 + (3 * HEX_DUMP_ROW) + 2 + HEX_DUMP_ROW + 2)
+
+static const char hex_digit[16] = "0123456789abcdef";
+
+static uint8_t last_row[HEX_DUMP_ROW];  // last full row of the previous call
+static bool last_row_valid;
+static bool skipping;                   // rows are being skipped as repeats
+
+/***************************************************************************//**
+* @brief
+*	Format one row
+*
+* @param[out] *line
+* 		Line buffer, HEX_DUMP_LINE_MAX bytes
+* @param[in] *p
+* 		Data of the row
+* @param[in] n
+* 		Bytes in the row, up to HEX_DUMP_ROW
+* @param[in] addr
+* 		Address of the first byte
+* @param[in] flags
+* 		HEX_DUMP_ flags
+* @return Length of the line, with CR LF
+*
+******************************************************************************/
+static size_t hex_dump_row(char *line, const uint8_t *p, size_t n, uint32_t addr, unsigned int flags)
+{
+	char *q = line;
+	int shift;
+	size_t i;
+
+	for (shift = 28; shift >= 0; shift -= 4)
+		*q++ = hex_digit[(addr >> shift) & 0xf];
+	*q++ = ':';
+	for (i = 0; i < HEX_DUMP_ROW; i++)
+	{
+		if (i < n)
+		{
+			q[0] = ' ';
+			q[1] = hex_digit[p[i] >> 4];
+			q[2] = hex_digit[p[i] & 0xf];
+		}
+		else
+			q[0] = q[1] = q[2] = ' ';
+		q += 3;
+	}
+	if (flags & HEX_DUMP_ASCII)
+	{
+		*q++ = ' ';
+		*q++ = ' ';
+		for (i = 0; i < n; i++)
+			*q++ = ((p[i] >= 0x20) && (p[i] < 0x7f)) ? p[i] : '.';
+	}
+	*q++ = '\r';
+	*q++ = '\n';
+	return q - line;
+}
+
 /***************************************************************************//**
 * @brief
 *	Print Hex Data
+* @note
+* 		Each row is formatted into a line buffer by table lookup, and
+* 		written to the serial port in one call, rather than by printf().
+* 		Anything printf() has buffered is flushed first.
 *
 * @param[in] *buf
 * 		Pointer to Buffer to print out
@@ -56,25 +121,48 @@
 * 		Length of Buffer to print
 * @param[in] addr_offset
 * 		Address offset
-*
+* @param[in] flags
+* 		HEX_DUMP_ flags
 *
 ******************************************************************************/
-void hex_dump(uint8_t *buf, size_t len, uint32_t addr_offset)
+void hex_dump(const uint8_t *buf, size_t len, uint32_t addr_offset, unsigned int flags)
 {
-  uint32_t i;
-  int j;
-  for (i = 0; i < len; i += 16)
-  {
-	printf("%08" PRIx32 ":", addr_offset + i);
-	for (j = 0; j < 16; j++)
+	char line[HEX_DUMP_LINE_MAX];
+	const uint8_t *prev;
+	size_t i;
+	size_t n;
+
+	fflush(stdout);
+	if (! (flags & HEX_DUMP_CONTINUED))
 	{
-	  if (i + j < len)
-		printf(" %02" PRIx8 "", buf[i+j]);
-	  else
-		printf("   ");
+		last_row_valid = false;
+		skipping = false;
 	}
-	printf("\r\n");
-  }
+	prev = last_row_valid ? last_row : NULL;
+
+	for (i = 0; i < len; i += HEX_DUMP_ROW)
+	{
+		n = (len - i) < HEX_DUMP_ROW ? (len - i) : HEX_DUMP_ROW;
+		if ((flags & HEX_DUMP_SKIP_REPEATS) && prev && (n == HEX_DUMP_ROW) &&
+			(memcmp(prev, & buf[i], HEX_DUMP_ROW) == 0) &&
+			((i + n < len) || (flags & HEX_DUMP_MORE)))  // the last row always shows
+		{
+			if (! skipping)
+				serial_blocking_write((const uint8_t *) "*\r\n", 3);
+			skipping = true;
+		}
+		else
+		{
+			serial_blocking_write((const uint8_t *) line,
+					              hex_dump_row(line, & buf[i], n, addr_offset + i, flags));
+			skipping = false;
+		}
+		prev = (n == HEX_DUMP_ROW) ? & buf[i] : NULL;
+	}
+
+	last_row_valid = prev != NULL;
+	if (prev)
+		memcpy(last_row, prev, HEX_DUMP_ROW);
 }
 
 /** @} (end addtogroup Hex_Dump) */
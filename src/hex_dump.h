@@ -34,6 +34,7 @@
 #ifndef HEX_DUMP_H_
 #define HEX_DUMP_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 /***************************************************************************//**
@@ -46,7 +47,13 @@
  * @{
  ******************************************************************************/
 
-void hex_dump(uint8_t *buf, size_t len, uint32_t addr_offset);
+// hex_dump() flags
+#define HEX_DUMP_ASCII        0x01  // ASCII column after the bytes
+#define HEX_DUMP_SKIP_REPEATS 0x02  // "*" in place of rows repeating the one before
+#define HEX_DUMP_CONTINUED    0x04  // continues the previous call, for SKIP_REPEATS
+#define HEX_DUMP_MORE         0x08  // more calls follow, so the last row may be skipped
+
+void hex_dump(const uint8_t *buf, size_t len, uint32_t addr_offset, unsigned int flags);
 
 /** @} (end addtogroup Hex_Dump) */
 /** @} (end addtogroup AppManagement) */
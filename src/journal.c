@@ -0,0 +1,524 @@
+/******************************************************************************
+ * @file journal.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "journal.h"
+#include "spiflash.h"
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Journal
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+ * @verbatim
+ *  The region is a ring of erase units. Records are appended to the head
+ *  unit, packed one after another across its program pages. When the
+ *  next record doesn't fit, the unit after the head is erased, given a
+ *  unit header and becomes the head; once every unit is in use, that is
+ *  the oldest unit, the tail, whose records are lost.
+ *
+ *  Units are erased in ring order, so unlike those of store.c their
+ *  headers have no erase count, but they do have the sequence number of
+ *  their first record. Unit header, little-endian:
+ *    magic u32, unit sequence u32, first record sequence u32,
+ *    CRC-16 u16 of those, 0xffff
+ *  Record:
+ *    data length u16, CRC-16 u16 of length, sequence and data,
+ *    sequence u32, data
+ *  A length of 0xffff is erased flash, the end of the unit's records.
+ *
+ *  Unit sequence numbers increase around the ring from the tail to the
+ *  head, then drop, so journal_mount() finds the head by binary search
+ *  over the unit headers. A unit is erased and given its header in one
+ *  step, so the only unit without a valid header, other than those not
+ *  yet used, is one which power failed between the two: the one after
+ *  the head. Within the head unit, record headers are followed to the
+ *  first erased one. If the last record was torn by a power failure,
+ *  its CRC is bad, and the unit is treated as full.
+ *  @endverbatim
+ *****************************************************************************/
+
+#define JOURNAL_MAGIC 0x4c4e524a  // "JRNL"
+
+static uint32_t jr_base;
+static uint32_t jr_unit_size;
+static uint32_t jr_unit_count;
+static bool jr_use_so_irq;
+
+static uint32_t jr_units_used;  // 0 if the journal is empty
+static uint32_t jr_head;        // unit being appended to
+static uint32_t jr_head_offset; // where the next record goes in it
+static uint32_t jr_tail;        // oldest unit
+static uint32_t jr_unit_seq;    // of the head unit
+static uint32_t jr_first_seq;   // of the oldest record
+static uint32_t jr_next_seq;
+
+static journal_stats_t jr_stats;
+static uint32_t jr_reads;
+
+static uint8_t jr_record[JOURNAL_MAX_RECORD];
+
+/***************************************************************************//**
+ * @brief
+ *   CRC of a record, whose header and data are in rec
+ ******************************************************************************/
+static uint16_t journal_record_crc(const uint8_t *rec, size_t len)
+{
+	uint16_t crc = store_crc16(0xffff, rec, 2);  // length
+
+	crc = store_crc16(crc, & rec[4], 4);  // sequence
+	return store_crc16(crc, & rec[JOURNAL_RECORD_HEADER_SIZE], len);
+}
+
+static uint32_t journal_unit_addr(uint32_t unit)
+{
+	return jr_base + unit * jr_unit_size;
+}
+
+static uint32_t journal_next_unit(uint32_t unit)
+{
+	return (unit + 1) % jr_unit_count;
+}
+
+static void journal_flash_read(uint32_t addr, size_t len, uint8_t *buf)
+{
+	spiflash_read(addr, len, buf, NULL, NULL);
+	jr_reads++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read a unit header
+ * @param[in] unit
+ * 		Unit index
+ * @param[out] *first_seq
+ * 		Sequence number of its first record, or NULL
+ * @return Unit sequence number, or 0 if the header isn't valid
+ ******************************************************************************/
+static uint32_t journal_read_unit_header(uint32_t unit, uint32_t *first_seq)
+{
+	uint8_t h[JOURNAL_UNIT_HEADER_SIZE];
+
+	journal_flash_read(journal_unit_addr(unit), sizeof(h), h);
+	if ((store_get_u32(& h[0]) != JOURNAL_MAGIC) ||
+		(store_get_u16(& h[12]) != store_crc16(0xffff, h, 12)))
+		return 0;
+	if (first_seq)
+		*first_seq = store_get_u32(& h[8]);
+	return store_get_u32(& h[4]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the end of the records in the head unit
+ * @note
+ * 		Sets jr_head_offset and jr_next_seq. Only the data of the last
+ * 		record is read, to check for a torn write.
+ * @param[in] first_seq
+ * 		Sequence number of the unit's first record
+ ******************************************************************************/
+static void journal_find_head_end(uint32_t first_seq)
+{
+	uint32_t addr = journal_unit_addr(jr_head);
+	uint32_t offset = JOURNAL_UNIT_HEADER_SIZE;
+	uint32_t last = 0;  // offset of the last record, 0 if none
+	uint32_t len = 0;
+	uint8_t h[JOURNAL_RECORD_HEADER_SIZE];
+
+	jr_next_seq = first_seq;
+	while ((offset + JOURNAL_RECORD_HEADER_SIZE) <= jr_unit_size)
+	{
+		journal_flash_read(addr + offset, sizeof(h), h);
+		len = store_get_u16(& h[0]);
+		if (len == 0xffff)
+			break;
+		if ((len > journal_max_data()) || ((offset + JOURNAL_RECORD_HEADER_SIZE + len) > jr_unit_size))
+		{
+			offset = jr_unit_size;  // garbled header, take no more
+			break;
+		}
+		last = offset;
+		jr_next_seq = store_get_u32(& h[4]) + 1;
+		offset += JOURNAL_RECORD_HEADER_SIZE + len;
+	}
+	jr_head_offset = offset;
+
+	if (last)
+	{
+		journal_flash_read(addr + last, JOURNAL_RECORD_HEADER_SIZE, jr_record);
+		len = store_get_u16(& jr_record[0]);
+		journal_flash_read(addr + last + JOURNAL_RECORD_HEADER_SIZE, len, & jr_record[JOURNAL_RECORD_HEADER_SIZE]);
+		if (store_get_u16(& jr_record[2]) != journal_record_crc(jr_record, len))
+		{
+			// torn: its sequence number goes to the next record, in a new unit
+			jr_next_seq = store_get_u32(& jr_record[4]);
+			jr_head_offset = jr_unit_size;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Mount a journal, finding its head and tail
+ * @note
+ * 		Reads about log2(unit count) + 3 unit headers, and the record
+ * 		headers of the head unit. The flash must already be unprotected
+ * 		over the whole region before appending.
+ * @param[in] base
+ * 		Start address of the region, aligned to unit_size
+ * @param[in] len
+ * 		Length of the region, a multiple of unit_size
+ * @param[in] unit_size
+ * 		Erase unit, must be one of the erase sizes supported by the part
+ * @param[in] use_so_irq
+ * 		Use the Active Status Interrupt on SO for erases and writes, if
+ * 		the part supports it
+ * @return
+ * 		true if successful, including if the region holds no journal
+ ******************************************************************************/
+bool journal_mount(uint32_t base,
+		           uint32_t len,
+		           uint32_t unit_size,
+		           bool use_so_irq)
+{
+	uint32_t first_seq = 1;
+	uint32_t seq0;
+	uint32_t lo;
+	uint32_t hi;
+	uint32_t mid;
+	uint32_t seq;
+	bool found = false;
+	int i;
+
+	if ((unit_size < (JOURNAL_UNIT_HEADER_SIZE + JOURNAL_RECORD_HEADER_SIZE + 1)) ||
+		(base % unit_size) || (len % unit_size) || ((len / unit_size) < JOURNAL_MIN_UNITS))
+		return false;
+
+	jr_base = base;
+	jr_unit_size = unit_size;
+	jr_unit_count = len / unit_size;
+	jr_use_so_irq = use_so_irq;
+	memset(& jr_stats, 0, sizeof(jr_stats));
+	jr_reads = 0;
+
+	// The head is the last unit from 0 whose sequence number is at least
+	// unit 0's, unless unit 0 is the one without a header.
+	seq0 = journal_read_unit_header(0, NULL);
+	if (seq0 == 0)
+		lo = jr_unit_count - 1;
+	else
+	{
+		lo = 0;
+		hi = jr_unit_count;
+		while ((hi - lo) > 1)
+		{
+			mid = lo + (hi - lo) / 2;
+			seq = journal_read_unit_header(mid, NULL);
+			if (seq && (seq >= seq0))
+				lo = mid;
+			else
+				hi = mid;
+		}
+	}
+	jr_head = lo;
+	jr_unit_seq = journal_read_unit_header(jr_head, & first_seq);
+
+	if (jr_unit_seq == 0)
+	{
+		// empty
+		jr_units_used = 0;
+		jr_head = 0;
+		jr_tail = 0;
+		jr_head_offset = unit_size;
+		jr_first_seq = 1;
+		jr_next_seq = 1;
+		jr_stats.mount_reads = jr_reads;
+		return true;
+	}
+
+	// The tail is the first unit with a header after the head, skipping
+	// one left without a header, or unit 0 if the ring hasn't wrapped.
+	jr_tail = jr_head;
+	for (i = 1; i <= 2; i++)
+	{
+		mid = (jr_head + i) % jr_unit_count;
+		if (mid == jr_head)
+			break;
+		if (journal_read_unit_header(mid, & jr_first_seq))
+		{
+			jr_tail = mid;
+			found = true;
+			break;
+		}
+	}
+	if (! found)
+	{
+		if (seq0 && jr_head)
+			journal_read_unit_header(0, & jr_first_seq);
+		else
+			jr_first_seq = first_seq;
+		jr_tail = seq0 ? 0 : jr_head;
+	}
+	jr_units_used = ((jr_head + jr_unit_count - jr_tail) % jr_unit_count) + 1;
+
+	journal_find_head_end(first_seq);
+	jr_stats.mount_reads = jr_reads;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a region and mount an empty journal in it
+ * @note
+ * 		Parameters as journal_mount().
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool journal_format(uint32_t base,
+		            uint32_t len,
+		            uint32_t unit_size,
+		            bool use_so_irq)
+{
+	if ((unit_size == 0) || (base % unit_size) || (len % unit_size))
+		return false;
+	if (! spiflash_erase(base, len, 0, use_so_irq, NULL, NULL))
+		return false;
+	return journal_mount(base, len, unit_size, use_so_irq);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Largest record data journal_append() takes
+ ******************************************************************************/
+size_t journal_max_data(void)
+{
+	size_t max = JOURNAL_MAX_RECORD;
+
+	if (max > (jr_unit_size - JOURNAL_UNIT_HEADER_SIZE))
+		max = jr_unit_size - JOURNAL_UNIT_HEADER_SIZE;
+	return max - JOURNAL_RECORD_HEADER_SIZE;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Make the unit after the head the new head
+ * @note
+ * 		If every unit is in use, the tail is dropped.
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+static bool journal_open_unit(void)
+{
+	uint8_t h[JOURNAL_UNIT_HEADER_SIZE];
+	uint32_t unit = jr_units_used ? journal_next_unit(jr_head) : jr_head;
+
+	if (jr_units_used == jr_unit_count)
+	{
+		jr_tail = journal_next_unit(jr_tail);
+		jr_units_used--;
+		journal_read_unit_header(jr_tail, & jr_first_seq);
+	}
+
+	if (! spiflash_erase(journal_unit_addr(unit), jr_unit_size, jr_unit_size, jr_use_so_irq, NULL, NULL))
+		return false;
+	jr_stats.unit_erases++;
+
+	store_put_u32(& h[0], JOURNAL_MAGIC);
+	store_put_u32(& h[4], jr_unit_seq + 1);
+	store_put_u32(& h[8], jr_next_seq);
+	store_put_u16(& h[12], store_crc16(0xffff, h, 12));
+	store_put_u16(& h[14], 0xffff);
+	spiflash_write(journal_unit_addr(unit), sizeof(h), h, jr_use_so_irq, NULL, NULL);
+
+	if (jr_units_used == 0)
+	{
+		jr_tail = unit;
+		jr_first_seq = jr_next_seq;
+	}
+	jr_unit_seq++;
+	jr_head = unit;
+	jr_head_offset = JOURNAL_UNIT_HEADER_SIZE;
+	jr_units_used++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Append a record
+ * @note
+ * 		The record is on the flash when this returns. If the head unit has
+ * 		no room for it, the next unit is erased first, which may drop the
+ * 		oldest records.
+ * @param[in] *data
+ * 		Record data
+ * @param[in] len
+ * 		Length of data, up to journal_max_data()
+ * @param[out] *seq
+ * 		Sequence number given to the record, or NULL
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool journal_append(const uint8_t *data, size_t len, uint32_t *seq)
+{
+	size_t rec_len = JOURNAL_RECORD_HEADER_SIZE + len;
+
+	if (! jr_unit_count || (len > journal_max_data()))
+		return false;
+
+	if ((jr_units_used == 0) || ((jr_head_offset + rec_len) > jr_unit_size))
+		if (! journal_open_unit())
+			return false;
+
+	store_put_u16(& jr_record[0], len);
+	store_put_u32(& jr_record[4], jr_next_seq);
+	memcpy(& jr_record[JOURNAL_RECORD_HEADER_SIZE], data, len);
+	store_put_u16(& jr_record[2], journal_record_crc(jr_record, len));
+	spiflash_write(journal_unit_addr(jr_head) + jr_head_offset, rec_len, jr_record, jr_use_so_irq, NULL, NULL);
+
+	if (seq)
+		*seq = jr_next_seq;
+	jr_head_offset += rec_len;
+	jr_next_seq++;
+	jr_stats.appends++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start reading at the oldest record
+ * @param[out] *cursor
+ * 		Cursor for journal_read()
+ * @return
+ * 		false if the journal is empty
+ ******************************************************************************/
+bool journal_first(journal_cursor_t *cursor)
+{
+	cursor->unit = jr_tail;
+	cursor->offset = JOURNAL_UNIT_HEADER_SIZE;
+	cursor->seq = jr_first_seq;
+	return jr_units_used && (jr_first_seq != jr_next_seq);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the record at a cursor, and move it to the next
+ * @note
+ * 		Records with a bad CRC end their unit, and are skipped.
+ * @param[in,out] *cursor
+ * 		From journal_first()
+ * @param[out] *data
+ * 		Buffer for the record data
+ * @param[in] size
+ * 		Size of the buffer; data beyond it is left out
+ * @param[out] *len
+ * 		Length of the record data
+ * @return
+ * 		false if there are no more records
+ ******************************************************************************/
+bool journal_read(journal_cursor_t *cursor,
+		          uint8_t *data,
+		          size_t size,
+		          size_t *len)
+{
+	uint32_t addr;
+	uint32_t rec_len;
+
+	while (jr_units_used)
+	{
+		if (cursor->unit == jr_head)
+		{
+			if (cursor->offset >= jr_head_offset)
+				return false;
+		}
+		else if ((cursor->offset + JOURNAL_RECORD_HEADER_SIZE) > jr_unit_size)
+		{
+			cursor->unit = journal_next_unit(cursor->unit);
+			cursor->offset = JOURNAL_UNIT_HEADER_SIZE;
+			continue;
+		}
+
+		addr = journal_unit_addr(cursor->unit) + cursor->offset;
+		spiflash_read(addr, JOURNAL_RECORD_HEADER_SIZE, jr_record, NULL, NULL);
+		rec_len = store_get_u16(& jr_record[0]);
+		if ((rec_len <= journal_max_data()) &&
+			((cursor->offset + JOURNAL_RECORD_HEADER_SIZE + rec_len) <= jr_unit_size))
+		{
+			spiflash_read(addr + JOURNAL_RECORD_HEADER_SIZE, rec_len, & jr_record[JOURNAL_RECORD_HEADER_SIZE], NULL, NULL);
+			if (store_get_u16(& jr_record[2]) == journal_record_crc(jr_record, rec_len))
+			{
+				cursor->seq = store_get_u32(& jr_record[4]);
+				cursor->offset += JOURNAL_RECORD_HEADER_SIZE + rec_len;
+				memcpy(data, & jr_record[JOURNAL_RECORD_HEADER_SIZE], (rec_len < size) ? rec_len : size);
+				*len = rec_len;
+				return true;
+			}
+		}
+
+		// end of the unit's records
+		if (cursor->unit == jr_head)
+			return false;
+		cursor->unit = journal_next_unit(cursor->unit);
+		cursor->offset = JOURNAL_UNIT_HEADER_SIZE;
+	}
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get journal statistics
+ * @param[out] *stats
+ * 		Pointer to structure to receive the statistics
+ ******************************************************************************/
+void journal_get_stats(journal_stats_t *stats)
+{
+	*stats = jr_stats;
+	stats->unit_count = jr_unit_count;
+	stats->unit_size = jr_unit_size;
+	stats->units_used = jr_units_used;
+	stats->first_seq = jr_first_seq;
+	stats->next_seq = jr_next_seq;
+	stats->used_bytes = jr_units_used * jr_unit_size;
+}
+
+/** @} (end addtogroup Journal) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
@@ -0,0 +1,105 @@
+/****************************************************************************//**
+ * @file journal.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup Journal
+ * @brief Append-only record log in a ring of erase units
+ * @{
+ ******************************************************************************/
+
+#define JOURNAL_UNIT_HEADER_SIZE   16   // at the start of each unit in use
+#define JOURNAL_RECORD_HEADER_SIZE 8    // before each record's data
+#define JOURNAL_MAX_RECORD         256  // header and data of one record
+
+#define JOURNAL_MIN_UNITS 2
+
+typedef struct
+{
+	uint32_t unit_count;
+	uint32_t unit_size;
+	uint32_t units_used;     // units holding records
+	uint32_t first_seq;      // sequence number of the oldest record
+	uint32_t next_seq;       // sequence number the next record will get
+	uint32_t used_bytes;     // flash taken by the units holding records
+	uint32_t appends;        // records appended since mount
+	uint32_t unit_erases;    // units erased since mount
+	uint32_t mount_reads;    // flash reads made by the last mount
+} journal_stats_t;
+
+// Position of a record, for reading the journal oldest first
+typedef struct
+{
+	uint32_t unit;    // unit index in the ring
+	uint32_t offset;  // of the record header within the unit
+	uint32_t seq;     // sequence number of the record there
+} journal_cursor_t;
+
+bool journal_format(uint32_t base,
+		            uint32_t len,
+		            uint32_t unit_size,
+		            bool use_so_irq);
+
+bool journal_mount(uint32_t base,
+		           uint32_t len,
+		           uint32_t unit_size,
+		           bool use_so_irq);
+
+size_t journal_max_data(void);
+
+bool journal_append(const uint8_t *data, size_t len, uint32_t *seq);
+
+bool journal_first(journal_cursor_t *cursor);
+
+bool journal_read(journal_cursor_t *cursor,
+		          uint8_t *data,
+		          size_t size,
+		          size_t *len);
+
+void journal_get_stats(journal_stats_t *stats);
+
+/** @} (end addtogroup Journal) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
+
+#endif /* JOURNAL_H_ */
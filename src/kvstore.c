@@ -0,0 +1,720 @@
+/******************************************************************************
+ * @file kvstore.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "rtcdriver.h"
+
+#include "kvstore.h"
+#include "spiflash.h"
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup KV_Store
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+ * @verbatim
+ *  Entries are appended to the active unit; a put of a key which is already
+ *  stored leaves its old entry behind as dead space, and a delete appends a
+ *  deleted entry. The RAM index maps each key to the region offset and size
+ *  of its newest entry, so a get is one flash read. The index is rebuilt at
+ *  mount by reading the entries of the units in the order they were opened.
+ *
+ *  Units have the header described in store.c, with the magic "KVST".
+ *  Entry, little-endian:
+ *    key u32, value length u8, flags u8, CRC-16 u16 of all but itself,
+ *    value
+ *  A length of 0xff is erased flash, the end of the unit's entries.
+ *
+ *  One free unit is always kept back for garbage collection, which copies
+ *  the entries still in the index out of a full unit and erases it. The
+ *  unit collected is the one with the least live data, unless the spread
+ *  of erase counts has grown past KV_WEAR_DELTA, when it is the least
+ *  erased unit, so that units holding data which never changes take their
+ *  share of erases.
+ *
+ *  Only the newest unit can hold an entry torn by a power failure, so its
+ *  entries' CRCs are checked at mount, and a torn entry ends the unit. If
+ *  that unit is the one kept back, a collection was copying to it, so it
+ *  is erased, leaving the victim's entries where they were.
+ *  @endverbatim
+ *****************************************************************************/
+
+#define KV_MAGIC 0x5453564b  // "KVST"
+
+#define KV_FLAG_VALUE   0xfe
+#define KV_FLAG_DELETED 0xfc
+
+// erase count spread which makes collection pick the least erased unit
+#define KV_WEAR_DELTA 16
+
+#define KV_INDEX_SIZE 128  // power of two, above KV_MAX_KEYS
+
+typedef struct
+{
+	uint32_t fill;  // offset of the end of the unit's entries
+	uint32_t live;  // bytes of entries in the index
+} kv_unit_t;
+
+typedef struct
+{
+	uint32_t key;  // KV_KEY_INVALID if the slot is empty
+	uint32_t loc;  // region offset, with the entry size in the top byte
+} kv_slot_t;
+
+static store_units_t kv_store = { .magic = KV_MAGIC };
+static bool kv_mounted;
+
+static kv_unit_t kv_units[KV_MAX_UNITS];
+static uint8_t kv_active;  // unit being appended to, or STORE_UNIT_NONE
+
+static kv_slot_t kv_index[KV_INDEX_SIZE];
+static uint32_t kv_keys;
+
+static kv_stats_t kv_stats;
+static uint32_t kv_reads;
+
+static uint8_t kv_entry[KV_ENTRY_HEADER_SIZE + KV_MAX_VALUE];
+
+/***************************************************************************//**
+ * @brief
+ *   CRC of the entry in kv_entry, whose value is len bytes
+ ******************************************************************************/
+static uint16_t kv_entry_crc(size_t len)
+{
+	uint16_t crc = store_crc16(0xffff, kv_entry, 6);  // key, length, flags
+
+	return store_crc16(crc, & kv_entry[KV_ENTRY_HEADER_SIZE], len);
+}
+
+static void kv_flash_read(uint32_t addr, size_t len, uint8_t *buf)
+{
+	spiflash_read(addr, len, buf, NULL, NULL);
+	kv_reads++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Index access
+ * @note
+ * 		Open addressing with linear probing. The table is never full, as
+ * 		there are at most KV_MAX_KEYS keys.
+ ******************************************************************************/
+static uint32_t kv_hash(uint32_t key)
+{
+	return (key * 2654435761u) >> 25;  // top 7 bits, KV_INDEX_SIZE
+}
+
+static uint32_t kv_loc_offset(uint32_t loc)
+{
+	return loc & 0xffffff;
+}
+
+static uint32_t kv_loc_size(uint32_t loc)
+{
+	return loc >> 24;
+}
+
+// slot holding key, or the empty slot where it would go
+static uint32_t kv_index_find(uint32_t key)
+{
+	uint32_t i = kv_hash(key);
+
+	while ((kv_index[i].key != KV_KEY_INVALID) && (kv_index[i].key != key))
+		i = (i + 1) & (KV_INDEX_SIZE - 1);
+	return i;
+}
+
+static void kv_index_remove(uint32_t slot)
+{
+	uint32_t i = slot;
+	uint32_t h;
+
+	kv_units[kv_loc_offset(kv_index[slot].loc) / kv_store.unit_size].live -= kv_loc_size(kv_index[slot].loc);
+	kv_keys--;
+
+	// move back any later entry of the probe run which may not be left past the gap
+	for (;;)
+	{
+		i = (i + 1) & (KV_INDEX_SIZE - 1);
+		if (kv_index[i].key == KV_KEY_INVALID)
+			break;
+		h = kv_hash(kv_index[i].key);
+		if ((slot <= i) ? ((slot < h) && (h <= i)) : ((slot < h) || (h <= i)))
+			continue;
+		kv_index[slot] = kv_index[i];
+		slot = i;
+	}
+	kv_index[slot].key = KV_KEY_INVALID;
+}
+
+// point key at a new entry, updating the live data of the units
+static void kv_index_set(uint32_t key, uint32_t offset, uint32_t size)
+{
+	uint32_t slot = kv_index_find(key);
+
+	if (kv_index[slot].key == key)
+		kv_units[kv_loc_offset(kv_index[slot].loc) / kv_store.unit_size].live -= kv_loc_size(kv_index[slot].loc);
+	else
+		kv_keys++;
+	kv_index[slot].key = key;
+	kv_index[slot].loc = offset | (size << 24);
+	kv_units[offset / kv_store.unit_size].live += size;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a unit and write the first part of its header
+ * @param[in] unit
+ * 		Unit index; its erase count is incremented
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+static bool kv_erase_unit(uint32_t unit)
+{
+	if (! store_unit_erase(& kv_store, unit))
+		return false;
+	kv_units[unit].fill = KV_UNIT_HEADER_SIZE;
+	kv_units[unit].live = 0;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Make the least erased free unit the active unit
+ * @return
+ * 		false if there is no free unit
+ ******************************************************************************/
+static bool kv_open_unit(void)
+{
+	uint32_t unit = store_unit_open(& kv_store);
+
+	if (unit == STORE_UNIT_NONE)
+		return false;
+	kv_active = unit;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the entry in kv_entry to the active unit
+ * @note
+ * 		The caller has made room for it.
+ * @param[in] size
+ * 		Size of the entry, header and value
+ * @return Region offset of the entry
+ ******************************************************************************/
+static uint32_t kv_write_entry(uint32_t size)
+{
+	uint32_t offset = kv_active * kv_store.unit_size + kv_units[kv_active].fill;
+
+	spiflash_write(kv_store.base + offset, size, kv_entry, kv_store.use_so_irq, NULL, NULL);
+	kv_units[kv_active].fill += size;
+	return offset;
+}
+
+static bool kv_active_has_room(uint32_t size)
+{
+	return (kv_active != STORE_UNIT_NONE) && ((kv_units[kv_active].fill + size) <= kv_store.unit_size);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Choose the unit to collect
+ * @param[in] wear
+ * 		Allow choosing the least erased unit for wear leveling
+ * @return
+ * 		Unit index, or STORE_UNIT_NONE if no unit holds any data
+ ******************************************************************************/
+static uint32_t kv_choose_victim(bool wear)
+{
+	uint32_t ec_min = 0xffffffff;
+	uint32_t ec_max = 0;
+	uint32_t least_live = STORE_UNIT_NONE;
+	uint32_t least_erased = STORE_UNIT_NONE;
+	uint32_t i;
+
+	for (i = 0; i < kv_store.unit_count; i++)
+	{
+		if (kv_store.unit[i].erase_count < ec_min)
+			ec_min = kv_store.unit[i].erase_count;
+		if (kv_store.unit[i].erase_count > ec_max)
+			ec_max = kv_store.unit[i].erase_count;
+		if ((kv_store.unit[i].seq == STORE_SEQ_FREE) || (i == kv_active))
+			continue;
+		if ((least_live == STORE_UNIT_NONE) || (kv_units[i].live < kv_units[least_live].live) ||
+			((kv_units[i].live == kv_units[least_live].live) && (kv_store.unit[i].seq < kv_store.unit[least_live].seq)))
+			least_live = i;
+		if ((least_erased == STORE_UNIT_NONE) || (kv_store.unit[i].erase_count < kv_store.unit[least_erased].erase_count))
+			least_erased = i;
+	}
+
+	if (wear && (least_erased != STORE_UNIT_NONE) && ((ec_max - ec_min) > KV_WEAR_DELTA) &&
+		(kv_store.unit[least_erased].erase_count == ec_min))
+		return least_erased;
+	return least_live;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Garbage collect a unit
+ * @note
+ * 		Its entries which are in the index are copied to the active unit,
+ * 		opening the free unit kept back if needed, and it is erased.
+ * 		Deleted entries are dropped if the unit is the oldest, as no older
+ * 		entry for the key can then be left on the flash.
+ * @param[in] unit
+ * 		Unit to collect, neither free nor active
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+static bool kv_collect(uint32_t unit)
+{
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint64_t ticks;
+	uint32_t copied = kv_stats.gc_copied_bytes;
+	uint32_t offset;
+	uint32_t region_offset;
+	uint32_t size;
+	uint32_t slot;
+	bool oldest = true;
+	uint32_t i;
+
+	for (i = 0; i < kv_store.unit_count; i++)
+		if ((kv_store.unit[i].seq != STORE_SEQ_FREE) && (kv_store.unit[i].seq < kv_store.unit[unit].seq))
+			oldest = false;
+
+	offset = KV_UNIT_HEADER_SIZE;
+	while (kv_units[unit].live && ((offset + KV_ENTRY_HEADER_SIZE) <= kv_units[unit].fill))
+	{
+		region_offset = unit * kv_store.unit_size + offset;
+		spiflash_read(kv_store.base + region_offset, KV_ENTRY_HEADER_SIZE, kv_entry, NULL, NULL);
+		size = KV_ENTRY_HEADER_SIZE + kv_entry[4];
+		slot = kv_index_find(store_get_u32(& kv_entry[0]));
+		if ((kv_index[slot].key != KV_KEY_INVALID) && (kv_loc_offset(kv_index[slot].loc) == region_offset))
+		{
+			if (oldest && (kv_entry[5] == KV_FLAG_DELETED))
+				kv_index_remove(slot);
+			else
+			{
+				spiflash_read(kv_store.base + region_offset + KV_ENTRY_HEADER_SIZE, size - KV_ENTRY_HEADER_SIZE,
+						      & kv_entry[KV_ENTRY_HEADER_SIZE], NULL, NULL);
+				if (! kv_active_has_room(size))
+					if (! kv_open_unit())
+						return false;
+				kv_index_set(store_get_u32(& kv_entry[0]), kv_write_entry(size), size);
+				kv_stats.gc_copied_bytes += size;
+			}
+		}
+		offset += size;
+	}
+
+	if (! kv_erase_unit(unit))
+		return false;
+
+	ticks = RTCDRV_GetWallClockTicks64() - start;
+	kv_stats.gc_runs++;
+	kv_stats.gc_ticks += ticks;
+	if (ticks > kv_stats.gc_max_ticks)
+		kv_stats.gc_max_ticks = ticks;
+	if (kv_stats.gc_copied_bytes != copied)
+	{
+		kv_stats.gc_copy_runs++;
+		if (ticks > kv_stats.gc_copy_max_ticks)
+			kv_stats.gc_copy_max_ticks = ticks;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Make room in the active unit for an entry
+ * @param[in] size
+ * 		Size of the entry, header and value
+ * @return
+ * 		false if the store is full
+ ******************************************************************************/
+static bool kv_make_room(uint32_t size)
+{
+	uint32_t victim;
+	uint32_t tries;
+
+	for (tries = 0; tries <= (2 * kv_store.unit_count); tries++)
+	{
+		if (kv_active_has_room(size))
+			return true;
+		if (kv_store.free_count > 1)
+		{
+			if (! kv_open_unit())
+				return false;
+			continue;
+		}
+		victim = kv_choose_victim(true);
+		if ((victim == STORE_UNIT_NONE) || ! kv_collect(victim))
+			return false;
+	}
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check and set the geometry of the store
+ ******************************************************************************/
+static bool kv_set_geometry(uint32_t base,
+		                    uint32_t len,
+		                    uint32_t unit_size,
+		                    bool use_so_irq)
+{
+	kv_mounted = false;
+	if ((unit_size <= (KV_UNIT_HEADER_SIZE + KV_ENTRY_HEADER_SIZE)) ||
+		(base % unit_size) || (len % unit_size) || (len > (1 << 24)) ||
+		((len / unit_size) < KV_MIN_UNITS) || ((len / unit_size) > KV_MAX_UNITS))
+		return false;
+
+	kv_store.base = base;
+	kv_store.unit_size = unit_size;
+	kv_store.unit_count = len / unit_size;
+	kv_store.erase_cmd_size = unit_size;
+	kv_store.use_so_irq = use_so_irq;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Index the entries of a unit
+ * @param[in] unit
+ * 		Unit index
+ * @param[in] newest
+ * 		Check the CRC of every entry, and stop at a torn one
+ * @param[out] *torn
+ * 		Set if the unit ended at a torn or bad entry
+ * @return
+ * 		false if there are too many keys
+ ******************************************************************************/
+static bool kv_scan_unit(uint32_t unit, bool newest, bool *torn)
+{
+	uint32_t offset = KV_UNIT_HEADER_SIZE;
+	uint32_t key;
+	uint32_t len;
+	uint32_t slot;
+	bool ok = true;
+
+	*torn = false;
+	while ((offset + KV_ENTRY_HEADER_SIZE) <= kv_store.unit_size)
+	{
+		kv_flash_read(store_unit_addr(& kv_store, unit) + offset, KV_ENTRY_HEADER_SIZE, kv_entry);
+		key = store_get_u32(& kv_entry[0]);
+		len = kv_entry[4];
+		if (len == 0xff)
+			break;
+		if ((len > KV_MAX_VALUE) || ((offset + KV_ENTRY_HEADER_SIZE + len) > kv_store.unit_size) ||
+			(key == KV_KEY_INVALID))
+		{
+			*torn = true;
+			break;
+		}
+		if (newest)
+		{
+			kv_flash_read(store_unit_addr(& kv_store, unit) + offset + KV_ENTRY_HEADER_SIZE, len, & kv_entry[KV_ENTRY_HEADER_SIZE]);
+			if (store_get_u16(& kv_entry[6]) != kv_entry_crc(len))
+			{
+				*torn = true;
+				break;
+			}
+		}
+		slot = kv_index_find(key);
+		if ((kv_index[slot].key != key) && (kv_keys >= KV_MAX_KEYS))
+		{
+			ok = false;
+			break;
+		}
+		kv_index_set(key, unit * kv_store.unit_size + offset, KV_ENTRY_HEADER_SIZE + len);
+		offset += KV_ENTRY_HEADER_SIZE + len;
+	}
+	kv_units[unit].fill = offset;
+	return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Mount a store, building the index
+ * @note
+ * 		Units left half erased or half opened by a power failure are
+ * 		erased, and a collection cut short is finished. The flash must
+ * 		already be unprotected over the whole region.
+ * @param[in] base
+ * 		Start address of the region, aligned to unit_size
+ * @param[in] len
+ * 		Length of the region, a multiple of unit_size, up to KV_MAX_UNITS
+ * 		units and 16 MiB
+ * @param[in] unit_size
+ * 		Erase unit, must be one of the erase sizes supported by the part
+ * @param[in] use_so_irq
+ * 		Use the Active Status Interrupt on SO for erases and writes, if
+ * 		the part supports it
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool kv_mount(uint32_t base,
+		      uint32_t len,
+		      uint32_t unit_size,
+		      bool use_so_irq)
+{
+	uint8_t order[KV_MAX_UNITS];
+	uint32_t in_use;
+	uint32_t victim;
+	bool torn = false;
+	uint32_t i;
+
+	if (! kv_set_geometry(base, len, unit_size, use_so_irq))
+		return false;
+
+	memset(& kv_stats, 0, sizeof(kv_stats));
+	kv_reads = 0;
+	for (i = 0; i < KV_INDEX_SIZE; i++)
+		kv_index[i].key = KV_KEY_INVALID;
+	kv_keys = 0;
+	kv_active = STORE_UNIT_NONE;
+	for (i = 0; i < kv_store.unit_count; i++)
+	{
+		kv_units[i].fill = KV_UNIT_HEADER_SIZE;
+		kv_units[i].live = 0;
+	}
+
+	if (! store_units_mount(& kv_store, order, & in_use))
+		return false;
+
+	for (i = 0; i < in_use; i++)
+		if (! kv_scan_unit(order[i], i == (in_use - 1), & torn))
+			return false;
+
+	// a collection torn while copying to the unit kept back: that unit
+	// holds only copies of entries still in the victim, so erase it and
+	// mount again, with it free to collect to
+	if (torn && (kv_store.free_count == 0))
+	{
+		if (! kv_erase_unit(order[in_use - 1]))
+			return false;
+		return kv_mount(base, len, unit_size, use_so_irq);
+	}
+
+	// entries go on after the newest, unless a torn one ended it
+	if (in_use && ! torn)
+		kv_active = order[in_use - 1];
+
+	// any other collection cut short leaves no free unit, and the rest of
+	// the victim's live entries fit in the unit they were being copied to
+	if (kv_store.free_count == 0)
+	{
+		victim = kv_choose_victim(false);
+		if ((victim == STORE_UNIT_NONE) || (kv_active == STORE_UNIT_NONE) ||
+			((kv_store.unit_size - kv_units[kv_active].fill) < kv_units[victim].live) ||
+			! kv_collect(victim))
+			return false;
+		kv_stats.gc_runs = 0;
+		kv_stats.gc_copied_bytes = 0;
+		kv_stats.gc_copy_runs = 0;
+	}
+
+	kv_stats.mount_reads = kv_store.reads + kv_reads;
+	kv_mounted = true;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a region and mount an empty store in it
+ * @note
+ * 		Erase counts in valid unit headers are kept. Parameters as
+ * 		kv_mount().
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool kv_format(uint32_t base,
+		       uint32_t len,
+		       uint32_t unit_size,
+		       bool use_so_irq)
+{
+	if (! kv_set_geometry(base, len, unit_size, use_so_irq) || ! store_units_format(& kv_store))
+		return false;
+	return kv_mount(base, len, unit_size, use_so_irq);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Largest value kv_put() takes
+ ******************************************************************************/
+size_t kv_max_value(void)
+{
+	size_t max = kv_store.unit_size - KV_UNIT_HEADER_SIZE - KV_ENTRY_HEADER_SIZE;
+
+	return (max < KV_MAX_VALUE) ? max : KV_MAX_VALUE;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Append an entry for a key, and index it
+ ******************************************************************************/
+static bool kv_append(uint32_t key, uint8_t flags, const uint8_t *value, size_t len)
+{
+	uint32_t size = KV_ENTRY_HEADER_SIZE + len;
+
+	if (! kv_make_room(size))
+		return false;
+
+	store_put_u32(& kv_entry[0], key);
+	kv_entry[4] = len;
+	kv_entry[5] = flags;
+	if (len)
+		memcpy(& kv_entry[KV_ENTRY_HEADER_SIZE], value, len);
+	store_put_u16(& kv_entry[6], kv_entry_crc(len));
+	kv_index_set(key, kv_write_entry(size), size);
+	kv_stats.puts++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Store a value for a key
+ * @note
+ * 		The value is on the flash when this returns. If the active unit is
+ * 		full, this may first garbage collect a unit, taking an erase time.
+ * @param[in] key
+ * 		Key, anything but KV_KEY_INVALID
+ * @param[in] *value
+ * 		Value
+ * @param[in] len
+ * 		Length of value, up to kv_max_value()
+ * @return
+ * 		false if there are too many keys, or the store is full
+ ******************************************************************************/
+bool kv_put(uint32_t key, const uint8_t *value, size_t len)
+{
+	uint32_t slot;
+
+	if (! kv_mounted || (key == KV_KEY_INVALID) || (len > kv_max_value()))
+		return false;
+	slot = kv_index_find(key);
+	if ((kv_index[slot].key != key) && (kv_keys >= KV_MAX_KEYS))
+		return false;
+	return kv_append(key, KV_FLAG_VALUE, value, len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Delete a key
+ * @note
+ * 		The key keeps its place in the index until garbage collection
+ * 		drops it.
+ * @param[in] key
+ * 		Key
+ * @return
+ * 		false if the store is full
+ ******************************************************************************/
+bool kv_delete(uint32_t key)
+{
+	if (! kv_mounted || (kv_index[kv_index_find(key)].key != key))
+		return true;
+	return kv_append(key, KV_FLAG_DELETED, NULL, 0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get the value of a key
+ * @note
+ * 		One flash read.
+ * @param[in] key
+ * 		Key
+ * @param[out] *value
+ * 		Buffer for the value
+ * @param[in] size
+ * 		Size of the buffer; the value beyond it is left out
+ * @param[out] *len
+ * 		Length of the value
+ * @return
+ * 		false if the key is not stored, or its entry is bad
+ ******************************************************************************/
+bool kv_get(uint32_t key, uint8_t *value, size_t size, size_t *len)
+{
+	uint32_t slot;
+	uint32_t loc;
+
+	if (! kv_mounted)
+		return false;
+	slot = kv_index_find(key);
+	if (kv_index[slot].key != key)
+		return false;
+	loc = kv_index[slot].loc;
+
+	kv_stats.gets++;
+	spiflash_read(kv_store.base + kv_loc_offset(loc), kv_loc_size(loc), kv_entry, NULL, NULL);
+	*len = kv_entry[4];
+	if ((store_get_u32(& kv_entry[0]) != key) || (kv_entry[5] != KV_FLAG_VALUE) ||
+		((KV_ENTRY_HEADER_SIZE + *len) != kv_loc_size(loc)) ||
+		(store_get_u16(& kv_entry[6]) != kv_entry_crc(*len)))
+		return false;
+	memcpy(value, & kv_entry[KV_ENTRY_HEADER_SIZE], (*len < size) ? *len : size);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get store statistics
+ * @param[out] *stats
+ * 		Pointer to structure to receive the statistics
+ ******************************************************************************/
+void kv_get_stats(kv_stats_t *stats)
+{
+	uint32_t i;
+
+	*stats = kv_stats;
+	stats->unit_count = kv_store.unit_count;
+	stats->unit_size = kv_store.unit_size;
+	stats->keys = kv_keys;
+	stats->free_units = kv_store.free_count;
+	store_units_erase_counts(& kv_store, & stats->erase_count_min, & stats->erase_count_max);
+	for (i = 0; i < kv_store.unit_count; i++)
+		stats->live_bytes += kv_units[i].live;
+}
+
+/** @} (end addtogroup KV_Store) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
@@ -0,0 +1,107 @@
+/****************************************************************************//**
+ * @file kvstore.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef KVSTORE_H_
+#define KVSTORE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup KV_Store
+ * @brief Wear-leveled key-value store in a set of erase units
+ * @{
+ ******************************************************************************/
+
+#define KV_UNIT_HEADER_SIZE  STORE_UNIT_HEADER_SIZE  // at the start of each unit
+#define KV_ENTRY_HEADER_SIZE 8    // before each entry's value
+#define KV_MAX_VALUE         128
+
+#define KV_MAX_KEYS  96   // including deleted keys not yet collected
+#define KV_MAX_UNITS STORE_MAX_UNITS
+#define KV_MIN_UNITS 3
+
+#define KV_KEY_INVALID 0xffffffff
+
+typedef struct
+{
+	uint32_t unit_count;
+	uint32_t unit_size;
+	uint32_t keys;             // keys in the index, including deleted ones
+	uint32_t live_bytes;       // flash taken by the entries in the index
+	uint32_t free_units;       // erased units, one of them kept for collection
+	uint32_t puts;             // since mount, including deletes
+	uint32_t gets;             // since mount
+	uint32_t gc_runs;          // units collected since mount
+	uint32_t gc_copied_bytes;  // bytes of live entries moved by collection
+	uint64_t gc_ticks;         // RTC ticks spent collecting
+	uint64_t gc_max_ticks;     // longest single collection, RTC ticks
+	uint32_t gc_copy_runs;     // collections which copied live entries
+	uint64_t gc_copy_max_ticks;  // longest of those, RTC ticks
+	uint32_t erase_count_min;  // least erased unit
+	uint32_t erase_count_max;  // most erased unit
+	uint32_t mount_reads;      // flash reads made by the last mount
+} kv_stats_t;
+
+bool kv_format(uint32_t base,
+		       uint32_t len,
+		       uint32_t unit_size,
+		       bool use_so_irq);
+
+bool kv_mount(uint32_t base,
+		      uint32_t len,
+		      uint32_t unit_size,
+		      bool use_so_irq);
+
+size_t kv_max_value(void);
+
+bool kv_put(uint32_t key, const uint8_t *value, size_t len);
+
+bool kv_get(uint32_t key, uint8_t *value, size_t size, size_t *len);
+
+bool kv_delete(uint32_t key);
+
+void kv_get_stats(kv_stats_t *stats);
+
+/** @} (end addtogroup KV_Store) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
+
+#endif /* KVSTORE_H_ */
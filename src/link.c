@@ -0,0 +1,770 @@
+/******************************************************************************
+ * @file link.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "em_int.h"
+
+#include "rtcdriver.h"
+
+#include "fatal.h"
+#include "link.h"
+#include "low_power.h"
+#include "main.h"
+#include "serial.h"
+#include "spiflash.h"
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Link
+ * @brief Binary flash dump and upload protocol on the serial port
+ * @details
+ * 		The flash and the serial port overlap. For READ, the next
+ * 		LINK_READ_CHUNK of the range is read into one half of buf1 while
+ * 		DATA frames are sent from the other. For WRITE, DATA frames are
+ * 		received into LINK_WINDOW slots in buf2 while an earlier one is
+ * 		programmed, and the range is erased ahead of the programming.
+ * 		Flash operations complete by callback, and the board sleeps in
+ * 		enter_low_power_state() whenever it is waiting for one or for
+ * 		the host.
+ *
+ * 		The host is responsible for recovery. It sends NAK if DATA stops
+ * 		arriving, and goes back to the last ACK if ACKs stop arriving.
+ * @{
+ ******************************************************************************/
+
+#define LINK_FRAME_MAX   (1 + 4 + LINK_MAX_DATA + 2)  // type, offset, data, CRC
+#define LINK_ENCODED_MAX (LINK_FRAME_MAX + (LINK_FRAME_MAX / 254) + 2)  // COBS codes, delimiter
+#define LINK_READ_CHUNK  (BUFFER_SIZE / 2)
+
+// A NAK never goes back further than the window, so never before the
+// older of the two chunks held in buf1.
+#if (LINK_WINDOW * LINK_MAX_DATA) > LINK_READ_CHUNK
+#  error "LINK_WINDOW too large for the read chunks in buf1"
+#endif
+
+#if (LINK_READ_CHUNK % LINK_MAX_DATA) != 0
+#  error "DATA frames must not span read chunks"
+#endif
+
+extern spiflash_id_t part;  // detected part, in main.c
+
+static uint8_t rx_frame[LINK_FRAME_MAX];
+static size_t rx_len;
+static uint8_t rx_code;       // code byte of the current COBS block, 0 before the first
+static uint8_t rx_remaining;  // bytes left in the current COBS block
+static bool rx_overflow;
+
+static uint8_t tx_frame[LINK_FRAME_MAX];
+static uint8_t tx_encoded[LINK_ENCODED_MAX];
+
+static RTCDRV_TimerID_t idle_timer;
+static bool idle_timer_allocated;
+static volatile bool idle_expired;
+
+static volatile bool flash_done;
+
+static int32_t chunk_loaded[2];  // chunk of the range in each half of buf1, or -1
+static int32_t chunk_reading;    // chunk being read, or -1
+
+static uint16_t slot_len[LINK_WINDOW];  // data in each slot of buf2
+
+/***************************************************************************//**
+ * @brief
+ *   Continue a CRC-32, as in zlib, without the final inversion
+ * @param[in] crc
+ * 		CRC so far, 0xffffffff to start
+ * @param[in] *p
+ * 		Data
+ * @param[in] len
+ * 		Length of data
+ * @return CRC so far
+ ******************************************************************************/
+static uint32_t link_crc32(uint32_t crc, const uint8_t *p, size_t len)
+{
+	int i;
+
+	while (len--)
+	{
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & - (crc & 1));
+	}
+	return crc;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Restart the time allowed until the next frame
+ ******************************************************************************/
+static void link_idle_callback(RTCDRV_TimerID_t id, void *user)
+{
+	(void) id;
+	(void) user;
+
+	idle_expired = true;
+}
+
+static void link_idle_start(uint32_t ms)
+{
+	idle_expired = false;
+	RTCDRV_StartTimer(idle_timer, rtcdrvTimerTypeOneshot, ms, link_idle_callback, NULL);
+}
+
+static void link_idle_restart(void)
+{
+	link_idle_start(LINK_IDLE_MS);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Flash operation completion
+ ******************************************************************************/
+static void link_flash_done(void *ref)
+{
+	(void) ref;
+
+	flash_done = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait for an interrupt, from the serial port, the flash or the idle timer
+ * @note
+ * 		Interrupts are masked from the check to the sleep, so a frame byte,
+ * 		flash completion or timeout which has already happened can't be
+ * 		slept through; WFI still wakes for one pending.
+ * @param[in] host
+ * 		TRUE to wake for serial input or the idle timer
+ * @param[in] flash
+ * 		TRUE to wake for the flash operation in progress
+ ******************************************************************************/
+static void link_sleep(bool host, bool flash)
+{
+	INT_Disable();
+	if (! (host && (serial_rx_ready() || idle_expired)) && ! (flash && flash_done))
+		enter_low_power_state();
+	INT_Enable();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Send the frame in tx_frame
+ * @param[in] len
+ * 		Length of type and fields, to which the CRC is added
+ ******************************************************************************/
+static void link_send(size_t len)
+{
+	size_t code_pos = 0;
+	size_t out = 1;
+	uint8_t code = 1;
+	size_t i;
+
+	store_put_u16(& tx_frame[len], store_crc16(0xffff, tx_frame, len));
+	len += 2;
+
+	// COBS: each zero is replaced by the distance to the next, with one
+	// code byte at least every 254 bytes
+	for (i = 0; i < len; i++)
+	{
+		if (tx_frame[i] != 0)
+		{
+			tx_encoded[out++] = tx_frame[i];
+			code++;
+		}
+		if ((tx_frame[i] == 0) || (code == 0xff))
+		{
+			tx_encoded[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+		}
+	}
+	tx_encoded[code_pos] = code;
+	tx_encoded[out++] = 0;
+
+	serial_blocking_write(tx_encoded, out);
+}
+
+static void link_send_offset(uint8_t type, uint32_t offset)
+{
+	tx_frame[0] = type;
+	store_put_u32(& tx_frame[1], offset);
+	link_send(5);
+}
+
+static void link_send_data(uint32_t offset, const uint8_t *data, size_t len)
+{
+	tx_frame[0] = LINK_DATA;
+	store_put_u32(& tx_frame[1], offset);
+	memcpy(& tx_frame[5], data, len);
+	link_send(5 + len);
+}
+
+static void link_send_done(uint8_t status, uint32_t len, uint32_t crc)
+{
+	tx_frame[0] = LINK_DONE;
+	tx_frame[1] = status;
+	store_put_u32(& tx_frame[2], len);
+	store_put_u32(& tx_frame[6], crc);
+	link_send(10);
+}
+
+static void link_send_info(void)
+{
+	const char *name = spiflash_info_table[part].name;
+	size_t name_len = strlen(name);
+
+	if (name_len > LINK_FRAME_MAX - 2 - 17)
+		name_len = LINK_FRAME_MAX - 2 - 17;
+	tx_frame[0] = LINK_INFO_REPLY;
+	tx_frame[1] = LINK_VERSION;
+	tx_frame[2] = LINK_WINDOW;
+	store_put_u16(& tx_frame[3], LINK_MAX_DATA);
+	store_put_u32(& tx_frame[5], spiflash_info_table[part].device_size);
+	store_put_u32(& tx_frame[9], spiflash_smallest_erase_size_above(0));
+	store_put_u32(& tx_frame[13], serial_get_bit_rate());
+	memcpy(& tx_frame[17], name, name_len);
+	link_send(17 + name_len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add a decoded byte to rx_frame
+ ******************************************************************************/
+static void link_rx_put(uint8_t b)
+{
+	if (rx_len < sizeof(rx_frame))
+		rx_frame[rx_len++] = b;
+	else
+		rx_overflow = true;
+}
+
+static void link_rx_reset(void)
+{
+	rx_len = 0;
+	rx_code = 0;
+	rx_remaining = 0;
+	rx_overflow = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Decode what has been received, up to the end of a frame
+ * @return Length of the type and fields of a good frame, now in rx_frame
+ * 		until the next call, or 0 if no frame has been completed
+ ******************************************************************************/
+static size_t link_receive(void)
+{
+	size_t len;
+	bool ok;
+	int c;
+
+	while ((c = serial_read_char()) >= 0)
+	{
+		if (c == 0)
+		{
+			len = rx_len;
+			ok = rx_code && ! rx_remaining && ! rx_overflow && (len > 2);
+			link_rx_reset();
+			if (ok && (store_crc16(0xffff, rx_frame, len - 2) == store_get_u16(& rx_frame[len - 2])))
+			{
+				link_idle_restart();
+				return len - 2;
+			}
+		}
+		else if (rx_remaining == 0)
+		{
+			if (rx_code && (rx_code != 0xff))
+				link_rx_put(0);  // the zero the previous code stood for
+			rx_code = c;
+			rx_remaining = c - 1;
+		}
+		else
+		{
+			link_rx_put(c);
+			rx_remaining--;
+		}
+	}
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check a range from the host
+ ******************************************************************************/
+static bool link_range_ok(uint32_t addr, uint32_t len)
+{
+	uint32_t device_size = spiflash_info_table[part].device_size;
+
+	return len && (addr < device_size) && (len <= device_size - addr);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   CRC-32 of a range of the flash, read back into buf1
+ ******************************************************************************/
+static uint32_t link_flash_crc32(uint32_t addr, uint32_t len)
+{
+	uint32_t crc = 0xffffffff;
+	uint32_t n;
+
+	for (; len; addr += n, len -= n)
+	{
+		n = len < BUFFER_SIZE ? len : BUFFER_SIZE;
+		spiflash_read(addr, n, buf1, NULL, NULL);
+		crc = link_crc32(crc, buf1, n);
+	}
+	return ~ crc;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Keep the chunk holding the acknowledged offset and the one after it
+ *   in buf1, starting a read if one is missing
+ ******************************************************************************/
+static void link_read_ahead(uint32_t addr, uint32_t len, uint32_t acked)
+{
+	int32_t first = acked / LINK_READ_CHUNK;  // chunk holding the next frame to send
+	int32_t c;
+	uint32_t start;
+	uint32_t n;
+
+	if (chunk_reading >= 0)
+	{
+		if (! flash_done)
+			return;
+		chunk_loaded[chunk_reading & 1] = chunk_reading;
+		chunk_reading = -1;
+	}
+
+	for (c = first; c <= first + 1; c++)
+	{
+		start = c * LINK_READ_CHUNK;
+		if (start >= len)
+			return;
+		if (chunk_loaded[c & 1] != c)
+		{
+			n = (len - start) < LINK_READ_CHUNK ? (len - start) : LINK_READ_CHUNK;
+			chunk_loaded[c & 1] = -1;
+			chunk_reading = c;
+			flash_done = false;
+			spiflash_read(addr + start, n, & buf1[(c & 1) * LINK_READ_CHUNK], link_flash_done, NULL);
+			return;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   READ: send a range of the flash
+ * @param[in] addr
+ * 		Flash address
+ * @param[in] len
+ * 		Length
+ ******************************************************************************/
+static void link_dump(uint32_t addr, uint32_t len)
+{
+	uint32_t sent = 0;     // offset of the next DATA frame
+	uint32_t acked = 0;    // offset up to which the host has everything
+	uint32_t crc = 0xffffffff;
+	uint32_t crc_len = 0;  // bytes in crc, which is of the first sending only
+	uint8_t status = LINK_OK;
+	uint32_t offset;
+	uint32_t n;
+	size_t frame_len;
+	int32_t c;
+	uint8_t *data;
+
+	if (! link_range_ok(addr, len))
+	{
+		link_send_done(LINK_ERR_RANGE, 0, 0);
+		return;
+	}
+
+	chunk_loaded[0] = -1;
+	chunk_loaded[1] = -1;
+	chunk_reading = -1;
+
+	while (acked < len)
+	{
+		frame_len = link_receive();
+		if (frame_len)
+		{
+			offset = (frame_len >= 5) ? store_get_u32(& rx_frame[1]) : 0;
+			if ((rx_frame[0] == LINK_ACK) && (offset > acked) && (offset <= sent))
+				acked = offset;
+			else if ((rx_frame[0] == LINK_NAK) && (offset >= acked) && (offset <= sent))
+			{
+				acked = offset;
+				sent = offset;  // go back
+			}
+			else if (rx_frame[0] < LINK_DATA)
+			{
+				status = LINK_ERR_ABORTED;
+				break;
+			}
+			continue;
+		}
+		if (idle_expired)
+		{
+			status = LINK_ERR_TIMEOUT;
+			break;
+		}
+
+		link_read_ahead(addr, len, acked);
+
+		c = sent / LINK_READ_CHUNK;
+		if ((sent < len) && ((sent - acked) < (LINK_WINDOW * LINK_MAX_DATA)) &&
+			(chunk_loaded[c & 1] == c))
+		{
+			n = (len - sent) < LINK_MAX_DATA ? (len - sent) : LINK_MAX_DATA;
+			data = & buf1[(c & 1) * LINK_READ_CHUNK + (sent % LINK_READ_CHUNK)];
+			if (sent == crc_len)
+			{
+				crc = link_crc32(crc, data, n);
+				crc_len += n;
+			}
+			link_send_data(sent, data, n);
+			sent += n;
+		}
+		else
+			link_sleep(true, chunk_reading >= 0);
+	}
+
+	while ((chunk_reading >= 0) && ! flash_done)
+		link_sleep(false, true);
+	if (status == LINK_OK)
+		link_send_done(LINK_OK, len, ~ crc);
+	else
+		link_send_done(status, acked, 0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Choose the erase command for the next block of a WRITE range
+ * @details
+ * 		Of the sizes aligned at addr and within the range, the one which
+ * 		erases and programs the most bytes per microsecond: its typical
+ * 		erase time plus the page program time of every page in it. Larger
+ * 		blocks usually win, although the window fills and the host waits
+ * 		while one erases. Sizes whose worst case erase time is longer than
+ * 		LINK_STALL_MS aren't used, since the host only waits that long
+ * 		for an ACK.
+ * @param[in] addr
+ * 		Flash address of the block, on a boundary of the smallest size
+ * @param[in] len
+ * 		Length of the range left to erase from addr
+ * @return Bytes per erase command
+ ******************************************************************************/
+static uint32_t link_erase_size(uint32_t addr, uint32_t len)
+{
+	uint32_t best = spiflash_smallest_erase_size_above(0);
+	uint64_t best_us = (uint64_t) spiflash_estimate_erase_us(addr, best, best, false) +
+	                   spiflash_estimate_write_us(addr, best, false);
+	uint64_t us;
+	uint32_t size;
+
+	for (size = spiflash_smallest_erase_size_above(best); size; size = spiflash_smallest_erase_size_above(size))
+	{
+		if ((addr % size) || (size > len))
+			continue;
+		if (spiflash_estimate_erase_us(addr, size, size, true) > LINK_STALL_MS * 1000)
+			break;
+		us = (uint64_t) spiflash_estimate_erase_us(addr, size, size, false) +
+		     spiflash_estimate_write_us(addr, size, false);
+		if ((uint64_t) size * best_us > (uint64_t) best * us)  // more bytes per us
+		{
+			best = size;
+			best_us = us;
+		}
+	}
+	return best;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   WRITE: erase and program a range of the flash
+ * @details
+ * 		The range is erased block by block ahead of the programming,
+ * 		whenever the flash would otherwise be idle, so erasing overlaps
+ * 		the host sending rather than delaying ACK 0. The rest of the last
+ * 		erase unit, past len, is read into buf1 first and programmed back
+ * 		once the range is written, so it is left as it was.
+ * @param[in] addr
+ * 		Flash address, on a boundary of the smallest erase size
+ * @param[in] len
+ * 		Length
+ ******************************************************************************/
+static void link_upload(uint32_t addr, uint32_t len)
+{
+	uint32_t erase_size = spiflash_smallest_erase_size_above(0);
+	uint32_t erase_len;       // len rounded up to erase_size
+	uint32_t keep_len;        // rest of the last erase unit, kept in buf1
+	uint32_t erased = 0;      // offset up to which the range is erased
+	uint32_t erasing = 0;     // bytes being erased from erased, or 0
+	uint32_t expected = 0;    // offset of the next DATA frame wanted
+	uint32_t programmed = 0;  // offset up to which data is programmed
+	uint32_t head = 0;        // slots filled
+	uint32_t tail = 0;        // slots programmed
+	uint32_t out_of_order = 0;  // frames after a gap
+	bool writing = false;
+	uint8_t status = LINK_OK;
+	uint32_t offset;
+	uint32_t n;
+	size_t frame_len;
+
+	if (! link_range_ok(addr, len) || (addr % erase_size))
+	{
+		link_send_done(LINK_ERR_RANGE, 0, 0);
+		return;
+	}
+
+	// a whole number of erase units, which the part size always is
+	erase_len = ((len + erase_size - 1) / erase_size) * erase_size;
+	keep_len = erase_len - len;
+	if (keep_len > BUFFER_SIZE)
+	{
+		link_send_done(LINK_ERR_RANGE, 0, 0);
+		return;
+	}
+	if (keep_len)
+		spiflash_read(addr + len, keep_len, buf1, NULL, NULL);
+	if (spiflash_info_table[part].protection_sector_count == 0)
+		spiflash_set_global_protect(false, NULL, NULL);  // no sectors to unprotect singly
+	else if (! spiflash_set_range_protection(false, addr, erase_len))
+	{
+		link_send_done(LINK_ERR_RANGE, 0, 0);
+		return;
+	}
+	link_idle_restart();
+	link_send_offset(LINK_ACK, 0);
+
+	while (programmed < len)
+	{
+		frame_len = link_receive();
+		if (frame_len)
+		{
+			if ((rx_frame[0] == LINK_DATA) && (frame_len > 5))
+			{
+				offset = store_get_u32(& rx_frame[1]);
+				n = frame_len - 5;
+				if ((offset == expected) && (n <= LINK_MAX_DATA) && (n <= len - expected) &&
+					((head - tail) < LINK_WINDOW))
+				{
+					memcpy(& buf2[(head % LINK_WINDOW) * LINK_MAX_DATA], & rx_frame[5], n);
+					slot_len[head % LINK_WINDOW] = n;
+					head++;
+					expected += n;
+					out_of_order = 0;
+				}
+				else if (offset > expected)
+				{
+					// again after a window, in case the NAK was lost
+					if ((out_of_order++ % LINK_WINDOW) == 0)
+						link_send_offset(LINK_NAK, expected);
+				}
+				else if (offset < expected)
+					link_send_offset(LINK_ACK, programmed);  // a repeat, so an ACK was lost
+			}
+			else if (rx_frame[0] < LINK_DATA)
+			{
+				status = LINK_ERR_ABORTED;
+				break;
+			}
+			continue;
+		}
+		if (idle_expired)
+		{
+			status = LINK_ERR_TIMEOUT;
+			break;
+		}
+
+		if ((writing || erasing) && ! flash_done)
+			link_sleep(true, true);
+		else if (writing)
+		{
+			programmed += slot_len[tail % LINK_WINDOW];
+			tail++;
+			writing = false;
+			link_send_offset(LINK_ACK, programmed);
+		}
+		else if (erasing)
+		{
+			erased += erasing;
+			erasing = 0;
+		}
+		else if ((head != tail) && (programmed + slot_len[tail % LINK_WINDOW] <= erased))
+		{
+			writing = true;
+			flash_done = false;
+			spiflash_write(addr + programmed, slot_len[tail % LINK_WINDOW],
+					       & buf2[(tail % LINK_WINDOW) * LINK_MAX_DATA],
+					       false, link_flash_done, NULL);
+		}
+		else if (erased < erase_len)
+		{
+			erasing = link_erase_size(addr + erased, erase_len - erased);
+			flash_done = false;
+			if (! spiflash_erase(addr + erased, erasing, erasing, false, link_flash_done, NULL))
+				fatal("can't start link erase");
+		}
+		else
+			link_sleep(true, false);
+	}
+
+	while ((writing || erasing) && ! flash_done)
+		link_sleep(false, true);
+	if (erasing)
+		erased += erasing;
+	if (keep_len && (erased == erase_len))
+		spiflash_write(addr + len, keep_len, buf1, false, NULL, NULL);
+	if (status == LINK_OK)
+		link_send_done(LINK_OK, len, link_flash_crc32(addr, len));
+	else
+		link_send_done(status, programmed, 0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   RATE: move to another port and bit rate
+ * @param[in] port
+ * 		serial_port_t from the host
+ * @param[in] bit_rate
+ * 		Bit rate
+ * @return TRUE if the port has been changed, to be confirmed by a frame
+ * 		within LINK_SWITCH_MS
+ ******************************************************************************/
+static bool link_rate(uint8_t port, uint32_t bit_rate)
+{
+	if ((port > SERIAL_PORT_FAST) || ! serial_bit_rate_ok(port, bit_rate))
+	{
+		link_send_offset(LINK_NAK, serial_get_bit_rate());
+		return false;
+	}
+	link_send_offset(LINK_ACK, bit_rate);
+	serial_switch(port, bit_rate);  // once the ACK has gone
+	link_rx_reset();
+	link_idle_start(LINK_SWITCH_MS);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Take commands from the host until it quits or goes quiet
+ * @note
+ * 		The serial port must be open and the flash awake. Starts by sending
+ * 		a zero byte, which ends whatever text the host has received as a
+ * 		frame with a bad CRC. Returns on the console port at
+ * 		SERIAL_BIT_RATE, whatever RATE has done.
+ ******************************************************************************/
+void link_run(void)
+{
+	static const uint8_t delimiter = 0;
+	size_t frame_len;
+	bool quit = false;
+	bool switching = false;  // RATE awaits a frame at the new rate
+	serial_port_t old_port = SERIAL_PORT_CONSOLE;
+	uint32_t old_rate = SERIAL_BIT_RATE;
+
+	if (! idle_timer_allocated)
+	{
+		if (ECODE_EMDRV_RTCDRV_OK != RTCDRV_AllocateTimer(& idle_timer))
+			fatal("can't allocate link timer");
+		idle_timer_allocated = true;
+	}
+
+	link_rx_reset();
+	serial_blocking_write(& delimiter, 1);
+	link_idle_restart();
+
+	while (! quit)
+	{
+		if (idle_expired)
+		{
+			if (! switching)
+				break;
+			serial_switch(old_port, old_rate);  // nothing heard at the new rate
+			switching = false;
+			link_rx_reset();
+			link_idle_restart();
+		}
+		frame_len = link_receive();
+		if (! frame_len)
+		{
+			link_sleep(true, false);
+			continue;
+		}
+		switching = false;
+		switch (rx_frame[0])
+		{
+		case LINK_INFO:
+			link_send_info();
+			break;
+		case LINK_READ:
+			if (frame_len >= 9)
+				link_dump(store_get_u32(& rx_frame[1]), store_get_u32(& rx_frame[5]));
+			break;
+		case LINK_WRITE:
+			if (frame_len >= 9)
+				link_upload(store_get_u32(& rx_frame[1]), store_get_u32(& rx_frame[5]));
+			break;
+		case LINK_RATE:
+			if (frame_len >= 6)
+			{
+				old_port = serial_get_port();
+				old_rate = serial_get_bit_rate();
+				switching = link_rate(rx_frame[1], store_get_u32(& rx_frame[2]));
+			}
+			break;
+		case LINK_QUIT:
+			link_send_done(LINK_OK, 0, 0);
+			RTCDRV_StopTimer(idle_timer);
+			quit = true;
+			break;
+		default:
+			break;  // left over from a transfer
+		}
+	}
+
+	if ((serial_get_port() != SERIAL_PORT_CONSOLE) || (serial_get_bit_rate() != SERIAL_BIT_RATE))
+		serial_switch(SERIAL_PORT_CONSOLE, SERIAL_BIT_RATE);
+}
+
+/** @} (end addtogroup Link) */
+/** @} (end addtogroup AppManagement) */
@@ -0,0 +1,114 @@
+/****************************************************************************//**
+ * @file link.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef LINK_H_
+#define LINK_H_
+
+#include <inttypes.h>
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup Link
+ * @brief Binary flash dump and upload protocol on the serial port
+ * @details
+ * 		Each frame is COBS encoded and ends with a zero byte, so a frame
+ * 		boundary is found again after any error. Before encoding, a frame
+ * 		is a type byte, fields, and a CRC-16/CCITT-FALSE of those, all
+ * 		multi-byte values little-endian. Frames with a bad CRC are
+ * 		dropped.
+ *
+ * 		The host sends a command, and the board answers with INFO or a
+ * 		transfer. In a transfer, DATA frames carry up to LINK_MAX_DATA
+ * 		bytes at an offset from the start of the range. The receiver
+ * 		sends ACK with the offset up to which it has everything, and NAK
+ * 		with that offset when a frame is missing. The sender keeps up to
+ * 		LINK_WINDOW frames unacknowledged, and on NAK goes back to the
+ * 		offset given. A transfer ends with DONE, with a CRC-32 of the
+ * 		range as read from the flash.
+ *
+ * 		For WRITE, the range is unprotected, and ACK 0 follows at once.
+ * 		The board erases it as the data arrives, so it must start on a
+ * 		boundary of the smallest erase size. Each DATA frame is
+ * 		acknowledged once programmed. With the window full, the host
+ * 		waits for an ACK while the board erases, for up to LINK_STALL_MS,
+ * 		before going back.
+ *
+ * 		The link starts on the console port, at SERIAL_BIT_RATE. RATE asks
+ * 		for another port and bit rate. The board sends NAK with its
+ * 		current rate if it can't make the one asked for, or else ACK with
+ * 		it, and changes over once the ACK has been sent. The host must
+ * 		then send INFO at the new rate within LINK_SWITCH_MS, or the
+ * 		board goes back to the old one. The board returns to the console
+ * 		port when the link ends.
+ * @{
+ ******************************************************************************/
+
+#define LINK_VERSION  2
+
+#define LINK_MAX_DATA 256  // data bytes in a DATA frame
+#define LINK_WINDOW   16   // DATA frames sent ahead of the acknowledgement
+
+// Frame types, with fields
+#define LINK_INFO  0x01  // host: none
+#define LINK_READ  0x02  // host: addr u32, len u32
+#define LINK_WRITE 0x03  // host: addr u32, len u32
+#define LINK_QUIT  0x04  // host: none, answered by DONE
+#define LINK_RATE  0x05  // host: port u8 (serial_port_t), bit rate u32
+#define LINK_DATA  0x10  // offset u32, data
+#define LINK_ACK   0x11  // offset u32, or bit rate u32 for RATE
+#define LINK_NAK   0x12  // offset u32, or bit rate u32 for RATE
+#define LINK_INFO_REPLY 0x81  // version u8, window u8, max data u16,
+                              // device size u32, erase size u32,
+                              // bit rate u32, part name
+#define LINK_DONE  0x82  // status u8, len u32, crc32 u32
+
+// DONE status
+#define LINK_OK          0
+#define LINK_ERR_RANGE   1  // outside the part, or not on an erase boundary
+#define LINK_ERR_ABORTED 2  // host sent a command during a transfer
+#define LINK_ERR_TIMEOUT 3  // nothing received for LINK_IDLE_MS
+
+#define LINK_IDLE_MS 10000  // link mode ends after this long with no frame
+#define LINK_SWITCH_MS 1000  // for INFO at a new bit rate, before going back
+#define LINK_STALL_MS 2000   // longest WRITE holds back ACK for an erase
+
+void link_run(void);
+
+/** @} (end defgroup Link) */
+/** @} (end addtogroup AppManagement) */
+
+#endif /* LINK_H_ */
@@ -33,9 +33,12 @@
 
 #include "em_emu.h"
 #include "gpio.h"
+#include "rtcdriver.h"
 
 #include "low_power.h"
+#include "serial.h"
 #include "spi.h"
+#include "spi_trace.h"
 
 /***************************************************************************//**
  * @addtogroup Peripheral_Functions
@@ -58,8 +61,7 @@
 
 static bool force_em0;
 
-volatile uint32_t wait_em1_count;
-volatile uint32_t wait_em2_count;
+static low_power_residency_t residency;
 
 /***************************************************************************//**
  * @brief
@@ -77,28 +79,58 @@ void set_force_em0(bool val)
 /***************************************************************************//**
  * @brief
  *   Decides whether to put EFM into EM0, EM1, or EM2 based on Activity
+ * @note
+ * 		Time from entry to return is added to the residency of the mode
+ * 		entered, by RTC, which runs in EM2. Interrupt handlers run on
+ * 		wake-up count towards the sleep, but are short. Plain WFI sleeps
+ * 		in EM1. So does an active SPI transfer, or a UART or USART
+ * 		transmitting, which would stop in EM2.
  *
  ******************************************************************************/
 void enter_low_power_state(void)
 {
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+
 	if (force_em0)
-		__ASM volatile ("wfi");
-	else if (spi_active())
 	{
-//		wait_em1_count++;
+		__WFI();
+		residency.em1_count++;
+		residency.em1_ticks += RTCDRV_GetWallClockTicks64() - start;
+	}
+	else if (spi_active() || serial_blocks_em2())
+	{
 		GPIO_PinOutSet(EM1_DEBUG_PORT, EM1_DEBUG_PIN);
 		EMU_EnterEM1();
 		GPIO_PinOutClear(EM1_DEBUG_PORT, EM1_DEBUG_PIN);
+		residency.em1_count++;
+		residency.em1_ticks += RTCDRV_GetWallClockTicks64() - start;
 	}
 	else
 	{
-//		wait_em2_count++;
 		GPIO_PinOutSet(EM2_DEBUG_PORT, EM2_DEBUG_PIN);
 		EMU_EnterEM2(true);
 		GPIO_PinOutClear(EM2_DEBUG_PORT, EM2_DEBUG_PIN);
+		residency.em2_count++;
+		residency.em2_ticks += RTCDRV_GetWallClockTicks64() - start;
+		spi_timer_slept(RTCDRV_GetWallClockTicks64() - start);
 	}
 }
 
+/***************************************************************************//**
+ * @brief
+ *   Get the time spent in each sleep mode since low_power_init()
+ * @note
+ * 		Time not spent in enter_low_power_state() is EM0. The counts are
+ * 		cumulative, so callers measuring an interval take the difference
+ * 		of two readings.
+ * @param[out] *r
+ * 		Sleep counts and times
+ ******************************************************************************/
+void low_power_get_residency(low_power_residency_t *r)
+{
+	*r = residency;
+}
+
 static const gpio_init_t lp_debug_pins[] =
 {
   { EM1_DEBUG_PORT, EM1_DEBUG_PIN, gpioModePushPull,  0 },
@@ -107,15 +139,17 @@ static const gpio_init_t lp_debug_pins[] =
 
 /***************************************************************************//**
  * @brief
- *   This is for debugging the low power states to determine how many times
- *   the various low power states were entered.
+ *   Sets up the debug pins, which are high while in EM1 and EM2, and
+ *   clears the sleep mode residency.
  *
  ******************************************************************************/
 void low_power_init(void)
 {
 	force_em0 = 0;
-	wait_em1_count = 0;
-	wait_em2_count = 0;
+	residency.em1_count = 0;
+	residency.em2_count = 0;
+	residency.em1_ticks = 0;
+	residency.em2_ticks = 0;
 	gpio_init(lp_debug_pins, sizeof(lp_debug_pins)/sizeof(gpio_init_t));
 }
 
@@ -34,6 +34,7 @@
 #ifndef LOW_POWER_H_
 #define LOW_POWER_H_
 
+#include <inttypes.h>
 #include <stdbool.h>
 
 /***************************************************************************//**
@@ -46,12 +47,22 @@
  * @{
  ******************************************************************************/
 
+typedef struct
+{
+	uint32_t em1_count;   // times EM1 was entered
+	uint32_t em2_count;   // times EM2 was entered
+	uint64_t em1_ticks;   // RTC ticks spent in EM1
+	uint64_t em2_ticks;   // RTC ticks spent in EM2
+} low_power_residency_t;
+
 void set_force_em0(bool val);
 
 void enter_low_power_state(void);
 
 void low_power_init(void);
 
+void low_power_get_residency(low_power_residency_t *r);
+
 /** @} (end addtogroup Peripheral Functions) */
 /** @} (end addtogroup Low_Power) */
 
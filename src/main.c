@@ -63,11 +63,18 @@
  *   LEU0_TX0  PD4      12       5         RXD
  *   LEU0_RX0  PD5      14       4         TxD
  *
+ * The serial link's fast port, USART2 location 0 (see serial.h), is wired
+ * in parallel with the LEUART, to the same cable pins.
+ *
+ *   US2_TX0   PC2      pad      5         RXD
+ *   US2_RX0   PC3      5        4         TxD
+ *
  *   @endverbatim
  */
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "em_device.h"
@@ -75,16 +82,23 @@
 #include "em_cmu.h"
 #include "em_emu.h"
 #include "em_gpio.h"
+#include "em_int.h"
 
 #include "caplesense.h"
 #include "rtcdriver.h"
 #include "segmentlcd.h"
 
+#include "bench.h"
 #include "button.h"
+#include "console.h"
 #include "delay.h"
 #include "demo_serial.h"
+#include "erase_pool.h"
 #include "fatal.h"
+#include "ftl.h"
 #include "gpio.h"
+#include "journal.h"
+#include "kvstore.h"
 #include "lcdtest.h"
 #include "lcd_scroll.h"
 #include "led.h"
@@ -92,7 +106,11 @@
 #include "main.h"
 #include "oneshot.h"
 #include "serial.h"
+#include "spi.h"
 #include "spiflash.h"
+#include "spiflash_queue.h"
+#include "spi_trace.h"
+#include "workload.h"
 
 /***************************************************************************//**
  * @addtogroup MAIN
@@ -122,6 +140,12 @@ static bool use_so;
 static bool erase_size_choices_initialized;
 static uint32_t erase_size;
 static bool do_verify;
+static bool use_queue;
+static bool use_pull;
+static bool show_energy;
+static int32_t bench_iterations;
+static bool run_error;  // set by a run which found bad data
+static workload_config_t workload_config;
 
 int duration;
 
@@ -150,12 +174,32 @@ typedef enum
 	state_read,
 	state_rmw,
 	state_appl,
+	state_burst,
+	state_jrnl,
+	state_kv,
+	state_ftl,
+	state_wkld,
+	state_log,
+	state_cal,
+	state_prot,
 	state_powerdn,
+	state_trace,
+	state_console,
 	state_serial,
 
 	state_conf_so,
 	state_conf_erase_size,
 	state_conf_verify,
+	state_conf_queue,
+	state_conf_pull,
+	state_conf_energy,
+	state_conf_iter,
+	state_conf_dist,
+	state_conf_read_pct,
+	state_conf_erase_pct,
+	state_conf_req_min,
+	state_conf_req_max,
+	state_conf_seed,
 	state_conf_spi_clk,
 
 	state_message,
@@ -203,8 +247,32 @@ sm_fn_t run_rmw;
 
 sm_fn_t run_appl;
 
+sm_fn_t run_log;
+
+sm_fn_t idle_burst;
+sm_fn_t leave_burst;
+sm_fn_t run_burst;
+
+sm_fn_t run_journal;
+
+sm_fn_t run_kv;
+
+sm_fn_t run_ftl;
+
+sm_fn_t run_workload;
+
+sm_fn_t run_calibrate;
+
+sm_fn_t run_prot;
+
 sm_fn_t run_powerdn;
 
+sm_fn_t enter_trace;
+sm_fn_t button1_trace;
+
+sm_fn_t enter_console;
+sm_fn_t button1_console;
+
 sm_fn_t run_serial;
 
 sm_fn_t enter_conf_so;
@@ -216,6 +284,30 @@ sm_fn_t leave_conf_erase_size;
 sm_fn_t enter_conf_verify;
 sm_fn_t button1_conf_verify;
 
+sm_fn_t enter_conf_queue;
+sm_fn_t button1_conf_queue;
+
+sm_fn_t enter_conf_pull;
+sm_fn_t button1_conf_pull;
+
+sm_fn_t enter_conf_energy;
+sm_fn_t button1_conf_energy;
+
+sm_fn_t leave_conf_iter;
+
+sm_fn_t enter_conf_dist;
+sm_fn_t button1_conf_dist;
+
+sm_fn_t leave_conf_read_pct;
+
+sm_fn_t leave_conf_erase_pct;
+
+sm_fn_t leave_conf_req_min;
+
+sm_fn_t leave_conf_req_max;
+
+sm_fn_t leave_conf_seed;
+
 sm_fn_t leave_conf_spi_clk;
 
 sm_fn_t enter_message;
@@ -255,10 +347,50 @@ static const state_info_t state_info[STATE_MAX] =
 					    	 .run_fn       = run_appl,
 					    	 .numeric_choices_fixed_count  = 5,
 					    	 .numeric_choices_fixed      = { 16, 32, 64, 128, 256 }},
+	[state_burst]        = { .name         = "BURST",
+					    	 .idle_fn      = idle_burst,
+					    	 .leave_fn     = leave_burst,
+					    	 .run_fn       = run_burst,
+					    	 .numeric_choices_fixed_count  = 4,
+					    	 .numeric_choices_fixed      = { 16, 32, 64, 128 }},
+	[state_jrnl]         = { .name         = "JRNL",
+					    	 .run_fn       = run_journal,
+					    	 .numeric_choices_fixed_count  = 5,
+					    	 .numeric_choices_fixed      = { 16, 32, 64, 128, 256 }},
+	[state_kv]           = { .name         = "KV",
+					    	 .run_fn       = run_kv,
+					    	 .numeric_choices_fixed_count  = 5,
+					    	 .numeric_choices_fixed      = { 256, 512, 1024, 2048, 4096 }},
+	[state_ftl]          = { .name         = "FTL",
+					    	 .run_fn       = run_ftl,
+					    	 .numeric_choices_fixed_count  = 2,
+					    	 .numeric_choices_fixed      = { 256, 4096 }},
+	[state_wkld]         = { .name         = "WKLD",
+					    	 .run_fn       = run_workload,
+					    	 .numeric_choices_fixed_count  = 4,
+					    	 .numeric_choices_fixed      = { 16, 64, 256, 1024 }},
+	[state_log]          = { .name         = "LOG",
+					    	 .run_fn       = run_log,
+					    	 .numeric_choices_fixed_count  = 3,
+					    	 .numeric_choices_fixed      = { 1, 2, 5 }},
+	[state_cal]          = { .name         = "CAL",
+					    	 .run_fn       = run_calibrate,
+					    	 .numeric_choices_fixed_count = 2,
+					    	 .numeric_choices_fixed = {0, 1}},
+	[state_prot]         = { .name         = "PROT",
+					    	 .run_fn       = run_prot,
+					    	 .numeric_choices_fixed_count = 2,
+					    	 .numeric_choices_fixed = {0, 1}},
 	[state_powerdn]      = { .name         = "POWERDN",
 					    	 .run_fn       = run_powerdn,
 							 .numeric_choices_fixed_count = 2,
 							 .numeric_choices_fixed = {0, 1}},
+	[state_trace]        = { .name         = "TRACE",
+			                 .enter_fn     = enter_trace,
+			                 .button1_fn   = button1_trace },
+	[state_console]      = { .name         = "CONSOLE",
+			                 .enter_fn     = enter_console,
+			                 .button1_fn   = button1_console },
 	[state_serial]       = { .name         = "SERIAL",
 			                 .run_fn       = run_serial,
 						     .next         = state_id },
@@ -274,6 +406,42 @@ static const state_info_t state_info[STATE_MAX] =
     [state_conf_verify]     = { .name         = "VFY",
    						        .enter_fn     = enter_conf_verify,
    					   	        .button1_fn   = button1_conf_verify },
+    [state_conf_queue]      = { .name         = "QUE",
+   						        .enter_fn     = enter_conf_queue,
+   					   	        .button1_fn   = button1_conf_queue },
+    [state_conf_pull]       = { .name         = "PULL",
+   						        .enter_fn     = enter_conf_pull,
+   					   	        .button1_fn   = button1_conf_pull },
+    [state_conf_energy]     = { .name         = "NRG",
+   						        .enter_fn     = enter_conf_energy,
+   					   	        .button1_fn   = button1_conf_energy },
+   	[state_conf_iter]       = { .name         = "ITER",
+   						        .leave_fn     = leave_conf_iter,
+   						        .numeric_choices_fixed_count  = 4,
+   						        .numeric_choices_fixed      = { 1, 4, 16, 64 }},
+   	[state_conf_dist]       = { .name         = "DIST",
+   						        .enter_fn     = enter_conf_dist,
+   					   	        .button1_fn   = button1_conf_dist },
+   	[state_conf_read_pct]   = { .name         = "RD PCT",
+   						        .leave_fn     = leave_conf_read_pct,
+   						        .numeric_choices_fixed_count  = 5,
+   						        .numeric_choices_fixed      = { 0, 50, 70, 90, 100 }},
+   	[state_conf_erase_pct]  = { .name         = "ER PCT",
+   						        .leave_fn     = leave_conf_erase_pct,
+   						        .numeric_choices_fixed_count  = 4,
+   						        .numeric_choices_fixed      = { 0, 1, 5, 10 }},
+   	[state_conf_req_min]    = { .name         = "REQ MIN",
+   						        .leave_fn     = leave_conf_req_min,
+   						        .numeric_choices_fixed_count  = 5,
+   						        .numeric_choices_fixed      = { 0, 4, 8, 12, 16 }},
+   	[state_conf_req_max]    = { .name         = "REQ MAX",
+   						        .leave_fn     = leave_conf_req_max,
+   						        .numeric_choices_fixed_count  = 5,
+   						        .numeric_choices_fixed      = { 0, 4, 8, 12, 16 }},
+   	[state_conf_seed]       = { .name         = "SEED",
+   						        .leave_fn     = leave_conf_seed,
+   						        .numeric_choices_fixed_count  = 4,
+   						        .numeric_choices_fixed      = { 1, 2, 3, 4 }},
    	[state_conf_spi_clk]    = { .name         = "SPI CLK",
             			        .leave_fn     = leave_conf_spi_clk,
             			        .next         = state_config,
@@ -303,6 +471,10 @@ typedef struct
 static button_info_t button_info[2];
 
 
+// Core clock cycles per byte of the init_buffer() loop, a store, an add, a
+// compare and a taken branch on the Cortex-M3, from the instruction timings
+#define INIT_BUFFER_CYCLES_PER_BYTE 6
+
 /***************************************************************************//**
  * @brief
  *   Initialize Buffer with data to be used with Demo
@@ -317,12 +489,13 @@ static button_info_t button_info[2];
  ******************************************************************************/
 void init_buffer(uint32_t buffer_offset, uint32_t len, uint32_t seed)
 {
-	int i;
+	unsigned int i;
 	uint8_t initial;
 
 	initial = (seed >> 24) ^ (seed >> 16) ^ (seed >> 8) ^ seed;
-	for (i = 0; i < sizeof(buf1); i++)
+	for (i = 0; i < len; i++)
 		buf1[buffer_offset + i] = initial + i;
+	BENCH_CPU_CYCLES(len * INIT_BUFFER_CYCLES_PER_BYTE);
 }
 
 int slider_num_choices;
@@ -366,6 +539,27 @@ int32_t slider_get_choice(int32_t slider_position)		//Map value passed in from S
 	return slider_choices[i];
 }
 
+/***************************************************************************//**
+ * @brief
+ *   Set the initial slider position of a state to one of its fixed choices
+ * @note
+ * 		For CONFIG items whose default is not the first choice, so that
+ * 		visiting the item without touching the slider keeps the default.
+ * @param[in] s
+ * 		State, with fixed numeric choices
+ * @param[in] choice
+ * 		Default choice
+ ******************************************************************************/
+static void slider_preset(state_t s, int32_t choice)
+{
+	int count = state_info[s].numeric_choices_fixed_count;
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (state_info[s].numeric_choices_fixed[i] == choice)
+			state_slider_position[s] = (((i + 1) * SLIDER_MAX) / count) - 1;
+}
+
 /***************************************************************************//**
  * @brief
  *   Callback function for Button Press detection on STK for Demo Menu
@@ -406,6 +600,10 @@ void spiflash_demo(void)		//State machine main loop
 
 	while (true)
 	{
+		if (console_is_open())
+			console_poll();
+		spiflash_queue_poll();  // a request the driver was too busy for
+
 		if (state != prev_state)
 		{
 			if ((prev_state < STATE_MAX) && state_info[prev_state].leave_fn)
@@ -473,9 +671,9 @@ void test_start(void)
 	spiflash_ultra_deep_power_down(false, NULL, NULL);		//XXX verify if we need both of these...?
 	spiflash_ultra_deep_power_down(false, NULL, NULL);
 
-	// Necessary for erase and write commands.
-	// XXX could add a bool field to state_info to control whether this is done
-	spiflash_set_write_enable(true, NULL, NULL);
+	// Necessary for erase and write commands. The driver sends WRITE ENABLE
+	// along with the command, and skips the command if the part is already
+	// known to be unprotected.
 	spiflash_set_global_protect(false, NULL, NULL);
 
 	spiflash_read_status(2, ts_status_buf_1, NULL, NULL);
@@ -582,6 +780,103 @@ void button0_default(void)
 	    state += 1;
 }
 
+static bool set_config(const char *name, int32_t value);
+
+static state_t last_run_state = STATE_MAX;
+static int32_t last_run_choice;
+
+/***************************************************************************//**
+ * @brief
+ *   Run the demo of the current state, ITER times
+ * @note
+ * 		Each run is timed, along with the flash operations the demo
+ * 		reports to the bench. Stops early if a run finds bad data. If
+ * 		operations were timed, the LCD number shows the throughput over
+ * 		all runs in KiB/s, or with NRG set, the estimated MCU energy in
+ * 		uJ/KiB. The SPI trace, if enabled, is cleared first, so that it
+ * 		shows the end of this demo.
+ ******************************************************************************/
+static void run_demo(void)
+{
+	state_t s = state;
+	bench_result_t result;
+	int32_t i;
+
+	last_run_state = s;
+	last_run_choice = slider_get_choice(state_slider_position[s]);
+
+	if (state_info[s].preflight_fn)
+		state_info[s].preflight_fn();
+
+	spi_trace_clear();
+
+	test_start();
+
+	bench_start();
+	run_error = false;
+	for (i = 0; (i < bench_iterations) && ! run_error; i++)
+	{
+		state = s;
+		bench_run_start();
+		state_info[s].run_fn();
+		bench_run_stop();
+	}
+
+	test_stop();
+
+	bench_get_result(& result);
+	if (result.ops && ! run_error)
+	{
+		if (show_energy)
+			message_number = (result.nj_per_kib + 500) / 1000;
+		else
+			message_number = result.kib_per_sec;
+		if (message_number > 9999)
+			message_number = 9999;
+	}
+}
+
+static char bench_title[160];
+
+/***************************************************************************//**
+ * @brief
+ *   Print the benchmark result of the last demo run
+ * @note
+ * 		Output goes wherever printf() goes, the serial port if open.
+ ******************************************************************************/
+void demo_print_report(void)
+{
+	state_t s = last_run_state;
+
+	if (s == STATE_MAX)
+	{
+		printf("no demo run yet\r\n");
+		return;
+	}
+
+	snprintf(bench_title, sizeof(bench_title),
+			 "%s %s %" PRId32 "  %s  SPI %" PRIu32 " MHz  SO %c VFY %c QUE %c PULL %c",
+			 spiflash_info_table[part].name, state_info[s].name, last_run_choice,
+			 run_error ? message_text : "ok",
+			 spi_freq / 1000000,
+			 use_so ? 'Y' : 'N', do_verify ? 'Y' : 'N',
+			 use_queue ? 'Y' : 'N', use_pull ? 'Y' : 'N');
+
+	if (s == state_wkld)
+	{
+		size_t n = strlen(bench_title);
+		snprintf(bench_title + n, sizeof(bench_title) - n,
+				 "\r\nDIST %s RD %" PRIu32 "%% ER %" PRIu32 "%% REQ %" PRIu32 "-%" PRIu32
+				 " SEED %" PRIu32 "  OPS %" PRIu32 " HASH %08" PRIx32,
+				 workload_dist_name(workload_config.dist),
+				 workload_config.read_pct, workload_config.erase_pct,
+				 workload_config.min_size, workload_config.max_size,
+				 workload_config.seed, workload_op_count(), workload_hash());
+	}
+
+	bench_report(bench_title);
+}
+
 /***************************************************************************//**
  * @brief
  *   Normally Starts Test/Demo
@@ -589,21 +884,243 @@ void button0_default(void)
  ******************************************************************************/
 void button1_default(void)
 {
-	if (! state_info[state].run_fn)
+	state_t s = state;
+
+	if (! state_info[s].run_fn)
 		return;
 
 	// wait for button 1 release
 	while (button_info[1].state)
 		enter_low_power_state();
 
-	if (state_info[state].preflight_fn)
-		state_info[state].preflight_fn();
+	run_demo();
 
-	test_start();
+	demo_serial_open();
+	demo_print_report();
+	demo_serial_close();
+}
 
-	state_info[state].run_fn();
+/***************************************************************************//**
+ * @brief
+ *   Find a state by the name shown on the LCD
+ * @param[in] *name
+ * 		State name, e.g., "WRITE" or "ERA SZ"
+ * @return State, or STATE_MAX if not found
+ ******************************************************************************/
+static state_t state_by_name(const char *name)
+{
+	state_t s;
 
-	test_stop();
+	for (s = 0; s < STATE_MAX; s++)
+		if (state_info[s].name && (strcmp(state_info[s].name, name) == 0))
+			return s;
+	return STATE_MAX;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Enter a state and move its slider to a numeric choice
+ * @param[in] s
+ * 		State
+ * @param[in] choice
+ * 		Numeric choice, as would be shown on the LCD
+ * @return TRUE if the state offers that choice
+ ******************************************************************************/
+static bool select_choice(state_t s, int32_t choice)
+{
+	int i;
+
+	state = s;
+	numeric_choices_init();
+	for (i = 0; i < numeric_choices_count[state]; i++)
+	{
+		if (numeric_choices[state][i] == choice)
+		{
+			state_slider_position[state] = slider_threshold[i] - 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run a demo as though selected on the slider and started with PB1
+ * @note
+ * 		For callers without the buttons and slider, e.g., the host build.
+ * 		On return, message_text, message_number and duration hold the
+ * 		result, as they would be displayed. The benchmark result is left
+ * 		for bench_get_result() rather than sent over serial.
+ * @param[in] *name
+ * 		Demo name, as shown in the main menu
+ * @param[in] choice
+ * 		Numeric choice, as would be shown on the LCD
+ * @return TRUE if the demo was run
+ ******************************************************************************/
+bool demo_run_state(const char *name, int32_t choice)
+{
+	state_t s = state_by_name(name);
+
+	if ((s == STATE_MAX) || ! state_info[s].run_fn)
+		return false;
+	if (! select_choice(s, choice))
+		return false;
+
+	run_demo();
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Leave a menu item idle for a while, as though selected and not touched
+ * @note
+ * 		For callers without the buttons and slider, e.g., the host build,
+ * 		to give a demo the idle time before PB1 that it has on the board.
+ * @param[in] *name
+ * 		Item name, as shown in the menu
+ * @param[in] msec
+ * 		Idle time
+ * @return TRUE if there is such an item
+ ******************************************************************************/
+bool demo_idle_state(const char *name, uint32_t msec)
+{
+	state_t s = state_by_name(name);
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+
+	if (s == STATE_MAX)
+		return false;
+
+	state = s;
+	numeric_choices_init();
+	while (RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start) < msec)
+	{
+		if (state_info[s].idle_fn)
+			state_info[s].idle_fn();
+		else
+			idle_default();
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get the numeric choices of a demo
+ * @param[in] *name
+ * 		Demo name, as shown in the main menu
+ * @param[out] *choices
+ * 		Choices, as would be shown on the LCD
+ * @param[in] max
+ * 		Size of choices
+ * @return Number of choices, 0 if no such demo
+ ******************************************************************************/
+int demo_get_choices(const char *name, int32_t *choices, int max)
+{
+	state_t s = state_by_name(name);
+	int count;
+
+	if ((s == STATE_MAX) || ! state_info[s].run_fn)
+		return 0;
+	count = state_info[s].numeric_choices_fixed_count;
+	if (count > max)
+		count = max;
+	memcpy(choices, state_info[s].numeric_choices_fixed, count * sizeof(int32_t));
+	return count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set a CONFIG menu item without the buttons and slider
+ * @note
+ * 		The menu stays in the current state, which is entered again to
+ * 		redisplay it.
+ * @param[in] *name
+ * 		Item name, as shown in the CONFIG menu
+ * @param[in] value
+ * 		0 or 1 for the Y/N items, 0 to 3 for "DIST" (SEQ, UNI, ZIPF,
+ * 		HOT), any value for "SEED", otherwise the numeric choice as shown
+ * 		on the LCD, e.g., KiB for "ERA SZ" (0 for the smallest size)
+ * @return TRUE if the item exists and the value is valid for the part
+ ******************************************************************************/
+bool demo_set_config(const char *name, int32_t value)
+{
+	state_t saved = state;
+	bool ok = set_config(name, value);
+
+	state = saved;
+	prev_state = STATE_MAX;
+	return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set a CONFIG menu item, for demo_set_config()
+ ******************************************************************************/
+static bool set_config(const char *name, int32_t value)
+{
+	switch (state_by_name(name))
+	{
+	case state_conf_so:
+		use_so = value != 0;
+		return true;
+	case state_conf_verify:
+		do_verify = value != 0;
+		return true;
+	case state_conf_queue:
+		use_queue = value != 0;
+		return true;
+	case state_conf_pull:
+		use_pull = value != 0;
+		return true;
+	case state_conf_energy:
+		show_energy = value != 0;
+		return true;
+	case state_conf_erase_size:
+		if (! select_choice(state_conf_erase_size, value))
+			return false;
+		leave_conf_erase_size();
+		return true;
+	case state_conf_iter:
+		if (! select_choice(state_conf_iter, value))
+			return false;
+		leave_conf_iter();
+		return true;
+	case state_conf_dist:
+		if ((value < 0) || (value >= WORKLOAD_DIST_COUNT))
+			return false;
+		workload_config.dist = value;
+		return true;
+	case state_conf_read_pct:
+		if (! select_choice(state_conf_read_pct, value))
+			return false;
+		leave_conf_read_pct();
+		return true;
+	case state_conf_erase_pct:
+		if (! select_choice(state_conf_erase_pct, value))
+			return false;
+		leave_conf_erase_pct();
+		return true;
+	case state_conf_req_min:
+		if (! select_choice(state_conf_req_min, value))
+			return false;
+		leave_conf_req_min();
+		return true;
+	case state_conf_req_max:
+		if (! select_choice(state_conf_req_max, value))
+			return false;
+		leave_conf_req_max();
+		return true;
+	case state_conf_seed:
+		// any seed, not only those on the slider
+		workload_config.seed = value;
+		return true;
+	case state_conf_spi_clk:
+		if (! select_choice(state_conf_spi_clk, value))
+			return false;
+		leave_conf_spi_clk();
+		return true;
+	default:
+		return false;
+	}
 }
 
 
@@ -681,12 +1198,65 @@ void enter_erase(void)
 	numeric_choices_init();
 }
 
+// Erases expected to take at least this long show progress on the LCD.
+// This adds LCD current to the measurement, but only for long erases.
+#define ERASE_PROGRESS_MIN_MS 1000
+#define ERASE_PROGRESS_INTERVAL_MS 250
+#define ERASE_TIMEOUT_CHECK_INTERVAL_MS 1000
+
+// Allowance on top of the estimated worst case erase time
+#define ERASE_TIMEOUT_MARGIN_MS 1000
+
+static volatile bool erase_done;
+static char erase_progress_msg[8];
+
+/***************************************************************************//**
+ * @brief
+ *   Erase completion, called from interrupt context
+ ******************************************************************************/
+static void erase_done_completion(void *ref)
+{
+	(void) ref;
+
+	erase_done = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Show erase progress
+ * @note
+ * 		Progress is by elapsed time against the estimated duration, since a
+ * 		single chip erase command gives no other indication. Shows percent
+ * 		complete in the text field and estimated seconds remaining in the
+ * 		numeric field.
+ * @param[in] elapsed_ms
+ * 		Time since the erase started
+ * @param[in] estimate_ms
+ * 		Estimated (typical) duration
+ ******************************************************************************/
+static void erase_show_progress(uint32_t elapsed_ms, uint32_t estimate_ms)
+{
+	uint32_t percent = 99;
+	uint32_t remaining_s = 0;
+
+	if (elapsed_ms < estimate_ms)
+	{
+		percent = (uint64_t) elapsed_ms * 100 / estimate_ms;
+		remaining_s = (estimate_ms - elapsed_ms + 999) / 1000;
+	}
+	snprintf(erase_progress_msg, sizeof(erase_progress_msg), "ER %2" PRIu32, percent);
+	SegmentLCD_Write(erase_progress_msg);
+	SegmentLCD_Number(remaining_s > 9999 ? 9999 : remaining_s);
+}
+
 /***************************************************************************//**
  * @brief
  *   	Demo Menu: Runs Erase Demo, Gets Erase size from user selected value on
  *   	slider.
  * @note
  * 		Determines total size of device from Device Table in spiflash.c
+ * 		The driver's duration estimate sets the timeout, and for long
+ * 		erases, drives a progress display.
  *
  ******************************************************************************/
 void run_erase(void)
@@ -699,17 +1269,68 @@ void run_erase(void)
 	uint32_t device_size = spiflash_info_table[part].device_size;
 
 	uint32_t addr = 0;
+	uint64_t estimate_us = 0;
+	uint64_t timeout_us = 0;
+	uint64_t start;
+	uint64_t op_start;
+	uint32_t elapsed_ms;
+	bool show_progress;
+
+	// estimate the whole run, for progress display and timeout
+	while (count > 0)
+	{
+		estimate_us += spiflash_estimate_erase_us(addr, erase_size, erase_size, false);
+		timeout_us += spiflash_estimate_erase_us(addr, erase_size, erase_size, true);
+		addr += erase_size;
+		if (addr >= device_size)
+			addr = 0;
+		count -= erase_size;
+	}
+	timeout_us += 1000 * ERASE_TIMEOUT_MARGIN_MS;
+
+	show_progress = estimate_us >= (1000 * ERASE_PROGRESS_MIN_MS);
+	if (show_progress)
+		SegmentLCD_Init(false);
 
+	// periodic wake-up, to check the timeout and update progress
+	RTCDRV_StartTimer(xTimerForWakeUp, rtcdrvTimerTypePeriodic,
+			          show_progress ? ERASE_PROGRESS_INTERVAL_MS : ERASE_TIMEOUT_CHECK_INTERVAL_MS,
+			          NULL, NULL);
+
+	start = RTCDRV_GetWallClockTicks64();
+	count = size;
+	addr = 0;
 	while (count > 0)
 	{
-		if (! spiflash_erase(addr, erase_size, erase_size, use_so, NULL, NULL))
+		erase_done = false;
+		op_start = bench_op_start();
+		if (! spiflash_erase(addr, erase_size, erase_size, use_so, erase_done_completion, NULL))
 			fatal("erase error");
+		while (! erase_done)
+		{
+			elapsed_ms = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+			if (elapsed_ms > (timeout_us / 1000))
+				fatal("erase timeout");
+			if (show_progress)
+				erase_show_progress(elapsed_ms, estimate_us / 1000);
+			enter_low_power_state();
+		}
+		bench_op_done(op_start, erase_size);
 		addr += erase_size;
 		if (addr >= device_size)
 			addr = 0;
 		count -= erase_size;
 	}
 
+	RTCDRV_StopTimer(xTimerForWakeUp);
+	if (show_progress)
+	{
+		SegmentLCD_AllOff();
+		SegmentLCD_Disable();
+	}
+
+	duration = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+
 	message_text = "ER done";
 	message_number = slider;
 	message_return_state = state;
@@ -726,6 +1347,156 @@ void preflight_program(void)
 	init_buffer(0, BUFFER_SIZE, 0xdeadbeef);
 }
 
+#define QUEUE_BENCH_DEPTH 4
+
+static spiflash_op_t queue_bench_ops[QUEUE_BENCH_DEPTH];
+static uint64_t queue_bench_op_start[QUEUE_BENCH_DEPTH];
+static volatile int32_t queue_bench_remaining;
+static volatile uint32_t queue_bench_in_flight;
+static uint32_t queue_bench_addr;
+static uint32_t queue_bench_device_size;
+
+/***************************************************************************//**
+ * @brief
+ *   Submit a benchmark request for the next page
+ * @param[in] *op
+ * 		Operation descriptor to reuse
+ ******************************************************************************/
+static void queue_bench_submit(spiflash_op_t *op)
+{
+	op->addr = queue_bench_addr;
+	queue_bench_addr += op->len;
+	if (queue_bench_addr >= queue_bench_device_size)
+		queue_bench_addr = 0;
+	queue_bench_remaining -= op->len;
+	queue_bench_in_flight++;
+	queue_bench_op_start[op - queue_bench_ops] = bench_op_start();
+	spiflash_queue_submit(op);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Benchmark request completion, called from interrupt context
+ * @note
+ * 		Resubmits the descriptor for the next page until the requested
+ * 		size has been submitted.
+ * @param[in] *op
+ * 		Completed operation descriptor
+ ******************************************************************************/
+static void queue_bench_completion(spiflash_op_t *op)
+{
+	bench_op_done(queue_bench_op_start[op - queue_bench_ops], op->len);
+	queue_bench_in_flight--;
+	if (queue_bench_remaining > 0)
+		queue_bench_submit(op);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read or write a number of pages through the operation queue
+ * @note
+ * 		Keeps QUEUE_BENCH_DEPTH page requests in flight, each with its own
+ * 		page of the buffer, and waits until all have completed.
+ * @param[in] type
+ * 		SPIFLASH_OP_READ or SPIFLASH_OP_WRITE
+ * @param[in] *buffer
+ * 		Buffer of at least QUEUE_BENCH_DEPTH pages
+ * @param[in] size
+ * 		Number of bytes to transfer, starting at address 0
+ ******************************************************************************/
+static void queue_bench_run(spiflash_op_type_t type, uint8_t *buffer, uint32_t size)
+{
+	uint32_t program_page_size = spiflash_info_table[part].program_page_size;
+	int i;
+
+	queue_bench_remaining = size;
+	queue_bench_in_flight = 0;
+	queue_bench_addr = 0;
+	queue_bench_device_size = spiflash_info_table[part].device_size;
+
+	for (i = 0; i < QUEUE_BENCH_DEPTH; i++)
+	{
+		spiflash_op_t *op = & queue_bench_ops[i];
+		memset(op, 0, sizeof(*op));
+		op->type = type;
+		op->priority = SPIFLASH_PRIO_NORMAL;
+		op->len = program_page_size;
+		op->buffer = & buffer[i * program_page_size];
+		op->use_so_irq = use_so;
+		op->completion = queue_bench_completion;
+	}
+
+	// hold off completions until all descriptors are in flight
+	INT_Disable();
+	for (i = 0; (i < QUEUE_BENCH_DEPTH) && (queue_bench_remaining > 0); i++)
+		queue_bench_submit(& queue_bench_ops[i]);
+	INT_Enable();
+
+	while (queue_bench_in_flight)
+		enter_low_power_state();
+}
+
+static uint32_t program_source_offset;
+static uint64_t program_source_op_start;  // of the page being transferred
+static size_t program_source_len;         // of that page, 0 before the first
+static volatile bool program_source_busy;
+
+/***************************************************************************//**
+ * @brief
+ *   Write data source for the WRITE demo
+ * @note
+ * 		Generates the same data for each page as the synchronous WRITE path
+ * 		does with verify enabled. Called by the flash driver while the
+ * 		previous page is programming.
+ *
+ * 		Each page is recorded as an operation from the call for it to the
+ * 		call for the next page, i.e. from when the previous page had been
+ * 		transferred until this one has, which includes waiting for the
+ * 		previous page to program. The last page is recorded on completion,
+ * 		so it also includes its own programming.
+ * @param[in] addr
+ * 		Flash address of the page
+ * @param[in] len
+ * 		Length of the page
+ * @param[in] *ref
+ * 		Unused
+ * @return Pointer to page data
+ ******************************************************************************/
+static uint8_t *program_source(uint32_t addr, size_t len, void *ref)
+{
+	(void) ref;
+
+	uint8_t *page;
+
+	if (program_source_len)
+		bench_op_done(program_source_op_start, program_source_len);
+	program_source_op_start = bench_op_start();
+	program_source_len = len;
+
+	if ((program_source_offset + len) > sizeof(buf1))
+		program_source_offset = 0;
+	init_buffer(program_source_offset, len, addr);
+	page = & buf1[program_source_offset];
+	program_source_offset += len;
+	return page;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Completion of a WRITE demo write from program_source()
+ * @param[in] *ref
+ * 		Unused
+ ******************************************************************************/
+static void program_source_done(void *ref)
+{
+	(void) ref;
+
+	if (program_source_len)
+		bench_op_done(program_source_op_start, program_source_len);
+	program_source_len = 0;
+	program_source_busy = false;
+}
+
 /***************************************************************************//**
  * @brief
  *   Demo Menu: Runs Flash Write Demo  Programs Flash, Gets Program Size from user
@@ -747,13 +1518,42 @@ void run_program(void)
 
 	uint32_t addr = 0;
 	uint32_t buffer_offset = 0;
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint64_t op_start;
+
+	if (use_pull)
+	{
+		program_source_offset = 0;
+		while (count > 0)
+		{
+			uint32_t len = device_size - addr;
+			if (len > (uint32_t) count)
+				len = count;
+			program_source_busy = true;
+			spiflash_write_source(addr, len, program_source, NULL, use_so, program_source_done, NULL);
+			while (program_source_busy)
+				enter_low_power_state();
+			addr += len;
+			if (addr >= device_size)
+				addr = 0;
+			count -= len;
+		}
+	}
+	// verify needs the expected data of each page, so uses the synchronous calls
+	else if (use_queue && ! do_verify)
+	{
+		queue_bench_run(SPIFLASH_OP_WRITE, buf1, size);
+		addr = size % device_size;
+		count = 0;
+	}
 
 	while (count > 0)
 	{
 		if (do_verify)
 			init_buffer(buffer_offset, program_page_size, addr);
-		spiflash_set_write_enable(true, NULL, NULL);
+		op_start = bench_op_start();
 		spiflash_write(addr, program_page_size, & buf1[buffer_offset], use_so, NULL, NULL);
+		bench_op_done(op_start, program_page_size);
 
 		addr += program_page_size;
 		if (addr >= device_size)
@@ -764,6 +1564,8 @@ void run_program(void)
 		count -= program_page_size;
 	}
 
+	duration = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+
 	data_written_byte_count = addr;
 
 	message_text = "Wr done";
@@ -792,12 +1594,23 @@ void run_read(void)
 
 	uint32_t addr = 0;
 	uint32_t buffer_offset = 0;
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint64_t op_start;
+
+	// verify compares each page as it is read, so uses the synchronous calls
+	if (use_queue && ! do_verify)
+	{
+		queue_bench_run(SPIFLASH_OP_READ, buf2, size);
+		count = 0;
+	}
 
 	while (count > 0)
 	{
 		if (do_verify)
 			init_buffer(buffer_offset, program_page_size, addr);
+		op_start = bench_op_start();
 		spiflash_read(addr, program_page_size, & buf2[buffer_offset], NULL, NULL);
+		bench_op_done(op_start, program_page_size);
 
 		addr += program_page_size;
 
@@ -805,6 +1618,7 @@ void run_read(void)
 		{
 			if (memcmp (buf1 + buffer_offset, buf2 + buffer_offset, program_page_size) != 0)
 			{
+				run_error = true;
 				message_text = "DataErr";
 				message_number = addr >> 10;
 				if (message_number > 9999)
@@ -823,6 +1637,8 @@ void run_read(void)
 		count -= program_page_size;
 	}
 
+	duration = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+
 	message_text = "READ dn";
 	message_number = slider;
 	message_return_state = state;
@@ -863,10 +1679,13 @@ void run_rmw_dataflash(void)
 
 	uint32_t addr = 0;
 	uint32_t offset = 0;  // offset within block to update
+	uint64_t op_start;
 
 	while (count > 0)
 	{
+		op_start = bench_op_start();
 		dataflash_rmw(addr + offset, RMW_UPDATE_BYTE_COUNT, buf1 + offset, NULL, NULL);
+		bench_op_done(op_start, program_page_size);
 
 		addr += program_page_size;
 		if (addr > device_size)
@@ -904,11 +1723,13 @@ void run_rmw_normal(void)
 
 	uint32_t addr = 0;
 	uint32_t offset = 0;  // offset within block to update
+	uint64_t op_start;
 
 	while (count > 0)
 	{
 		int i;
 
+		op_start = bench_op_start();
 		spiflash_read(addr, erase_size, buf2, NULL, NULL);
 
 		// modify data
@@ -918,6 +1739,7 @@ void run_rmw_normal(void)
 		// erase and write back
 		spiflash_erase(addr, erase_size, erase_size, use_so, NULL, NULL);
 		spiflash_write(addr, erase_size, buf2, use_so, NULL, NULL);
+		bench_op_done(op_start, erase_size);
 
 		addr += erase_size;
 		if (addr > device_size)
@@ -961,11 +1783,15 @@ void run_rmw(void)
 void appl_erase(uint32_t len)
 {
 	uint32_t device_size = spiflash_info_table[part].device_size;
+	uint64_t op_start;
+
 	if (len > device_size)
 		len = device_size;
 
+	op_start = bench_op_start();
 	if (! spiflash_erase(0, len, 0, use_so, NULL, NULL))
 		fatal("erase error");
+	bench_op_done(op_start, len);
 }
 
 /***************************************************************************//**
@@ -983,13 +1809,16 @@ void appl_write(uint32_t len)
 	uint32_t addr = 0;
 	uint32_t buffer_offset = 0;
 	uint32_t count = len;
+	uint64_t op_start;
 
 	while (count)
 	{
 		if (addr == 0)
 			appl_erase(len - addr);
 		init_buffer(buffer_offset, program_page_size, addr);
+		op_start = bench_op_start();
 		spiflash_write(addr, program_page_size, & buf1[buffer_offset], use_so, NULL, NULL);
+		bench_op_done(op_start, program_page_size);
 		data_written_byte_count += program_page_size;
 		addr += program_page_size;
 		if (addr >= device_size)
@@ -1016,11 +1845,14 @@ bool appl_read(uint32_t len)
 	uint32_t addr = 0;
 	uint32_t buffer_offset = 0;
 	uint32_t count = len;
+	uint64_t op_start;
 
 	while (count)
 	{
 		init_buffer(buffer_offset, program_page_size, addr);
+		op_start = bench_op_start();
 		spiflash_read(addr, program_page_size, & buf2[buffer_offset], NULL, NULL);
+		bench_op_done(op_start, program_page_size);
 		if (memcmp(buf1 + buffer_offset, buf2 + buffer_offset, program_page_size) != 0)
 		{
 			return false;
@@ -1038,53 +1870,1180 @@ bool appl_read(uint32_t len)
 
 /***************************************************************************//**
  * 	@brief
- * 		Demo Menu: Runs Application Demo from Main Menu
+ * 		Demo Menu: Runs Application Demo from Main Menu
+ * 	@note
+ * 		Looks up Device Size from Serial Memory Table
+ ******************************************************************************/
+//TODO There is not an Erase that is occurring in the Application Demo??
+//TODO Compare to older versions
+void run_appl(void)
+{
+	uint32_t slider = slider_get_choice(state_slider_position[state]);
+	uint32_t size = 1024 * slider;
+	uint32_t addr;
+	uint32_t device_size = spiflash_info_table[part].device_size;
+	uint32_t bytes_per_iter;
+	bool read_status;
+
+	if (size > device_size)
+		bytes_per_iter = device_size;
+	else
+		bytes_per_iter = size;
+
+	addr = 0;
+	while (size)
+	{
+		data_written_byte_count = 0;
+		appl_write(bytes_per_iter);
+		read_status = appl_read(bytes_per_iter);
+		if (! read_status)
+		{
+			message_number = addr / spiflash_info_table[part].program_page_size;
+			if (message_number > 9999)
+				message_number = 9999;
+			break;
+		}
+		size -= bytes_per_iter;
+		addr += bytes_per_iter;
+	}
+
+	if (read_status)
+	{
+		message_text = "Appl dn";
+		message_number = slider;
+	}
+	else
+	{
+		run_error = true;
+		message_text = "ReadErr";
+	}
+
+	message_return_state = state;
+	state = state_message;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Write one erase unit of data for the Burst Demo
+ *	@param[in] addr
+ *		Address of the erased unit
+ *	@param[in] unit_size
+ *		Size of the unit, may be larger than the data buffer
+ ******************************************************************************/
+static void burst_write_unit(uint32_t addr, uint32_t unit_size)
+{
+	uint32_t offset;
+	uint32_t len;
+
+	for (offset = 0; offset < unit_size; offset += len)
+	{
+		len = unit_size - offset;
+		if (len > sizeof(buf1))
+			len = sizeof(buf1);
+		spiflash_write(addr + offset, len, buf1, use_so, NULL, NULL);
+	}
+}
+
+static uint32_t burst_pool_unit_size;  // erase size the pool is set up for, 0 if not
+static bool burst_pool_awake;          // part woken from deep power down to erase ahead
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Set up the pre-erase pool for the Burst Write Demo, unless it already is
+ * 	@note
+ * 		The pool owns the whole device, so it is only set up while BURST is
+ * 		selected, and dropped on leaving it.
+ ******************************************************************************/
+static void burst_pool_start(void)
+{
+	uint32_t device_size = spiflash_info_table[part].device_size;
+
+	if ((burst_pool_unit_size == erase_size) || (erase_size >= device_size))
+		return;
+	if (! erase_pool_init(0, device_size, erase_size, ERASE_POOL_MAX_DEPTH, use_so))
+		fatal("erase pool error");
+	burst_pool_unit_size = erase_size;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Idle function of the Burst Write Demo
+ * 	@note
+ * 		While BURST is selected, the pre-erase pool erases units ahead in
+ * 		the background, except while the console is open, whose commands
+ * 		may use the flash at any time. Demos leave the part in deep power
+ * 		down, so it is woken until the pool is full. While an erase is
+ * 		running, sleeps through enter_low_power_state() rather than in EM2,
+ * 		which would stop its SPI transfers.
+ ******************************************************************************/
+void idle_burst(void)
+{
+	if (! console_is_open())
+	{
+		burst_pool_start();
+		if (! erase_pool_full())
+		{
+			if (! burst_pool_awake)
+			{
+				spiflash_ultra_deep_power_down(false, NULL, NULL);
+				spiflash_set_global_protect(false, NULL, NULL);
+				burst_pool_awake = true;
+			}
+			erase_pool_service();
+		}
+		else if (burst_pool_awake && spiflash_idle())
+		{
+			spiflash_ultra_deep_power_down(true, NULL, NULL);
+			burst_pool_awake = false;
+		}
+	}
+	if (spiflash_idle())
+		idle_default();
+	else
+		enter_low_power_state();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Leave the Burst Write Demo
+ * 	@note
+ * 		Other demos write anywhere, so the pool's erased units can't be
+ * 		kept.
+ ******************************************************************************/
+void leave_burst(void)
+{
+	erase_pool_quiesce();
+	if (burst_pool_awake)
+		spiflash_ultra_deep_power_down(true, NULL, NULL);
+	burst_pool_awake = false;
+	burst_pool_unit_size = 0;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs Burst Write Demo from Main Menu
+ * 	@note
+ * 		Writes a burst of erase units (of the configured erase size) twice:
+ * 		first claiming units which the pre-erase pool erased while BURST
+ * 		was selected and idle, then erasing each unit right before
+ * 		programming it, as appl_write() does. Claims beyond the units
+ * 		ready wait for their erase. The times, and the pool's depth and
+ * 		the erase time it took off the write path, are printed on the
+ * 		serial port. Displays the time saved by the pool, in milliseconds.
+ ******************************************************************************/
+void run_burst(void)
+{
+	uint32_t slider = slider_get_choice(state_slider_position[state]);
+	uint32_t size = 1024 * slider;
+	uint32_t device_size = spiflash_info_table[part].device_size;
+	uint32_t unit_count;
+	uint32_t addr;
+	uint32_t i;
+	uint64_t start;
+	uint64_t no_pool_ticks;
+	uint64_t pool_ticks;
+	erase_pool_stats_t ready_stats;
+	erase_pool_stats_t stats;
+
+	if (erase_size >= device_size)
+		fatal("ERA SZ too big for burst");
+
+	unit_count = size / erase_size;
+	if (unit_count == 0)
+		unit_count = 1;
+	if (unit_count > (device_size / erase_size))
+		unit_count = device_size / erase_size;
+
+	init_buffer(0, BUFFER_SIZE, 0xdeadbeef);
+
+	// not set up yet if run without idling in the menu, e.g. from the console
+	burst_pool_start();
+	erase_pool_get_stats(& ready_stats);
+
+	// burst with pool
+	start = RTCDRV_GetWallClockTicks64();
+	for (i = 0; i < unit_count; i++)
+	{
+		if (! erase_pool_claim(& addr))
+			fatal("erase error");
+		burst_write_unit(addr, erase_size);
+	}
+	pool_ticks = RTCDRV_GetWallClockTicks64() - start;
+	erase_pool_get_stats(& stats);
+
+	// burst without pool, erase time is on the write path
+	start = RTCDRV_GetWallClockTicks64();
+	for (i = 0, addr = 0; i < unit_count; i++, addr += erase_size)
+	{
+		if (! spiflash_erase(addr, erase_size, erase_size, use_so, NULL, NULL))
+			fatal("erase error");
+		burst_write_unit(addr, erase_size);
+	}
+	no_pool_ticks = RTCDRV_GetWallClockTicks64() - start;
+
+	// that wrote over the units the pool had erased, and test_stop() will
+	// power the part down
+	burst_pool_unit_size = 0;
+	burst_pool_awake = false;
+
+	demo_serial_open();
+	printf("\r\n%s burst, %" PRIu32 " x %" PRIu32 " byte units\r\n",
+		   spiflash_info_table[part].name, unit_count, erase_size);
+	printf("pool     %" PRIu32 " ms, %u of %u units ready\r\n",
+		   RTCDRV_TicksToMsec(pool_ticks), ready_stats.depth, ready_stats.target_depth);
+	printf("no pool  %" PRIu32 " ms\r\n", RTCDRV_TicksToMsec(no_pool_ticks));
+	printf("claims   %" PRIu32 " ready, %" PRIu32 " ms stalled, %" PRIu32 " ms of erase avoided\r\n",
+		   stats.claim_ready_count, RTCDRV_TicksToMsec(stats.stall_ticks),
+		   RTCDRV_TicksToMsec(stats.stall_avoided_ticks));
+	demo_serial_close();
+
+	duration = RTCDRV_TicksToMsec(pool_ticks);
+
+	message_text = "Bu sav";
+	if (pool_ticks < no_pool_ticks)
+		message_number = RTCDRV_TicksToMsec(no_pool_ticks - pool_ticks);
+	else
+		message_number = 0;
+	if (message_number > 9999)
+		message_number = 9999;
+	message_return_state = state;
+	state = state_message;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Timed operations of a store demo (Journal, KV Store, FTL)
+ ******************************************************************************/
+typedef struct
+{
+	uint32_t ops;
+	uint64_t bytes;
+	uint64_t op_us;     // in the operations
+	uint32_t max_op_us;
+	uint32_t mean_op_us;
+	uint32_t ms;        // from the first operation to the end of the last
+	uint32_t mount_us;  // to mount the store again
+} store_demo_result_t;
+
+/***************************************************************************//**
+ * 	@brief
+ * 		A store demo, run by run_store_demo(); each function may call
+ * 		fatal() if the store fails
+ ******************************************************************************/
+typedef struct
+{
+	char *message_text;         // displayed with the number from report
+	bool (*format)(void);       // format, and write any data not timed; false if there is no room
+	size_t (*op)(uint32_t i);   // timed operation i; bytes written, or 0 once done
+	bool (*check)(bool mounted);  // check the data, after the operations and after mounting again
+	void (*mount)(void);
+	uint32_t (*report)(const store_demo_result_t *r);  // print, returning the number to display
+} store_demo_t;
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Region of a store demo
+ *	@param[in] units
+ *		Most erase units of the configured erase size to take
+ *	@param[in] *what
+ *		Store, for the error message
+ *	@return Length of the region, from address 0
+ ******************************************************************************/
+static uint32_t store_demo_region(uint32_t units, const char *what)
+{
+	uint32_t device_size = spiflash_info_table[part].device_size;
+	static char error[32];  // "ERA SZ too big for Journal"
+
+	if (erase_size >= device_size)
+	{
+		snprintf(error, sizeof(error), "ERA SZ too big for %s", what);
+		fatal(error);
+	}
+	return ((units * erase_size) < device_size) ? (units * erase_size) : device_size;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Run a store demo
+ * 	@note
+ * 		Formats the store, times its operations, checks the data, mounts
+ * 		the store again, timing that, and checks the data again. The report
+ * 		is printed on the serial port. Displays the demo's number, or
+ * 		DataErr and the slider setting if a check failed.
+ *	@param[in] *d
+ *		Demo
+ ******************************************************************************/
+static void run_store_demo(const store_demo_t *d)
+{
+	uint32_t slider = slider_get_choice(state_slider_position[state]);
+	store_demo_result_t r;
+	uint64_t start;
+	uint64_t op_start;
+	uint32_t op_us;
+	uint32_t number;
+	size_t bytes;
+	bool ok;
+
+	memset(& r, 0, sizeof(r));
+	init_buffer(0, BUFFER_SIZE, 0xdeadbeef);
+
+	if (! d->format())
+	{
+		message_text = "No room";
+		message_number = slider;
+		message_return_state = state;
+		state = state_message;
+		return;
+	}
+
+	start = RTCDRV_GetWallClockTicks64();
+	for (;;)
+	{
+		op_start = bench_op_start();
+		bytes = d->op(r.ops);
+		if (! bytes)
+			break;
+		bench_op_done(op_start, bytes);
+		op_us = ((uint64_t) (spi_timer_now() - (uint32_t) op_start) * 1000000) / spi_timer_tick_hz();
+		if (op_us > r.max_op_us)
+			r.max_op_us = op_us;
+		r.op_us += op_us;
+		r.bytes += bytes;
+		r.ops++;
+	}
+	r.ms = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+	r.mean_op_us = r.ops ? r.op_us / r.ops : 0;
+
+	ok = d->check(false);
+
+	start = RTCDRV_GetWallClockTicks64();
+	d->mount();
+	r.mount_us = RTCDRV_TicksToMsec((RTCDRV_GetWallClockTicks64() - start) * 1000);
+	ok = d->check(true) && ok;
+
+	demo_serial_open();
+	number = d->report(& r);
+	demo_serial_close();
+
+	duration = r.ms;
+
+	if (ok)
+	{
+		message_text = d->message_text;
+		message_number = (number > 9999) ? 9999 : number;
+	}
+	else
+	{
+		run_error = true;
+		message_text = "DataErr";
+		message_number = slider;
+	}
+	message_return_state = state;
+	state = state_message;
+}
+
+#define JOURNAL_DEMO_UNITS 16
+
+static uint32_t journal_demo_region;
+static uint32_t journal_demo_size;  // bytes of record data to append
+static uint32_t journal_demo_seq;   // of the first record
+static uint32_t journal_demo_count;
+static uint32_t journal_demo_read_bytes;
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Record data length for the Journal Demo, from its sequence number
+ *	@param[in] seq
+ *		Sequence number of the record
+ *	@return Length, from 1 to journal_max_data()
+ ******************************************************************************/
+static size_t journal_demo_len(uint32_t seq)
+{
+	return 1 + ((seq * 37) % journal_max_data());
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Record data for the Journal Demo, from its sequence number
+ *	@param[in] seq
+ *		Sequence number of the record
+ *	@return Pointer into buf1
+ ******************************************************************************/
+static const uint8_t *journal_demo_data(uint32_t seq)
+{
+	return & buf1[(seq * 13) % (BUFFER_SIZE - JOURNAL_MAX_RECORD)];
+}
+
+static bool journal_demo_format(void)
+{
+	journal_stats_t stats;
+
+	journal_demo_region = store_demo_region(JOURNAL_DEMO_UNITS, "journal");
+	journal_demo_size = 1024 * slider_get_choice(state_slider_position[state]);
+	journal_demo_count = 0;
+	journal_demo_read_bytes = 0;
+	if (! journal_format(0, journal_demo_region, erase_size, use_so))
+		fatal("journal error");
+	journal_get_stats(& stats);
+	journal_demo_seq = stats.next_seq;
+	return true;
+}
+
+static size_t journal_demo_append(uint32_t i)
+{
+	size_t len = journal_demo_len(journal_demo_seq + i);
+
+	if (journal_demo_count >= journal_demo_size)
+		return 0;
+	if (! journal_append(journal_demo_data(journal_demo_seq + i), len, NULL))
+		fatal("journal error");
+	journal_demo_count += len;
+	return len;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Read back the Journal Demo's records, oldest first
+ *	@param[in] mounted
+ *		Check only once mounted again
+ *	@return true if the records run up to the last one appended
+ ******************************************************************************/
+static bool journal_demo_check(bool mounted)
+{
+	journal_cursor_t cursor;
+	journal_stats_t stats;
+	uint32_t expect_seq;
+	size_t len;
+
+	if (! mounted)
+		return true;
+	journal_get_stats(& stats);
+	expect_seq = stats.first_seq;
+	journal_demo_read_bytes = 0;
+	if (journal_first(& cursor))
+	{
+		while (journal_read(& cursor, buf2, sizeof(buf2), & len))
+		{
+			if ((cursor.seq != expect_seq) || (len != journal_demo_len(cursor.seq)) ||
+				(memcmp(buf2, journal_demo_data(cursor.seq), len) != 0))
+				return false;
+			journal_demo_read_bytes += len;
+			expect_seq++;
+		}
+	}
+	return expect_seq == stats.next_seq;
+}
+
+static void journal_demo_mount(void)
+{
+	if (! journal_mount(0, journal_demo_region, erase_size, use_so))
+		fatal("journal error");
+}
+
+static uint32_t journal_demo_report(const store_demo_result_t *r)
+{
+	journal_stats_t stats;
+	uint32_t rate = r->ms ? (r->bytes * 1000ULL) / (r->ms * 1024ULL) : 0;
+
+	journal_get_stats(& stats);
+	printf("\r\n%s journal, %" PRIu32 " x %" PRIu32 " byte units\r\n",
+		   spiflash_info_table[part].name, stats.unit_count, stats.unit_size);
+	printf("append   %" PRIu32 " records, %" PRIu32 " bytes, %" PRIu32 " ms, %" PRIu32 " KiB/s\r\n",
+		   r->ops, (uint32_t) r->bytes, r->ms, rate);
+	printf("mount    %" PRIu32 " us, %" PRIu32 " reads\r\n", r->mount_us, stats.mount_reads);
+	printf("held     %" PRIu32 " records, %" PRIu32 " bytes in %" PRIu32 " units, %" PRIu32 "%% efficient\r\n",
+		   stats.next_seq - stats.first_seq, journal_demo_read_bytes, stats.units_used,
+		   stats.used_bytes ? (uint32_t) ((journal_demo_read_bytes * 100ULL) / stats.used_bytes) : 0);
+	return rate;
+}
+
+static const store_demo_t journal_demo =
+{
+	.message_text = "Jr dn",
+	.format       = journal_demo_format,
+	.op           = journal_demo_append,
+	.check        = journal_demo_check,
+	.mount        = journal_demo_mount,
+	.report       = journal_demo_report,
+};
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs the Journal Demo from Main Menu
+ * 	@note
+ * 		Formats a journal of up to 16 erase units of the configured erase
+ * 		size, and appends records of varying length to it until the
+ * 		slider's KiB of data have been written, wrapping around if they
+ * 		don't fit. It then mounts the journal again, and reads back every
+ * 		record it still holds, checking data and sequence numbers. The
+ * 		append rate, mount time and space efficiency (record data over the
+ * 		flash taken by the units holding it) are printed on the serial
+ * 		port. Displays the append rate, in KiB/s.
+ ******************************************************************************/
+void run_journal(void)
+{
+	run_store_demo(& journal_demo);
+}
+
+#define KV_DEMO_UNITS 16
+#define KV_DEMO_KEYS  64
+#define KV_DEMO_ENTRY 26  // typical entry, header and value, for spreading the cold keys
+
+static uint16_t kv_demo_gen[KV_DEMO_KEYS];  // puts of each key so far
+static uint32_t kv_demo_cold_keys;   // keys from 2 put once, never changed
+static uint32_t kv_demo_cold_every;  // puts from one cold key to the next
+static uint32_t kv_demo_region;
+static uint32_t kv_demo_get_us;
+static kv_stats_t kv_demo_stats;  // after the puts
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Value length for the KV Demo, from its key and generation
+ *	@param[in] key
+ *		Key
+ *	@return Length, from 4 to 32 bytes, or less on small units
+ ******************************************************************************/
+static size_t kv_demo_len(uint32_t key)
+{
+	size_t len = 4 + ((key * 7 + kv_demo_gen[key] * 13) % 29);
+
+	return (len < kv_max_value()) ? len : kv_max_value();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Value for the KV Demo, from its key and generation
+ *	@param[in] key
+ *		Key
+ *	@return Pointer into buf1
+ ******************************************************************************/
+static const uint8_t *kv_demo_value(uint32_t key)
+{
+	return & buf1[(key * 257 + kv_demo_gen[key] * 31) % (BUFFER_SIZE - KV_MAX_VALUE)];
+}
+
+// Cold keys take about a quarter of the store, and are spread over its
+// first fill, so that every unit collected holds some live entries
+static bool kv_demo_format(void)
+{
+	uint32_t entries;
+
+	kv_demo_region = store_demo_region(KV_DEMO_UNITS, "KV");
+	memset(kv_demo_gen, 0, sizeof(kv_demo_gen));
+	if (! kv_format(0, kv_demo_region, erase_size, use_so))
+		fatal("KV error");
+
+	entries = kv_demo_region / KV_DEMO_ENTRY;
+	kv_demo_cold_keys = entries / 4;
+	if (kv_demo_cold_keys > (KV_DEMO_KEYS - 2))
+		kv_demo_cold_keys = KV_DEMO_KEYS - 2;
+	kv_demo_cold_every = entries / (kv_demo_cold_keys + 1);
+	return true;
+}
+
+// two hot keys, and now and then a cold key put for the first time
+static size_t kv_demo_put(uint32_t i)
+{
+	uint32_t cold = (i + 1) / kv_demo_cold_every;
+	uint32_t key = i % 2;
+
+	if ((((i + 1) % kv_demo_cold_every) == 0) && (cold <= kv_demo_cold_keys))
+		key = 1 + cold;
+	if (i >= (uint32_t) slider_get_choice(state_slider_position[state]))
+		return 0;
+	kv_demo_gen[key]++;
+	if (! kv_put(key, kv_demo_value(key), kv_demo_len(key)))
+		fatal("KV full");
+	return kv_demo_len(key);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Check every key of the KV Demo
+ * 	@note
+ * 		Before mounting again, this takes the store's statistics, times
+ * 		the gets, then deletes key 0.
+ *	@param[in] mounted
+ *		Key 0 has been deleted, and must not be found
+ *	@return true if all values are as last put
+ ******************************************************************************/
+static bool kv_demo_check(bool mounted)
+{
+	uint64_t start;
+	bool ok = true;
+	uint32_t key;
+	size_t len;
+
+	if (! mounted)
+		kv_get_stats(& kv_demo_stats);
+	start = RTCDRV_GetWallClockTicks64();
+	for (key = 0; ok && (key < KV_DEMO_KEYS); key++)
+	{
+		if ((mounted && (key == 0)) || ! kv_demo_gen[key])
+			ok = ! kv_get(key, buf2, sizeof(buf2), & len);
+		else
+			ok = kv_get(key, buf2, sizeof(buf2), & len) && (len == kv_demo_len(key)) &&
+				 (memcmp(buf2, kv_demo_value(key), len) == 0);
+	}
+	if (! mounted)
+	{
+		kv_demo_get_us = RTCDRV_TicksToMsec(((RTCDRV_GetWallClockTicks64() - start) * 1000) / KV_DEMO_KEYS);
+		if (! kv_delete(0))
+			fatal("KV full");
+	}
+	return ok;
+}
+
+static void kv_demo_mount(void)
+{
+	if (! kv_mount(0, kv_demo_region, erase_size, use_so))
+		fatal("KV error");
+}
+
+static uint32_t kv_demo_report(const store_demo_result_t *r)
+{
+	const kv_stats_t *stats = & kv_demo_stats;
+	kv_stats_t mount_stats;
+
+	kv_get_stats(& mount_stats);
+	printf("\r\n%s KV store, %" PRIu32 " x %" PRIu32 " byte units, %" PRIu32 " keys\r\n",
+		   spiflash_info_table[part].name, stats->unit_count, stats->unit_size, stats->keys);
+	printf("put      %" PRIu32 " us mean, %" PRIu32 " us max\r\n", r->mean_op_us, r->max_op_us);
+	printf("get      %" PRIu32 " us mean\r\n", kv_demo_get_us);
+	printf("gc       %" PRIu32 " runs, %" PRIu32 " ms, %" PRIu32 " ms max, %" PRIu32 " bytes copied\r\n",
+		   stats->gc_runs, RTCDRV_TicksToMsec(stats->gc_ticks), RTCDRV_TicksToMsec(stats->gc_max_ticks),
+		   stats->gc_copied_bytes);
+	printf("copying  %" PRIu32 " runs, %" PRIu32 " ms max\r\n",
+		   stats->gc_copy_runs, RTCDRV_TicksToMsec(stats->gc_copy_max_ticks));
+	printf("erases   %" PRIu32 " to %" PRIu32 " per unit\r\n", stats->erase_count_min, stats->erase_count_max);
+	printf("mount    %" PRIu32 " us, %" PRIu32 " reads\r\n", r->mount_us, mount_stats.mount_reads);
+	return r->mean_op_us;
+}
+
+static const store_demo_t kv_demo =
+{
+	.message_text = "KV dn",
+	.format       = kv_demo_format,
+	.op           = kv_demo_put,
+	.check        = kv_demo_check,
+	.mount        = kv_demo_mount,
+	.report       = kv_demo_report,
+};
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs the KV Store Demo from Main Menu
+ * 	@note
+ * 		Formats a key-value store of up to 16 erase units of the configured
+ * 		erase size, and puts the slider's number of values, to two hot
+ * 		keys but for up to 62 cold keys, each put once. The cold keys fill
+ * 		about a quarter of the store and are spread over its first fill,
+ * 		so once the units fill, collection copies their live entries.
+ * 		Every key is then read back, one is deleted, and the store is
+ * 		mounted again and checked. Put and get latency, the longest put
+ * 		(which includes any collection), mount time, collection counts,
+ * 		time and bytes copied, the longest collection which copied, and
+ * 		erase counts are printed on the serial port. Displays the mean put
+ * 		latency, in microseconds.
+ ******************************************************************************/
+void run_kv(void)
+{
+	run_store_demo(& kv_demo);
+}
+
+#define FTL_DEMO_UNIT_BLOCKS 8   // least unit size, in logical blocks
+#define FTL_DEMO_FILL_PCT    75  // of the slots not kept spare
+#define FTL_DEMO_PASSES      4   // random writes, in multiples of the block count
+
+static uint8_t ftl_demo_gen[FTL_MAX_BLOCKS];  // writes of each block so far
+static uint32_t ftl_demo_block_size;
+static uint32_t ftl_demo_block_count;
+static uint32_t ftl_demo_unit_size;
+static uint32_t ftl_demo_unit_count;
+static uint32_t ftl_demo_rand;
+static ftl_stats_t ftl_demo_fill_stats;  // after every block is written once
+static ftl_stats_t ftl_demo_stats;       // after the random writes
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Data for a logical block in the FTL Demo, from its number and generation
+ *	@param[in] block
+ *		Logical block
+ *	@return Pointer into buf1
+ ******************************************************************************/
+static const uint8_t *ftl_demo_data(uint32_t block)
+{
+	return & buf1[(block * 61 + ftl_demo_gen[block] * 29) % (BUFFER_SIZE - ftl_demo_block_size)];
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Format the FTL Demo's FTL and write every block in order
+ *	@return false if the part is too small for it
+ ******************************************************************************/
+static bool ftl_demo_format(void)
+{
+	uint32_t device_size = spiflash_info_table[part].device_size;
+	uint32_t block;
+
+	if (erase_size >= device_size)
+		fatal("ERA SZ too big for FTL");
+
+	ftl_demo_block_size = slider_get_choice(state_slider_position[state]);
+	ftl_demo_unit_size = erase_size;
+	if (ftl_demo_unit_size < (FTL_DEMO_UNIT_BLOCKS * ftl_demo_block_size))
+		ftl_demo_unit_size = FTL_DEMO_UNIT_BLOCKS * ftl_demo_block_size;
+	ftl_demo_unit_count = device_size / ftl_demo_unit_size;
+	if (ftl_demo_unit_count > FTL_MAX_UNITS)
+		ftl_demo_unit_count = FTL_MAX_UNITS;
+	if (ftl_demo_unit_count < FTL_MIN_UNITS)
+		return false;
+	ftl_demo_block_count = ((ftl_demo_unit_count - 2) * ftl_slots_per_unit(ftl_demo_unit_size, ftl_demo_block_size) *
+			                FTL_DEMO_FILL_PCT) / 100;
+	if (ftl_demo_block_count > FTL_MAX_BLOCKS)
+		ftl_demo_block_count = FTL_MAX_BLOCKS;
+
+	memset(ftl_demo_gen, 0, sizeof(ftl_demo_gen));
+	ftl_demo_rand = 1;
+
+	if (! ftl_format(0, ftl_demo_unit_count * ftl_demo_unit_size, ftl_demo_unit_size,
+			         ftl_demo_block_size, ftl_demo_block_count, use_so))
+		fatal("FTL error");
+	for (block = 0; block < ftl_demo_block_count; block++)
+		if (! ftl_write(block, ftl_demo_data(block)))
+			fatal("FTL error");
+	ftl_get_stats(& ftl_demo_fill_stats);
+	return true;
+}
+
+static size_t ftl_demo_write(uint32_t i)
+{
+	uint32_t block;
+
+	if (i >= (FTL_DEMO_PASSES * ftl_demo_block_count))
+		return 0;
+	ftl_demo_rand = ftl_demo_rand * 1103515245 + 12345;
+	block = (ftl_demo_rand >> 16) % ftl_demo_block_count;
+	ftl_demo_gen[block]++;
+	if (! ftl_write(block, ftl_demo_data(block)))
+		fatal("FTL error");
+	return ftl_demo_block_size;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Check every logical block of the FTL Demo
+ *	@param[in] mounted
+ *		Mounted again; if not, the FTL's statistics are taken first
+ *	@return true if all blocks are as last written
+ ******************************************************************************/
+static bool ftl_demo_check(bool mounted)
+{
+	uint32_t block;
+
+	if (! mounted)
+		ftl_get_stats(& ftl_demo_stats);
+	for (block = 0; block < ftl_demo_block_count; block++)
+		if (! ftl_read(block, buf2) || (memcmp(buf2, ftl_demo_data(block), ftl_demo_block_size) != 0))
+			return false;
+	return true;
+}
+
+static void ftl_demo_mount(void)
+{
+	if (! ftl_mount(0, ftl_demo_unit_count * ftl_demo_unit_size, ftl_demo_unit_size,
+			        ftl_demo_block_size, ftl_demo_block_count, use_so))
+		fatal("FTL error");
+}
+
+static uint32_t ftl_demo_report(const store_demo_result_t *r)
+{
+	const ftl_stats_t *stats = & ftl_demo_stats;
+	uint32_t wa = r->bytes ? (uint32_t) (((stats->bytes_programmed - ftl_demo_fill_stats.bytes_programmed) * 100) / r->bytes) : 0;
+	uint32_t iops = r->ms ? ((r->ops * 1000) / r->ms) : 0;
+	ftl_stats_t mount_stats;
+
+	ftl_get_stats(& mount_stats);
+	printf("\r\n%s FTL, %" PRIu32 " x %" PRIu32 " byte units of %" PRIu32 " slots, %" PRIu32 " x %" PRIu32 " byte blocks\r\n",
+		   spiflash_info_table[part].name, stats->unit_count, stats->unit_size, stats->slots_per_unit,
+		   ftl_demo_block_count, ftl_demo_block_size);
+	printf("random   %" PRIu32 " writes, %" PRIu32 " ms, %" PRIu32 " IOPS\r\n", r->ops, r->ms, iops);
+	printf("WA       %" PRIu32 ".%02" PRIu32 ", %" PRIu32 " blocks copied\r\n",
+		   wa / 100, wa % 100, stats->gc_copies - ftl_demo_fill_stats.gc_copies);
+	printf("gc       %" PRIu32 " units, %" PRIu32 " writes waited, %" PRIu32 " ms max\r\n",
+		   stats->gc_units, stats->gc_blocking, RTCDRV_TicksToMsec(stats->gc_max_ticks));
+	printf("erases   %" PRIu32 " to %" PRIu32 " per unit\r\n", stats->erase_count_min, stats->erase_count_max);
+	printf("mount    %" PRIu32 " us, %" PRIu32 " reads\r\n", r->mount_us, mount_stats.mount_reads);
+	return iops;
+}
+
+static const store_demo_t ftl_demo =
+{
+	.message_text = "FTL dn",
+	.format       = ftl_demo_format,
+	.op           = ftl_demo_write,
+	.check        = ftl_demo_check,
+	.mount        = ftl_demo_mount,
+	.report       = ftl_demo_report,
+};
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs the FTL Demo from Main Menu
+ * 	@note
+ * 		The slider sets the logical block size. Formats an FTL over up to
+ * 		32 units of the configured erase size, or of 8 logical blocks if
+ * 		that is larger, with the logical blocks filling 75% of the slots not
+ * 		kept spare. Writes every block in order, then four times as many
+ * 		writes to random blocks, and checks every block before and after
+ * 		mounting again. The random writes' IOPS and write amplification
+ * 		(bytes programmed, including metadata and garbage collection, over
+ * 		bytes written), collection counts and mount time are printed on the
+ * 		serial port. Displays the random write IOPS.
+ ******************************************************************************/
+void run_ftl(void)
+{
+	run_store_demo(& ftl_demo);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Read or write one workload request, through the data buffers
+ *	@param[in] *op
+ *		Read or write request, up to WORKLOAD_MAX_SIZE bytes
+ ******************************************************************************/
+static void workload_transfer(const workload_op_t *op)
+{
+	uint32_t offset;
+	uint32_t len;
+
+	for (offset = 0; offset < op->len; offset += len)
+	{
+		len = op->len - offset;
+		if (len > sizeof(buf1))
+			len = sizeof(buf1);
+		if (op->type == WORKLOAD_OP_READ)
+			spiflash_read(op->addr + offset, len, buf2, NULL, NULL);
+		else
+			spiflash_write(op->addr + offset, len, buf1, use_so, NULL, NULL);
+	}
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs the Workload Demo from Main Menu
+ * 	@note
+ * 		Runs requests from the workload generator, as set up by DIST,
+ * 		RD PCT, ER PCT, REQ MIN, REQ MAX and SEED in the CONFIG menu, until
+ * 		the slider's KiB have been read and written. Erases are of the
+ * 		ERA SZ size. Data is not verified, since writes land on data that
+ * 		was not erased. The serial report has the generator's operation
+ * 		count and hash, to check that a run on the host build did the
+ * 		same operations.
+ ******************************************************************************/
+void run_workload(void)
+{
+	uint32_t slider = slider_get_choice(state_slider_position[state]);
+	uint32_t size = 1024 * slider;
+	uint32_t device_size = spiflash_info_table[part].device_size;
+	uint32_t count = 0;
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint64_t op_start;
+	workload_op_t op;
+
+	init_buffer(0, BUFFER_SIZE, 0xdeadbeef);
+
+	workload_init(& workload_config, device_size, erase_size);
+	while (count < size)
+	{
+		workload_next(& op);
+		op_start = bench_op_start();
+		if (op.type == WORKLOAD_OP_ERASE)
+		{
+			if (! spiflash_erase(op.addr, op.len, op.len, use_so, NULL, NULL))
+				fatal("erase error");
+		}
+		else
+		{
+			workload_transfer(& op);
+			count += op.len;
+		}
+		bench_op_done(op_start, op.len);
+	}
+
+	duration = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+
+	message_text = "Wl dn";
+	message_number = slider;
+	message_return_state = state;
+	state = state_message;
+}
+
+#define LOG_PAGES 64
+
+static volatile bool log_sample_ready;
+static volatile uint32_t log_in_flight;
+
+static void log_sample_callback(RTCDRV_TimerID_t id, void *user)
+{
+	(void) id;
+	(void) user;
+
+	log_sample_ready = true;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Logger page write completion, called from interrupt context
+ *	@param[in] *op
+ *		Completed operation descriptor
+ ******************************************************************************/
+static void log_write_done(spiflash_op_t *op)
+{
+	bench_op_done(queue_bench_op_start[op - queue_bench_ops], op->len);
+	log_in_flight--;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs the Logger Demo from Main Menu
+ * 	@note
+ * 		Logs LOG_PAGES program pages, one per sensor sample. Each sample
+ * 		takes a conversion of the slider's milliseconds, timed by the RTC,
+ * 		before its page can be written. Without QUE, each page is written
+ * 		synchronously, so the next conversion only starts once it is
+ * 		programmed. With QUE, the page is submitted to the operation queue
+ * 		and the next conversion starts at once, overlapping the programming,
+ * 		with up to QUEUE_BENCH_DEPTH pages in flight.
+ ******************************************************************************/
+void run_log(void)
+{
+	uint32_t slider = slider_get_choice(state_slider_position[state]);
+	uint32_t program_page_size = spiflash_info_table[part].program_page_size;
+	uint32_t addr = 0;
+	uint64_t start = RTCDRV_GetWallClockTicks64();
+	uint64_t op_start;
+	spiflash_op_t *op;
+	uint32_t page;
+	uint32_t slot;
+
+	log_in_flight = 0;
+	for (page = 0; page < LOG_PAGES; page++)
+	{
+		log_sample_ready = false;
+		RTCDRV_StartTimer(xTimerForWakeUp, rtcdrvTimerTypeOneshot, slider, log_sample_callback, NULL);
+		while (! log_sample_ready)
+			enter_low_power_state();
+
+		if (! use_queue)
+		{
+			init_buffer(0, program_page_size, addr);
+			op_start = bench_op_start();
+			spiflash_write(addr, program_page_size, buf1, use_so, NULL, NULL);
+			bench_op_done(op_start, program_page_size);
+		}
+		else
+		{
+			// pages complete in order, so the oldest slot is free first
+			while (log_in_flight == QUEUE_BENCH_DEPTH)
+				enter_low_power_state();
+			slot = page % QUEUE_BENCH_DEPTH;
+			init_buffer(slot * program_page_size, program_page_size, addr);
+
+			op = & queue_bench_ops[slot];
+			memset(op, 0, sizeof(*op));
+			op->type = SPIFLASH_OP_WRITE;
+			op->priority = SPIFLASH_PRIO_NORMAL;
+			op->addr = addr;
+			op->len = program_page_size;
+			op->buffer = & buf1[slot * program_page_size];
+			op->use_so_irq = use_so;
+			op->completion = log_write_done;
+
+			INT_Disable();
+			log_in_flight++;
+			INT_Enable();
+			queue_bench_op_start[slot] = bench_op_start();
+			spiflash_queue_submit(op);
+		}
+		addr += program_page_size;
+	}
+	spiflash_queue_wait_idle();
+
+	duration = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
+
+	message_text = "LOG dn";
+	message_number = slider;
+	message_return_state = state;
+	state = state_message;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Format an erase size for display, e.g. "256b", "4K" or "Chip"
+ *	@param[in] size
+ *		Erase size in bytes
+ *	@param[out] *label
+ *		Buffer for label
+ *	@param[in] label_size
+ *		Size of label buffer
+ ******************************************************************************/
+static void erase_size_label(uint32_t size, char *label, size_t label_size)
+{
+	if (size == spiflash_info_table[part].device_size)
+		snprintf(label, label_size, "Chip");
+	else if (size < 1024)
+		snprintf(label, label_size, "%" PRIu32 "b", size);
+	else
+		snprintf(label, label_size, "%" PRIu32 "K", size >> 10);
+}
+
+static char cal_msg[80];
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs Erase Calibration from Main Menu
+ * 	@note
+ * 		Times every erase size of the part over the start of the flash, and
+ * 		chip erase too if the slider is set to 1. The resulting ns/byte
+ * 		table is printed on the serial port and scrolled on the LCD. From
+ * 		then on, automatic erase size selection uses the cheapest mix of
+ * 		erase commands.
+ ******************************************************************************/
+void run_calibrate(void)
+{
+	uint32_t slider = slider_get_choice(state_slider_position[state]);
+	const spiflash_info_t *info = & spiflash_info_table[part];
+	uint32_t ns_per_byte[MAX_ERASE_SIZES];
+	bool preferred[MAX_ERASE_SIZES];
+	char label[12];  // up to "4194303K"
+	size_t n;
+	int i;
+
+	if (! spiflash_erase_calibrate(0, slider != 0, use_so))
+		fatal("calibration error");
+	spiflash_get_erase_calibration(ns_per_byte, preferred);
+
+	demo_serial_open();
+	printf("\r\n%s erase calibration\r\n", info->name);
+	printf("size     ns/byte  auto\r\n");
+
+	n = snprintf(cal_msg, sizeof(cal_msg), "CAL NS/B");
+	for (i = 0; i < info->erase_info_count; i++)
+	{
+		erase_size_label(info->erase_info[i].size, label, sizeof(label));
+		if (! ns_per_byte[i])
+		{
+			printf("%-6s         -     -\r\n", label);
+			continue;
+		}
+		printf("%-6s %9" PRIu32 "     %c\r\n", label, ns_per_byte[i], preferred[i] ? 'Y' : 'N');
+		if (n < sizeof(cal_msg))
+			n += snprintf(cal_msg + n, sizeof(cal_msg) - n, " %s %" PRIu32, label, ns_per_byte[i]);
+	}
+	demo_serial_close();
+
+	message_text = cal_msg;
+	message_number = slider;
+	message_return_state = state;
+	state = state_message;
+}
+
+#define PROT_REGION_SIZE (100 * 1024)
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Unprotect or protect the PROT demo region one sector at a time
+ * 	@note
+ * 		What a caller without the driver's protection sector map has to do:
+ * 		step through the region by the smallest sector size, and send a
+ * 		command for each step, whatever the current state of the sector.
+ *	@param[in] protect
+ *		True/False
+ *	@param[in] addr
+ *		Start address of region
+ ******************************************************************************/
+static void prot_region_by_step(bool protect, uint32_t addr)
+{
+	const spiflash_info_t *info = & spiflash_info_table[part];
+	uint32_t step = info->protection_sector_sizes[0];
+	uint32_t offset;
+	unsigned int i;
+
+	for (i = 1; i < info->protection_sector_count; i++)
+		if (info->protection_sector_sizes[i] < step)
+			step = info->protection_sector_sizes[i];
+
+	for (offset = 0; offset < PROT_REGION_SIZE; offset += step)
+		spiflash_set_sector_protection(protect, addr + offset, NULL, NULL);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Runs Protection Demo from Main Menu
  * 	@note
- * 		Looks up Device Size from Serial Memory Table
+ * 		Unprotects a 100 KB region at the top of the protectable area of a
+ * 		fully protected part, writes it, and protects it again. With the
+ * 		slider set to 0, protection commands are sent for every step of the
+ * 		smallest sector size; with 1, the driver's protection manager sends
+ * 		only the commands needed. Displays the time taken to unprotect and
+ * 		protect, in microseconds, without the write between them.
  ******************************************************************************/
-//TODO There is not an Erase that is occurring in the Application Demo??
-//TODO Compare to older versions
-void run_appl(void)
+void run_prot(void)
 {
 	uint32_t slider = slider_get_choice(state_slider_position[state]);
-	uint32_t size = 1024 * slider;
+	const spiflash_info_t *info = & spiflash_info_table[part];
+	uint32_t prot_end = 0;
 	uint32_t addr;
-	uint32_t device_size = spiflash_info_table[part].device_size;
-	uint32_t bytes_per_iter;
-	bool read_status;
+	uint32_t offset;
+	uint64_t start;
+	uint64_t prot_ticks;
+	unsigned int i;
+
+	for (i = 0; i < info->protection_sector_count; i++)
+		prot_end += info->protection_sector_sizes[i];
+	if (prot_end < PROT_REGION_SIZE)
+	{
+		message_text = "No prot";
+		message_number = slider;
+		message_return_state = state;
+		state = state_message;
+		return;
+	}
+	addr = prot_end - PROT_REGION_SIZE;
 
-	if (size > device_size)
-		bytes_per_iter = device_size;
+	init_buffer(0, BUFFER_SIZE, 0xdeadbeef);
+	spiflash_set_global_protect(true, NULL, NULL);
+
+	start = RTCDRV_GetWallClockTicks64();
+
+	if (slider)
+		spiflash_set_range_protection(false, addr, PROT_REGION_SIZE);
 	else
-		bytes_per_iter = size;
+		prot_region_by_step(false, addr);
+	prot_ticks = RTCDRV_GetWallClockTicks64() - start;
 
-	addr = 0;
-	while (size)
+	for (offset = 0; offset < PROT_REGION_SIZE; offset += sizeof(buf1))
 	{
-		data_written_byte_count = 0;
-		appl_write(bytes_per_iter);
-		read_status = appl_read(bytes_per_iter);
-		if (! read_status)
-		{
-			message_number = addr / spiflash_info_table[part].program_page_size;
-			if (message_number > 9999)
-				message_number = 9999;
-			break;
-		}
-		size -= bytes_per_iter;
-		addr += bytes_per_iter;
+		uint32_t len = PROT_REGION_SIZE - offset;
+		if (len > sizeof(buf1))
+			len = sizeof(buf1);
+		spiflash_write(addr + offset, len, buf1, use_so, NULL, NULL);
 	}
 
-	if (read_status)
-	{
-		message_text = "Appl dn";
-		message_number = slider;
-	}
+	prot_ticks -= RTCDRV_GetWallClockTicks64();
+	if (slider)
+		spiflash_set_range_protection(true, addr, PROT_REGION_SIZE);
 	else
-	{
-		message_text = "ReadErr";
-	}
+		prot_region_by_step(true, addr);
+	prot_ticks += RTCDRV_GetWallClockTicks64();
+
+	duration = RTCDRV_TicksToMsec(RTCDRV_GetWallClockTicks64() - start);
 
+	message_text = "PROT us";
+	message_number = RTCDRV_TicksToMsec(prot_ticks * 1000);
+	if (message_number > 9999)
+		message_number = 9999;
 	message_return_state = state;
 	state = state_message;
 }
@@ -1104,7 +3063,8 @@ void run_powerdn(void)
 	if(slider == 0){
 		spiflash_deep_power_down(true, NULL, NULL);
 		oneshot_start_s(1);
-		while( ! oneshot_done() );
+		while( ! oneshot_done() )
+			enter_low_power_state();
 		EMU_EnterEM3(true);
 		message_text = "DPD dn";
 		spiflash_deep_power_down(false, NULL, NULL);
@@ -1112,7 +3072,8 @@ void run_powerdn(void)
 	else{
 		spiflash_ultra_deep_power_down(true, NULL, NULL);
 		oneshot_start_s(1);
-		while( ! oneshot_done() );
+		while( ! oneshot_done() )
+			enter_low_power_state();
 		EMU_EnterEM3(true);
 		message_text = "UDPD dn";
 		spiflash_ultra_deep_power_down(false, NULL, NULL);
@@ -1123,6 +3084,83 @@ void run_powerdn(void)
 	state = state_message;
 }
 
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Skips the SPI trace item unless built with SPI_TRACE
+ *
+ ******************************************************************************/
+void enter_trace(void)
+{
+	if (! SPI_TRACE)
+	{
+		state++;
+		return;
+	}
+	enter_default();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Sends the SPI trace of the last demo over serial
+ * 	@note
+ * 		The trace is binary, for tools/spi_trace.py. Displays the number of
+ * 		transactions sent.
+ *
+ ******************************************************************************/
+void button1_trace(void)
+{
+	demo_serial_open();
+	message_number = spi_trace_dump();
+	demo_serial_close();
+
+	message_text = "TR sent";
+	message_return_state = state;
+	state = state_message;
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Displays whether the serial console is open
+ *
+ ******************************************************************************/
+void display_console(void)
+{
+	char *s;
+	if (console_is_open())
+		s = "CON   Y";
+	else
+		s = "CON   N";
+	SegmentLCD_Write(s);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: Calls function to display console Y/N on LCD
+ *
+ ******************************************************************************/
+void enter_console(void)
+{
+	display_console();
+	SegmentLCD_NumberOff();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		Demo Menu: PB1 opens or closes the serial console
+ * 	@note
+ * 		While open, the console takes commands on the serial port in any
+ * 		menu state. Type "help" for the commands.
+ *
+ ******************************************************************************/
+void button1_console(void)
+{
+	if (console_is_open())
+		console_close();
+	else
+		console_open();
+	display_console();
+}
+
 /***************************************************************************//**
  * 	@brief
  * 		Demo Menu: Runs Serial Output Demo from Main Menu
@@ -1214,7 +3252,7 @@ void numeric_choices_init_conf_erase_size(void)
 	{
 		int32_t choice = numeric_choices[state][i];
 		if (((erase_size < 1024) && (choice == 0)) ||
-		    ((erase_size >= 1024) && (choice == erase_size >> 10)))
+		    ((erase_size >= 1024) && (choice == (int32_t) (erase_size >> 10))))
 		{
 			state_slider_position[state] = slider_threshold[i] - 1;
 			break;
@@ -1284,6 +3322,243 @@ void button1_conf_verify(void)
 	display_conf_verify();
 }
 
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Displays whether WRITE and READ use the operation queue
+ * 	@note
+ * 		With the queue, several page requests are kept in flight and each
+ * 		is started from the completion of the previous one. Without it,
+ * 		each page is a synchronous driver call. WRITE and READ display the
+ * 		throughput in KiB/s, so the two can be compared. Verify always uses
+ * 		the synchronous calls.
+ *
+ ******************************************************************************/
+void display_conf_queue(void)
+{
+	char *s;
+	if (use_queue)
+		s = "QUE   Y";
+	else
+		s = "QUE   N";
+	SegmentLCD_Write(s);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Calls function to display Queue Y/N on LCD
+ *
+ ******************************************************************************/
+void enter_conf_queue(void)
+{
+	display_conf_queue();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: PB1 toggles between Queue Enable/Disable
+ *
+ ******************************************************************************/
+void button1_conf_queue(void)
+{
+	use_queue = ! use_queue;
+	display_conf_queue();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Displays whether WRITE uses a write data source
+ * 	@note
+ * 		With a data source, WRITE generates each page while the previous
+ * 		page is programming. Without it, pages are generated (if verify is
+ * 		enabled) and written one at a time. Takes precedence over QUE for
+ * 		WRITE.
+ *
+ ******************************************************************************/
+void display_conf_pull(void)
+{
+	char *s;
+	if (use_pull)
+		s = "PULL  Y";
+	else
+		s = "PULL  N";
+	SegmentLCD_Write(s);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Calls function to display Pull Y/N on LCD
+ *
+ ******************************************************************************/
+void enter_conf_pull(void)
+{
+	display_conf_pull();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: PB1 toggles between Pull Enable/Disable
+ *
+ ******************************************************************************/
+void button1_conf_pull(void)
+{
+	use_pull = ! use_pull;
+	display_conf_pull();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Displays whether demo results show energy or throughput
+ * 	@note
+ * 		With energy, the LCD number after a demo is the estimated MCU
+ * 		energy per KiB, from the time spent in each energy mode. Compare
+ * 		e.g. WRITE with SO set and not set. The serial report has both.
+ *
+ ******************************************************************************/
+void display_conf_energy(void)
+{
+	char *s;
+	if (show_energy)
+		s = "NRG   Y";
+	else
+		s = "NRG   N";
+	SegmentLCD_Write(s);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Calls function to display Energy Y/N on LCD
+ *
+ ******************************************************************************/
+void enter_conf_energy(void)
+{
+	display_conf_energy();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: PB1 toggles between energy and throughput results
+ *
+ ******************************************************************************/
+void button1_conf_energy(void)
+{
+	show_energy = ! show_energy;
+	display_conf_energy();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Gets user selected number of runs per demo
+ * 	@note
+ * 		The demo is run that many times for each PB1 press, and the
+ * 		benchmark result covers all of them.
+ *
+ ******************************************************************************/
+void leave_conf_iter(void)
+{
+	bench_iterations = slider_get_choice(state_slider_position[state_conf_iter]);
+	SegmentLCD_NumberOff();
+}
+
+static char dist_msg[8];
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Displays the workload address distribution
+ *
+ ******************************************************************************/
+void display_conf_dist(void)
+{
+	snprintf(dist_msg, sizeof(dist_msg), "DI %s", workload_dist_name(workload_config.dist));
+	SegmentLCD_Write(dist_msg);
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Calls function to display the distribution on LCD
+ *
+ ******************************************************************************/
+void enter_conf_dist(void)
+{
+	display_conf_dist();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: PB1 steps through the workload address distributions
+ * 	@note
+ * 		SEQ: each request follows the last. UNI: uniform random. ZIPF: a
+ * 		few areas get most requests. HOT: 90% of requests go to 10% of
+ * 		the flash.
+ *
+ ******************************************************************************/
+void button1_conf_dist(void)
+{
+	workload_config.dist = (workload_config.dist + 1) % WORKLOAD_DIST_COUNT;
+	display_conf_dist();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Gets user selected percentage of workload reads
+ *
+ ******************************************************************************/
+void leave_conf_read_pct(void)
+{
+	workload_config.read_pct = slider_get_choice(state_slider_position[state_conf_read_pct]);
+	SegmentLCD_NumberOff();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Gets user selected percentage of workload erases
+ * 	@note
+ * 		Requests which neither read nor erase write.
+ *
+ ******************************************************************************/
+void leave_conf_erase_pct(void)
+{
+	workload_config.erase_pct = slider_get_choice(state_slider_position[state_conf_erase_pct]);
+	SegmentLCD_NumberOff();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Gets user selected smallest workload request
+ * 	@note
+ * 		Shown as a power of two, 0 for 1 byte to 16 for 64 KiB. Request
+ * 		sizes are uniformly distributed from REQ MIN to REQ MAX.
+ *
+ ******************************************************************************/
+void leave_conf_req_min(void)
+{
+	workload_config.min_size = 1 << slider_get_choice(state_slider_position[state_conf_req_min]);
+	SegmentLCD_NumberOff();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Gets user selected largest workload request
+ * 	@note
+ * 		Shown as a power of two, as for REQ MIN.
+ *
+ ******************************************************************************/
+void leave_conf_req_max(void)
+{
+	workload_config.max_size = 1 << slider_get_choice(state_slider_position[state_conf_req_max]);
+	SegmentLCD_NumberOff();
+}
+
+/***************************************************************************//**
+ * 	@brief
+ * 		CONFIG Menu: Gets user selected workload random seed
+ *
+ ******************************************************************************/
+void leave_conf_seed(void)
+{
+	workload_config.seed = slider_get_choice(state_slider_position[state_conf_seed]);
+	SegmentLCD_NumberOff();
+}
+
 /***************************************************************************//**
  * 	@brief
  * 		CONFIG Menu: User Selection for SPI Clock Frequency.  User can select
@@ -1340,7 +3615,11 @@ void button1_cfg_done(void)
  ******************************************************************************/
 void enter_message(void)
 {
-	SegmentLCD_Write(message_text);
+	// messages too long for the display are scrolled by idle_default()
+	if (strlen(message_text) > 7)
+		lcd_scroll_start(message_text);
+	else
+		SegmentLCD_Write(message_text);
 	SegmentLCD_Number(message_number);
 }
 
@@ -1358,13 +3637,13 @@ void button1_message(void)
 
 /**************************************************************************//**
  * @brief
- * 		Main function, initializes demo
+ * 		Initializes demo
  * @details
  * 		Configures Clocks, GPIO/GPIO Interrupts for Push-buttons, Configures LEDs,
  * 		initializes Low Power States, Enables LCD, Enables Capsense/Slider, configures
- * 		SPI/spiflash setup, calls main spiflash_demo from while(1)
+ * 		SPI/spiflash setup
  *****************************************************************************/
-int main(void)
+void demo_init(void)
 {
   int i;
 
@@ -1405,11 +3684,29 @@ int main(void)
   CAPLESENSE_Init(true); // Init slider sensing but in sleep
 
   spiflash_setup();		//Configures SPI Port and Reads Flash ID
+  spiflash_queue_init();
+  bench_init();
 
   use_so = false;
   erase_size_choices_initialized = false;
   erase_size = spiflash_smallest_erase_size_above(256);
   do_verify = false;
+  use_queue = false;
+  use_pull = false;
+  show_energy = false;
+  bench_iterations = 1;
+
+  workload_config.dist = WORKLOAD_SEQ;
+  workload_config.read_pct = 70;
+  workload_config.erase_pct = 0;
+  workload_config.min_size = 256;
+  workload_config.max_size = 256;
+  workload_config.hot_pct = 90;
+  workload_config.hot_area_pct = 10;
+  workload_config.seed = 1;
+  slider_preset(state_conf_read_pct, 70);
+  slider_preset(state_conf_req_min, 8);
+  slider_preset(state_conf_req_max, 8);
 
   // if the part is a DataFlash, make sure it is set to 256b pages
   if (dataflash_get_page_size() == 264)
@@ -1424,6 +3721,15 @@ int main(void)
   EM2Sleep(250);
 
   data_written_byte_count = 0;
+}
+
+/**************************************************************************//**
+ * @brief
+ * 		Main function, calls main spiflash_demo from while(1)
+ *****************************************************************************/
+int main(void)
+{
+  demo_init();
 
   while (true)
 	spiflash_demo();
@@ -8,6 +8,7 @@
 #ifndef MAIN_H_
 #define MAIN_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /*****************************************************************************/
@@ -26,6 +27,17 @@ extern uint8_t buf1[BUFFER_SIZE];
 extern uint8_t buf2[BUFFER_SIZE];
 extern uint8_t buf3[BUFFER_SIZE];
 
+extern char *message_text;
+extern int message_number;
+extern int duration;
+
+void demo_init(void);
+bool demo_run_state(const char *name, int32_t choice);
+bool demo_idle_state(const char *name, uint32_t msec);
+bool demo_set_config(const char *name, int32_t value);
+int demo_get_choices(const char *name, int32_t *choices, int max);
+void demo_print_report(void);
+
 /** @} (end addtogroup MAIN) */
 
 #endif /* MAIN_H_ */
@@ -86,6 +86,9 @@ static volatile bool oneshot_done_flag;
  ******************************************************************************/
 static void oneshot_callback(RTCDRV_TimerID_t id, void *user)
 {
+	(void) id;
+	(void) user;
+
 	oneshot_done_flag = true;
 }
 
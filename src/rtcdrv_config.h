@@ -19,7 +19,7 @@
 #define EMDRV_RTCDRV_NUM_TIMERS     (2)
 
 // Uncomment the following line to include the wallclock functionality.
-//#define EMDRV_RTCDRV_WALLCLOCK_CONFIG
+#define EMDRV_RTCDRV_WALLCLOCK_CONFIG
 
 // Uncomment the following line to enable integration with SLEEP driver.
 //#define EMDRV_RTCDRV_SLEEPDRV_INTEGRATION
@@ -33,14 +33,17 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 
 #include "em_cmu.h"
 #include "em_emu.h"
+#include "em_int.h"
 
 // NOTE headers em_leuart.h, em_uart.h, em_usart.h conditionally included later
 
 #include "buffer.h"
 #include "gpio.h"
+#include "low_power.h"
 #include "serial.h"
 
 /***************************************************************************//**
@@ -100,8 +103,10 @@
 #  define STATUS_TXC  LEUART_STATUS_TXC
 #  define IF_RXDATAV  LEUART_IF_RXDATAV
 #  define IF_TXBL     LEUART_IF_TXBL
+#  define IF_TXC      LEUART_IF_TXC
 #  define IEN_RXDATAV LEUART_IEN_RXDATAV
 #  define IEN_TXBL    LEUART_IEN_TXBL
+#  define IEN_TXC     LEUART_IEN_TXC
 #  define INIT_STRUCT LEUART_Init_Typedef
 #  if LEUART_NUM == 0
 #    if SERIAL_LOC == 0
@@ -173,8 +178,10 @@
 #  define STATUS_TXC  UART_STATUS_TXC
 #  define IF_RXDATAV  UART_IF_RXDATAV
 #  define IF_TXBL     UART_IF_TXBL
+#  define IF_TXC      UART_IF_TXC
 #  define IEN_RXDATAV UART_IEN_RXDATAV
 #  define IEN_TXBL    UART_IEN_TXBL
+#  define IEN_TXC     UART_IEN_TXC
 #  if UART_NUM == 0
 #    if SERIAL_LOC == 0
 #      define RX_PORT gpioPortF
@@ -247,8 +254,10 @@
 #  define STATUS_TXC  USART_STATUS_TXC
 #  define IF_RXDATAV  USART_IF_RXDATAV
 #  define IF_TXBL     USART_IF_TXBL
+#  define IF_TXC      USART_IF_TXC
 #  define IEN_RXDATAV USART_IEN_RXDATAV
 #  define IEN_TXBL    USART_IEN_TXBL
+#  define IEN_TXC     USART_IEN_TXC
 #  if USART_NUM == 0
 #    define serial_cmuClock cmuClock_USART0
 #    if SERIAL_LOC == 0
@@ -325,47 +334,210 @@
 #endif
 /** @endcond */
 
+/**************************************************************************//**
+ * @verbatim
+ *	FAST_USART_NUM and FAST_SERIAL_LOC, if defined, select a USART and
+ *	location which serial_switch() can move to at run time, for rates
+ *	the console port can't reach. Only the port in use drives its TX
+ *	pin; the other's is disabled, with a pull-up.
+ * @endverbatim
+*************************************************************************/
+
+/** @cond DO_NOT_INCLUDE_WITH_DOXYGEN */
+#if defined(FAST_USART_NUM)
+#  if defined(USART_NUM) && (USART_NUM == FAST_USART_NUM)
+#    error "In serial.h, FAST_USART_NUM must not be the console port."
+#  endif
+#  if ! defined(USART_NUM)
+#    include "em_usart.h"
+#  endif
+#  define FPORT                       PASTE(USART, FAST_USART_NUM)
+#  define FAST_TX_IRQn                PASTE3(USART, FAST_USART_NUM, _TX_IRQn)
+#  define FAST_RX_IRQn                PASTE3(USART, FAST_USART_NUM, _RX_IRQn)
+#  define FAST_TX_IRQHandler          PASTE3(USART, FAST_USART_NUM, _TX_IRQHandler)
+#  define FAST_RX_IRQHandler          PASTE3(USART, FAST_USART_NUM, _RX_IRQHandler)
+#  define fast_cmuclock               PASTE(cmuClock_USART, FAST_USART_NUM)
+#  define FAST_STATUS_TXC  USART_STATUS_TXC
+#  define FAST_IF_RXDATAV  USART_IF_RXDATAV
+#  define FAST_IF_TXBL     USART_IF_TXBL
+#  define FAST_IF_TXC      USART_IF_TXC
+#  define FAST_IEN_RXDATAV USART_IEN_RXDATAV
+#  define FAST_IEN_TXBL    USART_IEN_TXBL
+#  define FAST_IEN_TXC     USART_IEN_TXC
+#  if FAST_USART_NUM == 0
+#    if FAST_SERIAL_LOC == 0
+#      define FAST_RX_PORT gpioPortE
+#      define FAST_RX_PIN  11
+#      define FAST_TX_PORT gpioPortE
+#      define FAST_TX_PIN  10
+#    elif FAST_SERIAL_LOC == 1
+#      define FAST_RX_PORT gpioPortE
+#      define FAST_RX_PIN  6
+#      define FAST_TX_PORT gpioPortE
+#      define FAST_TX_PIN  7
+#    elif FAST_SERIAL_LOC == 2
+#      define FAST_RX_PORT gpioPortC
+#      define FAST_RX_PIN  10
+#      define FAST_TX_PORT gpioPortC
+#      define FAST_TX_PIN  11
+#    elif FAST_SERIAL_LOC == 3
+#      define FAST_RX_PORT gpioPortE
+#      define FAST_RX_PIN  12
+#      define FAST_TX_PORT gpioPortE
+#      define FAST_TX_PIN  13
+#    elif FAST_SERIAL_LOC == 4
+#      define FAST_RX_PORT gpioPortB
+#      define FAST_RX_PIN  8
+#      define FAST_TX_PORT gpioPortB
+#      define FAST_TX_PIN  7
+#    elif FAST_SERIAL_LOC == 5
+#      define FAST_RX_PORT gpioPortC
+#      define FAST_RX_PIN  1
+#      define FAST_TX_PORT gpioPortC
+#      define FAST_TX_PIN  0
+#    else
+#      error "invalid FAST_SERIAL_LOC for FAST_USART_NUM==0"
+#    endif
+#  elif FAST_USART_NUM == 1
+#    if FAST_SERIAL_LOC == 0
+#      define FAST_RX_PORT gpioPortC
+#      define FAST_RX_PIN  1
+#      define FAST_TX_PORT gpioPortC
+#      define FAST_TX_PIN  0
+#    elif FAST_SERIAL_LOC == 1
+#      define FAST_RX_PORT gpioPortD
+#      define FAST_RX_PIN  1
+#      define FAST_TX_PORT gpioPortD
+#      define FAST_TX_PIN  0
+#    elif FAST_SERIAL_LOC == 2
+#      define FAST_RX_PORT gpioPortD
+#      define FAST_RX_PIN  6
+#      define FAST_TX_PORT gpioPortD
+#      define FAST_TX_PIN  7
+#    else
+#      error "invalid FAST_SERIAL_LOC for FAST_USART_NUM==1"
+#    endif
+#  elif FAST_USART_NUM == 2
+#    if FAST_SERIAL_LOC == 0
+#      define FAST_RX_PORT gpioPortC
+#      define FAST_RX_PIN  3
+#      define FAST_TX_PORT gpioPortC
+#      define FAST_TX_PIN  2
+#    elif FAST_SERIAL_LOC == 1
+#      define FAST_RX_PORT gpioPortB
+#      define FAST_RX_PIN  4
+#      define FAST_TX_PORT gpioPortB
+#      define FAST_TX_PIN  3
+#    else
+#      error "invalid FAST_SERIAL_LOC for FAST_USART_NUM==2"
+#    endif
+#  else
+#    error "invalid FAST_USART_NUM"
+#  endif
+#endif
+/** @endcond */
+
+// The registers and flags of the port in use. Only it has interrupts
+// enabled, so the handlers of both ports can use these.
+#if defined(FAST_USART_NUM)
+static bool serial_fast;  // the fast port is in use, rather than the console port
+#  define PORT_REG(reg) (*(serial_fast ? & FPORT->reg : & SPORT->reg))
+#  define PORT_BIT(bit) (serial_fast ? FAST_##bit : bit)
+#else
+#  define serial_fast   false
+#  define PORT_REG(reg) (SPORT->reg)
+#  define PORT_BIT(bit) (bit)
+#endif
+
+// Largest bit rate error allowed, per mille, leaving the rest of the
+// receiver's tolerance for the host's clock
+#define SERIAL_RATE_ERROR_MAX 20
+
 static buf_t *serial_tx_buf;
 static buf_t *serial_rx_buf;
 
+// serial_blocking_write() waits for this much room, rather than a byte
+#define SERIAL_TX_LOW_WATER 64
+
+static bool serial_tx_nonblocking;  // RETARGET_Write() drops what doesn't fit
+static uint32_t serial_tx_dropped;   // bytes dropped by RETARGET_Write()
+
+static uint32_t serial_bit_rate;  // of the port in use
+
 /***************************************************************************//**
  * @brief
  *   Serial RX IRQ Handler
  *
  ******************************************************************************/
-void SERIAL_RX_IRQHandler(void)
+static void serial_rx_irq(void)
 {
-	if (SPORT->IF & IF_RXDATAV)
+	if (PORT_REG(IF) & PORT_BIT(IF_RXDATAV))
 	{
-		uint8_t data = SPORT->RXDATA;
+		uint8_t data = PORT_REG(RXDATA);
 		buf_write_byte(serial_rx_buf, data);
 		if (buf_full(serial_rx_buf))
-			SPORT->IEN &= ~ IEN_RXDATAV;  // disable rx interrupt
+			PORT_REG(IEN) &= ~ PORT_BIT(IEN_RXDATAV);  // disable rx interrupt
 	}
 }
 
 /***************************************************************************//**
  * @brief
  *   Serial TX IRQ Handler
+ * @note
+ * 		When the TX buffer runs dry, TXBL is swapped for TXC, so that
+ * 		serial_tx_flush() wakes when the last byte has left the shift
+ * 		register. The port is busy while either is enabled.
  *
  ******************************************************************************/
-void SERIAL_TX_IRQHandler(void)
+static void serial_tx_irq(void)
 {
-	if (SPORT->IF & IF_TXBL)
+	if ((PORT_REG(IEN) & PORT_BIT(IEN_TXBL)) && (PORT_REG(IF) & PORT_BIT(IF_TXBL)))
 	{
 		uint8_t data;
 		if (buf_read_byte(serial_tx_buf, & data))
-			SPORT->TXDATA = data;
+			PORT_REG(TXDATA) = data;
 		else
-			SPORT->IEN &= ~ IEN_TXBL;  // disable tx interrupt
+		{
+			PORT_REG(IEN) &= ~ PORT_BIT(IEN_TXBL);  // disable tx interrupt
+			PORT_REG(IFC) = PORT_BIT(IF_TXC);
+			if (! (PORT_REG(STATUS) & PORT_BIT(STATUS_TXC)))
+				PORT_REG(IEN) |= PORT_BIT(IEN_TXC);  // still sending
+		}
+	}
+	if ((PORT_REG(IEN) & PORT_BIT(IEN_TXC)) && (PORT_REG(IF) & PORT_BIT(IF_TXC)))
+	{
+		PORT_REG(IFC) = PORT_BIT(IF_TXC);
+		PORT_REG(IEN) &= ~ PORT_BIT(IEN_TXC);
 	}
 }
 
 #if defined(SERIAL_IRQHandler)
 void SERIAL_IRQHandler(void)
 {
-	SERIAL_RX_IRQHandler();
-	SERIAL_TX_IRQHandler();
+	serial_rx_irq();
+	serial_tx_irq();
+}
+#else
+void SERIAL_RX_IRQHandler(void)
+{
+	serial_rx_irq();
+}
+
+void SERIAL_TX_IRQHandler(void)
+{
+	serial_tx_irq();
+}
+#endif
+
+#if defined(FAST_USART_NUM)
+void FAST_RX_IRQHandler(void)
+{
+	serial_rx_irq();
+}
+
+void FAST_TX_IRQHandler(void)
+{
+	serial_tx_irq();
 }
 #endif
 
@@ -379,10 +551,91 @@ void SERIAL_IRQHandler(void)
 void serial_blocking_write_char(char c)
 {
 	while (! buf_write_char(serial_tx_buf, c))
+		serial_tx_wait(1);
+	PORT_REG(IEN) |= PORT_BIT(IEN_TXBL);  // enable tx if not already going
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read Character from Serial Port - Non-Blocking
+ * @return Character, or -1 if none has been received
+ *
+ ******************************************************************************/
+int serial_read_char(void)
+{
+	uint8_t data;
+
+	if (! buf_read_byte(serial_rx_buf, & data))
+		return -1;
+	PORT_REG(IEN) |= PORT_BIT(IEN_RXDATAV);  // there is room again, if rx was stopped when full
+	return data;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check for Received Data
+ * @return TRUE if serial_read_char() has a character to return
+ ******************************************************************************/
+bool serial_rx_ready(void)
+{
+	return ! buf_empty(serial_rx_buf);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write Data to Serial Port - Non-Blocking
+ * @note
+ * 		Copies whole spans into the TX buffer, and starts the transmitter
+ * 		once for each.
+ * @param[in] *p
+ * 		Pointer to data to write, which may include zero bytes
+ * @param[in] len
+ * 		Length of data
+ * @return Bytes written, less than len if the TX buffer filled
+ *
+ ******************************************************************************/
+size_t serial_write(const uint8_t *p, size_t len)
+{
+	uint8_t *span;
+	size_t done = 0;
+	size_t n;
+
+	while (done < len)
 	{
-		;
+		n = buf_write_span(serial_tx_buf, & span);
+		if (n == 0)
+			break;
+		if (n > len - done)
+			n = len - done;
+		memcpy(span, & p[done], n);
+		buf_write_commit(serial_tx_buf, n);
+		PORT_REG(IEN) |= PORT_BIT(IEN_TXBL);  // enable tx if not already going
+		done += n;
+	}
+	return done;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write Data to Serial Port - Blocking
+ * @param[in] *p
+ * 		Pointer to data to write, which may include zero bytes
+ * @param[in] len
+ * 		Length of data
+ *
+ ******************************************************************************/
+void serial_blocking_write(const uint8_t *p, size_t len)
+{
+	size_t n;
+
+	while (len)
+	{
+		n = serial_write(p, len);
+		p += n;
+		len -= n;
+		if (len)
+			serial_tx_wait(len < SERIAL_TX_LOW_WATER ? len : SERIAL_TX_LOW_WATER);
 	}
-	SPORT->IEN |= IEN_TXBL;  // enable tx if not already going
 }
 
 /***************************************************************************//**
@@ -394,8 +647,7 @@ void serial_blocking_write_char(char c)
  ******************************************************************************/
 void serial_blocking_write_str(const char *p)
 {
-	while (*p)
-		serial_blocking_write_char(*p++);
+	serial_blocking_write((const uint8_t *) p, strlen(p));
 }
 
 /** @cond DO_NOT_INCLUDE_WITH_DOXYGEN */
@@ -447,43 +699,148 @@ USART_InitAsync_TypeDef sportInit =
   .prsRxCh      = usartPrsRxCh0,  /* Select PRS channel if enabled */
 };
 #endif
+
+#if defined(FAST_USART_NUM)
+const gpio_init_t fast_serial_pins[] =
+{
+	{ FAST_TX_PORT, FAST_TX_PIN, gpioModePushPull,  1 },
+	{ FAST_RX_PORT, FAST_RX_PIN, gpioModeInputPull, 1 },
+};
+
+USART_InitAsync_TypeDef fastInit =
+{
+  .enable       = usartEnableRx | usartEnableTx,
+  .refFreq      = 0,
+  .baudrate     = 115200,         /* set by serial_fast_start() */
+  .oversampling = usartOVS16,     /* set by serial_fast_start() */
+  .databits     = usartDatabits8,
+  .parity       = usartNoParity,
+  .stopbits     = usartStopbits1,
+  .mvdis        = false,          /* Disable majority voting */
+  .prsRxEnable  = false,          /* Enable USART Rx via Peripheral Reflex System */
+  .prsRxCh      = usartPrsRxCh0,  /* Select PRS channel if enabled */
+};
+#endif
+
+#if defined(UART_NUM) || defined(USART_NUM) || defined(FAST_USART_NUM)
+static const struct
+{
+	USART_OVS_TypeDef ovs;
+	uint8_t           clocks;  // per bit
+} serial_ovs_table[] =
+{
+	{ usartOVS16, 16 },  // the most tolerant of noise, so tried first
+	{ usartOVS8,   8 },
+	{ usartOVS6,   6 },
+	{ usartOVS4,   4 },
+};
+#endif
 /** @endcond */
 
 /***************************************************************************//**
  * @brief
- *   Reset Serial Port
+ *   Bit Rate Error of a Fractional Divider
+ * @param[in] ref_freq
+ * 		Clock of the port, Hz
+ * @param[in] bit_rate
+ * 		Bit rate wanted, which is ref_freq / (ovs x (1 + CLKDIV / 256))
+ * @param[in] ovs
+ * 		Clocks per bit
+ * @param[in] step
+ * 		Smallest step of CLKDIV
+ * @param[in] div_max
+ * 		Largest CLKDIV
+ * @return Error of the nearest rate the divider makes, per mille, or
+ * 		UINT32_MAX if it can't make one
  *
  ******************************************************************************/
-void serial_close(void)
+static uint32_t serial_rate_error(uint32_t ref_freq,
+		                          uint32_t bit_rate,
+		                          uint32_t ovs,
+		                          uint32_t step,
+		                          uint32_t div_max)
 {
-	serial_reset(SPORT);
+	uint64_t clocks = (uint64_t) ovs * bit_rate;
+	uint64_t div;  // 256 + CLKDIV
+	uint64_t actual;
+
+	if (bit_rate == 0)
+		return UINT32_MAX;
+	div = ((uint64_t) ref_freq * 256 + clocks / 2) / clocks;
+	div = (div + step / 2) / step * step;  // 256 is a multiple of step
+	if ((div < 256) || ((div - 256) > div_max))
+		return UINT32_MAX;
+	actual = (uint64_t) ref_freq * 256 / (ovs * div);
+	return ((actual > bit_rate) ? (actual - bit_rate) : (bit_rate - actual)) * 1000 / bit_rate;
 }
 
+#if defined(UART_NUM) || defined(USART_NUM) || defined(FAST_USART_NUM)
 /***************************************************************************//**
  * @brief
- *   Initialize Serial Port and TX/RX Buffers
+ *   Choose the Oversampling of a UART or USART for a Bit Rate
+ * @param[in] bit_rate
+ * 		Bit rate
+ * @return Index in serial_ovs_table of the most oversampling which gives
+ * 		the rate within SERIAL_RATE_ERROR_MAX, or -1 if none does
+ *
+ ******************************************************************************/
+static int serial_usart_ovs(uint32_t bit_rate)
+{
+	uint32_t ref_freq = CMU_ClockFreqGet(cmuClock_HFPER);
+	unsigned int i;
+
+	for (i = 0; i < sizeof(serial_ovs_table)/sizeof(serial_ovs_table[0]); i++)
+		if (serial_rate_error(ref_freq, bit_rate, serial_ovs_table[i].clocks, 64, 0x1fffc0)
+				<= SERIAL_RATE_ERROR_MAX)
+			return i;
+	return -1;
+}
+#endif
+
+/***************************************************************************//**
+ * @brief
+ *   Called to determine if a port can run at a bit rate
+ * @note
+ * 		The rate of a UART or USART depends on the HF clock, so may change
+ * 		with it.
+ * @param[in] port
+ * 		SERIAL_PORT_CONSOLE or SERIAL_PORT_FAST
+ * @param[in] bit_rate
+ * 		Bit rate
+ * @return TRUE/FALSE
+ *
+ ******************************************************************************/
+bool serial_bit_rate_ok(serial_port_t port, uint32_t bit_rate)
+{
+	if (port == SERIAL_PORT_FAST)
+#if defined(FAST_USART_NUM)
+		return serial_usart_ovs(bit_rate) >= 0;
+#else
+		return false;
+#endif
+#if defined(LEUART_NUM)
+	// the LEUART samples each bit once, from the 32768 Hz LFXO
+	return (bit_rate <= 9600) &&
+		   (serial_rate_error(CMU_ClockFreqGet(serial_cmuclock2), bit_rate, 1, 8, 0x7ff8)
+				   <= SERIAL_RATE_ERROR_MAX);
+#else
+	return serial_usart_ovs(bit_rate) >= 0;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the Console Port
  *  @param[in] bit_rate
- *  	Baud Rate
- *  @param[in] *raw_rx_buf
- *  	Pointer to Receive Buffer
- *  @param[in] raw_rx_buf_size
- *  	Size of RX buffer
- *  @param[in] *raw_tx_buf
- *  	Pointer to Transmit Buffer
- *  @param[in] raw_tx_buf_size
- *  	Size of TX buffer
+ *  	Baud Rate, or 0 for that of sportInit
  *
  ******************************************************************************/
-void serial_init(int bit_rate,
-		         uint8_t *raw_rx_buf,
-		         size_t raw_rx_buf_size,
-		         uint8_t *raw_tx_buf,
-		         size_t raw_tx_buf_size)
+static void serial_console_start(uint32_t bit_rate)
 {
-	serial_rx_buf = init_buf(raw_rx_buf, raw_rx_buf_size);
-	serial_tx_buf = init_buf(raw_tx_buf, raw_tx_buf_size);
+#if ! defined(LEUART_NUM)
+	int i;
+#endif
 
-	CMU_ClockEnable(cmuClock_GPIO, true);
 #ifdef serial_cmuclock1
 	CMU_ClockEnable(serial_cmuclock1, true);
 #endif
@@ -496,11 +853,15 @@ void serial_init(int bit_rate,
 	SPORT->ROUTE = SERIAL_ROUTE_TXPEN | SERIAL_ROUTE_RXPEN | (SERIAL_LOC << SERIAL_ROUTE_LOCATION_SHIFT);
 
 	if (bit_rate)
+	{
 #if defined(LEUART_NUM)
 		serial_baudrateset(SPORT, 0, bit_rate);
 #else
-		serial_baudrateset(SPORT, 0, bit_rate, usartOVS16);
+		i = serial_usart_ovs(bit_rate);
+		serial_baudrateset(SPORT, 0, bit_rate, serial_ovs_table[(i < 0) ? 0 : i].ovs);
 #endif
+	}
+	serial_bit_rate = bit_rate ? bit_rate : sportInit.baudrate;
 
 	serial_intclear(SPORT, IF_RXDATAV | IF_TXBL);
 	serial_intenable(SPORT, IF_RXDATAV);
@@ -514,15 +875,231 @@ void serial_init(int bit_rate,
 #endif
 }
 
+#if defined(FAST_USART_NUM)
+/***************************************************************************//**
+ * @brief
+ *   Start the Fast Port
+ *  @param[in] bit_rate
+ *  	Baud Rate, which serial_bit_rate_ok() has accepted
+ *
+ ******************************************************************************/
+static void serial_fast_start(uint32_t bit_rate)
+{
+	int i = serial_usart_ovs(bit_rate);
+
+	CMU_ClockEnable(fast_cmuclock, true);
+
+	gpio_init(fast_serial_pins, sizeof(fast_serial_pins)/sizeof(gpio_init_t));
+
+	USART_Reset(FPORT);
+	fastInit.baudrate = bit_rate;
+	fastInit.oversampling = serial_ovs_table[(i < 0) ? 0 : i].ovs;
+	USART_InitAsync(FPORT, &fastInit);
+	FPORT->ROUTE = USART_ROUTE_TXPEN | USART_ROUTE_RXPEN | (FAST_SERIAL_LOC << _USART_ROUTE_LOCATION_SHIFT);
+	serial_bit_rate = bit_rate;
+	serial_fast = true;
+
+	USART_IntClear(FPORT, USART_IF_RXDATAV | USART_IF_TXBL);
+	USART_IntEnable(FPORT, USART_IF_RXDATAV);
+
+	NVIC_ClearPendingIRQ(FAST_RX_IRQn);
+	NVIC_EnableIRQ(FAST_RX_IRQn);
+	NVIC_ClearPendingIRQ(FAST_TX_IRQn);
+	NVIC_EnableIRQ(FAST_TX_IRQn);
+}
+#endif
+
+/***************************************************************************//**
+ * @brief
+ *   Reset the Port in Use
+ * @note
+ * 		Its TX pin is disabled, with a pull-up holding the line idle, so
+ * 		that the other port can drive a line wired in parallel.
+ *
+ ******************************************************************************/
+static void serial_stop(void)
+{
+	gpio_init_t tx_off = { TX_PORT, TX_PIN, gpioModeDisabled, 1 };
+
+#if defined(FAST_USART_NUM)
+	if (serial_fast)
+	{
+		USART_Reset(FPORT);
+		CMU_ClockEnable(fast_cmuclock, false);
+		tx_off.port = FAST_TX_PORT;
+		tx_off.pin = FAST_TX_PIN;
+		serial_fast = false;
+	}
+	else
+#endif
+		serial_reset(SPORT);
+	gpio_init(& tx_off, 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset Serial Port
+ * @note
+ * 		Whichever port is in use; serial_init() starts on the console port
+ * 		again.
+ *
+ ******************************************************************************/
+void serial_close(void)
+{
+	serial_stop();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Initialize Serial Port and TX/RX Buffers
+ * @note
+ * 		Starts on the console port.
+ *  @param[in] bit_rate
+ *  	Baud Rate
+ *  @param[in] *raw_rx_buf
+ *  	Pointer to Receive Buffer
+ *  @param[in] raw_rx_buf_size
+ *  	Size of RX buffer
+ *  @param[in] *raw_tx_buf
+ *  	Pointer to Transmit Buffer
+ *  @param[in] raw_tx_buf_size
+ *  	Size of TX buffer
+ *
+ ******************************************************************************/
+void serial_init(int bit_rate,
+		         uint8_t *raw_rx_buf,
+		         size_t raw_rx_buf_size,
+		         uint8_t *raw_tx_buf,
+		         size_t raw_tx_buf_size)
+{
+	serial_rx_buf = init_buf(raw_rx_buf, raw_rx_buf_size);
+	serial_tx_buf = init_buf(raw_tx_buf, raw_tx_buf_size);
+
+	CMU_ClockEnable(cmuClock_GPIO, true);
+
+	serial_console_start(bit_rate);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Move to a Port and Bit Rate
+ * @note
+ * 		Waits for the TX buffer to be sent at the old rate first. What the
+ * 		host sends while the ports change over may be lost or garbled,
+ * 		so the host should wait for a reply at the old rate, switch, and
+ * 		then send.
+ * @param[in] port
+ * 		SERIAL_PORT_CONSOLE or SERIAL_PORT_FAST
+ * @param[in] bit_rate
+ * 		Bit rate
+ * @return FALSE, with the port unchanged, if the rate can't be made
+ *
+ ******************************************************************************/
+bool serial_switch(serial_port_t port, uint32_t bit_rate)
+{
+	if (! serial_bit_rate_ok(port, bit_rate))
+		return false;
+
+	serial_tx_flush();
+
+	INT_Disable();
+	serial_stop();
+#if defined(FAST_USART_NUM)
+	if (port == SERIAL_PORT_FAST)
+		serial_fast_start(bit_rate);
+	else
+#endif
+		serial_console_start(bit_rate);
+	INT_Enable();
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Port in Use
+ * @return SERIAL_PORT_CONSOLE or SERIAL_PORT_FAST
+ *
+ ******************************************************************************/
+serial_port_t serial_get_port(void)
+{
+	return serial_fast ? SERIAL_PORT_FAST : SERIAL_PORT_CONSOLE;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Bit Rate of the Port in Use
+ * @return Bit rate
+ *
+ ******************************************************************************/
+uint32_t serial_get_bit_rate(void)
+{
+	return serial_bit_rate;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait for Room in the Transmit Buffer
+ * @note
+ * 		Sleeps in enter_low_power_state(), woken by the TX interrupt as
+ * 		bytes go out, rather than spinning. Interrupts are masked from
+ * 		the check to the sleep, so a wake-up can't be missed; WFI still
+ * 		wakes for one pending. Also returns if the buffer empties, so
+ * 		space may be more than the buffer holds.
+ * @param[in] space
+ * 		Bytes of room wanted
+ *
+ ******************************************************************************/
+void serial_tx_wait(size_t space)
+{
+	INT_Disable();
+	while ((buf_space(serial_tx_buf) < space) && ! buf_empty(serial_tx_buf))
+	{
+		enter_low_power_state();
+		INT_Enable();  // run the handler which woke us
+		INT_Disable();
+	}
+	INT_Enable();
+}
+
 /***************************************************************************//**
  * @brief
- *   Clear Transmit Buffer
+ *   Wait for the Transmit Buffer to be Sent
+ * @note
+ * 		Returns once the last byte has left the shift register, so the
+ * 		port can be closed or reconfigured. Sleeps as serial_tx_wait().
  *
  ******************************************************************************/
 void serial_tx_flush(void)
 {
-	while (! buf_empty(serial_tx_buf))
-		;
+	INT_Disable();
+	while (PORT_REG(IEN) & (PORT_BIT(IEN_TXBL) | PORT_BIT(IEN_TXC)))
+	{
+		enter_low_power_state();
+		INT_Enable();
+		INT_Disable();
+	}
+	INT_Enable();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Called to determine if the serial port stops EM2 being entered
+ * @note
+ * 		The LEUART runs from the LFXO, so works in EM2. A UART or USART
+ * 		needs the HF clock, so holds the core in EM1 while transmitting,
+ * 		and the fast port does whenever it is in use.
+ * @return TRUE/FALSE
+ *
+ ******************************************************************************/
+bool serial_blocks_em2(void)
+{
+	if (serial_fast)
+		return true;  // the fast port can't receive without the HF clock
+#if defined(LEUART_NUM)
+	return false;
+#else
+	return serial_tx_buf && (SPORT->IEN & (IEN_TXBL | IEN_TXC));
+#endif
 }
 
 /***************************************************************************//**
@@ -538,14 +1115,71 @@ int RETARGET_WriteChar(char c)
 	return 0;
 }
 
+/***************************************************************************//**
+ * @brief
+ *   Write Data to Serial Port, for _write() of retargetio.c
+ * @note
+ * 		Blocking unless serial_set_tx_nonblocking() has been called, in
+ * 		which case only what fits in the TX buffer is written. Returning
+ * 		-1 when nothing fits makes stdio drop the rest of its buffer,
+ * 		rather than retry.
+ * @param[in] *p
+ * 		Pointer to data to write
+ * @param[in] len
+ * 		Length of data
+ * @return Bytes written, or -1 if none
+ *
+ ******************************************************************************/
+int RETARGET_Write(const char *p, int len)
+{
+	size_t n;
+
+	if (! serial_tx_nonblocking)
+	{
+		serial_blocking_write((const uint8_t *) p, len);
+		return len;
+	}
+
+	n = serial_write((const uint8_t *) p, len);
+	if (n)
+		return n;
+	serial_tx_dropped += len;
+	return -1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Choose whether printf() output waits for room in the TX buffer
+ * @param[in] nonblocking
+ * 		If true, output which doesn't fit is dropped and counted
+ * @note
+ * 		Clears any stdout error left by dropped output, so printf()
+ * 		works again in either mode.
+ * @return Bytes dropped since the last call
+ *
+ ******************************************************************************/
+uint32_t serial_set_tx_nonblocking(bool nonblocking)
+{
+	uint32_t dropped = serial_tx_dropped;
+
+	fflush(stdout);
+	// a -1 from RETARGET_Write() leaves the stream's error flag set, and
+	// newlib then refuses every later write until it is cleared
+	clearerr(stdout);
+	serial_tx_nonblocking = nonblocking;
+	serial_tx_dropped = 0;
+	return dropped;
+}
+
 /***************************************************************************//**
  * @brief
  *   Read Character from Serial Port
+ * @return Character, or -1 if none has been received
  *
  ******************************************************************************/
 int RETARGET_ReadChar(void)
 {
-	return 0;
+	return serial_read_char();
 }
 
 /** @} (end addtogroup LEUART) */
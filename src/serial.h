@@ -35,7 +35,9 @@
 #define SERIAL_H_
 
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /***************************************************************************//**
  * @addtogroup Peripheral_Functions
@@ -51,19 +53,66 @@
 
 #define SERIAL_LOC 0
 
+// The console port. The LEUART runs from the 32768 Hz LFXO, so works in
+// EM2, but is limited to 9600 bit/s. A USART may be used instead, e.g.
+// USART0 location 0 (PE10 TX, PE11 RX) in place of the two lines above:
+//   #define USART_NUM 0
+//   #define SERIAL_LOC 0
+#if defined(LEUART_NUM)
+#define SERIAL_BIT_RATE 9600
+#else
+#define SERIAL_BIT_RATE 460800  // reachable from the 14 MHz HFRCO and the HFXO
+#endif
+
+// The fast port, a USART which serial_switch() moves to for bulk
+// transfers, at rates up to the HF peripheral clock / 4. It must not be
+// the SPI flash's USART (USART1 location 1, PD0-PD3; see spi.h). USART2
+// location 0 is PC2 TX, PC3 RX, which may be wired in parallel with the
+// console's PD4 TX, PD5 RX to use one adapter, as only the port in use
+// drives its TX pin. Remove both lines to do without.
+#define FAST_USART_NUM  2
+#define FAST_SERIAL_LOC 0
+
+typedef enum
+{
+	SERIAL_PORT_CONSOLE,
+	SERIAL_PORT_FAST,
+} serial_port_t;
 
 void serial_blocking_write_char(char c);
 
 void serial_blocking_write_str(const char *p);
 
+void serial_blocking_write(const uint8_t *p, size_t len);
+
+size_t serial_write(const uint8_t *p, size_t len);
+
+uint32_t serial_set_tx_nonblocking(bool nonblocking);
+
+int serial_read_char(void);
+
+bool serial_rx_ready(void);
+
 void serial_init(int bit_rate,
 		         uint8_t *raw_rx_buf,
 		         size_t raw_rx_buf_size,
 		         uint8_t *raw_tx_buf,
 		         size_t raw_tx_buf_size);
 
+void serial_tx_wait(size_t space);
+
 void serial_tx_flush(void);
 
+bool serial_blocks_em2(void);
+
+bool serial_bit_rate_ok(serial_port_t port, uint32_t bit_rate);
+
+bool serial_switch(serial_port_t port, uint32_t bit_rate);
+
+serial_port_t serial_get_port(void);
+
+uint32_t serial_get_bit_rate(void);
+
 void serial_close(void);
 
 #endif /* SERIAL_H_ */
@@ -33,11 +33,14 @@
 #include "em_cmu.h"
 #include "em_emu.h"
 #include "em_int.h"
+#include "em_timer.h"
 #include "em_usart.h"
 
 #include "gpio.h"
 #include "low_power.h"
+#include "serial.h"
 #include "spi.h"
+#include "spi_trace.h"
 
 /***************************************************************************//**
  * @addtogroup Peripheral_Functions
@@ -69,6 +72,11 @@
 #define SERIAL_RX_IRQHandler PASTE3(USART, USART_NUM, _RX_IRQHandler
 #define SPI_cmuClock         PASTE(cmuClock_USART, USART_NUM)
 
+// The serial link's fast port has its own interrupt handlers and settings
+#if defined(FAST_USART_NUM) && (FAST_USART_NUM == USART_NUM)
+#  error "In serial.h, FAST_USART_NUM must not be the SPI flash's USART (spi.h)."
+#endif
+
 #if USART_NUM == 0
 #  if USART_LOC == 0
 #    define CK_PORT gpioPortE
@@ -202,6 +210,119 @@ static size_t spi_rx_post_padding_len;
 
 static bool spi_hold_cs_active;
 
+static size_t spi_prefix_tx_len;
+static const uint8_t *spi_prefix_data;
+static size_t spi_prefix_rx_len;
+
+#define SPI_DEFAULT_CS_HIGH_NS 100  // until the part is known
+
+static uint32_t spi_cs_high_loops;  // NOP loop passes for the CS high time, at least a cycle each
+
+#if SPI_TRACE
+static spi_trace_record_t *spi_trace_prefix_record;
+static spi_trace_record_t *spi_trace_xfer_record;
+static spi_trace_record_t *spi_trace_so_record;
+#endif
+
+// The timer is TIMER1, extended to 32 bits by its overflow interrupt
+#define SPI_TIMER       TIMER1
+#define SPI_TIMER_IRQn  TIMER1_IRQn
+#define SPI_TIMER_CLOCK cmuClock_TIMER1
+
+static uint32_t spi_timer_hz;
+static volatile uint32_t spi_timer_base;  // overflows, and time slept in EM2
+
+/***************************************************************************//**
+ * @brief
+ *   Timer overflow interrupt handler
+ ******************************************************************************/
+void TIMER1_IRQHandler(void)
+{
+	TIMER_IntClear(SPI_TIMER, TIMER_IF_OF);
+	spi_timer_base += 0x10000;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the timer
+ * @note
+ * 		The prescaler is the largest that keeps a tick within a
+ * 		microsecond, at the current HFPER clock. The count starts again
+ * 		from 0, so a time across a clock change isn't meaningful.
+ ******************************************************************************/
+static void spi_timer_init(void)
+{
+	TIMER_Init_TypeDef init = TIMER_INIT_DEFAULT;
+	uint32_t hz = CMU_ClockFreqGet(cmuClock_HFPER);
+
+	CMU_ClockEnable(SPI_TIMER_CLOCK, true);
+
+	init.prescale = timerPrescale1;
+	while ((init.prescale < timerPrescale1024) && ((hz >> (init.prescale + 1)) >= 1000000))
+		init.prescale++;
+	spi_timer_hz = hz >> init.prescale;
+	spi_timer_base = 0;
+
+	TIMER_Init(SPI_TIMER, & init);
+	TIMER_IntClear(SPI_TIMER, TIMER_IF_OF);
+	TIMER_IntEnable(SPI_TIMER, TIMER_IF_OF);
+	NVIC_ClearPendingIRQ(SPI_TIMER_IRQn);
+	NVIC_EnableIRQ(SPI_TIMER_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the timer
+ * @note
+ * 		May be called in thread or interrupt context.
+ * @return Ticks
+ ******************************************************************************/
+uint32_t spi_timer_now(void)
+{
+	uint32_t base;
+	uint32_t count;
+
+	INT_Disable();
+	base = spi_timer_base;
+	count = TIMER_CounterGet(SPI_TIMER);
+	// an overflow not handled yet, because interrupts are disabled
+	if (SPI_TIMER->IF & TIMER_IF_OF)
+	{
+		base += 0x10000;
+		count = TIMER_CounterGet(SPI_TIMER);
+	}
+	INT_Enable();
+	return base + count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Timer rate
+ * @return Ticks per second
+ ******************************************************************************/
+uint32_t spi_timer_tick_hz(void)
+{
+	return spi_timer_hz;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Account for time slept in EM2, where the timer stops
+ * @note
+ * 		Called by enter_low_power_state(). The timer also counted part of
+ * 		the RTC tick at each end, so this is accurate to about an RTC tick.
+ * @param[in] rtc_ticks
+ * 		Time slept, in RTC ticks
+ ******************************************************************************/
+void spi_timer_slept(uint64_t rtc_ticks)
+{
+	uint32_t ticks = (rtc_ticks * spi_timer_hz) / 32768;
+
+	INT_Disable();
+	spi_timer_base += ticks;
+	INT_Enable();
+}
+
 /***************************************************************************//**
  * @brief
  *   Called to determine if SPI bus is active
@@ -229,6 +350,29 @@ void USART1_RX_IRQHandler(void)
 	uint8_t dummy;
 	if (SPI_PORT->IF & USART_IF_RXDATAV)
 	{
+		if (spi_prefix_rx_len)
+		{
+			dummy = SPI_PORT->RXDATA;
+			(void) dummy;
+			spi_prefix_rx_len--;
+			if (spi_prefix_rx_len == 0)
+			{
+				// End the prefix command and start the main one, with CS
+				// high for at least the part's tCSH in between
+				uint32_t i;
+
+				GPIO_PinOutSet(CS_PORT, CS_PIN);    // deassert CS
+				for (i = spi_cs_high_loops; i; i--)
+					__NOP();
+				GPIO_PinOutClear(CS_PORT, CS_PIN);  // assert CS
+				SPI_PORT->IEN |= USART_IEN_TXBL;    // resume tx
+#if SPI_TRACE
+				spi_trace_end(spi_trace_prefix_record);
+				spi_trace_xfer_record->start = SPI_TRACE_NOW();
+#endif
+			}
+			return;
+		}
 		if (spi_rx_pre_padding_len)
 		{
 			dummy = SPI_PORT->RXDATA;
@@ -256,6 +400,9 @@ void USART1_RX_IRQHandler(void)
 			SPI_PORT->IEN &= ~ USART_IEN_RXDATAV;  // disable rx interrupt
 			if (! spi_hold_cs_active)
 				GPIO_PinOutSet(CS_PORT, CS_PIN);  // deassert CS
+#if SPI_TRACE
+			spi_trace_end(spi_trace_xfer_record);
+#endif
 			spi_busy = false;
 			if (completion)
 				completion(completion_ref);
@@ -273,7 +420,18 @@ void USART1_TX_IRQHandler(void)
 {
 	if (SPI_PORT->IF & USART_IF_TXBL)
 	{
-		if (spi_tx_len)
+		if (spi_prefix_tx_len)
+		{
+			SPI_PORT->TXDATA = *spi_prefix_data++;
+			spi_prefix_tx_len--;
+			if (spi_prefix_tx_len == 0)
+			{
+				// hold off the main command until the prefix is complete
+				SPI_PORT->IEN &= ~ USART_IEN_TXBL;
+				return;
+			}
+		}
+		else if (spi_tx_len)
 		{
 			SPI_PORT->TXDATA = *spi_tx_data++;
 			spi_tx_len--;
@@ -295,45 +453,51 @@ void USART1_TX_IRQHandler(void)
 
 /***************************************************************************//**
  * @brief
- *   SPI transfer function
+ *   Set the minimum CS high time between a prefix and the main command
+ * @note
+ * 		The time is counted in core clock cycles, so is only as long as
+ * 		required at the clock frequency set when this is called.
+ * @param[in] ns
+ * 		tCSH of the part, in nanoseconds
+ ******************************************************************************/
+void spi_set_cs_high_ns(uint32_t ns)
+{
+	uint32_t mhz = CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
+
+	spi_cs_high_loops = (ns * mhz + 999) / 1000;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   SPI transfer function with prefix command
  *
  * @details
- * 		Performs one SPI transaction. Fundamentally SPI does a write and read of the
- * 		same length (byte count) at the same time. Often only a few bytes are to be
- *		written, and the data returned while those bytes are written is to be
- *		discarded. This can be done using the "half_duplex" flag.  The data to be
- *		written may optionally be split into two separate buffers in order to handle
- *		discontiguous data. Set tx_len or tx_len2 to 0 if the corresponding buffer
- *		is not used.  Will block if NULL passed for completion function; otherwise
- *		will call completion function passing ref argument.  Note that completion
- *		function may be called either before or after the function returns.
+ * 		Like spi_xfer(), but first sends a separate prefix command in its own
+ * 		CS cycle, e.g., WRITE ENABLE before a program or erase command. The
+ * 		main transaction is started directly by the interrupt handlers when
+ * 		the prefix is complete, without an intervening completion callback.
+ * 		Data received during the prefix is discarded.
  *
- * @param[in] tx_len
- * 		Number of bytes to transfer from tx buffer
- * @param[in] *tx_data
- * 		Pointer to data to be transferred/TX'd
- * @param[in] tx2_len
- * 		Number of bytes to transfer from tx2 buffer
- * @param[in] *tx2_data
- * 		Pointer to data to be transferred from tx2 buffer.
- * @param[in] hold_cs_active
- * 		TRUE/FALSE, Determines whether to hold CS active
- * @param[in] *completion
- * 		Completion state machine callback function
- * @param[in] *completion_ref
- * 		Argument to be passed to completion callback
+ * @param[in] prefix_len
+ * 		Number of bytes in prefix command, 0 for none
+ * @param[in] *prefix_data
+ * 		Pointer to prefix command
+ * @param[in] tx_len ... completion_ref
+ * 		As for spi_xfer()
  *
  ******************************************************************************/
-void spi_xfer(size_t tx_len,
-			  const uint8_t *tx_data,
-			  size_t tx2_len,
-			  const uint8_t *tx2_data,
-			  bool half_duplex,
-			  size_t rx_len,
-			  uint8_t *rx_data,
-			  bool hold_cs_active,
-			  spi_completion_fn_t *completion,
-			  void *completion_ref)
+void spi_xfer_prefixed(size_t prefix_len,
+					   const uint8_t *prefix_data,
+					   size_t tx_len,
+					   const uint8_t *tx_data,
+					   size_t tx2_len,
+					   const uint8_t *tx2_data,
+					   bool half_duplex,
+					   size_t rx_len,
+					   uint8_t *rx_data,
+					   bool hold_cs_active,
+					   spi_completion_fn_t *completion,
+					   void *completion_ref)
 {
 	spi_rx_len = rx_len;
 	spi_rx_data = rx_data;
@@ -349,6 +513,10 @@ void spi_xfer(size_t tx_len,
 
 	spi_hold_cs_active = hold_cs_active;
 
+	spi_prefix_tx_len = prefix_len;
+	spi_prefix_data = prefix_data;
+	spi_prefix_rx_len = prefix_len;
+
 	if (half_duplex)
 	{
 		spi_rx_pre_padding_len = tx_len + tx2_len;
@@ -367,6 +535,16 @@ void spi_xfer(size_t tx_len,
 
 	spi_busy = true;
 
+#if SPI_TRACE
+	if (prefix_len)
+		spi_trace_prefix_record = spi_trace_begin(SPI_TRACE_FLAG_PREFIX, prefix_len, prefix_data,
+				                                  prefix_len, 0);
+	spi_trace_xfer_record = spi_trace_begin((hold_cs_active ? SPI_TRACE_FLAG_HOLD_CS : 0) |
+			                                (half_duplex ? SPI_TRACE_FLAG_HALF_DUPLEX : 0) |
+			                                (completion ? SPI_TRACE_FLAG_ASYNC : 0),
+			                                tx_len, tx_data, tx_len + tx2_len, rx_len);
+#endif
+
 	GPIO_PinOutClear(CS_PORT, CS_PIN);  // assert CS
 
 	// enable interrupts to start transfer
@@ -377,6 +555,58 @@ void spi_xfer(size_t tx_len,
 			EMU_EnterEM1();
 }
 
+/***************************************************************************//**
+ * @brief
+ *   SPI transfer function
+ *
+ * @details
+ * 		Performs one SPI transaction. Fundamentally SPI does a write and read of the
+ * 		same length (byte count) at the same time. Often only a few bytes are to be
+ *		written, and the data returned while those bytes are written is to be
+ *		discarded. This can be done using the "half_duplex" flag.  The data to be
+ *		written may optionally be split into two separate buffers in order to handle
+ *		discontiguous data. Set tx_len or tx_len2 to 0 if the corresponding buffer
+ *		is not used.  Will block if NULL passed for completion function; otherwise
+ *		will call completion function passing ref argument.  Note that completion
+ *		function may be called either before or after the function returns.
+ *
+ * @param[in] tx_len
+ * 		Number of bytes to transfer from tx buffer
+ * @param[in] *tx_data
+ * 		Pointer to data to be transferred/TX'd
+ * @param[in] tx2_len
+ * 		Number of bytes to transfer from tx2 buffer
+ * @param[in] *tx2_data
+ * 		Pointer to data to be transferred from tx2 buffer.
+ * @param[in] hold_cs_active
+ * 		TRUE/FALSE, Determines whether to hold CS active
+ * @param[in] *completion
+ * 		Completion state machine callback function
+ * @param[in] *completion_ref
+ * 		Argument to be passed to completion callback
+ *
+ ******************************************************************************/
+void spi_xfer(size_t tx_len,
+			  const uint8_t *tx_data,
+			  size_t tx2_len,
+			  const uint8_t *tx2_data,
+			  bool half_duplex,
+			  size_t rx_len,
+			  uint8_t *rx_data,
+			  bool hold_cs_active,
+			  spi_completion_fn_t *completion,
+			  void *completion_ref)
+{
+	spi_xfer_prefixed(0, NULL,
+			          tx_len, tx_data,
+			          tx2_len, tx2_data,
+			          half_duplex,
+			          rx_len, rx_data,
+			          hold_cs_active,
+			          completion,
+			          completion_ref);
+}
+
 
 static bool so_busy;
 static spi_completion_fn_t *so_completion;
@@ -422,6 +652,9 @@ void SO_IRQ(void *ref)
 	}
 
 	GPIO_PinOutSet(CS_PORT, CS_PIN);  // deassert CS
+#if SPI_TRACE
+	spi_trace_end(spi_trace_so_record);
+#endif
 
 	// copy completion fn ptr and ref arg, to avoid race condition
 	// if completion fn starts another SPI xfer
@@ -462,6 +695,11 @@ void spi_wait_so(uint8_t level,
 	so_completion_ref = completion_ref;
 	so_busy = true;
 
+#if SPI_TRACE
+	spi_trace_so_record = spi_trace_begin(SPI_TRACE_FLAG_SO_WAIT | (completion ? SPI_TRACE_FLAG_ASYNC : 0),
+			                              1, & level, 0, 0);
+#endif
+
 	INT_Disable();
 
 	// enable IRQ
@@ -539,6 +777,8 @@ void spi_init(int bit_rate)
 
 	USART_IntClear(SPI_PORT, USART_IF_RXDATAV | USART_IF_TXBL);
 
+	spi_set_cs_high_ns(SPI_DEFAULT_CS_HIGH_NS);
+
 	NVIC_ClearPendingIRQ(SPI_TX_IRQn);
 	NVIC_EnableIRQ(SPI_TX_IRQn);
 
@@ -553,6 +793,8 @@ void spi_init(int bit_rate)
 
 	// register (but don't enable) rx pin GPIO interrupt
 	gpio_irq_handler_install(RX_PORT, RX_PIN, SO_IRQ, NULL);
+
+	spi_timer_init();
 	}
 
 /** @} (end addtogroup Peripheral Functions) */
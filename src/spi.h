@@ -72,6 +72,23 @@ void spi_xfer(size_t tx_len,
 			  spi_completion_fn_t *completion,  // completion callback fn
 			  void *completion_ref);  // argument to be passed to completion callback
 
+// Minimum CS high time between a prefix command and the main command
+void spi_set_cs_high_ns(uint32_t ns);
+
+// As spi_xfer(), but preceded by a separate prefix command in its own CS cycle
+void spi_xfer_prefixed(size_t prefix_len,
+					   const uint8_t *prefix_data,
+					   size_t tx_len,
+					   const uint8_t *tx_data,
+					   size_t tx2_len,
+					   const uint8_t *tx2_data,
+					   bool half_duplex,
+					   size_t rx_len,
+					   uint8_t *rx_data,
+					   bool hold_cs_active,
+					   spi_completion_fn_t *completion,
+					   void *completion_ref);
+
 
 #ifdef USE_SO_IRQ
 void spi_wait_so(uint8_t level,
@@ -82,6 +99,13 @@ void spi_wait_so(uint8_t level,
 
 void spi_init(int bit_rate);
 
+// Timer of about 1 MHz, started by spi_init(), for the SPI trace and for
+// timing operations, since RTC ticks (30.5 us) are too coarse. It stops
+// in EM2, so enter_low_power_state() adds the RTC time slept there.
+uint32_t spi_timer_now(void);
+uint32_t spi_timer_tick_hz(void);
+void spi_timer_slept(uint64_t rtc_ticks);
+
 /** @} (end addtogroup Peripheral Functions) */
 /** @} (end addtogroup SPI) */
 
@@ -0,0 +1,173 @@
+/******************************************************************************
+ * @file spi_trace.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include "em_int.h"
+
+#include "serial.h"
+#include "spi_trace.h"
+
+/***************************************************************************//**
+ * @addtogroup Peripheral_Functions
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup SPI_Trace
+ * @details
+ * 		The dump format is little-endian:
+ *
+ * 		  offset  size  field
+ * 		  0       4     "SPTR"
+ * 		  4       1     format version, 2
+ * 		  5       1     record size, 18
+ * 		  6       2     record count
+ * 		  8       4     timestamp ticks per second
+ * 		  12      4     records lost, overwritten before the dump
+ * 		  16      18n   records, oldest first: start, addr, latency (u32),
+ * 		                tx_len, rx_len (u16), opcode, flags (u8)
+ * 		  16+18n  2     sum of all preceding bytes, modulo 65536
+ *
+ * 		tools/spi_trace.py decodes it.
+ * @{
+ ******************************************************************************/
+
+#define SPI_TRACE_FORMAT_VERSION 2
+#define SPI_TRACE_RECORD_SIZE 18
+
+#if SPI_TRACE
+
+spi_trace_record_t spi_trace_ring[SPI_TRACE_DEPTH];
+uint32_t spi_trace_count;  // records ever started
+unsigned int spi_trace_address_bytes = 3;  // of the part, for decoding commands
+
+static uint16_t spi_trace_sum;
+
+static void spi_trace_put_u8(uint8_t b)
+{
+	spi_trace_sum += b;
+	serial_blocking_write_char(b);
+}
+
+static void spi_trace_put_u16(uint16_t v)
+{
+	spi_trace_put_u8(v);
+	spi_trace_put_u8(v >> 8);
+}
+
+static void spi_trace_put_u32(uint32_t v)
+{
+	spi_trace_put_u16(v);
+	spi_trace_put_u16(v >> 16);
+}
+
+#endif /* SPI_TRACE */
+
+/***************************************************************************//**
+ * @brief
+ *   Discard all trace records
+ ******************************************************************************/
+void spi_trace_clear(void)
+{
+#if SPI_TRACE
+	INT_Disable();
+	spi_trace_count = 0;
+	INT_Enable();
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set the number of address bytes after a command's opcode
+ * @note
+ * 		Called by the flash driver once the part is known.
+ * @param[in] address_bytes
+ * 		2 or 3, from the part table
+ ******************************************************************************/
+void spi_trace_set_address_bytes(unsigned int address_bytes)
+{
+#if SPI_TRACE
+	spi_trace_address_bytes = address_bytes;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Send the trace over serial, in binary
+ * @note
+ * 		The serial port must be open. Without SPI_TRACE, sends nothing.
+ * @return Number of records sent
+ ******************************************************************************/
+uint32_t spi_trace_dump(void)
+{
+#if SPI_TRACE
+	uint32_t count;
+	uint32_t n;
+	uint32_t i;
+
+	INT_Disable();
+	count = spi_trace_count;
+	INT_Enable();
+	n = (count < SPI_TRACE_DEPTH) ? count : SPI_TRACE_DEPTH;
+
+	spi_trace_sum = 0;
+	spi_trace_put_u8('S');
+	spi_trace_put_u8('P');
+	spi_trace_put_u8('T');
+	spi_trace_put_u8('R');
+	spi_trace_put_u8(SPI_TRACE_FORMAT_VERSION);
+	spi_trace_put_u8(SPI_TRACE_RECORD_SIZE);
+	spi_trace_put_u16(n);
+	spi_trace_put_u32(spi_timer_tick_hz());
+	spi_trace_put_u32(count - n);
+
+	for (i = count - n; i != count; i++)
+	{
+		const spi_trace_record_t *r = & spi_trace_ring[i & (SPI_TRACE_DEPTH - 1)];
+		spi_trace_put_u32(r->start);
+		spi_trace_put_u32(r->addr);
+		spi_trace_put_u32(r->latency);
+		spi_trace_put_u16(r->tx_len);
+		spi_trace_put_u16(r->rx_len);
+		spi_trace_put_u8(r->opcode);
+		spi_trace_put_u8(r->flags);
+	}
+
+	spi_trace_put_u16(spi_trace_sum);
+	return n;
+#else
+	return 0;
+#endif
+}
+
+/** @} (end addtogroup SPI_Trace) */
+/** @} (end addtogroup Peripheral_Functions) */
@@ -0,0 +1,158 @@
+/****************************************************************************//**
+ * @file spi_trace.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef SPI_TRACE_H_
+#define SPI_TRACE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "em_device.h"
+
+#include "spi.h"
+
+/***************************************************************************//**
+ * @addtogroup Peripheral_Functions
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup SPI_Trace
+ * @brief Ring buffer of SPI transactions, for timing without a logic analyzer
+ * @{
+ ******************************************************************************/
+
+// Define SPI_TRACE to 1 to record each SPI transaction in a ring buffer,
+// which can be sent over serial with spi_trace_dump(), or 0 to leave it
+// out.
+#ifndef SPI_TRACE
+#define SPI_TRACE 0
+#endif
+
+// Number of records kept, must be a power of two
+#define SPI_TRACE_DEPTH 128
+
+// Timestamps are ticks of the SPI driver's timer, of about 1 MHz, since
+// RTC ticks (30.5 us) are too coarse to show the gaps between commands
+#define SPI_TRACE_NOW() spi_timer_now()
+
+#define SPI_TRACE_FLAG_PREFIX       0x01  // prefix command, in its own CS cycle
+#define SPI_TRACE_FLAG_HOLD_CS      0x02  // CS left asserted at completion
+#define SPI_TRACE_FLAG_HALF_DUPLEX  0x04  // rx data follows tx data
+#define SPI_TRACE_FLAG_SO_WAIT      0x08  // wait for SO level, opcode is the level
+#define SPI_TRACE_FLAG_ASYNC        0x10  // caller gave a completion
+#define SPI_TRACE_FLAG_DONE         0x80  // latency is valid
+
+typedef struct
+{
+	uint32_t start;     // timer ticks at start
+	uint32_t addr;      // address bytes after the opcode, if sent, else 0
+	uint32_t latency;   // timer ticks from start to completion
+	uint16_t tx_len;    // command and data bytes sent
+	uint16_t rx_len;    // bytes received
+	uint8_t opcode;     // first command byte
+	uint8_t flags;      // SPI_TRACE_FLAG_*
+} spi_trace_record_t;
+
+#if SPI_TRACE
+
+extern spi_trace_record_t spi_trace_ring[SPI_TRACE_DEPTH];
+extern uint32_t spi_trace_count;
+extern unsigned int spi_trace_address_bytes;
+
+/***************************************************************************//**
+ * @brief
+ *   Start a trace record
+ * @note
+ * 		Called from spi.c, in thread or interrupt context. The SPI driver
+ * 		runs one transaction at a time, so records are never started
+ * 		concurrently.
+ * @param[in] flags
+ * 		SPI_TRACE_FLAG_*
+ * @param[in] tx_len
+ * 		Number of command bytes in tx_data
+ * @param[in] *tx_data
+ * 		Command bytes
+ * @param[in] total_tx_len
+ * 		Number of bytes sent, including any data after the command
+ * @param[in] rx_len
+ * 		Number of bytes received
+ * @return Record, to be passed to spi_trace_end()
+ ******************************************************************************/
+static inline spi_trace_record_t *spi_trace_begin(uint8_t flags,
+		                                          size_t tx_len,
+		                                          const uint8_t *tx_data,
+		                                          size_t total_tx_len,
+		                                          size_t rx_len)
+{
+	spi_trace_record_t *r = & spi_trace_ring[spi_trace_count++ & (SPI_TRACE_DEPTH - 1)];
+	unsigned int i;
+
+	r->start = SPI_TRACE_NOW();
+	r->opcode = tx_len ? tx_data[0] : 0;
+	r->addr = 0;
+	if (tx_len > spi_trace_address_bytes)
+		for (i = 1; i <= spi_trace_address_bytes; i++)
+			r->addr = (r->addr << 8) | tx_data[i];
+	r->tx_len = total_tx_len;
+	r->rx_len = rx_len;
+	r->latency = 0;
+	r->flags = flags;
+	return r;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Complete a trace record
+ * @param[in] *r
+ * 		Record returned by spi_trace_begin()
+ ******************************************************************************/
+static inline void spi_trace_end(spi_trace_record_t *r)
+{
+	r->latency = SPI_TRACE_NOW() - r->start;
+	r->flags |= SPI_TRACE_FLAG_DONE;
+}
+
+#endif /* SPI_TRACE */
+
+void spi_trace_clear(void);
+
+void spi_trace_set_address_bytes(unsigned int address_bytes);
+
+uint32_t spi_trace_dump(void);
+
+/** @} (end defgroup SPI_Trace) */
+/** @} (end addtogroup Peripheral_Functions) */
+
+#endif /* SPI_TRACE_H_ */
@@ -37,9 +37,12 @@
 
 #include "em_emu.h"
 
+#include "rtcdriver.h"
+
 #include "low_power.h"
 #include "spi.h"
 #include "spiflash.h"
+#include "spi_trace.h"
 
 /***************************************************************************//**
  * @addtogroup Adesto_FlashDrivers
@@ -96,11 +99,19 @@ int cycle_count = 0;
 #define CMD_DATAFLASH_RMW_BUF1          0x58
 #define CMD_DATAFLASH_RMW_BUF2          0x59
 
+#define MAX_PROTECTION_SECTORS 16  // bits of protection_mask used
+
+// Number of entries in a part's protection sector sizes, which fails to
+// compile if there are more than the driver's table holds
+#define PROTECTION_SECTOR_COUNT(sizes) \
+	((sizeof(sizes) / sizeof(size_t)) + \
+	 0 * sizeof(char[((sizeof(sizes) / sizeof(size_t)) <= MAX_PROTECTION_SECTORS) ? 1 : -1]))
+
+// the blocks which the AT25SF041 block protect bits select 1/8 of the array in
+static const size_t at25sf041_protection_sector_sizes[] = { 65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536 };
 
-static const uint8_t at25xe021a_id_bytes[] = { 0x1f, 0x43, 0x01, 0x00 };
 static const size_t at25xe021a_protection_sector_sizes[] = { 65536, 65536, 65536, 65536 };
 
-static const uint8_t at25xe041b_id_bytes[] = { 0x1f, 0x44, 0x02, 0x00 };
 static const size_t at25xe041b_protection_sector_sizes[] = { 65536, 65536, 65536, 65536, 65536, 65536, 65536, 32768, 8192, 8192, 16384 };
 
 static const uint8_t dataflash_cmd_set_256b_page [] = { 0x3d, 0x2a, 0x80, 0xa6 };
@@ -119,17 +130,24 @@ const spiflash_info_t spiflash_info_table[] =
 	    .address_bytes           = 3,
 	    .program_page_size       = 256,
 	    .erase_info_count        = 4,
-	    .erase_info              = {{ 4096,   CMD_BLOCK_ERASE,        true },
-	    		                    { 32768,  CMD_BLOCK_ERASE_LARGE,  true },
-	    		                    { 65536,  CMD_BLOCK_ERASE_LARGER, true },
-	    		                    { (4 << 20) / 8, CMD_CHIP_ERASE,  false }},
-	    .protection_sector_sizes = at25xe021a_protection_sector_sizes,
-	    .protection_sector_count = sizeof(at25xe021a_protection_sector_sizes) / sizeof(size_t),
+	    .erase_info              = {{ 4096,   CMD_BLOCK_ERASE,        true, 50000, 200000 },
+	    		                    { 32768,  CMD_BLOCK_ERASE_LARGE,  true, 150000, 600000 },
+	    		                    { 65536,  CMD_BLOCK_ERASE_LARGER, true, 250000, 1000000 },
+	    		                    { (4 << 20) / 8, CMD_CHIP_ERASE,  false, 4000000, 8000000 }},
+	    .protection_sector_sizes = at25sf041_protection_sector_sizes,
+	    .protection_sector_count = PROTECTION_SECTOR_COUNT(at25sf041_protection_sector_sizes),
+	    .protection_by_status    = true,
 	    .read_status_cmd         = CMD_READ_STATUS,
 	    .status_busy_mask        = 0x01,
 	    .status_busy_level       = 0x01,
+	    .status_error_mask       = 0x0000,
 	    .has_so_irq              = false,
 	    .dataflash               = false,
+	    .t_csh_ns                = 50,
+	    .t_pp_typ_us             = 600,
+	    .t_pp_max_us             = 2500,
+	    .t_wake_dpd_us           = 8,
+	    .t_wake_udpd_us          = 8,
 	},
 	[AT25XE021A] = {
 		.name                    = "AT25XE021A",
@@ -139,19 +157,25 @@ const spiflash_info_t spiflash_info_table[] =
 	    .address_bytes           = 3,
 	    .program_page_size       = 256,
 	    .erase_info_count        = 5,
-	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,         true },
-	                                { 4096,   CMD_BLOCK_ERASE,        true },
-	    		                    { 32768,  CMD_BLOCK_ERASE_LARGE,  true },
-	    		                    { 65536,  CMD_BLOCK_ERASE_LARGER, true },
-	    		                    { (2 << 20) / 8, CMD_CHIP_ERASE,  false }},
+	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,         true, 10000, 25000 },
+	                                { 4096,   CMD_BLOCK_ERASE,        true, 40000, 200000 },
+	    		                    { 32768,  CMD_BLOCK_ERASE_LARGE,  true, 200000, 600000 },
+	    		                    { 65536,  CMD_BLOCK_ERASE_LARGER, true, 400000, 950000 },
+	    		                    { (2 << 20) / 8, CMD_CHIP_ERASE,  false, 1500000, 4000000 }},
 	    .protection_sector_sizes = at25xe021a_protection_sector_sizes,
-	    .protection_sector_count = sizeof(at25xe021a_protection_sector_sizes) / sizeof(size_t),
+	    .protection_sector_count = PROTECTION_SECTOR_COUNT(at25xe021a_protection_sector_sizes),
 	    .read_status_cmd         = CMD_READ_STATUS,
 	    .status_busy_mask        = 0x01,
 	    .status_busy_level       = 0x01,
+	    .status_error_mask       = 0x0020,
 	    .has_so_irq              = true,
 	    .so_done_level           = 0,
 	    .dataflash               = false,
+	    .t_csh_ns                = 50,
+	    .t_pp_typ_us             = 1500,
+	    .t_pp_max_us             = 3000,
+	    .t_wake_dpd_us           = 8,
+	    .t_wake_udpd_us          = 70,
 	},
 	[AT25XE041B] = {
 	    .name                    = "AT25XE041B",
@@ -161,19 +185,25 @@ const spiflash_info_t spiflash_info_table[] =
 	    .address_bytes           = 3,
 	    .program_page_size       = 256,
 	    .erase_info_count        = 5,
-	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,         true },
-	                                { 4096,   CMD_BLOCK_ERASE,        true },
-	    		                    { 32768,  CMD_BLOCK_ERASE_LARGE,  true },
-	    		                    { 65536,  CMD_BLOCK_ERASE_LARGER, true },
-	    		                    { (4 << 20) / 8, CMD_CHIP_ERASE,  false }},
+	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,         true, 10000, 25000 },
+	                                { 4096,   CMD_BLOCK_ERASE,        true, 45000, 200000 },
+	    		                    { 32768,  CMD_BLOCK_ERASE_LARGE,  true, 250000, 600000 },
+	    		                    { 65536,  CMD_BLOCK_ERASE_LARGER, true, 450000, 950000 },
+	    		                    { (4 << 20) / 8, CMD_CHIP_ERASE,  false, 3000000, 7000000 }},
 	    .protection_sector_sizes = at25xe041b_protection_sector_sizes,
-	    .protection_sector_count = sizeof(at25xe041b_protection_sector_sizes) / sizeof(size_t),
+	    .protection_sector_count = PROTECTION_SECTOR_COUNT(at25xe041b_protection_sector_sizes),
 	    .read_status_cmd         = CMD_READ_STATUS,
 	    .status_busy_mask        = 0x01,
 	    .status_busy_level       = 0x01,
+	    .status_error_mask       = 0x0020,
 	    .has_so_irq              = true,
 	    .so_done_level           = 0,
 	    .dataflash               = false,
+	    .t_csh_ns                = 50,
+	    .t_pp_typ_us             = 1500,
+	    .t_pp_max_us             = 3000,
+	    .t_wake_dpd_us           = 8,
+	    .t_wake_udpd_us          = 70,
 	},
 	[AT45DB081E] = {
 	    .name                    = "AT45DB081E",
@@ -183,16 +213,22 @@ const spiflash_info_t spiflash_info_table[] =
 	    .address_bytes           = 3,
 	    .program_page_size       = 256,
 	    .erase_info_count        = 3,
-	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,            true },
-	                                { 2048,   CMD_DATAFLASH_BLOCK_ERASE, true },
-	    		                    { (8 << 20) / 8, 0,                  false }},
+	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,            true, 8000, 35000 },
+	                                { 2048,   CMD_DATAFLASH_BLOCK_ERASE, true, 25000, 50000 },
+	    		                    { (8 << 20) / 8, 0,                  false, 10000000, 22000000 }},
 	    .protection_sector_sizes = 0,
 	    .protection_sector_count = 0,
 	    .read_status_cmd         = CMD_DATAFLASH_READ_STATUS,
 	    .status_busy_mask        = 0x80,
 	    .status_busy_level       = 0x00,
+	    .status_error_mask       = 0x2000,
 	    .has_so_irq              = false,
 	    .dataflash               = true,
+	    .t_csh_ns                = 50,
+	    .t_pp_typ_us             = 1500,
+	    .t_pp_max_us             = 3000,
+	    .t_wake_dpd_us           = 35,
+	    .t_wake_udpd_us          = 70,
 	},
 	[AT45DB641E] = {
 	    .name                    = "AT45DB641E",
@@ -202,16 +238,22 @@ const spiflash_info_t spiflash_info_table[] =
 	    .address_bytes           = 3,
 	    .program_page_size       = 256,
 	    .erase_info_count        = 3,
-	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,             true },
-	                                { 2048,   CMD_DATAFLASH_BLOCK_ERASE,  true },
-	    		                    { (64 << 20) / 8, 0,                  false }},
+	    .erase_info              = {{ 256,    CMD_PAGE_ERASE,             true, 8000, 35000 },
+	                                { 2048,   CMD_DATAFLASH_BLOCK_ERASE,  true, 25000, 50000 },
+	    		                    { (64 << 20) / 8, 0,                  false, 80000000, 208000000 }},
 	    .protection_sector_sizes = 0,
 	    .protection_sector_count = 0,
 	    .read_status_cmd         = CMD_DATAFLASH_READ_STATUS,
 	    .status_busy_mask        = 0x80,
 	    .status_busy_level       = 0x00,
+	    .status_error_mask       = 0x2000,
 	    .has_so_irq              = false,
 	    .dataflash               = true,
+	    .t_csh_ns                = 50,
+	    .t_pp_typ_us             = 1500,
+	    .t_pp_max_us             = 3000,
+	    .t_wake_dpd_us           = 35,
+	    .t_wake_udpd_us          = 100,
 	},
 	[RM25C256DS] = {
 		.name                    = "RM25C256DS",
@@ -223,21 +265,27 @@ const spiflash_info_t spiflash_info_table[] =
 #define RM25C256DS_ALLOW_ERASE_64B 1
 #if RM25C256DS_ALLOW_ERASE_64B
 		.erase_info_count        = 2,
-		.erase_info              = {{ 64,              CMD_RM25C_PAGE_ERASE, true },    // 0x42 command
-				                    { (256 << 10) / 8, CMD_CHIP_ERASE,       false }},  // 0x60 or 0xc7
+		.erase_info              = {{ 64,              CMD_RM25C_PAGE_ERASE, true,  1000,  5000 },    // 0x42 command
+				                    { (256 << 10) / 8, CMD_CHIP_ERASE,       false, 50000, 100000 }},  // 0x60 or 0xc7
 #else
 	    .erase_info_count        = 1,
-	    .erase_info              = {{ (256 << 10) / 8, CMD_CHIP_ERASE,       false }},  // 0x60 or 0xc7
+	    .erase_info              = {{ (256 << 10) / 8, CMD_CHIP_ERASE,       false, 50000, 100000 }},  // 0x60 or 0xc7
 #endif
   	    .protection_sector_sizes = 0,
   	    .protection_sector_count = 0,
   	    .read_status_cmd         = CMD_READ_STATUS,
   	    .status_busy_mask        = 0x01,
   	    .status_busy_level       = 0x01,
+  	    .status_error_mask       = 0x0000,
   	    .has_so_irq              = false,
   	    .dataflash               = false,
+  	    .t_csh_ns                = 100,
   	    .read_slow               = true,  // RM25C256DS seems to acutally support the 0x0b READ ARRAY command, but
   	                                      // it's not documented, so we shouldn't use it.
+  	    .t_pp_typ_us             = 1000,
+  	    .t_pp_max_us             = 5000,
+  	    .t_wake_dpd_us           = 10,
+  	    .t_wake_udpd_us          = 10,
 	},
 };
 
@@ -246,13 +294,144 @@ const spiflash_info_t spiflash_info_table[] =
 
 
 static const spiflash_info_t *spiflash_info;
+static uint32_t spiflash_bit_rate;
+static const spiflash_info_t *calibrated_info;
 static bool spiflash_use_so_irq;
 static bool spiflash_busy;
 static spiflash_completion_fn_t *spiflash_completion;
 static void *spiflash_completion_ref;
 
+// Completion for a multi-command operation (erase, write, RMW). The
+// individual commands of the operation use spiflash_completion for
+// their own state machine steps, so the caller's completion has to be
+// kept separately until the whole operation is done.
+static spiflash_completion_fn_t *spiflash_op_completion;
+static void *spiflash_op_completion_ref;
+
 static uint8_t spiflash_scratch_buf [257];
 
+#define SPIFLASH_DEFAULT_BIT_RATE 1000000  // used by spi_init() if bit rate is 0
+
+// Nominal time to start a command and handle its completion, in addition
+// to the time the bytes take on the bus, for duration estimates.
+#define SPIFLASH_CMD_OVERHEAD_US 20
+
+static const uint8_t spiflash_cmd_write_enable[] = { CMD_WRITE_ENABLE };
+
+// Device state tracked by the driver, so that commands which wouldn't
+// change it can be skipped. Only valid as long as all commands which
+// affect it are issued through the functions of this driver, rather
+// than as raw commands.
+static bool spiflash_wel;  // write enable latch known to be set
+static bool protection_known;     // protection_mask is valid
+static uint32_t protection_mask;  // bit n set if protection sector n is protected
+
+// Start address of each protection sector, plus the end of the last one.
+// Parts without individually protectable sectors are treated as a single
+// sector covering the whole device, for the state of global protection.
+static uint32_t protection_sector_start[MAX_PROTECTION_SECTORS + 1];
+static unsigned int protection_sector_count;
+static uint32_t protection_mask_all;
+
+// If set, the next command is preceded by WRITE ENABLE in the same
+// SPI transfer.
+static bool spiflash_prefix_write_enable;
+
+
+/***************************************************************************//**
+ * @brief
+ *   Arrange for the next command to be preceded by WRITE ENABLE
+ * @note
+ * 		For a program, erase or protection command, which requires the write
+ * 		enable latch to be set, and clears it. WRITE ENABLE is only sent if
+ * 		the latch isn't already known to be set, and is sent in the same SPI
+ * 		transfer as the command, so doesn't cost a completion of its own.
+ * 		DataFlash parts don't have a write enable latch.
+ ******************************************************************************/
+static void spiflash_write_enable_first(void)
+{
+	spiflash_prefix_write_enable = ! spiflash_wel && ! spiflash_info->dataflash;
+	spiflash_wel = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Take the prefix for the command about to be sent
+ * @return Number of bytes of spiflash_cmd_write_enable to send first
+ ******************************************************************************/
+static size_t spiflash_take_prefix(void)
+{
+	size_t len = spiflash_prefix_write_enable ? sizeof(spiflash_cmd_write_enable) : 0;
+
+	spiflash_prefix_write_enable = false;
+	return len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Forget tracked device state
+ * @note
+ * 		Called when the device may have been reset, e.g., by entering ultra
+ * 		deep power down, after which the write enable latch is clear and
+ * 		the sector protection is back to its power-up default.
+ ******************************************************************************/
+static void spiflash_forget_state(void)
+{
+	spiflash_wel = false;
+	protection_known = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set up the protection sector table for the detected part
+ ******************************************************************************/
+static void spiflash_protection_init(void)
+{
+	unsigned int i;
+
+	protection_sector_count = spiflash_info->protection_sector_count;  // checked at compile time
+
+	protection_sector_start[0] = 0;
+	if (protection_sector_count == 0)
+	{
+		protection_sector_start[1] = spiflash_info->device_size;
+		protection_mask_all = 1;
+		return;
+	}
+
+	for (i = 0; i < protection_sector_count; i++)
+		protection_sector_start[i + 1] = protection_sector_start[i] + spiflash_info->protection_sector_sizes[i];
+	protection_mask_all = (1 << protection_sector_count) - 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the protection sector containing an address
+ * @note
+ * 		Binary search, since sectors may be of different sizes.
+ * @param[in] addr
+ * 		Address
+ * @return Sector number, or -1 if the address isn't in a protection sector
+ ******************************************************************************/
+static int spiflash_protection_sector(uint32_t addr)
+{
+	unsigned int lo = 0;
+	unsigned int hi = protection_sector_count;
+
+	if ((protection_sector_count == 0) || (addr >= protection_sector_start[hi]))
+		return -1;
+
+	// invariant: start[lo] <= addr < start[hi]
+	while ((hi - lo) > 1)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		if (protection_sector_start[mid] <= addr)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
 
 /***************************************************************************//**
  * @brief
@@ -298,6 +477,27 @@ static void spiflash_spi_simple_completion(void *ref)
 		completion(spiflash_ref);
 }
 
+/***************************************************************************//**
+ * @brief
+ *   Multi-command operation completion
+ * @note
+ * 		Called by the erase, write and RMW state machines when the last
+ * 		command of the operation has finished.  Invokes the completion
+ * 		function which was passed to the top level function.
+ ******************************************************************************/
+static void spiflash_op_complete(void)
+{
+	// copy completion fn ptr and ref arg, to avoid race condition
+	// if completion fn starts another spiflash operation
+	spiflash_completion_fn_t *completion = spiflash_op_completion;
+	void *completion_ref = spiflash_op_completion_ref;
+
+	spiflash_op_completion = NULL;
+
+	if (completion)
+		completion(completion_ref);
+}
+
 /***************************************************************************//**
  * @brief
  *   SPI Flash Single Byte Command
@@ -329,7 +529,8 @@ void spiflash_single_byte_command(uint8_t cmd,
 
 	spiflash_busy = true;
 
-	spi_xfer(1, spiflash_scratch_buf,  // tx1
+	spi_xfer_prefixed(spiflash_take_prefix(), spiflash_cmd_write_enable,  // prefix
+			 1, spiflash_scratch_buf,  // tx1
 			 0, NULL,                  // tx2
 			 true,                     // half duplex
 			 rx_len, rx_buf,           // rx
@@ -377,7 +578,8 @@ void spiflash_multiple_byte_command(size_t tx_len,
 
 	spiflash_busy = true;
 
-	spi_xfer(tx_len, tx_buf,  // tx1
+	spi_xfer_prefixed(spiflash_take_prefix(), spiflash_cmd_write_enable,  // prefix
+			 tx_len, tx_buf,  // tx1
 			 0, NULL,         // tx2
 			 true,            // half duplex
 			 rx_len, rx_buf,  // rx
@@ -443,7 +645,8 @@ void spiflash_command_with_address(uint8_t cmd,
 
 	spiflash_busy = true;
 
-	spi_xfer(i, spiflash_scratch_buf,  // tx1
+	spi_xfer_prefixed(spiflash_take_prefix(), spiflash_cmd_write_enable,  // prefix
+			 i, spiflash_scratch_buf,  // tx1
 			 tx_len, tx_buf,                         // tx2
 			 true,                                   // half duplex
 			 rx_len, rx_buf,
@@ -514,12 +717,46 @@ static size_t erase_len;
 static uint8_t erase_status_buf[2];
 static volatile bool spiflash_erase_busy;
 
+// Measured erase cost of each erase_info entry, 0 if not calibrated.
+// An entry which is not preferred costs more per byte than erasing the
+// same range with smaller commands, so automatic selection skips it.
+static uint32_t erase_ns_per_byte[MAX_ERASE_SIZES];
+static bool erase_preferred[MAX_ERASE_SIZES];
+
 static void spiflash_erase_completion1(void *ref);
 static void spiflash_erase_completion2(void *ref);
 static void spiflash_erase_completion3(void *ref);
 static void spiflash_erase_completion4(void *ref);
 static void spiflash_erase_completion5(void *ref);
 
+/***************************************************************************//**
+ * @brief
+ *   Choose the erase command for the start of a range
+ * @note
+ * 		Uses the largest preferred erase size which fits the remaining
+ * 		length and to which the address is aligned.
+ * @param[in] addr
+ * 		Start address of remaining range
+ * @param[in] len
+ * 		Length of remaining range
+ * @return Erase command, or NULL if there is none suitable
+ ******************************************************************************/
+static const erase_info_t *spiflash_choose_erase(uint32_t addr, size_t len)
+{
+	const erase_info_t *info;
+	int i;
+
+	for (i = spiflash_info->erase_info_count - 1; i >= 0; i--)
+	{
+		info = & spiflash_info->erase_info [i];
+		if ((i > 0) && ! erase_preferred[i])
+			continue;
+		if ((len >= info->size) && addr_aligned(addr, info->size))
+			return info;
+	}
+	return NULL;
+}
+
 /***************************************************************************//**
  * @brief
  *   SPI Erase Completion State 1(initial state)
@@ -530,20 +767,17 @@ static void spiflash_erase_completion5(void *ref);
  ******************************************************************************/
 static void spiflash_erase_completion1(void *ref)
 {
+	(void) ref;
+
 	if (! erase_len)
 	{
 		spiflash_erase_busy = false;
-		spiflash_spi_simple_completion(ref);
+		spiflash_op_complete();
 		return;
 	}
 
-	if (spiflash_info->dataflash)
-		spiflash_erase_completion2(NULL);
-	else
-		spiflash_single_byte_command(CMD_WRITE_ENABLE,
-									 0, NULL,  // rx
-									 spiflash_erase_completion2,
-									 NULL);
+	// WRITE ENABLE, if needed, is sent along with the erase command
+	spiflash_erase_completion2(NULL);
 }
 
 /***************************************************************************//**
@@ -557,28 +791,22 @@ static void spiflash_erase_completion1(void *ref)
  ******************************************************************************/
 static void spiflash_erase_completion2(void *ref)
 {
-	int i;
+	(void) ref;
 
 	if (erase_info_fixed)
 		erase_info = erase_info_fixed;
 	else
 	{
-		for (i = spiflash_info->erase_info_count - 1; i >= 0; i--)
-		{
-			erase_info = & spiflash_info->erase_info [i];
-			if ((erase_len >= erase_info->size) &&
-			    addr_aligned(erase_addr, erase_info->size))
-				break;
-		}
-		if (i < 0)
+		erase_info = spiflash_choose_erase(erase_addr, erase_len);
+		if (! erase_info)
 		{
 			// no suitable erase command found!
 			// should never happen
-			erase_info = NULL;
 			while (true)
 				;
 		}
 	}
+	spiflash_write_enable_first();
 	if (erase_info->addr_needed)
 	{
 		spiflash_command_with_address(erase_info->cmd,
@@ -622,6 +850,8 @@ static void spiflash_erase_completion2(void *ref)
  ******************************************************************************/
 static void spiflash_erase_completion3(void *ref)
 {
+	(void) ref;
+
 	erase_addr += erase_info->size;
 	erase_len -= erase_info->size;
 
@@ -656,6 +886,8 @@ static void spiflash_erase_completion3(void *ref)
  ******************************************************************************/
 static void spiflash_erase_completion4(void *ref)
 {
+	(void) ref;
+
 	spi_wait_so(spiflash_info->so_done_level,
 					spiflash_erase_completion1,
 					NULL);
@@ -672,6 +904,8 @@ static void spiflash_erase_completion4(void *ref)
  ******************************************************************************/
 static void spiflash_erase_completion5(void *ref)
 {
+	(void) ref;
+
 	if ((erase_status_buf[0] & spiflash_info->status_busy_mask) == spiflash_info->status_busy_level)
 	{
         // BUSY
@@ -753,6 +987,7 @@ bool spiflash_erase(uint32_t addr,
 	{
 		// No erase size per command was specified.
 		// Ensure that there is a suitable choice.
+		erase_info_fixed = NULL;
 		for (i = spiflash_info->erase_info_count - 1; i >= 0; i--)
 		{
 			erase_info = & spiflash_info->erase_info [i];
@@ -770,8 +1005,8 @@ bool spiflash_erase(uint32_t addr,
 
 	erase_addr = addr;
 	erase_len = len;
-	spiflash_completion = completion;
-	spiflash_completion_ref = completion_ref;
+	spiflash_op_completion = completion;
+	spiflash_op_completion_ref = completion_ref;
 	spiflash_erase_busy = true;
 
 	if (spiflash_info->dataflash)
@@ -795,6 +1030,145 @@ bool spiflash_erase(uint32_t addr,
 	return true;
 }
 
+/***************************************************************************//**
+ * @brief
+ *   Choose preferred erase sizes from the erase cost table
+ * @note
+ * 		All erase sizes are powers of two, so an aligned block of any size
+ * 		can be erased exactly by commands of any smaller size. A size is
+ * 		preferred only if it is no more expensive per byte than the cheapest
+ * 		way of erasing the same block with smaller commands. Sizes which have
+ * 		not been calibrated are always preferred.
+ ******************************************************************************/
+static void spiflash_erase_choose_preferred(void)
+{
+	int i;
+	uint32_t best = 0;  // lowest cost per byte of sizes below i, 0 if unknown
+
+	for (i = 0; i < spiflash_info->erase_info_count; i++)
+	{
+		uint32_t cost = erase_ns_per_byte[i];
+
+		erase_preferred[i] = (cost == 0) || (best == 0) || (cost <= best);
+		if (cost && ((best == 0) || (cost < best)))
+			best = cost;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Calibrate Erase Sizes
+ * @note
+ * 		Measures the time taken by each erase command of the attached part,
+ * 		and from then on spiflash_erase() in auto mode (cmd_size == 0) uses
+ * 		the combination of erase commands which takes the least total time.
+ * 		Each erase size is timed by erasing the whole calibration region
+ * 		with commands of that size, so that the short commands are
+ * 		measured over many repetitions. The calibration region is the size
+ * 		of the largest erase command other than chip erase, and its
+ * 		contents are destroyed. Chip erase is only timed if requested, as it
+ * 		destroys the contents of the whole part.
+ * 		The flash must be unprotected over the calibration region.
+ * @param[in] addr
+ * 		Start of calibration region, aligned to its size
+ * @param[in] include_chip_erase
+ * 		If true, also time chip erase
+ * @param[in] use_so_irq
+ * 		Determines whether or not Active SO is used or not.
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool spiflash_erase_calibrate(uint32_t addr,
+		                      bool include_chip_erase,
+		                      bool use_so_irq)
+{
+	int i;
+	uint32_t region_size = 0;
+	const erase_info_t *ei;
+
+	for (i = 0; i < spiflash_info->erase_info_count; i++)
+	{
+		ei = & spiflash_info->erase_info [i];
+		if (ei->addr_needed)
+			region_size = ei->size;
+	}
+	if ((region_size == 0) || ! addr_aligned(addr, region_size))
+		return false;
+
+	for (i = 0; i < spiflash_info->erase_info_count; i++)
+	{
+		uint64_t start;
+		uint32_t start_addr;
+		uint32_t len;
+		uint32_t us;
+
+		ei = & spiflash_info->erase_info [i];
+		if (ei->addr_needed)
+		{
+			start_addr = addr;
+			len = region_size;
+		}
+		else if (include_chip_erase)
+		{
+			start_addr = 0;
+			len = ei->size;
+		}
+		else
+			continue;
+
+		start = RTCDRV_GetWallClockTicks64();
+		if (! spiflash_erase(start_addr, len, ei->size, use_so_irq, NULL, NULL))
+			return false;
+		// scaling the tick count by 1000 makes the conversion yield microseconds
+		us = RTCDRV_TicksToMsec((RTCDRV_GetWallClockTicks64() - start) * 1000);
+
+		erase_ns_per_byte[i] = ((uint64_t) us * 1000 + len - 1) / len;
+		if (erase_ns_per_byte[i] == 0)
+			erase_ns_per_byte[i] = 1;
+	}
+
+	spiflash_erase_choose_preferred();
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get Erase Calibration Table
+ * @note
+ * 		Entries correspond to erase_info[] of the attached part; an entry is
+ * 		0 if that erase size has not been calibrated. The table may be saved
+ * 		by the application and restored with spiflash_set_erase_calibration()
+ * 		to avoid repeating the calibration.
+ * @param[out] *ns_per_byte
+ * 		Array of MAX_ERASE_SIZES entries to receive the erase cost per byte
+ * @param[out] *preferred
+ * 		Array of MAX_ERASE_SIZES entries to receive whether each size is used
+ * 		by automatic erase selection, or NULL
+ ******************************************************************************/
+void spiflash_get_erase_calibration(uint32_t *ns_per_byte,
+		                            bool *preferred)
+{
+	memcpy(ns_per_byte, erase_ns_per_byte, sizeof(erase_ns_per_byte));
+	if (preferred)
+		memcpy(preferred, erase_preferred, sizeof(erase_preferred));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set Erase Calibration Table
+ * @param[in] *ns_per_byte
+ * 		Array of MAX_ERASE_SIZES entries of erase cost per byte, as returned
+ * 		by spiflash_get_erase_calibration(), or NULL to clear the calibration
+ ******************************************************************************/
+void spiflash_set_erase_calibration(const uint32_t *ns_per_byte)
+{
+	if (ns_per_byte)
+		memcpy(erase_ns_per_byte, ns_per_byte, sizeof(erase_ns_per_byte));
+	else
+		memset(erase_ns_per_byte, 0, sizeof(erase_ns_per_byte));
+	spiflash_erase_choose_preferred();
+}
+
 
 static uint8_t *write_data;
 static uint32_t write_addr;
@@ -802,6 +1176,8 @@ static size_t write_len;
 static size_t write_size;
 static uint8_t write_status_buf[2];
 static volatile bool spiflash_write_busy;
+static spiflash_write_source_fn_t *write_source;
+static void *write_source_ref;
 
 static void spiflash_write_completion1(void *ref);
 static void spiflash_write_completion2(void *ref);
@@ -809,6 +1185,38 @@ static void spiflash_write_completion3(void *ref);
 static void spiflash_write_completion4(void *ref);
 static void spiflash_write_completion5(void *ref);
 
+/***************************************************************************//**
+ * @brief
+ *   Size of the next write chunk
+ * @note
+ * 		A single program command can't cross a program page boundary.
+ * @return Number of bytes to program at write_addr
+ ******************************************************************************/
+static size_t spiflash_write_chunk_size(void)
+{
+	size_t size = write_len;
+
+	if ((write_addr & ~(spiflash_info->program_page_size-1)) !=
+		((write_addr + size - 1) & ~(spiflash_info->program_page_size-1)))
+		size = spiflash_info->program_page_size - (write_addr & (spiflash_info->program_page_size-1));
+	return size;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Ask the write source for the next chunk
+ * @note
+ * 		Sets write_size and write_data. If the source has no data, the
+ * 		remainder of the write is abandoned.
+ ******************************************************************************/
+static void spiflash_write_pull(void)
+{
+	write_size = spiflash_write_chunk_size();
+	write_data = write_source(write_addr, write_size, write_source_ref);
+	if (! write_data)
+		write_len = 0;
+}
+
 /***************************************************************************//**
  * @brief
  *   SPI Write Completion State 1(initial state)
@@ -819,20 +1227,17 @@ static void spiflash_write_completion5(void *ref);
  ******************************************************************************/
 static void spiflash_write_completion1(void *ref)
 {
+	(void) ref;
+
 	if (! write_len)
 	{
 		spiflash_write_busy = false;
-		spiflash_spi_simple_completion(ref);
+		spiflash_op_complete();
 		return;
 	}
 
-	if (spiflash_info->dataflash)
-		spiflash_write_completion2(NULL);
-	else
-		spiflash_single_byte_command(CMD_WRITE_ENABLE,
-			                     	 0, NULL,  // rx
-			                     	 spiflash_write_completion2,
-			                     	 NULL);
+	// WRITE ENABLE, if needed, is sent along with the program command
+	spiflash_write_completion2(NULL);
 }
 
 /***************************************************************************//**
@@ -845,11 +1250,12 @@ static void spiflash_write_completion1(void *ref)
  ******************************************************************************/
 static void spiflash_write_completion2(void *ref)
 {
-	write_size = write_len;
-	if ((write_addr & ~(spiflash_info->program_page_size-1)) !=
-		((write_addr + write_size - 1) & ~(spiflash_info->program_page_size-1)))
-		write_size = spiflash_info->program_page_size - (write_addr & (spiflash_info->program_page_size-1));
+	(void) ref;
+
+	if (! write_source)
+		write_size = spiflash_write_chunk_size();
 
+	spiflash_write_enable_first();
 	spiflash_command_with_address(CMD_BYTE_PAGE_PROGRAM,
 	                              write_addr,
 	                              0, // dummy bytes
@@ -874,6 +1280,8 @@ static void spiflash_write_completion2(void *ref)
  ******************************************************************************/
 static void spiflash_write_completion3(void *ref)
 {
+	(void) ref;
+
 	// Write is in progress, but advance the address
 	// and decrease the length in preparation for next
 	// iteration.  If write_len drops to zero, that will
@@ -883,6 +1291,11 @@ static void spiflash_write_completion3(void *ref)
 	write_addr += write_size;
 	write_len -= write_size;
 
+	// With a write source, the next chunk is prepared while this one
+	// programs, so it is ready as soon as the flash is no longer busy.
+	if (write_source && write_len)
+		spiflash_write_pull();
+
 	if (spiflash_use_so_irq == 1)
 	{
 		// use of SO is enabled, so issue ASI command
@@ -914,6 +1327,8 @@ static void spiflash_write_completion3(void *ref)
  ******************************************************************************/
 static void spiflash_write_completion4(void *ref)
 {
+	(void) ref;
+
 	// wait for flash chip to be done with command,
 	// then invoke completion1
 	spi_wait_so(spiflash_info->so_done_level,
@@ -932,6 +1347,8 @@ static void spiflash_write_completion4(void *ref)
  ******************************************************************************/
 static void spiflash_write_completion5(void *ref)
 {
+	(void) ref;
+
 	if ((write_status_buf[0] & spiflash_info->status_busy_mask) == spiflash_info->status_busy_level)
 	{
         // BUSY
@@ -980,10 +1397,82 @@ void spiflash_write(uint32_t addr,
 	write_data = buffer;
 	write_addr = addr;
 	write_len = len;
-	spiflash_completion = completion;
-	spiflash_completion_ref = completion_ref;
+	write_source = NULL;
+	spiflash_op_completion = completion;
+	spiflash_op_completion_ref = completion_ref;
+	spiflash_write_busy = true;
+
+	if (spiflash_info->dataflash)
+		spiflash_multiple_byte_command(sizeof(dataflash_cmd_disable_sector_protection), dataflash_cmd_disable_sector_protection,
+									   0, NULL, // rx
+									   false, // hold_cs_active
+									   spiflash_write_completion1,
+									   NULL);
+
+	else
+		spiflash_write_completion1(NULL);
+
+	// if called synchronously, wait for entire write sequence to complete
+	if (! completion)
+		while (spiflash_write_busy)
+			enter_low_power_state();
+}
+
+
+/***************************************************************************//**
+ * @brief
+ *   SPI Flash Write from a Data Source
+ * @note
+ * 		Like spiflash_write(), but instead of a buffer, the data is obtained
+ * 		one program page at a time from a source callback. The source is
+ * 		called for the first page before the write starts, and for each
+ * 		following page as soon as the previous page has been transferred to
+ * 		the flash, while the flash is still busy programming it. Preparing
+ * 		the data therefore overlaps the page program time, rather than
+ * 		adding to it.
+ *
+ * 		Except for the first page, the source is called from interrupt
+ * 		context. The data it returns must remain valid until the source is
+ * 		called again or the write completes; since the previous page has
+ * 		already been transferred by then, a single page buffer may be
+ * 		reused for every page. If the source returns NULL, the rest of the
+ * 		write is abandoned.
+ * @param[in] addr
+ * 		Address to write to
+ * @param[in] len
+ * 		How many bytes to write
+ * @param[in] *source
+ * 		Data source callback
+ * @param[in] *source_ref
+ * 		Argument to be passed to data source callback function
+ * @param[in] use_so_irq
+ * 		Determines whether or not Active SO is used or not.
+ * @param[in] *completion
+ * 		Completion Function pointer.
+ * @param[in] *completion_ref
+ * 		Argument to be passed to completion callback function
+ ******************************************************************************/
+void spiflash_write_source(uint32_t addr,
+		                   size_t len,
+		                   spiflash_write_source_fn_t *source,
+		                   void *source_ref,
+		                   bool use_so_irq,
+		                   spiflash_completion_fn_t *completion,
+		                   void *completion_ref)
+{
+	spiflash_use_so_irq = use_so_irq && spiflash_info->has_so_irq;
+
+	write_addr = addr;
+	write_len = len;
+	write_source = source;
+	write_source_ref = source_ref;
+	spiflash_op_completion = completion;
+	spiflash_op_completion_ref = completion_ref;
 	spiflash_write_busy = true;
 
+	if (write_len)
+		spiflash_write_pull();
+
 	if (spiflash_info->dataflash)
 		spiflash_multiple_byte_command(sizeof(dataflash_cmd_disable_sector_protection), dataflash_cmd_disable_sector_protection,
 									   0, NULL, // rx
@@ -1015,6 +1504,8 @@ static void dataflash_rmw_completion3(void *ref);
  ******************************************************************************/
 static void dataflash_rmw_completion1(void *ref)
 {
+	(void) ref;
+
 	spiflash_command_with_address(CMD_DATAFLASH_RMW_BUF1,
 	                              write_addr,
 	                              0, // dummy bytes
@@ -1035,6 +1526,8 @@ static void dataflash_rmw_completion1(void *ref)
  ******************************************************************************/
 static void dataflash_rmw_completion2(void *ref)
 {
+	(void) ref;
+
 	// start polling status register
 	write_status_buf[0] = spiflash_info->status_busy_level;  // prime pump w/ BUSY
 	dataflash_rmw_completion3(NULL);
@@ -1051,6 +1544,8 @@ static void dataflash_rmw_completion2(void *ref)
  ******************************************************************************/
 static void dataflash_rmw_completion3(void *ref)
 {
+	(void) ref;
+
 	// poll the status register
 	// until the flash indicates that the RMW is done.
 	if ((write_status_buf[0] & spiflash_info->status_busy_mask) == spiflash_info->status_busy_level)
@@ -1066,7 +1561,7 @@ static void dataflash_rmw_completion3(void *ref)
 	{
 		// DONE
 		spiflash_write_busy = false;
-		spiflash_spi_simple_completion(ref);
+		spiflash_op_complete();
 	}
 }
 
@@ -1101,8 +1596,8 @@ void dataflash_rmw(uint32_t addr,
 	write_data = buffer;
 	write_addr = addr;
 	write_len = len;
-	spiflash_completion = completion;
-	spiflash_completion_ref = completion_ref;
+	spiflash_op_completion = completion;
+	spiflash_op_completion_ref = completion_ref;
 	spiflash_write_busy = true;
 
 	spiflash_multiple_byte_command(sizeof(dataflash_cmd_disable_sector_protection), dataflash_cmd_disable_sector_protection,
@@ -1121,6 +1616,11 @@ void dataflash_rmw(uint32_t addr,
 /***************************************************************************//**
  * @brief
  * 		Send Write Enable/Disable Command
+ * @note
+ * 		Program, erase and protection functions of this driver send WRITE
+ * 		ENABLE themselves as needed, so this is only required before raw
+ * 		commands. Nothing is sent if the write enable latch is already
+ * 		known to be set.
  * @param[in] *ref
  * 		Completion Function Pointer
  ******************************************************************************/
@@ -1128,15 +1628,127 @@ void spiflash_set_write_enable(bool enable,
 					           spiflash_completion_fn_t *completion,
                                void *completion_ref)
 {
+	if (enable && spiflash_wel)
+	{
+		// latch is already set
+		if (completion)
+			completion(completion_ref);
+		return;
+	}
+
+	spiflash_wel = enable;
 	spiflash_single_byte_command(enable ? CMD_WRITE_ENABLE : CMD_WRITE_DISABLE,
 			                     0, NULL,  // rx
 			                     completion,
 			                     completion_ref);
 }
 
+/***************************************************************************//**
+ * @brief
+ * 		Decode the Block Protect Bits of Status Register Byte 1
+ * @note
+ * 		For parts which protect by the status register. BP2..BP0 protect
+ * 		none, 1/8, 1/4 or 1/2 of the protection sectors, or with BP2 set,
+ * 		all of them. TB set counts the sectors from the bottom of the array
+ * 		rather than the top. Assumes SEC and CMP clear, as they are from the
+ * 		factory and as this driver leaves them.
+ * @param[in] status
+ * 		Status register byte 1
+ * @return Protection mask
+ ******************************************************************************/
+static uint32_t spiflash_status_protection_mask(uint8_t status)
+{
+	unsigned int bp = (status >> 2) & 0x07;
+	unsigned int n;
+
+	if (bp == 0)
+		return 0;
+	if (bp >= 4)
+		return protection_mask_all;
+
+	n = protection_sector_count >> (4 - bp);
+	if (status & 0x20)
+		return (1 << n) - 1;
+	return protection_mask_all & ~ ((1 << (protection_sector_count - n)) - 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Number of Protection Sectors in a Mask
+ * @param[in] mask
+ * 		Protection mask
+ * @return Number of bits set
+ ******************************************************************************/
+static unsigned int spiflash_protection_mask_count(uint32_t mask)
+{
+	unsigned int n = 0;
+
+	for ( ; mask; mask &= mask - 1)
+		n++;
+	return n;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Set Protection through the Block Protect Bits of the Status Register
+ * @note
+ * 		The block protect bits can only express a run of sectors from the
+ * 		top or the bottom of the array, so the requested mask is rounded to
+ * 		the nearest one they can: when protecting, the fewest sectors which
+ * 		include all of the mask; when unprotecting, the most sectors which
+ * 		include none outside it. Either way the sectors asked for end up in
+ * 		the requested state, but others may change with them.
+ * @param[in] protect
+ * 		True/False
+ * @param[in] mask
+ * 		Requested protection mask
+ * @param[in] *completion
+ * 		Completion Function pointer.
+ * @param[in] *completion_ref
+ * 		Argument to be passed to completion callback function
+ ******************************************************************************/
+static void spiflash_set_status_protection(bool protect,
+		                                   uint32_t mask,
+		                                   spiflash_completion_fn_t *completion,
+		                                   void *completion_ref)
+{
+	uint8_t best_bits = protect ? 0x1c : 0x00;  // all or none, always acceptable
+	uint32_t best_mask = protect ? protection_mask_all : 0;
+	uint8_t bits;
+
+	for (bits = 0x00; bits <= 0x3c; bits += 0x04)
+	{
+		uint32_t m = spiflash_status_protection_mask(bits);
+
+		if (protect ? ((m & mask) != mask) : ((m & ~ mask) != 0))
+			continue;
+		if (protect ? (spiflash_protection_mask_count(m) < spiflash_protection_mask_count(best_mask)) :
+				      (spiflash_protection_mask_count(m) > spiflash_protection_mask_count(best_mask)))
+		{
+			best_bits = bits;
+			best_mask = m;
+		}
+	}
+	protection_known = true;
+	protection_mask = best_mask;
+
+	spiflash_scratch_buf[0] = CMD_WRITE_STATUS_REG_BYTE_1;
+	spiflash_scratch_buf[1] = best_bits;
+
+	spiflash_write_enable_first();
+	spiflash_multiple_byte_command(2, spiflash_scratch_buf,  // tx
+			                       0, NULL, // rx
+			                       false,  // hold_cs_active
+			                       completion,
+			                       completion_ref);
+}
+
 /***************************************************************************//**
  * @brief
  * 		Send Sector Protect/Unprotect Command
+ * @note
+ * 		On a part which protects by the status register, writes the block
+ * 		protect bits instead, which may change neighbouring sectors too.
  * @param[in] protect
  * 		True/False
  * @param[in] addr
@@ -1151,6 +1763,28 @@ void spiflash_set_sector_protection(bool protect,
 		                            spiflash_completion_fn_t *completion,
                                     void *completion_ref)
 {
+	int sector = spiflash_protection_sector(addr);
+
+	if (spiflash_info->protection_by_status && (sector >= 0))
+	{
+		if (! protection_known)
+			spiflash_read_sector_protection();
+		spiflash_set_status_protection(protect,
+				                       protect ? (protection_mask | (1 << sector)) :
+				                    		     (protection_mask & ~ (1 << sector)),
+				                       completion,
+				                       completion_ref);
+		return;
+	}
+
+	if (sector < 0)
+		protection_known = false;
+	else if (protect)
+		protection_mask |= (1 << sector);
+	else
+		protection_mask &= ~ (1 << sector);
+
+	spiflash_write_enable_first();
 	spiflash_command_with_address(protect? CMD_PROTECT_SECTOR : CMD_UNPROTECT_SECTOR,
 			                      addr,
 			                      0, // dummy bytes
@@ -1164,6 +1798,9 @@ void spiflash_set_sector_protection(bool protect,
 /***************************************************************************//**
  * @brief
  * 		Send Global Protect Command
+ * @note
+ * 		Nothing is sent if all sectors are already known to be in the
+ * 		requested state.
  * @param[in] protect
  * 		True/False
   * @param[in] *completion
@@ -1175,9 +1812,22 @@ void spiflash_set_global_protect(bool protect,
 								 spiflash_completion_fn_t *completion,
 								 void *completion_ref)
 {
+	uint32_t new_mask = protect ? protection_mask_all : 0;
+
+	if (protection_known && (protection_mask == new_mask))
+	{
+		// all sectors are already in the requested state
+		if (completion)
+			completion(completion_ref);
+		return;
+	}
+	protection_known = true;
+	protection_mask = new_mask;
+
 	spiflash_scratch_buf[0] = CMD_WRITE_STATUS_REG_BYTE_1;
 	spiflash_scratch_buf[1] = protect ? 0x3c : 0x00;
 
+	spiflash_write_enable_first();
 	spiflash_multiple_byte_command(2, spiflash_scratch_buf,  // tx
 			                       0, NULL, // rx
 			                       false,  // hold_cs_active
@@ -1185,6 +1835,192 @@ void spiflash_set_global_protect(bool protect,
 			                       completion_ref);
 }
 
+/***************************************************************************//**
+ * @brief
+ * 		Read Sector Protection Registers
+ * @note
+ * 		Reads the protection state of every protection sector into the
+ * 		driver's cache, or on a part which protects by the status register,
+ * 		decodes it from the block protect bits. Not normally needed, since
+ * 		the cache is filled on first use and then kept up to date.
+ * 		Synchronous.
+ ******************************************************************************/
+void spiflash_read_sector_protection(void)
+{
+	unsigned int i;
+	uint8_t reg;
+
+	if (spiflash_info->protection_by_status)
+	{
+		spiflash_read_status(1, & reg, NULL, NULL);
+		protection_mask = spiflash_status_protection_mask(reg);
+		protection_known = true;
+		return;
+	}
+
+	protection_mask = 0;
+	for (i = 0; i < protection_sector_count; i++)
+	{
+		spiflash_command_with_address(CMD_READ_SECTOR_PROTECTION,
+				                      protection_sector_start[i],
+				                      0,          // dummy bytes
+				                      0, NULL,    // tx
+				                      1, & reg,   // rx
+				                      NULL,
+				                      NULL);
+		if (reg)
+			protection_mask |= (1 << i);
+	}
+	protection_known = protection_sector_count != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Protect or Unprotect an Address Range
+ * @note
+ * 		Maps the range to the protection sectors which contain it, and sends
+ * 		commands only for sectors which aren't already in the requested
+ * 		state. If the result is that every sector is protected, or every
+ * 		sector unprotected, a single global protect command is used instead.
+ * 		Since sectors are whole units, parts of the neighbouring data in the
+ * 		first and last sector are affected too. On a part which protects by
+ * 		the status register, the block protect bits are written instead,
+ * 		which may change other sectors as well. Synchronous.
+ * @param[in] protect
+ * 		True/False
+ * @param[in] addr
+ * 		Start address of range
+ * @param[in] len
+ * 		Length of range in bytes
+ * @return TRUE/FALSE
+ * 		False if the part doesn't have protection sectors, or the range
+ * 		isn't within them
+ ******************************************************************************/
+bool spiflash_set_range_protection(bool protect,
+		                           uint32_t addr,
+		                           size_t len)
+{
+	int first;
+	int last;
+	int i;
+	uint32_t range_mask;
+	uint32_t new_mask;
+
+	if (len == 0)
+		return false;
+	first = spiflash_protection_sector(addr);
+	last = spiflash_protection_sector(addr + len - 1);
+	if ((first < 0) || (last < 0))
+		return false;
+
+	if (! protection_known)
+		spiflash_read_sector_protection();
+
+	range_mask = ((1 << (last + 1)) - 1) & ~ ((1 << first) - 1);
+	if (protect)
+		new_mask = protection_mask | range_mask;
+	else
+		new_mask = protection_mask & ~ range_mask;
+
+	if ((new_mask == protection_mask_all) || (new_mask == 0))
+	{
+		spiflash_set_global_protect(new_mask != 0, NULL, NULL);
+		return true;
+	}
+	if (spiflash_info->protection_by_status)
+	{
+		if (new_mask != protection_mask)
+			spiflash_set_status_protection(protect, new_mask, NULL, NULL);
+		return true;
+	}
+
+	for (i = first; i <= last; i++)
+		if ((new_mask ^ protection_mask) & (1 << i))
+			spiflash_set_sector_protection(protect, protection_sector_start[i], NULL, NULL);
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Check whether Any of an Address Range is Protected
+ * @note
+ * 		From the driver's protection state, reading the sector protection
+ * 		registers if it isn't known. A part without protection sectors is
+ * 		only known to be protected after a global protect through the
+ * 		driver. Synchronous.
+ * @param[in] addr
+ * 		Start address of range
+ * @param[in] len
+ * 		Length of range in bytes
+ * @return TRUE/FALSE
+ ******************************************************************************/
+bool spiflash_range_protected(uint32_t addr,
+		                      size_t len)
+{
+	int first;
+	int last;
+	uint32_t range_mask;
+
+	if (protection_sector_count == 0)
+		return protection_known && protection_mask;
+
+	first = spiflash_protection_sector(addr);
+	last = spiflash_protection_sector(addr + len - 1);
+	if ((len == 0) || (first < 0))
+		return false;
+	if (last < 0)
+		last = protection_sector_count - 1;
+
+	if (! protection_known)
+		spiflash_read_sector_protection();
+
+	range_mask = ((1 << (last + 1)) - 1) & ~ ((1 << first) - 1);
+	return (protection_mask & range_mask) != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Check whether the Last Program or Erase Failed
+ * @note
+ * 		Reads the status register, for parts which report errors there.
+ * 		Synchronous.
+ * @return TRUE if the part reports an error
+ ******************************************************************************/
+bool spiflash_op_failed(void)
+{
+	uint8_t status[2];
+
+	if (! spiflash_info->status_error_mask)
+		return false;
+	spiflash_read_status(sizeof(status), status, NULL, NULL);
+	return ((status[0] | (status[1] << 8)) & spiflash_info->status_error_mask) != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Find the Protection Sector Containing an Address
+ * @param[in] addr
+ * 		Address
+ * @param[out] *start
+ * 		Start address of sector
+ * @param[out] *size
+ * 		Size of sector
+ * @return TRUE/FALSE
+ * 		False if the address isn't in a protection sector
+ ******************************************************************************/
+bool spiflash_get_protection_sector(uint32_t addr,
+		                            uint32_t *start,
+		                            uint32_t *size)
+{
+	int sector = spiflash_protection_sector(addr);
+
+	if (sector < 0)
+		return false;
+	*start = protection_sector_start[sector];
+	*size = protection_sector_start[sector + 1] - protection_sector_start[sector];
+	return true;
+}
+
 /***************************************************************************//**
  * @brief
  * 		Send Reset Command
@@ -1205,6 +2041,8 @@ void spiflash_reset(spiflash_completion_fn_t *completion,
 	spiflash_scratch_buf[0] = CMD_RESET;
 	spiflash_scratch_buf[1] = ARG_RESET;
 
+	spiflash_forget_state();
+
 	spiflash_multiple_byte_command(2, spiflash_scratch_buf,  // tx
 			                       0, NULL, // rx
 			                       false,  // hold_cs_active
@@ -1265,6 +2103,10 @@ void spiflash_write_otp(uint32_t addr,
 		                spiflash_completion_fn_t *completion,
 		                void *completion_ref)
 {
+	(void) completion;
+	(void) completion_ref;
+
+	spiflash_write_enable_first();
 	spiflash_command_with_address(CMD_PROGRAM_OTP,
 	                              addr,
 	                              0, // dummy bytes
@@ -1388,12 +2230,175 @@ void spiflash_ultra_deep_power_down(bool power_down,
 	                                void *completion_ref)
 {
 	// any command can be used to resume; device will otherwise ignore the cmd
+	if (power_down)
+		spiflash_forget_state();
 	spiflash_single_byte_command(power_down ? CMD_ULTRA_DEEP_POWER_DOWN : CMD_RESUME_FROM_DEEP_POWER_DOWN,
 			                     0, NULL,  // rx
 			                     completion,
 			                     completion_ref);
 }
 
+/***************************************************************************//**
+ * @brief
+ * 		Determines if the driver can accept a new command or operation
+ * @note
+ * 		The driver can only hold one command or operation at a time. Callers
+ * 		which issue asynchronous (completion != NULL) requests must not start
+ * 		another one until the previous one has completed.
+ * @return TRUE/FALSE
+ * 		True if no command, erase or write is in progress
+ ******************************************************************************/
+
+bool spiflash_idle(void)
+{
+	return ! (spiflash_busy || spiflash_erase_busy || spiflash_write_busy);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Estimated duration of one command
+ * @param[in] bytes
+ * 		Number of bytes transferred, including command, address and dummy bytes
+ * @return Duration in microseconds, at the current SPI bit rate
+ ******************************************************************************/
+static uint64_t spiflash_estimate_xfer_us(uint64_t bytes)
+{
+	return SPIFLASH_CMD_OVERHEAD_US + (bytes * 8 * 1000000 + spiflash_bit_rate - 1) / spiflash_bit_rate;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Limit an estimate to the range of the return value
+ ******************************************************************************/
+static uint32_t spiflash_estimate_limit(uint64_t us)
+{
+	return (us > UINT32_MAX) ? UINT32_MAX : us;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Estimate Read Duration
+ * @param[in] len
+ * 		How many bytes to read
+ * @return Duration in microseconds
+ ******************************************************************************/
+uint32_t spiflash_estimate_read_us(size_t len)
+{
+	unsigned int overhead = 1 + spiflash_info->address_bytes + (spiflash_info->read_slow ? 0 : 1);
+
+	return spiflash_estimate_limit(spiflash_estimate_xfer_us(overhead + len));
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Estimate Write Duration
+ * @note
+ * 		Assumes every page program takes the full page program time, even
+ * 		if only part of the page is written.
+ * @param[in] addr
+ * 		Address to write to
+ * @param[in] len
+ * 		How many bytes to write
+ * @param[in] worst_case
+ * 		If true, use maximum rather than typical program times
+ * @return Duration in microseconds
+ ******************************************************************************/
+uint32_t spiflash_estimate_write_us(uint32_t addr,
+		                            size_t len,
+		                            bool worst_case)
+{
+	uint32_t page_size = spiflash_info->program_page_size;
+	uint32_t t_pp = worst_case ? spiflash_info->t_pp_max_us : spiflash_info->t_pp_typ_us;
+	uint64_t pages;
+	uint64_t us = 0;
+
+	if (len == 0)
+		return 0;
+
+	if (spiflash_info->dataflash)
+		us += spiflash_estimate_xfer_us(sizeof(dataflash_cmd_disable_sector_protection));
+
+	pages = ((addr + len - 1) / page_size) - (addr / page_size) + 1;
+	us += pages * (spiflash_estimate_xfer_us(1 + spiflash_info->address_bytes) + t_pp);
+	us += spiflash_estimate_xfer_us(len) - SPIFLASH_CMD_OVERHEAD_US;
+	return spiflash_estimate_limit(us);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Estimate Erase Duration
+ * @note
+ * 		Follows the same choice of erase commands as spiflash_erase(),
+ * 		including any erase calibration.
+ * @param[in] addr
+ * 		Address to start erasing at
+ * @param[in] len
+ * 		How many bytes to erase
+ * @param[in] cmd_size
+ * 		Bytes per erase command, 0 for auto
+ * @param[in] worst_case
+ * 		If true, use maximum rather than typical erase times
+ * @return Duration in microseconds, or 0 if spiflash_erase() would refuse
+ * 		the request
+ ******************************************************************************/
+uint32_t spiflash_estimate_erase_us(uint32_t addr,
+		                            size_t len,
+		                            uint32_t cmd_size,
+		                            bool worst_case)
+{
+	const erase_info_t *info = NULL;
+	uint64_t us = 0;
+	int i;
+
+	if (cmd_size)
+	{
+		if (len % cmd_size)
+			return 0;
+		for (i = 0; i < spiflash_info->erase_info_count; i++)
+			if (spiflash_info->erase_info[i].size == cmd_size)
+				info = & spiflash_info->erase_info[i];
+		if (! info)
+			return 0;
+	}
+
+	if (spiflash_info->dataflash)
+		us += spiflash_estimate_xfer_us(sizeof(dataflash_cmd_disable_sector_protection));
+
+	while (len)
+	{
+		if (! cmd_size)
+		{
+			info = spiflash_choose_erase(addr, len);
+			if (! info)
+				return 0;
+		}
+		if (info->addr_needed)
+			us += spiflash_estimate_xfer_us(1 + spiflash_info->address_bytes);
+		else if (spiflash_info->dataflash)
+			us += spiflash_estimate_xfer_us(sizeof(dataflash_cmd_chip_erase));
+		else
+			us += spiflash_estimate_xfer_us(1);
+		us += worst_case ? info->t_max_us : info->t_typ_us;
+		addr += info->size;
+		len -= info->size;
+	}
+	return spiflash_estimate_limit(us);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Estimate Wake-up Duration
+ * @param[in] ultra_deep
+ * 		True for exit from ultra deep power down, false for resume from deep
+ * 		power down
+ * @return Duration in microseconds, including the resume command
+ ******************************************************************************/
+uint32_t spiflash_estimate_wake_us(bool ultra_deep)
+{
+	return spiflash_estimate_xfer_us(1) +
+			(ultra_deep ? spiflash_info->t_wake_udpd_us : spiflash_info->t_wake_dpd_us);
+}
+
 /***************************************************************************//**
  * @brief
  * 		Determines if Device is DataFlash or note
@@ -1479,12 +2484,15 @@ bool dataflash_set_page_size(uint32_t page_size)
 //SPI Port Initialization:  Reads Device ID, Verify if it is Device we support
 spiflash_id_t spiflash_init(int bit_rate)
 {
-	int i;
+	unsigned int i;
 	const spiflash_info_t *p;
 
 	spi_init(bit_rate);
+	spiflash_bit_rate = bit_rate ? bit_rate : SPIFLASH_DEFAULT_BIT_RATE;
 	spiflash_busy = false;
 	spiflash_info = NULL;
+	spiflash_prefix_write_enable = false;
+	spiflash_forget_state();
 
 	// issue a resume from deep power down synchronously
 	spiflash_deep_power_down(false, NULL, NULL);
@@ -1499,6 +2507,15 @@ spiflash_id_t spiflash_init(int bit_rate)
 		if (memcmp(spiflash_scratch_buf, p->id_bytes, p->id_size) == 0)
 		{
 			spiflash_info = p;
+			spiflash_protection_init();
+			spi_set_cs_high_ns(p->t_csh_ns);
+			spi_trace_set_address_bytes(p->address_bytes);
+			// erase calibration is only valid for the part it was measured on
+			if (p != calibrated_info)
+			{
+				calibrated_info = p;
+				spiflash_set_erase_calibration(NULL);
+			}
 			return i;
 		}
 	}
@@ -66,6 +66,8 @@ typedef struct
 	size_t size;
 	uint8_t cmd;
 	bool addr_needed;
+	uint32_t t_typ_us;  // typical erase time, tSE/tBE/tCE
+	uint32_t t_max_us;  // maximum erase time
 } erase_info_t;
 
 #define MAX_ERASE_SIZES 5
@@ -86,15 +88,27 @@ typedef struct
 
 	const size_t *protection_sector_sizes;
 	unsigned int protection_sector_count;
+	bool protection_by_status;  // if true, sectors are protected by the block protect bits
+	                            // of the status register, not by sector commands
 
 	uint8_t read_status_cmd;
 	uint8_t status_busy_mask;
 	uint8_t status_busy_level;
+	uint16_t status_error_mask;  // status bits set by a failed program or erase, byte 2 in
+	                             // the high half; 0 if the part doesn't report it
 
 	bool read_slow;  // if true, use READ ARRAY SLOW command with no dummy byte
 	bool has_so_irq;
 	bool dataflash;     // if true, part has 256 byte and 264 byte page capability
 	uint8_t so_done_level;  // level expected on SO when operation done, when using active status interrupt
+	uint32_t t_csh_ns;      // minimum CS high time between commands, tCSH
+
+	// Timing, used only to estimate durations. Nominal figures, which
+	// should be checked against the datasheet of the part revision in use.
+	uint32_t t_pp_typ_us;     // page program time, tPP
+	uint32_t t_pp_max_us;
+	uint32_t t_wake_dpd_us;   // resume from deep power down, tRDPD
+	uint32_t t_wake_udpd_us;  // exit from ultra deep power down, tXUDPD
 } spiflash_info_t;
 
 extern const spiflash_info_t spiflash_info_table[];
@@ -129,6 +143,15 @@ bool spiflash_erase(uint32_t addr,
 		            spiflash_completion_fn_t *completion,
 		            void *completion_ref);  // argument to be passed to completion callback
 
+bool spiflash_erase_calibrate(uint32_t addr,
+		                      bool include_chip_erase,
+		                      bool use_so_irq);
+
+void spiflash_get_erase_calibration(uint32_t *ns_per_byte,  // MAX_ERASE_SIZES entries
+		                            bool *preferred);       // MAX_ERASE_SIZES entries, or NULL
+
+void spiflash_set_erase_calibration(const uint32_t *ns_per_byte);  // NULL to clear
+
 void spiflash_write(uint32_t addr,
 		            size_t len,
 		            uint8_t  *buffer,
@@ -136,6 +159,17 @@ void spiflash_write(uint32_t addr,
 		            spiflash_completion_fn_t *completion,
 		            void *completion_ref);  // argument to be passed to completion callback
 
+// Returns a pointer to len bytes of data to be written at addr, or NULL to stop
+typedef uint8_t *spiflash_write_source_fn_t(uint32_t addr, size_t len, void *ref);
+
+void spiflash_write_source(uint32_t addr,
+		                   size_t len,
+		                   spiflash_write_source_fn_t *source,
+		                   void *source_ref,
+		                   bool use_so_irq,
+		                   spiflash_completion_fn_t *completion,
+		                   void *completion_ref);
+
 void spiflash_set_write_enable(bool enable,
 				               spiflash_completion_fn_t *completion,
 				               void *completion_ref);
@@ -149,6 +183,21 @@ void spiflash_set_global_protect(bool protect,
 								 spiflash_completion_fn_t *completion,
 								 void *completion_ref);
 
+void spiflash_read_sector_protection(void);
+
+bool spiflash_set_range_protection(bool protect,
+		                           uint32_t addr,
+		                           size_t len);
+
+bool spiflash_range_protected(uint32_t addr,
+		                      size_t len);
+
+bool spiflash_op_failed(void);
+
+bool spiflash_get_protection_sector(uint32_t addr,
+		                            uint32_t *start,
+		                            uint32_t *size);
+
 void spiflash_read_otp(uint32_t addr,
 		               size_t   len,
 		               uint8_t  *buffer,
@@ -201,6 +250,21 @@ uint32_t spiflash_smallest_erase_size_above(uint32_t size);
 
 bool spiflash_is_dataflash(void);
 
+bool spiflash_idle(void);
+
+uint32_t spiflash_estimate_read_us(size_t len);
+
+uint32_t spiflash_estimate_write_us(uint32_t addr,
+		                            size_t len,
+		                            bool worst_case);
+
+uint32_t spiflash_estimate_erase_us(uint32_t addr,
+		                            size_t len,
+		                            uint32_t cmd_size,  // bytes per erase command, 0 for auto
+		                            bool worst_case);
+
+uint32_t spiflash_estimate_wake_us(bool ultra_deep);
+
 void dataflash_rmw(uint32_t addr,
 				   size_t len,
 				   uint8_t  *buffer,
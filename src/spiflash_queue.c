@@ -0,0 +1,249 @@
+/******************************************************************************
+ * @file spiflash_queue.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "em_int.h"
+
+#include "low_power.h"
+#include "spiflash.h"
+#include "spiflash_queue.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup SPIFlash_Queue
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+ * @verbatim
+ *  The flash driver can only hold one operation at a time. The queue keeps
+ *  a FIFO of operation descriptors for each priority class, and starts the
+ *  next operation directly from the completion of the previous one, so a
+ *  stream of requests runs back to back under interrupt control without
+ *  returning to the main loop. Within a class, requests run in submission
+ *  order; a request of a higher class runs before any of a lower class
+ *  which have not yet started. A running operation is never preempted.
+ *
+ *  While any requests are queued, the application must not call the flash
+ *  driver directly. If a request is submitted while the driver is busy with
+ *  a direct call, it starts from spiflash_queue_poll() once the driver is
+ *  idle, which the main loop and spiflash_queue_wait_idle() call.
+ *  @endverbatim
+ *****************************************************************************/
+
+static spiflash_op_t *queue_head[SPIFLASH_PRIO_COUNT];
+static spiflash_op_t *queue_tail[SPIFLASH_PRIO_COUNT];
+static spiflash_op_t * volatile queue_current;
+static volatile unsigned int queue_count;  // queued plus running
+
+static void spiflash_queue_dispatch(void);
+
+/***************************************************************************//**
+ * @brief
+ *   Operation Completion
+ * @note
+ * 		Called by the flash driver, normally from interrupt context, when the
+ * 		current operation is done. Calls the requester's completion function,
+ * 		then starts the next queued operation.
+ * @param[in] *ref
+ * 		The completed operation descriptor
+ ******************************************************************************/
+static void spiflash_queue_op_done(void *ref)
+{
+	spiflash_op_t *op = ref;
+
+	INT_Disable();
+	queue_current = NULL;
+	queue_count--;
+	INT_Enable();
+
+	if (op->completion)
+		op->completion(op);
+
+	spiflash_queue_dispatch();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the highest priority queued operation, if the driver is free
+ ******************************************************************************/
+static void spiflash_queue_dispatch(void)
+{
+	spiflash_op_t *op = NULL;
+	int prio;
+
+	INT_Disable();
+	if ((queue_current == NULL) && spiflash_idle())
+	{
+		for (prio = 0; prio < SPIFLASH_PRIO_COUNT; prio++)
+		{
+			op = queue_head[prio];
+			if (op)
+			{
+				queue_head[prio] = op->next;
+				if (! queue_head[prio])
+					queue_tail[prio] = NULL;
+				break;
+			}
+		}
+		queue_current = op;
+	}
+	INT_Enable();
+
+	if (! op)
+		return;
+
+	op->result = true;
+	switch (op->type)
+	{
+	case SPIFLASH_OP_READ:
+		spiflash_read(op->addr, op->len, op->buffer,
+				      spiflash_queue_op_done, op);
+		break;
+	case SPIFLASH_OP_WRITE:
+		spiflash_write(op->addr, op->len, op->buffer, op->use_so_irq,
+				       spiflash_queue_op_done, op);
+		break;
+	case SPIFLASH_OP_ERASE:
+		if (! spiflash_erase(op->addr, op->len, op->erase_cmd_size, op->use_so_irq,
+				             spiflash_queue_op_done, op))
+		{
+			op->result = false;
+			spiflash_queue_op_done(op);
+		}
+		break;
+	case SPIFLASH_OP_STATUS:
+		spiflash_read_status(op->len, op->buffer,
+				             spiflash_queue_op_done, op);
+		break;
+	default:
+		op->result = false;
+		spiflash_queue_op_done(op);
+		break;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Initialize the operation queue
+ ******************************************************************************/
+void spiflash_queue_init(void)
+{
+	int prio;
+
+	for (prio = 0; prio < SPIFLASH_PRIO_COUNT; prio++)
+	{
+		queue_head[prio] = NULL;
+		queue_tail[prio] = NULL;
+	}
+	queue_current = NULL;
+	queue_count = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Submit an operation
+ * @note
+ * 		May be called from a completion function. The operation starts
+ * 		immediately if the driver is free. The completion function of the
+ * 		descriptor is called when the operation is done, normally from
+ * 		interrupt context; it may submit further operations, including the
+ * 		same descriptor.
+ * @param[in] *op
+ * 		Operation descriptor
+ ******************************************************************************/
+void spiflash_queue_submit(spiflash_op_t *op)
+{
+	spiflash_prio_t prio = op->priority;
+
+	if (prio >= SPIFLASH_PRIO_COUNT)
+		prio = SPIFLASH_PRIO_BACKGROUND;
+
+	op->next = NULL;
+
+	INT_Disable();
+	if (queue_tail[prio])
+		queue_tail[prio]->next = op;
+	else
+		queue_head[prio] = op;
+	queue_tail[prio] = op;
+	queue_count++;
+	INT_Enable();
+
+	spiflash_queue_dispatch();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Determine whether all submitted operations have completed
+ * @return TRUE/FALSE
+ ******************************************************************************/
+bool spiflash_queue_idle(void)
+{
+	return queue_count == 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the next queued operation, if the driver has gone idle
+ * @note
+ * 		Otherwise an operation only starts on submission or on completion of
+ * 		the one before it.
+ ******************************************************************************/
+void spiflash_queue_poll(void)
+{
+	spiflash_queue_dispatch();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait until all submitted operations have completed
+ ******************************************************************************/
+void spiflash_queue_wait_idle(void)
+{
+	spiflash_queue_dispatch();
+	while (queue_count)
+	{
+		enter_low_power_state();
+		spiflash_queue_dispatch();
+	}
+}
+
+/** @} (end addtogroup SPIFlash_Queue) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
@@ -0,0 +1,103 @@
+/****************************************************************************//**
+ * @file spiflash_queue.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef SPIFLASH_QUEUE_H_
+#define SPIFLASH_QUEUE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup SPIFlash_Queue
+ * @brief Asynchronous operation queue for the flash driver
+ * @{
+ ******************************************************************************/
+
+typedef enum
+{
+	SPIFLASH_OP_READ,
+	SPIFLASH_OP_WRITE,
+	SPIFLASH_OP_ERASE,
+	SPIFLASH_OP_STATUS,
+} spiflash_op_type_t;
+
+typedef enum
+{
+	SPIFLASH_PRIO_HIGH,
+	SPIFLASH_PRIO_NORMAL,
+	SPIFLASH_PRIO_BACKGROUND,
+	SPIFLASH_PRIO_COUNT
+} spiflash_prio_t;
+
+typedef struct spiflash_op spiflash_op_t;
+
+typedef void spiflash_op_completion_fn_t(spiflash_op_t *op);
+
+// Operation descriptor. The descriptor is owned by the queue from
+// spiflash_queue_submit() until its completion function is called,
+// and must not be modified by the caller during that time.
+struct spiflash_op
+{
+	spiflash_op_type_t type;
+	spiflash_prio_t priority;
+	uint32_t addr;
+	size_t len;
+	uint8_t *buffer;
+	uint32_t erase_cmd_size;  // erase only: bytes per erase command, 0 for auto
+	bool use_so_irq;          // write and erase only
+	bool result;              // set before completion: false if the driver rejected the request
+	spiflash_op_completion_fn_t *completion;
+	void *completion_ref;     // for use by the completion function
+	spiflash_op_t *next;      // private to the queue
+};
+
+void spiflash_queue_init(void);
+
+void spiflash_queue_submit(spiflash_op_t *op);
+
+bool spiflash_queue_idle(void);
+
+void spiflash_queue_poll(void);
+
+void spiflash_queue_wait_idle(void);
+
+/** @} (end addtogroup SPIFlash_Queue) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
+
+#endif /* SPIFLASH_QUEUE_H_ */
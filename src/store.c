@@ -0,0 +1,319 @@
+/******************************************************************************
+ * @file store.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "spiflash.h"
+#include "store.h"
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Store
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+ * @verbatim
+ *  Multi-byte fields on the flash are little-endian, and checked with
+ *  CRC-16/CCITT-FALSE.
+ *
+ *  The KV store and FTL divide their region into units, each starting
+ *  with a header:
+ *    magic u32, erase count u32, CRC-16 u16 of those,
+ *    CRC-16 u16 of the sequence number, sequence number u32
+ *  The first three fields are written when the unit is erased, and the
+ *  last two when it is opened, so a free unit keeps its erase count on
+ *  the flash. Units are opened in increasing sequence number order, least
+ *  erased first.
+ *
+ *  A power failure can leave one unit erased without the first part of
+ *  its header, or opened with a torn sequence number. Mount erases such
+ *  a unit again; if its erase count was lost, it takes the highest of the
+ *  others, so that wear leveling doesn't favour it.
+ *  @endverbatim
+ *****************************************************************************/
+
+/***************************************************************************//**
+ * @brief
+ *   Continue a CRC-16/CCITT-FALSE
+ * @param[in] crc
+ * 		CRC so far, 0xffff to start
+ * @param[in] *p
+ * 		Data
+ * @param[in] len
+ * 		Length of data
+ * @return CRC so far
+ ******************************************************************************/
+uint16_t store_crc16(uint16_t crc, const uint8_t *p, size_t len)
+{
+	int i;
+
+	while (len--)
+	{
+		crc ^= (uint16_t) *p++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Little-endian field access
+ ******************************************************************************/
+void store_put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+void store_put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+uint16_t store_get_u16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+uint32_t store_get_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+uint32_t store_unit_addr(const store_units_t *s, uint32_t unit)
+{
+	return s->base + unit * s->unit_size;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase a unit and write the first part of its header
+ * @param[in] *s
+ * 		Units
+ * @param[in] unit
+ * 		Unit index; its erase count is incremented
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool store_unit_erase(store_units_t *s, uint32_t unit)
+{
+	uint8_t h[STORE_UNIT_ERASE_SIZE];
+
+	if (! spiflash_erase(store_unit_addr(s, unit), s->unit_size, s->erase_cmd_size, s->use_so_irq, NULL, NULL))
+		return false;
+	s->unit[unit].erase_count++;
+	store_put_u32(& h[0], s->magic);
+	store_put_u32(& h[4], s->unit[unit].erase_count);
+	store_put_u16(& h[8], store_crc16(0xffff, h, 8));
+	spiflash_write(store_unit_addr(s, unit), sizeof(h), h, s->use_so_irq, NULL, NULL);
+
+	s->unit[unit].seq = STORE_SEQ_FREE;
+	s->free_count++;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Open the least erased free unit, giving it the next sequence number
+ * @param[in] *s
+ * 		Units
+ * @return
+ * 		Unit index, or STORE_UNIT_NONE if there is no free unit
+ ******************************************************************************/
+uint32_t store_unit_open(store_units_t *s)
+{
+	uint8_t h[STORE_UNIT_OPEN_SIZE];
+	uint32_t best = STORE_UNIT_NONE;
+	uint32_t i;
+
+	for (i = 0; i < s->unit_count; i++)
+		if ((s->unit[i].seq == STORE_SEQ_FREE) &&
+			((best == STORE_UNIT_NONE) || (s->unit[i].erase_count < s->unit[best].erase_count)))
+			best = i;
+	if (best == STORE_UNIT_NONE)
+		return STORE_UNIT_NONE;
+
+	store_put_u32(& h[2], ++s->seq_last);
+	store_put_u16(& h[0], store_crc16(0xffff, & h[2], 4));
+	spiflash_write(store_unit_addr(s, best) + STORE_UNIT_ERASE_SIZE, sizeof(h), h, s->use_so_irq, NULL, NULL);
+
+	s->unit[best].seq = s->seq_last;
+	s->free_count--;
+	return best;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read a unit header
+ * @param[in] *s
+ * 		Units
+ * @param[in] unit
+ * 		Unit index; its erase count and sequence number are set
+ * @return
+ * 		false if the unit needs erasing; its erase count is still set if
+ * 		the first part of the header is valid, or else 0
+ ******************************************************************************/
+static bool store_read_unit_header(store_units_t *s, uint32_t unit)
+{
+	uint8_t h[STORE_UNIT_HEADER_SIZE];
+	static const uint8_t erased[STORE_UNIT_OPEN_SIZE] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	uint32_t seq;
+
+	spiflash_read(store_unit_addr(s, unit), sizeof(h), h, NULL, NULL);
+	s->reads++;
+	s->unit[unit].erase_count = 0;
+	s->unit[unit].seq = STORE_SEQ_FREE;
+	if ((store_get_u32(& h[0]) != s->magic) || (store_get_u16(& h[8]) != store_crc16(0xffff, h, 8)))
+		return false;
+	s->unit[unit].erase_count = store_get_u32(& h[4]);
+	if (memcmp(& h[STORE_UNIT_ERASE_SIZE], erased, sizeof(erased)) == 0)
+		return true;
+	seq = store_get_u32(& h[12]);
+	if ((seq == STORE_SEQ_FREE) || (store_get_u16(& h[10]) != store_crc16(0xffff, & h[12], 4)))
+		return false;
+	s->unit[unit].seq = seq;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase every unit, keeping the erase counts in valid headers
+ * @param[in] *s
+ * 		Units
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool store_units_format(store_units_t *s)
+{
+	uint32_t i;
+
+	s->free_count = 0;
+	s->seq_last = 0;
+	for (i = 0; i < s->unit_count; i++)
+	{
+		store_read_unit_header(s, i);
+		if (! store_unit_erase(s, i))
+			return false;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the unit headers, erasing units left half erased or half opened
+ * @param[in] *s
+ * 		Units
+ * @param[out] *order
+ * 		Units in use, in opening order
+ * @param[out] *in_use
+ * 		Number of units in use
+ * @return
+ * 		true if successful
+ ******************************************************************************/
+bool store_units_mount(store_units_t *s, uint8_t *order, uint32_t *in_use)
+{
+	bool needs_erase[STORE_MAX_UNITS];
+	uint32_t ec_max = 0;
+	uint32_t n = 0;
+	uint32_t i;
+	uint32_t j;
+
+	s->free_count = 0;
+	s->seq_last = 0;
+	s->reads = 0;
+	for (i = 0; i < s->unit_count; i++)
+	{
+		needs_erase[i] = ! store_read_unit_header(s, i);
+		if (s->unit[i].erase_count > ec_max)
+			ec_max = s->unit[i].erase_count;
+		if (needs_erase[i])
+			continue;
+		if (s->unit[i].seq == STORE_SEQ_FREE)
+		{
+			s->free_count++;
+			continue;
+		}
+		if (s->unit[i].seq > s->seq_last)
+			s->seq_last = s->unit[i].seq;
+
+		// insert in opening order
+		for (j = n; (j > 0) && (s->unit[order[j - 1]].seq > s->unit[i].seq); j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+		n++;
+	}
+
+	for (i = 0; i < s->unit_count; i++)
+		if (needs_erase[i])
+		{
+			// a unit whose erase count was lost takes the highest
+			if (s->unit[i].erase_count == 0)
+				s->unit[i].erase_count = ec_max;
+			if (! store_unit_erase(s, i))
+				return false;
+		}
+
+	*in_use = n;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Least and most erased units
+ ******************************************************************************/
+void store_units_erase_counts(const store_units_t *s, uint32_t *min, uint32_t *max)
+{
+	uint32_t i;
+
+	*min = 0xffffffff;
+	*max = 0;
+	for (i = 0; i < s->unit_count; i++)
+	{
+		if (s->unit[i].erase_count < *min)
+			*min = s->unit[i].erase_count;
+		if (s->unit[i].erase_count > *max)
+			*max = s->unit[i].erase_count;
+	}
+}
+
+/** @} (end addtogroup Store) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
@@ -0,0 +1,107 @@
+/****************************************************************************//**
+ * @file store.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/***************************************************************************//**
+ * @addtogroup Adesto_FlashDrivers
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup Store
+ * @brief Code shared by the journal, KV store and FTL: CRC, little-endian
+ * 		fields, and units with an erase count and opening sequence number
+ * @{
+ ******************************************************************************/
+
+#define STORE_UNIT_HEADER_SIZE 16  // at the start of each unit
+#define STORE_UNIT_ERASE_SIZE  10  // header bytes written when the unit is erased
+#define STORE_UNIT_OPEN_SIZE   6   // and when it is opened
+
+#define STORE_MAX_UNITS 32
+
+#define STORE_SEQ_FREE  0xffffffff
+#define STORE_UNIT_NONE 0xff
+
+typedef struct
+{
+	uint32_t erase_count;
+	uint32_t seq;  // order opened, STORE_SEQ_FREE if erased
+} store_unit_t;
+
+typedef struct
+{
+	uint32_t magic;           // first field of each unit header
+	uint32_t base;
+	uint32_t unit_size;
+	uint32_t unit_count;
+	uint32_t erase_cmd_size;  // for spiflash_erase(), 0 for the driver to choose
+	bool use_so_irq;
+	store_unit_t unit[STORE_MAX_UNITS];
+	uint32_t free_count;      // units erased and not yet opened
+	uint32_t seq_last;        // of the unit opened last
+	uint32_t reads;           // flash reads of unit headers
+} store_units_t;
+
+uint16_t store_crc16(uint16_t crc, const uint8_t *p, size_t len);
+
+void store_put_u16(uint8_t *p, uint16_t v);
+
+void store_put_u32(uint8_t *p, uint32_t v);
+
+uint16_t store_get_u16(const uint8_t *p);
+
+uint32_t store_get_u32(const uint8_t *p);
+
+uint32_t store_unit_addr(const store_units_t *s, uint32_t unit);
+
+bool store_unit_erase(store_units_t *s, uint32_t unit);
+
+uint32_t store_unit_open(store_units_t *s);
+
+bool store_units_format(store_units_t *s);
+
+bool store_units_mount(store_units_t *s, uint8_t *order, uint32_t *in_use);
+
+void store_units_erase_counts(const store_units_t *s, uint32_t *min, uint32_t *max);
+
+/** @} (end addtogroup Store) */
+/** @} (end addtogroup Adesto_FlashDrivers) */
+
+#endif /* STORE_H_ */
@@ -0,0 +1,303 @@
+/******************************************************************************
+ * @file workload.c
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "workload.h"
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @addtogroup Workload
+ * @brief Generator of flash operations for benchmarks
+ * @details
+ * 		Generates a sequence of reads, writes and erases over a region of
+ * 		the flash, from a configuration and a seed. Only integer arithmetic
+ * 		and its own random number generator are used, so a configuration
+ * 		gives the same sequence on the board and in the host build, and
+ * 		workload_hash() can be compared to check that it did.
+ *
+ * 		The Zipf distribution (exponent 1) is over WORKLOAD_ZIPF_BUCKETS
+ * 		equal areas of the region. Area popularity ranks are spread over
+ * 		the region, rather than the most popular areas being adjacent.
+ *
+ * 		Erases are of the given erase size, aligned, with the address
+ * 		from the same distribution as reads and writes.
+ * @{
+ ******************************************************************************/
+
+#define WORKLOAD_ZIPF_BUCKETS 64
+#define WORKLOAD_ZIPF_SPREAD  37  // odd, so rank * spread covers every area
+
+#define WORKLOAD_HASH_INIT  2166136261u  // FNV-1a
+#define WORKLOAD_HASH_PRIME 16777619u
+
+static workload_config_t config;
+static uint32_t region_size;
+static uint32_t erase_size;
+static uint32_t rng_state;
+static uint32_t seq_addr;
+static uint32_t seq_erase_addr;
+static uint32_t op_count;
+static uint32_t hash;
+
+// cumulative weight of Zipf ranks 0 to i
+static uint32_t zipf_cumulative[WORKLOAD_ZIPF_BUCKETS];
+
+static const char *dist_names[WORKLOAD_DIST_COUNT] =
+{
+	[WORKLOAD_SEQ]      = "SEQ",
+	[WORKLOAD_UNIFORM]  = "UNI",
+	[WORKLOAD_ZIPF]     = "ZIPF",
+	[WORKLOAD_HOT_COLD] = "HOT",
+};
+
+/***************************************************************************//**
+ * @brief
+ *   Next random number, by xorshift32
+ ******************************************************************************/
+static uint32_t workload_random(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Random number from 0 to n - 1
+ ******************************************************************************/
+static uint32_t workload_random_below(uint32_t n)
+{
+	return workload_random() % n;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add a word to the hash of the operations generated
+ ******************************************************************************/
+static void workload_hash_word(uint32_t word)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		hash ^= (word >> (i * 8)) & 0xff;
+		hash *= WORKLOAD_HASH_PRIME;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start a workload
+ * @param[in] *c
+ * 		Configuration, copied
+ * @param[in] size
+ * 		Size of the region, starting at address 0
+ * @param[in] erase_unit
+ * 		Size of each erase, which the region size must be a multiple of
+ ******************************************************************************/
+void workload_init(const workload_config_t *c, uint32_t size, uint32_t erase_unit)
+{
+	uint32_t sum = 0;
+	int i;
+
+	config = *c;
+	if (config.min_size < 1)
+		config.min_size = 1;
+	if (config.max_size > WORKLOAD_MAX_SIZE)
+		config.max_size = WORKLOAD_MAX_SIZE;
+	if (config.max_size > size)
+		config.max_size = size;
+	if (config.min_size > config.max_size)
+		config.min_size = config.max_size;
+	if (config.dist >= WORKLOAD_DIST_COUNT)
+		config.dist = WORKLOAD_SEQ;
+
+	region_size = size;
+	erase_size = erase_unit;
+	rng_state = config.seed ? config.seed : 1;  // xorshift state must not be zero
+	seq_addr = 0;
+	seq_erase_addr = 0;
+	op_count = 0;
+	hash = WORKLOAD_HASH_INIT;
+
+	for (i = 0; i < WORKLOAD_ZIPF_BUCKETS; i++)
+	{
+		sum += 0x10000 / (i + 1);
+		zipf_cumulative[i] = sum;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Pick an address for a request, from the configured distribution
+ * @param[in] len
+ * 		Request length, no larger than the region
+ * @return Address, such that the request fits in the region
+ ******************************************************************************/
+static uint32_t workload_addr(uint32_t len)
+{
+	uint32_t last = region_size - len;  // highest usable address
+	uint32_t addr;
+	uint32_t bucket_size;
+	uint32_t hot_size;
+	uint32_t r;
+	int rank;
+
+	switch (config.dist)
+	{
+	case WORKLOAD_UNIFORM:
+		return workload_random_below(last + 1);
+
+	case WORKLOAD_ZIPF:
+		r = workload_random_below(zipf_cumulative[WORKLOAD_ZIPF_BUCKETS - 1]);
+		for (rank = 0; zipf_cumulative[rank] <= r; rank++)
+			;
+		bucket_size = region_size / WORKLOAD_ZIPF_BUCKETS;
+		addr = ((rank * WORKLOAD_ZIPF_SPREAD) % WORKLOAD_ZIPF_BUCKETS) * bucket_size;
+		addr += workload_random_below(bucket_size);
+		break;
+
+	case WORKLOAD_HOT_COLD:
+		hot_size = (uint32_t) (((uint64_t) region_size * config.hot_area_pct) / 100);
+		if (hot_size == 0)
+			hot_size = 1;
+		if (workload_random_below(100) < config.hot_pct)
+			addr = workload_random_below(hot_size);
+		else if (hot_size < region_size)
+			addr = hot_size + workload_random_below(region_size - hot_size);
+		else
+			addr = workload_random_below(region_size);
+		break;
+
+	default:
+		return 0;  // sequential addresses are kept by the caller
+	}
+
+	if (addr > last)
+		addr = last;
+	return addr;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Generate the next operation
+ * @param[out] *op
+ * 		Operation
+ ******************************************************************************/
+void workload_next(workload_op_t *op)
+{
+	uint32_t r = workload_random_below(100);
+
+	if (r < config.read_pct)
+		op->type = WORKLOAD_OP_READ;
+	else if (r < config.read_pct + config.erase_pct)
+		op->type = WORKLOAD_OP_ERASE;
+	else
+		op->type = WORKLOAD_OP_WRITE;
+
+	if (op->type == WORKLOAD_OP_ERASE)
+	{
+		op->len = erase_size;
+		if (config.dist == WORKLOAD_SEQ)
+		{
+			op->addr = seq_erase_addr;
+			seq_erase_addr += erase_size;
+			if (seq_erase_addr >= region_size)
+				seq_erase_addr = 0;
+		}
+		else
+			op->addr = workload_addr(erase_size) / erase_size * erase_size;
+	}
+	else
+	{
+		op->len = config.min_size;
+		if (config.max_size > config.min_size)
+			op->len += workload_random_below(config.max_size - config.min_size + 1);
+		if (config.dist == WORKLOAD_SEQ)
+		{
+			if (seq_addr + op->len > region_size)
+				seq_addr = 0;
+			op->addr = seq_addr;
+			seq_addr += op->len;
+		}
+		else
+			op->addr = workload_addr(op->len);
+	}
+
+	op_count++;
+	workload_hash_word(op->type);
+	workload_hash_word(op->addr);
+	workload_hash_word(op->len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of operations generated since workload_init()
+ ******************************************************************************/
+uint32_t workload_op_count(void)
+{
+	return op_count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Hash of the operations generated since workload_init()
+ * @note
+ * 		Equal hashes on the board and the host mean the same operations
+ * 		were run.
+ ******************************************************************************/
+uint32_t workload_hash(void)
+{
+	return hash;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Short name of an address distribution, e.g. "ZIPF"
+ ******************************************************************************/
+const char *workload_dist_name(workload_dist_t dist)
+{
+	if (dist >= WORKLOAD_DIST_COUNT)
+		return "?";
+	return dist_names[dist];
+}
+
+/** @} (end addtogroup Workload) */
+/** @} (end addtogroup AppManagement) */
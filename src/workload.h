@@ -0,0 +1,102 @@
+/****************************************************************************//**
+ * @file workload.h
+ * @brief Adesto Serial Flash Demo
+ * @author Embedded Masters
+ * @version 1.0
+ ******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Embedded Masters LLC, http://www.embeddedmasters.com</b>
+ *******************************************************************************
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * DISCLAIMER OF WARRANTY/LIMITATION OF REMEDIES: Embedded Masters has no
+ * obligation to support this Software. Embedded Masters is providing the
+ * Software "AS IS", with no express or implied warranties of any kind,
+ * including, but not limited to, any implied warranties of merchantability
+ * or fitness for any particular purpose or warranties against infringement
+ * of any proprietary rights of a third party.
+ *
+ * Embedded Masters will not be liable for any consequential, incidental, or
+ * special damages, or any other relief, or for any claim by any third party,
+ * arising from your use of this Software.
+ *
+ ******************************************************************************/
+
+#ifndef WORKLOAD_H_
+#define WORKLOAD_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/***************************************************************************//**
+ * @addtogroup AppManagement
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @defgroup Workload
+ * @brief Generator of flash operations for benchmarks
+ * @{
+ ******************************************************************************/
+
+#define WORKLOAD_MAX_SIZE (64 * 1024)
+
+// address distribution
+typedef enum
+{
+	WORKLOAD_SEQ,       // each request follows the previous one
+	WORKLOAD_UNIFORM,   // any address equally likely
+	WORKLOAD_ZIPF,      // few areas get most requests, with a long tail
+	WORKLOAD_HOT_COLD,  // hot_pct of requests go to hot_area_pct of the region
+	WORKLOAD_DIST_COUNT
+} workload_dist_t;
+
+typedef enum
+{
+	WORKLOAD_OP_READ,
+	WORKLOAD_OP_WRITE,
+	WORKLOAD_OP_ERASE
+} workload_op_type_t;
+
+typedef struct
+{
+	workload_dist_t dist;
+	uint32_t read_pct;      // share of requests which read
+	uint32_t erase_pct;     // share which erase, the rest write
+	uint32_t min_size;      // read and write sizes in bytes, 1 to WORKLOAD_MAX_SIZE
+	uint32_t max_size;
+	uint32_t hot_pct;       // WORKLOAD_HOT_COLD only
+	uint32_t hot_area_pct;
+	uint32_t seed;
+} workload_config_t;
+
+typedef struct
+{
+	workload_op_type_t type;
+	uint32_t addr;
+	uint32_t len;
+} workload_op_t;
+
+void workload_init(const workload_config_t *config, uint32_t region_size, uint32_t erase_size);
+
+void workload_next(workload_op_t *op);
+
+uint32_t workload_op_count(void);
+
+uint32_t workload_hash(void);
+
+const char *workload_dist_name(workload_dist_t dist);
+
+/** @} (end defgroup Workload) */
+/** @} (end addtogroup AppManagement) */
+
+#endif /* WORKLOAD_H_ */
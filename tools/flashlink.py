@@ -0,0 +1,487 @@
+#!/usr/bin/env python3
+#
+# Dump the flash to a file, or upload a file to it, with the binary
+# protocol of the console link command, and report the throughput.
+#
+# The protocol is described in src/link.h. The board's console must be
+# open (CONSOLE menu item). The link starts at the console's rate, then
+# moves to the fast port at --fast, or stays if that fails. With --sim,
+# host/build/flashsim -c plays the board instead.
+#
+# usage: flashlink.py [-p PORT] [-b BAUD] [--fast BAUD] [--sim [--part PART]] info
+#        flashlink.py ... dump FILE [ADDR [LEN]]
+#        flashlink.py ... upload FILE [ADDR]
+#        flashlink.py ... rates [ADDR [LEN]]
+#
+# rates dumps LEN bytes (default 64 KiB) at each of RATES in turn, then
+# uploads them back unchanged, and reports the throughput of each.
+
+import argparse
+import binascii
+import os
+import select
+import struct
+import subprocess
+import sys
+import termios
+import time
+import tty
+import zlib
+
+INFO = 0x01
+READ = 0x02
+WRITE = 0x03
+QUIT = 0x04
+RATE = 0x05
+DATA = 0x10
+ACK = 0x11
+NAK = 0x12
+INFO_REPLY = 0x81
+DONE = 0x82
+
+STATUS_TEXT = {
+    0: 'ok',
+    1: 'range outside the part, or not on an erase boundary',
+    2: 'aborted',
+    3: 'timed out',
+}
+
+VERSION = 2
+
+PORT_CONSOLE = 0
+PORT_FAST = 1
+
+RATES = (115200, 230400, 460800, 921600, 1000000, 1500000, 2000000, 3000000)
+
+DATA_TIMEOUT = 0.5    # s without DATA before asking for it again
+ACK_TIMEOUT = 2.0     # s without an ACK before sending again, LINK_STALL_MS
+ERASE_TIMEOUT = 120.0
+SWITCH_TIMEOUT = 1.0  # LINK_SWITCH_MS
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+class LinkError(Exception):
+    pass
+
+
+class SerialPort:
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.set_baud(baud)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+
+    def can_baud(self, baud):
+        return hasattr(termios, 'B%d' % baud)
+
+    def set_baud(self, baud):
+        speed = getattr(termios, 'B%d' % baud, None)
+        if speed is None:
+            raise LinkError('unsupported bit rate %d' % baud)
+        termios.tcdrain(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.line_rate = baud / 10  # bytes/s, 8N1
+
+    def clock(self):
+        return time.monotonic()
+
+    def write(self, data):
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def read(self, timeout):
+        if not select.select([self.fd], [], [], timeout)[0]:
+            return b''
+        return os.read(self.fd, 4096)
+
+    def close(self):
+        os.close(self.fd)
+
+
+class SimPort:
+    """flashsim -c on a pipe, timed by its simulated clock.
+
+    flashsim paces the link's serial traffic at the bit rate, in simulated
+    time, and with -s writes that time on stderr whenever it waits for
+    input, so clock() is the time at which the board last went quiet.
+    """
+
+    def __init__(self, flashsim, part, baud):
+        self.proc = subprocess.Popen([flashsim, '-c', '-s'] + ([part] if part else []),
+                                     stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.PIPE, bufsize=0)
+        self.errors = bytearray()
+        self.sim_time = 0.0
+        self.set_baud(baud)
+
+    def can_baud(self, baud):
+        return True
+
+    def set_baud(self, baud):
+        self.line_rate = baud / 10  # bytes/s, 8N1, as the sim paces it
+
+    def clock(self):
+        fd = self.proc.stderr.fileno()
+        while select.select([fd], [], [], 0)[0] and self.read_errors():
+            pass
+        return self.sim_time
+
+    def read_errors(self):
+        """Read what there is on stderr, taking the times out of it."""
+        data = os.read(self.proc.stderr.fileno(), 4096)
+        self.errors += data
+        lines = self.errors.split(b'\n')
+        self.errors = lines.pop()
+        for line in lines:
+            fields = line.split()
+            if len(fields) == 3 and fields[0] == b'time':
+                self.sim_time = int(fields[1]) / 1e6
+            else:
+                sys.stderr.buffer.write(line + b'\n')
+        return data
+
+    def write(self, data):
+        try:
+            self.proc.stdin.write(data)
+        except BrokenPipeError:
+            self.clock()  # passes on why
+            raise LinkError('flashsim exited')
+
+    def read(self, timeout):
+        fd = self.proc.stdout.fileno()
+        deadline = time.monotonic() + timeout
+        while True:
+            # stderr too, so that flashsim never waits for room to write the time
+            ready = select.select([fd, self.proc.stderr.fileno()], [],
+                                  [], max(deadline - time.monotonic(), 0))[0]
+            if fd in ready:
+                break
+            if not ready:
+                return b''
+            self.read_errors()
+        data = os.read(fd, 4096)
+        if not data:
+            self.clock()
+            raise LinkError('flashsim exited')
+        return data
+
+    def close(self):
+        self.proc.stdin.write(b'exit\r')
+        self.proc.communicate()
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for b in data:
+        if b == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(b)
+            if len(block) == 254:
+                out += b'\xff' + block
+                block = bytearray()
+    return bytes(out + bytes([len(block) + 1]) + block)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Link:
+    def __init__(self, port):
+        self.port = port
+        self.rx = bytearray()
+        self.frames = []
+        self.bad_frames = 0
+
+    def send(self, frame_type, body=b''):
+        frame = bytes([frame_type]) + body
+        frame += struct.pack('<H', binascii.crc_hqx(frame, 0xffff))
+        self.port.write(cobs_encode(frame) + b'\0')
+
+    def receive(self, timeout):
+        """Next good frame as (type, body), or None after timeout s."""
+        deadline = time.monotonic() + timeout
+        while not self.frames:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.rx += self.port.read(remaining)
+            while b'\0' in self.rx:
+                encoded, _, self.rx = self.rx.partition(b'\0')
+                frame = cobs_decode(encoded)
+                if (frame is None or len(frame) < 3 or
+                        binascii.crc_hqx(frame[:-2], 0xffff) != struct.unpack('<H', frame[-2:])[0]):
+                    self.bad_frames += 1  # includes console text before the link started
+                    continue
+                self.frames.append((frame[0], frame[1:-2]))
+        return self.frames.pop(0)
+
+    def expect(self, frame_type, timeout):
+        while True:
+            frame = self.receive(timeout)
+            if frame is None:
+                raise LinkError('no reply from the board')
+            if frame[0] == frame_type:
+                return frame[1]
+            if frame[0] == DONE and frame_type != DONE:
+                raise LinkError(STATUS_TEXT.get(frame[1][0], 'error %d' % frame[1][0]))
+
+    def start(self):
+        self.port.write(b'\x03link\r')  # ^C drops any partly typed line
+        for _ in range(5):
+            self.send(INFO)
+            try:
+                body = self.expect(INFO_REPLY, 1.0)
+                break
+            except LinkError:
+                pass
+        else:
+            raise LinkError('no reply from the board, is the console open?')
+        version = body[0]
+        if version != VERSION:
+            raise LinkError('board has protocol version %d, not %d' % (version, VERSION))
+        version, self.window, self.max_data, self.device_size, self.erase_size, self.bit_rate = \
+            struct.unpack('<BBHIII', body[:16])
+        self.name = body[16:].decode('ascii', 'replace')
+        self.console_rate = self.bit_rate
+
+    def info(self, timeout):
+        self.send(INFO)
+        body = self.expect(INFO_REPLY, timeout)
+        self.bit_rate = struct.unpack('<I', body[12:16])[0]
+
+    def set_rate(self, port, baud):
+        """Move the board and the host to another port and bit rate.
+
+        Returns False, at the old rate, if the board can't make it or
+        nothing is heard at it.
+        """
+        if not self.port.can_baud(baud):
+            return False
+        old = self.bit_rate
+        self.send(RATE, struct.pack('<BI', port, baud))
+        while True:
+            frame = self.receive(1.0)
+            if frame is None:
+                raise LinkError('no reply from the board')
+            if frame[0] == NAK:
+                return False
+            if frame[0] == ACK:
+                break
+        self.port.set_baud(baud)
+        deadline = time.monotonic() + SWITCH_TIMEOUT / 2  # leave time for the reply
+        while time.monotonic() < deadline:
+            try:
+                self.info(0.1)
+                return self.bit_rate == baud
+            except LinkError:
+                pass
+        # the board goes back after LINK_SWITCH_MS
+        self.port.set_baud(old)
+        time.sleep(SWITCH_TIMEOUT)
+        self.rx.clear()
+        self.frames.clear()
+        self.info(1.0)
+        return False
+
+    def quit(self):
+        self.send(QUIT)
+        self.expect(DONE, 2.0)
+        self.port.set_baud(self.console_rate)  # where the board goes back to
+
+    def done(self, data):
+        status, length, crc = struct.unpack('<BII', self.expect(DONE, ERASE_TIMEOUT)[:9])
+        if status:
+            raise LinkError(STATUS_TEXT.get(status, 'error %d' % status))
+        if length != len(data) or crc != zlib.crc32(data):
+            raise LinkError('CRC-32 mismatch, board %08x, host %08x' % (crc, zlib.crc32(data)))
+
+    def dump(self, addr, length):
+        data = bytearray()
+        resends = 0
+        self.send(READ, struct.pack('<II', addr, length))
+        out_of_order = 0
+        while len(data) < length:
+            frame = self.receive(DATA_TIMEOUT)
+            if frame is None:
+                self.send(NAK, struct.pack('<I', len(data)))
+                resends += 1
+                continue
+            frame_type, body = frame
+            if frame_type == DONE:
+                raise LinkError(STATUS_TEXT.get(body[0], 'error %d' % body[0]))
+            if frame_type != DATA:
+                continue
+            offset = struct.unpack('<I', body[:4])[0]
+            if offset == len(data):
+                data += body[4:]
+                out_of_order = 0
+                self.send(ACK, struct.pack('<I', len(data)))
+            elif offset > len(data):
+                if out_of_order % self.window == 0:  # again after a window, in case it was lost
+                    self.send(NAK, struct.pack('<I', len(data)))
+                    resends += 1
+                out_of_order += 1
+        self.done(data)
+        return bytes(data), resends
+
+    def upload(self, addr, data):
+        resends = 0
+        self.send(WRITE, struct.pack('<II', addr, len(data)))
+        while struct.unpack('<I', self.expect(ACK, ERASE_TIMEOUT))[0] != 0:
+            pass
+        sent = acked = 0
+        while acked < len(data):
+            while sent < len(data) and sent - acked < self.window * self.max_data:
+                chunk = data[sent:sent + self.max_data]
+                self.send(DATA, struct.pack('<I', sent) + chunk)
+                sent += len(chunk)
+            frame = self.receive(ACK_TIMEOUT)
+            if frame is None:
+                sent = acked  # go back
+                resends += 1
+                continue
+            frame_type, body = frame
+            if frame_type == DONE:
+                raise LinkError(STATUS_TEXT.get(body[0], 'error %d' % body[0]))
+            offset = struct.unpack('<I', body[:4])[0] if len(body) >= 4 else 0
+            if frame_type == ACK and acked < offset <= sent:
+                acked = offset
+            elif frame_type == NAK and acked <= offset <= sent:
+                sent = offset  # frames before it may still be waiting to be programmed
+                resends += 1
+        self.done(data)
+        return resends
+
+
+def number(s):
+    s = s.lower()
+    scale = 1
+    if s.endswith('k'):
+        s, scale = s[:-1], 1024
+    elif s.endswith('m'):
+        s, scale = s[:-1], 1024 * 1024
+    return int(s, 0) * scale
+
+
+def report(port, verb, length, seconds, resends):
+    """Print the measured throughput against the line rate, 8N1."""
+    rate = length / seconds if seconds else 0
+    text = '%s %d bytes in %.2f s%s, %.1f KiB/s' % (
+        verb, length, seconds, ' simulated' if isinstance(port, SimPort) else '', rate / 1024)
+    text += ' of %.1f KiB/s line rate (%.0f%%)' % (port.line_rate / 1024, 100 * rate / port.line_rate)
+    print(text + ', %d resends, CRC-32 ok' % resends)
+
+
+def rates(link, port, addr, length):
+    """Dump length bytes at each of RATES and upload them back, and report the throughput."""
+    for baud in RATES:
+        if not link.set_rate(PORT_FAST, baud):
+            print('%d: not supported' % baud)
+            continue
+        start = port.clock()
+        try:
+            data, resends = link.dump(addr, length)
+        except LinkError as e:
+            print('%d: %s' % (baud, e))
+            continue
+        print('%d: ' % baud, end='')
+        report(port, 'dumped', len(data), port.clock() - start, resends)
+        start = port.clock()
+        try:
+            resends = link.upload(addr, data)
+        except LinkError as e:
+            print('%d: %s' % (baud, e))
+            continue
+        print('%d: ' % baud, end='')
+        report(port, 'uploaded', len(data), port.clock() - start, resends)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Dump or upload the flash of the demo board')
+    parser.add_argument('-p', '--port', default='/dev/ttyUSB0', help='serial port (default /dev/ttyUSB0)')
+    parser.add_argument('-b', '--baud', type=int, default=9600,
+                        help='console bit rate, SERIAL_BIT_RATE in src/serial.h (default 9600)')
+    parser.add_argument('--fast', type=int, default=921600,
+                        help='bit rate on the fast port for transfers, 0 to stay on the console (default 921600)')
+    parser.add_argument('--sim', action='store_true',
+                        help='run against host/build/flashsim instead of a board')
+    parser.add_argument('--part', help='part for --sim (default the first in spiflash_info_table)')
+    parser.add_argument('--flashsim', default=os.path.join(HERE, '..', 'host', 'build', 'flashsim'),
+                        help=argparse.SUPPRESS)
+    parser.add_argument('command', choices=('info', 'dump', 'upload', 'rates'))
+    parser.add_argument('file', nargs='?')
+    parser.add_argument('addr', nargs='?', type=number, default=0)
+    parser.add_argument('len', nargs='?', type=number)
+    args = parser.parse_args()
+    if args.command == 'rates':
+        args.addr, args.len = (number(args.file) if args.file else 0), args.addr or 64 * 1024
+    elif args.command != 'info' and not args.file:
+        parser.error('%s needs a file' % args.command)
+
+    link = None
+    try:
+        if args.sim:
+            port = SimPort(args.flashsim, args.part, args.baud)
+        else:
+            port = SerialPort(args.port, args.baud)
+        link = Link(port)
+        link.start()
+        print('%s, %d bytes, erase size %d, window %d x %d bytes' %
+              (link.name, link.device_size, link.erase_size, link.window, link.max_data))
+
+        if args.command == 'rates':
+            rates(link, port, args.addr, args.len)
+        elif args.fast and args.command != 'info':
+            if link.set_rate(PORT_FAST, args.fast):
+                print('%d bit/s on the fast port' % args.fast)
+            else:
+                print('can\'t use %d bit/s on the fast port, staying at %d' % (args.fast, link.bit_rate),
+                      file=sys.stderr)
+
+        if args.command == 'dump':
+            length = args.len if args.len is not None else link.device_size - args.addr
+            start = port.clock()
+            data, resends = link.dump(args.addr, length)
+            seconds = port.clock() - start
+            with open(args.file, 'wb') as f:
+                f.write(data)
+            report(port, 'dumped', length, seconds, resends)
+        elif args.command == 'upload':
+            with open(args.file, 'rb') as f:
+                data = f.read()
+            start = port.clock()
+            resends = link.upload(args.addr, data)
+            report(port, 'uploaded', len(data), port.clock() - start, resends)
+
+        link.quit()
+        port.close()
+    except (OSError, LinkError) as e:
+        print(e, file=sys.stderr)
+        if link:
+            try:
+                link.send(QUIT)  # back to the console, rather than after LINK_IDLE_MS
+            except (OSError, LinkError):
+                pass
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
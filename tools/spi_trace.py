@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+#
+# Decode an SPI trace sent by the demo's TRACE menu item or console trace
+# command (or written by host/build/flashsim -t), and print a timeline and
+# per-opcode statistics.
+#
+# The format is described in src/spi_trace.c.
+#
+# usage: spi_trace.py [--summary] [--storm N] trace.bin ...
+
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct('<4sBBHII')
+RECORD = struct.Struct('<IIIHHBB')
+
+FLAG_PREFIX = 0x01
+FLAG_HOLD_CS = 0x02
+FLAG_HALF_DUPLEX = 0x04
+FLAG_SO_WAIT = 0x08
+FLAG_ASYNC = 0x10
+FLAG_DONE = 0x80
+
+TICK_MASK = 0xffffffff
+
+STATUS_OPCODES = (0x05, 0xd7)
+
+OPCODE_NAMES = {
+    0x01: 'WRSR1',
+    0x02: 'PROGRAM',
+    0x03: 'READ_SLOW',
+    0x04: 'WRDI',
+    0x05: 'RDSR',
+    0x06: 'WREN',
+    0x0b: 'READ',
+    0x20: 'ERASE_4K',
+    0x25: 'ASI',
+    0x31: 'WRSR2',
+    0x36: 'PROTECT',
+    0x39: 'UNPROTECT',
+    0x3c: 'RD_PROT',
+    0x3d: 'DF_CONFIG',
+    0x42: 'PAGE_ERASE',
+    0x50: 'DF_BLK_ERASE',
+    0x52: 'ERASE_32K',
+    0x58: 'DF_RMW1',
+    0x59: 'DF_RMW2',
+    0x60: 'CHIP_ERASE',
+    0x77: 'RD_OTP',
+    0x79: 'UDPD',
+    0x7c: 'DF_SEC_ERASE',
+    0x81: 'PAGE_ERASE',
+    0x9b: 'PROG_OTP',
+    0x9f: 'READ_ID',
+    0xab: 'RESUME',
+    0xb9: 'DPD',
+    0xc7: 'CHIP_ERASE',
+    0xd7: 'DF_STATUS',
+    0xd8: 'ERASE_64K',
+    0xf0: 'RESET',
+}
+
+
+class Trace:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        # a console capture has text before the dump
+        start = data.find(b'SPTR')
+        if start > 0:
+            data = data[start:]
+        if len(data) < HEADER.size + 2:
+            raise ValueError('%s: too short' % path)
+        magic, version, record_size, count, self.tick_hz, self.lost = HEADER.unpack_from(data)
+        if magic != b'SPTR' or version != 2 or record_size != RECORD.size:
+            raise ValueError('%s: not an SPI trace, or unknown version' % path)
+        end = HEADER.size + count * record_size
+        if len(data) < end + 2:
+            raise ValueError('%s: truncated' % path)
+        (checksum,) = struct.unpack_from('<H', data, end)
+        if sum(data[:end]) & 0xffff != checksum:
+            raise ValueError('%s: checksum error' % path)
+
+        self.records = []
+        base = 0
+        prev = None
+        for i in range(count):
+            start, addr, latency, tx_len, rx_len, opcode, flags = \
+                RECORD.unpack_from(data, HEADER.size + i * record_size)
+            # unwrap the 32-bit timer count
+            if prev is not None and start < prev:
+                base += TICK_MASK + 1
+            prev = start
+            self.records.append((base + start, addr, tx_len, rx_len, latency, opcode, flags))
+
+    def us(self, ticks):
+        return ticks * 1000000.0 / self.tick_hz
+
+
+def name(opcode, flags):
+    if flags & FLAG_SO_WAIT:
+        return 'SO_WAIT'
+    return OPCODE_NAMES.get(opcode, '0x%02x' % opcode)
+
+
+def flag_text(flags):
+    text = ''
+    text += 'P' if flags & FLAG_PREFIX else '-'
+    text += 'H' if flags & FLAG_HOLD_CS else '-'
+    text += 'D' if flags & FLAG_HALF_DUPLEX else '-'
+    text += 'A' if flags & FLAG_ASYNC else '-'
+    text += '' if flags & FLAG_DONE else '!'
+    return text
+
+
+def print_timeline(trace):
+    print('%10s %10s %-12s %8s %6s %6s %9s  %s' %
+          ('time ms', 'gap us', 'op', 'addr', 'tx', 'rx', 'lat us', 'flags'))
+    t0 = trace.records[0][0]
+    prev_end = None
+    for start, addr, tx_len, rx_len, latency, opcode, flags in trace.records:
+        gap = '' if prev_end is None else '%.0f' % trace.us(start - prev_end)
+        addr_text = '%06x' % addr if tx_len >= 4 else ''
+        lat = '%.0f' % trace.us(latency) if flags & FLAG_DONE else '-'
+        print('%10.3f %10s %-12s %8s %6d %6d %9s  %s' %
+              (trace.us(start - t0) / 1000, gap, name(opcode, flags), addr_text,
+               tx_len, rx_len, lat, flag_text(flags)))
+        prev_end = start + latency
+
+
+def print_stats(trace, storm):
+    stats = {}
+    for start, addr, tx_len, rx_len, latency, opcode, flags in trace.records:
+        key = name(opcode, flags)
+        s = stats.setdefault(key, [0, 0, 0, 0, 0])
+        s[0] += 1
+        s[1] += tx_len
+        s[2] += rx_len
+        s[3] += latency
+        s[4] = max(s[4], latency)
+
+    print('%-12s %6s %9s %9s %10s %10s' % ('op', 'count', 'tx bytes', 'rx bytes', 'mean us', 'max us'))
+    for key in sorted(stats, key=lambda k: -stats[k][0]):
+        count, tx, rx, lat, lat_max = stats[key]
+        print('%-12s %6d %9d %9d %10.0f %10.0f' %
+              (key, count, tx, rx, trace.us(lat) / count, trace.us(lat_max)))
+
+    # runs of back-to-back status reads, i.e. busy polling
+    runs = []
+    run = 0
+    for record in trace.records:
+        if record[5] in STATUS_OPCODES and not record[6] & (FLAG_SO_WAIT | FLAG_PREFIX):
+            run += 1
+        else:
+            if run:
+                runs.append(run)
+            run = 0
+    if run:
+        runs.append(run)
+    storms = [r for r in runs if r >= storm]
+    print('status polls: %d in %d runs, longest %d, %d runs of %d or more' %
+          (sum(runs), len(runs), max(runs) if runs else 0, len(storms), storm))
+
+    first = trace.records[0]
+    last = trace.records[-1]
+    span = last[0] + last[4] - first[0]
+    busy = sum(r[4] for r in trace.records if not r[6] & FLAG_SO_WAIT)
+    print('span %.3f ms, SPI transactions %.0f%% of it' %
+          (trace.us(span) / 1000, 100.0 * busy / span if span else 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode an SPI trace from the flash demo')
+    parser.add_argument('--summary', action='store_true', help='statistics only, no timeline')
+    parser.add_argument('--storm', type=int, default=8, metavar='N',
+                        help='report runs of at least N back-to-back status reads (default 8)')
+    parser.add_argument('files', nargs='+')
+    args = parser.parse_args()
+
+    status = 0
+    for path in args.files:
+        try:
+            trace = Trace(path)
+        except (OSError, ValueError) as e:
+            print(e, file=sys.stderr)
+            status = 1
+            continue
+        print('%s: %d records, %d lost before the dump, %d ticks/s' %
+              (path, len(trace.records), trace.lost, trace.tick_hz))
+        if trace.records:
+            if not args.summary:
+                print_timeline(trace)
+                print()
+            print_stats(trace, args.storm)
+        print()
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())